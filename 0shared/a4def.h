@@ -12,7 +12,9 @@ enum { SUCCESS,
        ALREADY_IN_TREE,
        NO_SUCH_PATH, CONFLICTING_PATH, BAD_PATH,
        NOT_A_DIRECTORY, NOT_A_FILE,
-       MEMORY_ERROR
+       MEMORY_ERROR,
+       IO_ERROR, CORRUPT_FILE,
+       READ_ONLY_TREE, NOT_SUPPORTED
 };
 
 /* In lieu of a proper boolean datatype */
@@ -15,8 +15,19 @@ static const size_t MIN_PHYS_LENGTH = 2;
 
 /*--------------------------------------------------------------------*/
 
+/* The number of elements ahead of the current one whose pointees
+   DynArray_search prefetches. */
+
+static const size_t SEARCH_PREFETCH_DISTANCE = 4;
+
+/*--------------------------------------------------------------------*/
+
 /* A DynArray consists of an array, along with its logical and
-   physical lengths. */
+   physical lengths.  The array is used as a ring buffer: the client's
+   0th element resides at index uFirst of the underlying array, and
+   subsequent elements wrap around to index 0 after the physical end.
+   This makes addition and removal at either end of the DynArray
+   O(1) (amortized). */
 
 struct DynArray
 {
@@ -28,6 +39,10 @@ struct DynArray
       DynArray. */
    size_t uPhysLength;
 
+   /* The index within the underlying array of the client's 0th
+      element. */
+   size_t uFirst;
+
    /* The array that underlies the DynArray. */
    const void **ppvArray;
 };
@@ -43,6 +58,7 @@ static int DynArray_isValid(DynArray_T oDynArray)
 {
    if (oDynArray->uPhysLength < MIN_PHYS_LENGTH) return 0;
    if (oDynArray->uLength > oDynArray->uPhysLength) return 0;
+   if (oDynArray->uFirst >= oDynArray->uPhysLength) return 0;
    if (oDynArray->ppvArray == NULL) return 0;
    return 1;
 }
@@ -51,8 +67,46 @@ static int DynArray_isValid(DynArray_T oDynArray)
 
 /*--------------------------------------------------------------------*/
 
+/* Return the index within the underlying array of oDynArray of the
+   client's uIndex'th element.  uIndex may equal the logical length,
+   in which case the index of the slot just past the last element is
+   returned. */
+
+static size_t DynArray_slot(DynArray_T oDynArray, size_t uIndex)
+{
+   size_t uSlot;
+
+   assert(oDynArray != NULL);
+   assert(uIndex <= oDynArray->uPhysLength);
+
+   uSlot = oDynArray->uFirst + uIndex;
+   if (uSlot >= oDynArray->uPhysLength)
+      uSlot -= oDynArray->uPhysLength;
+   return uSlot;
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Hint to the processor that the memory at pvAddress will be read
+   soon.  This has no effect on the behavior of the program, only on
+   its speed, and does nothing on compilers that offer no way to give
+   such a hint. */
+
+static void DynArray_prefetch(const void *pvAddress)
+{
+#ifdef __GNUC__
+   __builtin_prefetch(pvAddress, 0, 3);
+#else
+   (void)pvAddress;
+#endif
+}
+
+/*--------------------------------------------------------------------*/
+
 /* Increase the physical length of oDynArray.  Return 1 (TRUE) if
-   successful and 0 (FALSE) if insufficient memory is available. */
+   successful and 0 (FALSE) if insufficient memory is available.
+   The elements are moved to the start of the new underlying array,
+   so that afterwards they no longer wrap around. */
 
 static int DynArray_grow(DynArray_T oDynArray)
 {
@@ -60,23 +114,73 @@ static int DynArray_grow(DynArray_T oDynArray)
 
    size_t uNewLength;
    const void **ppvNewArray;
+   size_t u;
 
    assert(oDynArray != NULL);
 
    uNewLength = GROWTH_FACTOR * oDynArray->uPhysLength;
 
-   ppvNewArray = (const void**)
-      realloc(oDynArray->ppvArray, sizeof(void*) * uNewLength);
+   ppvNewArray = (const void**)malloc(sizeof(void*) * uNewLength);
    if (ppvNewArray == NULL)
       return 0;
 
+   for (u = 0; u < oDynArray->uLength; u++)
+      ppvNewArray[u] = oDynArray->ppvArray[DynArray_slot(oDynArray, u)];
+
+   free(oDynArray->ppvArray);
    oDynArray->uPhysLength = uNewLength;
+   oDynArray->uFirst = 0;
    oDynArray->ppvArray = ppvNewArray;
    return 1;
 }
 
 /*--------------------------------------------------------------------*/
 
+/* Reverse the elements of the underlying array of oDynArray that
+   reside at indices uLo...uHi-1. */
+
+static void DynArray_reverse(DynArray_T oDynArray, size_t uLo,
+                             size_t uHi)
+{
+   const void *pvTemp;
+
+   assert(oDynArray != NULL);
+   assert(uLo <= uHi);
+   assert(uHi <= oDynArray->uPhysLength);
+
+   while (uLo + 1 < uHi)
+   {
+      uHi--;
+      pvTemp = oDynArray->ppvArray[uLo];
+      oDynArray->ppvArray[uLo] = oDynArray->ppvArray[uHi];
+      oDynArray->ppvArray[uHi] = pvTemp;
+      uLo++;
+   }
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Rearrange the underlying array of oDynArray so that its elements
+   reside contiguously, in order, starting at index 0. */
+
+static void DynArray_linearize(DynArray_T oDynArray)
+{
+   assert(oDynArray != NULL);
+
+   if (oDynArray->uFirst == 0)
+      return;
+
+   /* Rotate the whole underlying array left by uFirst positions
+      using three reversals; this needs no extra memory. */
+   DynArray_reverse(oDynArray, 0, oDynArray->uFirst);
+   DynArray_reverse(oDynArray, oDynArray->uFirst,
+                    oDynArray->uPhysLength);
+   DynArray_reverse(oDynArray, 0, oDynArray->uPhysLength);
+   oDynArray->uFirst = 0;
+}
+
+/*--------------------------------------------------------------------*/
+
 DynArray_T DynArray_new(size_t uLength)
 {
    DynArray_T oDynArray;
@@ -86,6 +190,7 @@ DynArray_T DynArray_new(size_t uLength)
       return NULL;
 
    oDynArray->uLength = uLength;
+   oDynArray->uFirst = 0;
    if (uLength > MIN_PHYS_LENGTH)
       oDynArray->uPhysLength = uLength;
    else
@@ -131,11 +236,24 @@ void *DynArray_get(DynArray_T oDynArray, size_t uIndex)
    assert(uIndex < oDynArray->uLength);
    assert(DynArray_isValid(oDynArray));
 
+   uIndex = DynArray_slot(oDynArray, uIndex);
    return (void*)(oDynArray->ppvArray)[uIndex];
 }
 
 /*--------------------------------------------------------------------*/
 
+void DynArray_prefetchElement(DynArray_T oDynArray, size_t uIndex)
+{
+   assert(oDynArray != NULL);
+   assert(uIndex < oDynArray->uLength);
+   assert(DynArray_isValid(oDynArray));
+
+   DynArray_prefetch(
+      &oDynArray->ppvArray[DynArray_slot(oDynArray, uIndex)]);
+}
+
+/*--------------------------------------------------------------------*/
+
 void *DynArray_set(DynArray_T oDynArray, size_t uIndex,
                    const void *pvElement)
 {
@@ -145,6 +263,7 @@ void *DynArray_set(DynArray_T oDynArray, size_t uIndex,
    assert(uIndex < oDynArray->uLength);
    assert(DynArray_isValid(oDynArray));
 
+   uIndex = DynArray_slot(oDynArray, uIndex);
    pvOldElement = oDynArray->ppvArray[uIndex];
    oDynArray->ppvArray[uIndex] = pvElement;
 
@@ -164,7 +283,8 @@ int DynArray_add(DynArray_T oDynArray, const void *pvElement)
       if (! DynArray_grow(oDynArray))
          return 0;
 
-   oDynArray->ppvArray[oDynArray->uLength] = pvElement;
+   oDynArray->ppvArray[DynArray_slot(oDynArray, oDynArray->uLength)] =
+      pvElement;
    oDynArray->uLength++;
 
    assert(DynArray_isValid(oDynArray));
@@ -187,10 +307,23 @@ int DynArray_addAt(DynArray_T oDynArray, size_t uIndex,
       if (! DynArray_grow(oDynArray))
          return 0;
 
-   for (u = oDynArray->uLength; u > uIndex; u--)
-      oDynArray->ppvArray[u] = oDynArray->ppvArray[u-1];
+   /* Shift whichever side of uIndex holds fewer elements. */
+   if (uIndex < oDynArray->uLength / 2)
+   {
+      if (oDynArray->uFirst == 0)
+         oDynArray->uFirst = oDynArray->uPhysLength - 1;
+      else
+         oDynArray->uFirst--;
+      for (u = 0; u < uIndex; u++)
+         oDynArray->ppvArray[DynArray_slot(oDynArray, u)] =
+            oDynArray->ppvArray[DynArray_slot(oDynArray, u+1)];
+   }
+   else
+      for (u = oDynArray->uLength; u > uIndex; u--)
+         oDynArray->ppvArray[DynArray_slot(oDynArray, u)] =
+            oDynArray->ppvArray[DynArray_slot(oDynArray, u-1)];
 
-   oDynArray->ppvArray[uIndex] = pvElement;
+   oDynArray->ppvArray[DynArray_slot(oDynArray, uIndex)] = pvElement;
    oDynArray->uLength++;
 
    assert(DynArray_isValid(oDynArray));
@@ -209,12 +342,24 @@ void *DynArray_removeAt(DynArray_T oDynArray, size_t uIndex)
    assert(uIndex < oDynArray->uLength);
    assert(DynArray_isValid(oDynArray));
 
-   pvOldElement = oDynArray->ppvArray[uIndex];
+   pvOldElement = oDynArray->ppvArray[DynArray_slot(oDynArray, uIndex)];
 
-   oDynArray->uLength--;
+   /* Shift whichever side of uIndex holds fewer elements. */
+   if (uIndex < oDynArray->uLength / 2)
+   {
+      for (u = uIndex; u > 0; u--)
+         oDynArray->ppvArray[DynArray_slot(oDynArray, u)] =
+            oDynArray->ppvArray[DynArray_slot(oDynArray, u-1)];
+      oDynArray->uFirst = DynArray_slot(oDynArray, 1);
+   }
+   else
+      for (u = uIndex; u + 1 < oDynArray->uLength; u++)
+         oDynArray->ppvArray[DynArray_slot(oDynArray, u)] =
+            oDynArray->ppvArray[DynArray_slot(oDynArray, u+1)];
 
-   for (u = uIndex; u < oDynArray->uLength; u++)
-      oDynArray->ppvArray[u] = oDynArray->ppvArray[u+1];
+   oDynArray->uLength--;
+   if (oDynArray->uLength == 0)
+      oDynArray->uFirst = 0;
 
    assert(DynArray_isValid(oDynArray));
 
@@ -232,7 +377,8 @@ void DynArray_toArray(DynArray_T oDynArray, void **ppvArray)
    assert(DynArray_isValid(oDynArray));
 
    for (u = 0; u < oDynArray->uLength; u++)
-      ppvArray[u] = (void*)oDynArray->ppvArray[u];
+      ppvArray[u] =
+         (void*)oDynArray->ppvArray[DynArray_slot(oDynArray, u)];
 }
 
 /*--------------------------------------------------------------------*/
@@ -248,7 +394,44 @@ void DynArray_map(DynArray_T oDynArray,
    assert(DynArray_isValid(oDynArray));
 
    for (u = 0; u < oDynArray->uLength; u++)
-      (*pfApply)((void*)oDynArray->ppvArray[u], (void*)pvExtra);
+      (*pfApply)((void*)oDynArray->ppvArray[DynArray_slot(oDynArray, u)],
+                 (void*)pvExtra);
+}
+
+/*--------------------------------------------------------------------*/
+
+size_t DynArray_mapUntil(DynArray_T oDynArray,
+                         int (*pfVisit)(void *pvElement,
+                                        void *pvExtra),
+                         const void *pvExtra,
+                         size_t uPrefetchDistance)
+{
+   size_t u;
+
+   assert(oDynArray != NULL);
+   assert(pfVisit != NULL);
+   assert(DynArray_isValid(oDynArray));
+
+   /* Start the first uPrefetchDistance loads before visiting
+      anything, so that they are in flight by the time they are
+      needed. */
+   if (uPrefetchDistance > 0)
+      for (u = 0; u < uPrefetchDistance && u < oDynArray->uLength; u++)
+         DynArray_prefetch(
+            oDynArray->ppvArray[DynArray_slot(oDynArray, u)]);
+
+   for (u = 0; u < oDynArray->uLength; u++)
+   {
+      if (uPrefetchDistance > 0 &&
+          u + uPrefetchDistance < oDynArray->uLength)
+         DynArray_prefetch(oDynArray->ppvArray[
+            DynArray_slot(oDynArray, u + uPrefetchDistance)]);
+      if ((*pfVisit)((void*)oDynArray->ppvArray[
+                        DynArray_slot(oDynArray, u)],
+                     (void*)pvExtra))
+         return u;
+   }
+   return oDynArray->uLength;
 }
 
 /*--------------------------------------------------------------------*/
@@ -322,6 +505,7 @@ void DynArray_sort(DynArray_T oDynArray,
    if (oDynArray->uLength < 2)
       return;
 
+   DynArray_linearize(oDynArray);
    DynArray_qsort(
       &oDynArray->ppvArray[0],
       &oDynArray->ppvArray[oDynArray->uLength-1],
@@ -346,11 +530,17 @@ int DynArray_search(DynArray_T oDynArray,
    assert(DynArray_isValid(oDynArray));
 
    for (u = 0; u < oDynArray->uLength; u++)
-      if ((*pfCompare)(oDynArray->ppvArray[u], pvSoughtElement) == 0)
+   {
+      if (u + SEARCH_PREFETCH_DISTANCE < oDynArray->uLength)
+         DynArray_prefetch(oDynArray->ppvArray[
+            DynArray_slot(oDynArray, u + SEARCH_PREFETCH_DISTANCE)]);
+      if ((*pfCompare)(oDynArray->ppvArray[DynArray_slot(oDynArray, u)],
+                       pvSoughtElement) == 0)
       {
          *puIndex = u;
          return 1;
       }
+   }
    return 0;
 }
 
@@ -358,45 +548,49 @@ int DynArray_search(DynArray_T oDynArray,
 
 /*--------------------------------------------------------------------*/
 
-/* Binary search the array of elements that resides in memory at
-   addresses ppvLo...ppvHi for pvSoughtElement.
+/* Binary search the elements of oDynArray at (client) indices
+   uLo...uHi-1 for pvSoughtElement.
    *pfCompare must return <0, 0, or >0 depending upon whether
    *pvElement1 is less than, equal to, or greater than *pvElement2,
-   respectively. If pvSoughtElement is not found, *pppvInsert is set to
-   point at the memory location where it would be placed if inserted.
-*/
-
-static const void **DynArray_bsearchHelp(
+   respectively. Return 1 and assign the index of the element to
+   *puIndex if pvSoughtElement is found. Otherwise return 0 and assign
+   to *puIndex the index where it would be placed if inserted.
+   This function does not modify oDynArray, so that it may safely be
+   called on a DynArray that is shared by concurrent readers. */
+
+static int DynArray_bsearchHelp(
+   DynArray_T oDynArray,
    void *pvSoughtElement,
-   const void **ppvLo,
-   const void **ppvHi,
+   size_t uLo,
+   size_t uHi,
    int (*pfCompare)(const void *pvElement1, const void *pvElement2),
-   const void*** pppvInsert)
+   size_t *puIndex)
 {
-   /* This function uses pointers instead of indices to avoid
-      complications with using unsigned integers as array indices. */
-
-   const void **ppvMid;
+   size_t uMid;
    int iCompare;
 
-   assert(ppvLo != NULL);
-   assert(ppvHi != NULL);
+   assert(oDynArray != NULL);
    assert(pfCompare != NULL);
-   assert(pppvInsert != NULL);
+   assert(puIndex != NULL);
 
-   while (ppvLo <= ppvHi)
+   while (uLo < uHi)
    {
-      ppvMid = ppvLo + ((ppvHi - ppvLo) / 2);
-      iCompare = (*pfCompare)(*ppvMid, pvSoughtElement);
+      uMid = uLo + ((uHi - uLo) / 2);
+      iCompare = (*pfCompare)(
+         oDynArray->ppvArray[DynArray_slot(oDynArray, uMid)],
+         pvSoughtElement);
       if (iCompare > 0)
-         ppvHi = ppvMid - 1;
+         uHi = uMid;
       else if (iCompare < 0)
-         ppvLo = ppvMid + 1;
+         uLo = uMid + 1;
       else
-         return ppvMid;
+      {
+         *puIndex = uMid;
+         return 1;
+      }
    }
-   *pppvInsert = ppvLo;
-   return NULL;
+   *puIndex = uLo;
+   return 0;
 }
 
 /*--------------------------------------------------------------------*/
@@ -407,31 +601,12 @@ int DynArray_bsearch(DynArray_T oDynArray,
                      int (*pfCompare)(const void *pvElement1,
                                       const void *pvElement2))
 {
-   const void **ppvElement;
-   const void **ppvInsert = NULL;
-
    assert(oDynArray != NULL);
    assert(puIndex != NULL);
    assert(pfCompare != NULL);
    assert(DynArray_isValid(oDynArray));
 
-   if (oDynArray->uLength == 0) {
-      *puIndex = 0;
-      return 0;
-   }
-
-   ppvElement = DynArray_bsearchHelp(
-      pvSoughtElement,
-      &oDynArray->ppvArray[0],
-      &oDynArray->ppvArray[oDynArray->uLength-1],
-      pfCompare,
-      &ppvInsert);
-
-   if (ppvElement == NULL) {
-      *puIndex = (size_t)(ppvInsert - &oDynArray->ppvArray[0]);
-      return 0;
-   }
-
-   *puIndex = (size_t)(ppvElement - &oDynArray->ppvArray[0]);
-   return 1;
-}
\ No newline at end of file
+   return DynArray_bsearchHelp(oDynArray, pvSoughtElement,
+                               0, oDynArray->uLength,
+                               pfCompare, puIndex);
+}
@@ -9,7 +9,9 @@
 #include <stddef.h>
 
 /* A DynArray_T object is an array whose length can expand
-   dynamically. */
+   dynamically.  Adding an element to, or removing an element from,
+   either end of a DynArray_T object takes O(1) amortized time, so a
+   DynArray_T object may also be used as a deque. */
 
 typedef struct DynArray *DynArray_T;
 
@@ -40,6 +42,15 @@ void *DynArray_get(DynArray_T oDynArray, size_t uIndex);
 
 /*--------------------------------------------------------------------*/
 
+/* Start loading the slot that holds the uIndex'th element of
+   oDynArray into the cache, without waiting for it, so that a later
+   DynArray_get of that element does not stall.  This has no effect on
+   the behavior of the program, only on its speed. */
+
+void DynArray_prefetchElement(DynArray_T oDynArray, size_t uIndex);
+
+/*--------------------------------------------------------------------*/
+
 /* Assign pvElement to the uIndex'th element of oDynArray.  Return the
    old element. */
 
@@ -58,14 +69,18 @@ int DynArray_add(DynArray_T oDynArray, const void *pvElement);
 
 /* Add pvElement to oDynArray such that it is the uIndex'th element.
    Return 1 (TRUE) if successful, or 0 (FALSE) if insufficient memory
-   is available. */
+   is available.  The elements on whichever side of uIndex is shorter
+   are shifted, so adding at index 0 is as cheap as adding at the
+   end. */
 
 int DynArray_addAt(DynArray_T oDynArray, size_t uIndex,
                    const void *pvElement);
 
 /*--------------------------------------------------------------------*/
 
-/* Remove and return the uIndex'th element of oDynArray. */
+/* Remove and return the uIndex'th element of oDynArray.  The elements
+   on whichever side of uIndex is shorter are shifted, so removing the
+   0th element is as cheap as removing the last. */
 
 void *DynArray_removeAt(DynArray_T oDynArray, size_t uIndex);
 
@@ -89,6 +104,24 @@ void DynArray_map(DynArray_T oDynArray,
 
 /*--------------------------------------------------------------------*/
 
+/* Apply function *pfVisit to the elements of oDynArray in order,
+   passing pvExtra as an extra argument, until *pfVisit returns
+   non-0 (TRUE).  Return the index of the element for which *pfVisit
+   returned non-0, or the length of oDynArray if it never did.
+   While element k is being visited, the memory that element
+   k+uPrefetchDistance points to is prefetched into the cache, which
+   hides much of the latency of walking an array of pointers to
+   objects that are scattered in memory.  If uPrefetchDistance is 0,
+   nothing is prefetched. */
+
+size_t DynArray_mapUntil(DynArray_T oDynArray,
+                         int (*pfVisit)(void *pvElement,
+                                        void *pvExtra),
+                         const void *pvExtra,
+                         size_t uPrefetchDistance);
+
+/*--------------------------------------------------------------------*/
+
 /* Sort oDynArray in the order determined by *pfCompare.
    *pfCompare must return <0, 0, or >0 depending upon whether
    *pvElement1 is less than, equal to, or greater than *pvElement2,
@@ -0,0 +1,286 @@
+/*--------------------------------------------------------------------*/
+/* dynarraypar.c                                                      */
+/* Author: Ishaan Javali & Jack Zhang                                 */
+/*--------------------------------------------------------------------*/
+
+#include "dynarraypar.h"
+#include <assert.h>
+#include <stdlib.h>
+#include <string.h>
+
+/*--------------------------------------------------------------------*/
+
+/* The arguments of one DynArray_mapParallel call. */
+
+struct MapJob
+{
+   /* The DynArray being mapped. */
+   DynArray_T oDynArray;
+
+   /* The function to apply, and its extra argument. */
+   void (*pfApply)(void *pvElement, void *pvExtra);
+   void *pvExtra;
+};
+
+/*--------------------------------------------------------------------*/
+
+/* Apply the function of the MapJob pointed to by pvJob to its
+   elements at indices uLo...uHi-1; a ThreadPool_parallelFor body. */
+
+static void DynArray_mapRange(size_t uLo, size_t uHi, void *pvJob)
+{
+   struct MapJob *psJob = (struct MapJob*)pvJob;
+   size_t u;
+
+   assert(psJob != NULL);
+
+   for (u = uLo; u < uHi; u++)
+      (*psJob->pfApply)(DynArray_get(psJob->oDynArray, u),
+                        psJob->pvExtra);
+}
+
+/*--------------------------------------------------------------------*/
+
+void DynArray_mapParallel(DynArray_T oDynArray,
+                          void (*pfApply)(void *pvElement,
+                                          void *pvExtra),
+                          const void *pvExtra,
+                          ThreadPool_T oPool, size_t uChunkSize)
+{
+   struct MapJob sJob;
+
+   assert(oDynArray != NULL);
+   assert(pfApply != NULL);
+
+   if (oPool == NULL)
+   {
+      DynArray_map(oDynArray, pfApply, pvExtra);
+      return;
+   }
+
+   sJob.oDynArray = oDynArray;
+   sJob.pfApply = pfApply;
+   sJob.pvExtra = (void*)pvExtra;
+   ThreadPool_parallelFor(oPool, DynArray_getLength(oDynArray),
+                          DynArray_mapRange, &sJob, uChunkSize);
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Merge the sorted runs ppvSrc[uLo...uMid-1] and ppvSrc[uMid...uHi-1]
+   into ppvDst[uLo...uHi-1], in the order determined by *pfCompare.
+   Take from the left run on ties, so that equal elements keep their
+   order. */
+
+static void DynArray_merge(
+   const void **ppvSrc, const void **ppvDst,
+   size_t uLo, size_t uMid, size_t uHi,
+   int (*pfCompare)(const void *pvElement1, const void *pvElement2))
+{
+   size_t uLeft = uLo;
+   size_t uRight = uMid;
+   size_t uOut = uLo;
+
+   assert(ppvSrc != NULL);
+   assert(ppvDst != NULL);
+   assert(pfCompare != NULL);
+
+   while (uLeft < uMid && uRight < uHi)
+   {
+      if ((*pfCompare)(ppvSrc[uRight], ppvSrc[uLeft]) < 0)
+         ppvDst[uOut++] = ppvSrc[uRight++];
+      else
+         ppvDst[uOut++] = ppvSrc[uLeft++];
+   }
+   while (uLeft < uMid)
+      ppvDst[uOut++] = ppvSrc[uLeft++];
+   while (uRight < uHi)
+      ppvDst[uOut++] = ppvSrc[uRight++];
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Sort the elements at ppvDst[uLo...uHi-1] in the order determined by
+   *pfCompare, using ppvSrc[uLo...uHi-1], which must hold the same
+   elements in the same order, as scratch space. This is a top-down
+   merge sort that alternates the roles of the two arrays at each
+   level, so that no element is copied except by a merge. */
+
+static void DynArray_mergeSort(
+   const void **ppvSrc, const void **ppvDst,
+   size_t uLo, size_t uHi,
+   int (*pfCompare)(const void *pvElement1, const void *pvElement2))
+{
+   size_t uMid;
+
+   assert(ppvSrc != NULL);
+   assert(ppvDst != NULL);
+   assert(pfCompare != NULL);
+
+   if (uHi - uLo < 2)
+      return;
+
+   uMid = uLo + (uHi - uLo) / 2;
+   DynArray_mergeSort(ppvDst, ppvSrc, uLo, uMid, pfCompare);
+   DynArray_mergeSort(ppvDst, ppvSrc, uMid, uHi, pfCompare);
+   DynArray_merge(ppvSrc, ppvDst, uLo, uMid, uHi, pfCompare);
+}
+
+/*--------------------------------------------------------------------*/
+
+/* One unit of work of DynArray_sortParallel: either sort the elements
+   at ppvDst[uLo...uHi-1], using ppvSrc as scratch space (if iMerge is
+   0), or merge the sorted runs ppvSrc[uLo...uMid-1] and
+   ppvSrc[uMid...uHi-1] into ppvDst[uLo...uHi-1] (if iMerge is 1). */
+
+struct SortTask
+{
+   int iMerge;
+   const void **ppvSrc;
+   const void **ppvDst;
+   size_t uLo;
+   size_t uMid;
+   size_t uHi;
+   int (*pfCompare)(const void *pvElement1, const void *pvElement2);
+};
+
+/*--------------------------------------------------------------------*/
+
+/* Perform the SortTasks at indices uLo...uHi-1 of the array pointed
+   to by pvTasks; a ThreadPool_parallelFor body. */
+
+static void DynArray_sortRange(size_t uLo, size_t uHi, void *pvTasks)
+{
+   struct SortTask *psTasks = (struct SortTask*)pvTasks;
+   struct SortTask *psTask;
+   size_t u;
+
+   assert(psTasks != NULL);
+
+   for (u = uLo; u < uHi; u++)
+   {
+      psTask = &psTasks[u];
+      if (psTask->iMerge)
+         DynArray_merge(psTask->ppvSrc, psTask->ppvDst, psTask->uLo,
+                        psTask->uMid, psTask->uHi, psTask->pfCompare);
+      else
+         DynArray_mergeSort(psTask->ppvSrc, psTask->ppvDst,
+                            psTask->uLo, psTask->uHi,
+                            psTask->pfCompare);
+   }
+}
+
+/*--------------------------------------------------------------------*/
+
+void DynArray_sortParallel(DynArray_T oDynArray,
+                           int (*pfCompare)(const void *pvElement1,
+                                            const void *pvElement2),
+                           ThreadPool_T oPool)
+{
+   struct SortTask *psTasks;
+   size_t *puBounds;
+   const void **ppvArray;
+   const void **ppvTemp;
+   const void **ppvSrc;
+   const void **ppvDst;
+   size_t uLength;
+   size_t uRuns;
+   size_t uTasks;
+   size_t uExtra;
+   size_t uThreads;
+   size_t u;
+
+   assert(oDynArray != NULL);
+   assert(pfCompare != NULL);
+
+   uLength = DynArray_getLength(oDynArray);
+
+   /* One slice for each worker and one for the calling thread. */
+   uThreads = oPool == NULL ? 1 : ThreadPool_getWorkers(oPool) + 1;
+   if (uThreads > uLength / 2)
+      uThreads = uLength / 2;
+   if (uThreads < 2)
+   {
+      DynArray_sort(oDynArray, pfCompare);
+      return;
+   }
+
+   psTasks =
+      (struct SortTask*)calloc(uThreads, sizeof(struct SortTask));
+   puBounds = (size_t*)calloc(uThreads + 1, sizeof(size_t));
+   ppvArray = (const void**)malloc(sizeof(void*) * uLength);
+   ppvTemp = (const void**)malloc(sizeof(void*) * uLength);
+   if (psTasks == NULL || puBounds == NULL || ppvArray == NULL ||
+       ppvTemp == NULL)
+   {
+      free(psTasks);
+      free(puBounds);
+      free((void*)ppvArray);
+      free((void*)ppvTemp);
+      DynArray_sort(oDynArray, pfCompare);
+      return;
+   }
+
+   DynArray_toArray(oDynArray, (void**)ppvArray);
+   (void)memcpy((void*)ppvTemp, (void*)ppvArray,
+                sizeof(void*) * uLength);
+
+   /* Sort uThreads slices of nearly equal length in parallel. */
+   uRuns = uThreads;
+   uExtra = uLength % uRuns;
+   for (u = 0; u <= uRuns; u++)
+      puBounds[u] = uLength / uRuns * u + (u < uExtra ? u : uExtra);
+   for (u = 0; u < uRuns; u++)
+   {
+      psTasks[u].iMerge = 0;
+      psTasks[u].ppvSrc = ppvTemp;
+      psTasks[u].ppvDst = ppvArray;
+      psTasks[u].uLo = puBounds[u];
+      psTasks[u].uMid = puBounds[u+1];
+      psTasks[u].uHi = puBounds[u+1];
+      psTasks[u].pfCompare = pfCompare;
+   }
+   ThreadPool_parallelFor(oPool, uRuns, DynArray_sortRange, psTasks, 1);
+
+   /* Merge adjacent pairs of runs in parallel, halving the number
+      of runs each round, alternating between the two buffers. An
+      unpaired last run is "merged" with an empty run, which copies
+      it to the other buffer. */
+   ppvSrc = ppvArray;
+   ppvDst = ppvTemp;
+   while (uRuns > 1)
+   {
+      uTasks = 0;
+      for (u = 0; u < uRuns; u += 2)
+      {
+         psTasks[uTasks].iMerge = 1;
+         psTasks[uTasks].ppvSrc = ppvSrc;
+         psTasks[uTasks].ppvDst = ppvDst;
+         psTasks[uTasks].uLo = puBounds[u];
+         psTasks[uTasks].uMid = puBounds[u+1];
+         if (u + 1 < uRuns)
+            psTasks[uTasks].uHi = puBounds[u+2];
+         else
+            psTasks[uTasks].uHi = puBounds[u+1];
+         psTasks[uTasks].pfCompare = pfCompare;
+         puBounds[uTasks] = puBounds[u];
+         uTasks++;
+      }
+      puBounds[uTasks] = uLength;
+
+      ThreadPool_parallelFor(oPool, uTasks, DynArray_sortRange, psTasks,
+                             1);
+
+      uRuns = uTasks;
+      ppvSrc = ppvDst;
+      ppvDst = (ppvSrc == ppvTemp) ? ppvArray : ppvTemp;
+   }
+
+   for (u = 0; u < uLength; u++)
+      (void)DynArray_set(oDynArray, u, ppvSrc[u]);
+
+   free(psTasks);
+   free(puBounds);
+   free((void*)ppvArray);
+   free((void*)ppvTemp);
+}
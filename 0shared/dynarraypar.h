@@ -0,0 +1,53 @@
+/*--------------------------------------------------------------------*/
+/* dynarraypar.h                                                      */
+/* Author: Ishaan Javali & Jack Zhang                                 */
+/*--------------------------------------------------------------------*/
+
+#ifndef DYNARRAYPAR_INCLUDED
+#define DYNARRAYPAR_INCLUDED
+
+#include <stddef.h>
+#include "dynarray.h"
+#include "threadpool.h"
+
+/* Variants of DynArray_map and DynArray_sort that spread their work
+   over the threads of a ThreadPool_T. They use only the DynArray
+   interface, so that clients of DynArray_T that never use a pool do
+   not have to link with one. */
+
+/*--------------------------------------------------------------------*/
+
+/* Apply function *pfApply to each element of oDynArray, passing
+   pvExtra as an extra argument, exactly as DynArray_map does, but
+   using the calling thread and the workers of oPool (see
+   ThreadPool_parallelFor), or only the calling thread if oPool is
+   NULL. The elements are split into ranges of at most uChunkSize; if
+   uChunkSize is 0, a chunk size is chosen automatically. *pfApply is
+   called exactly once per element, but possibly concurrently and in
+   no particular order, so it must be safe to call from several
+   threads at once. oDynArray must not be changed until
+   DynArray_mapParallel returns. */
+
+void DynArray_mapParallel(DynArray_T oDynArray,
+                          void (*pfApply)(void *pvElement,
+                                          void *pvExtra),
+                          const void *pvExtra,
+                          ThreadPool_T oPool, size_t uChunkSize);
+
+/*--------------------------------------------------------------------*/
+
+/* Sort oDynArray in the order determined by *pfCompare, as
+   DynArray_sort does, but using the calling thread and the workers of
+   oPool, or only the calling thread if oPool is NULL: each thread
+   merge sorts one slice of a copy of oDynArray, and the sorted slices
+   are then merged pairwise in parallel. *pfCompare may be called
+   concurrently, so it must be safe to call from several threads at
+   once. If there is insufficient memory for the copy, oDynArray is
+   sorted by DynArray_sort instead. */
+
+void DynArray_sortParallel(DynArray_T oDynArray,
+                           int (*pfCompare)(const void *pvElement1,
+                                            const void *pvElement2),
+                           ThreadPool_T oPool);
+
+#endif
@@ -0,0 +1,261 @@
+/*--------------------------------------------------------------------*/
+/* epoch.c                                                            */
+/* Author: Ishaan Javali & Jack Zhang                                 */
+/*--------------------------------------------------------------------*/
+
+/* for pthread_key_t and sched_yield, which C90 mode does not expose
+   by default */
+#define _POSIX_C_SOURCE 200112L
+
+#include <assert.h>
+#include <stdlib.h>
+#include <pthread.h>
+#include <sched.h>
+#include "epoch.h"
+
+/* How many objects may await reclamation before Epoch_retire tries to
+   advance the epoch and free some of them. */
+static const size_t RECLAIM_THRESHOLD = 64;
+
+/*
+  The per-thread state of a reader. Records are never freed: when a
+  thread exits, its record is marked unused and may be adopted by a
+  later thread.
+*/
+struct record {
+   /* the global epoch observed when the thread entered its outermost
+      critical section, or 0 if it is not in one */
+   unsigned long ulEpoch;
+   /* the depth of the thread's nested critical sections */
+   size_t uDepth;
+   /* 1 if a thread owns the record, 0 if it is free to adopt */
+   int iInUse;
+   /* the next record in the list of all records */
+   struct record *psNext;
+};
+
+/* An object that has been retired but not yet freed. */
+struct retired {
+   /* the object itself */
+   void *pvObject;
+   /* the function that frees it */
+   void (*pfFree)(void *pvObject);
+   /* the global epoch when it was retired */
+   unsigned long ulEpoch;
+   /* the next older retired object */
+   struct retired *psNext;
+};
+
+/*
+  The reclamation state is an AO with 6 state variables:
+*/
+
+/* 1. the global epoch, which starts at 1 so that 0 can mean
+      "quiescent" in a record */
+static unsigned long ulGlobalEpoch = 1;
+/* 2. the list of every thread's record, to which records are only
+      ever prepended */
+static struct record *psRecords = NULL;
+/* 3. the key under which each thread finds its own record */
+static pthread_key_t oRecordKey;
+/* 4. ensures that oRecordKey is created exactly once */
+static pthread_once_t oKeyOnce = PTHREAD_ONCE_INIT;
+/* 5. the retired objects, newest first, and how many there are */
+static struct retired *psLimbo = NULL;
+static size_t uLimboLength = 0;
+/* 6. a lock serializing changes to the global epoch and to the list
+      of retired objects */
+static pthread_mutex_t oLimboLock = PTHREAD_MUTEX_INITIALIZER;
+
+/*
+  Releases the record pvRecord of a thread that is exiting, so that
+  another thread may adopt it.
+*/
+static void Epoch_releaseRecord(void *pvRecord) {
+   struct record *psRecord = pvRecord;
+
+   assert(psRecord != NULL);
+
+   __atomic_store_n(&psRecord->ulEpoch, 0UL, __ATOMIC_RELEASE);
+   psRecord->uDepth = 0;
+   __atomic_store_n(&psRecord->iInUse, 0, __ATOMIC_RELEASE);
+}
+
+/* Creates the key under which each thread finds its own record. */
+static void Epoch_createKey(void) {
+   (void) pthread_key_create(&oRecordKey, Epoch_releaseRecord);
+}
+
+/*
+  Returns the calling thread's record, adopting an unused one or
+  allocating a new one if the thread does not have one yet. Returns
+  NULL if memory could not be allocated.
+*/
+static struct record *Epoch_getRecord(void) {
+   struct record *psRecord;
+   int iFree;
+
+   (void) pthread_once(&oKeyOnce, Epoch_createKey);
+   psRecord = pthread_getspecific(oRecordKey);
+   if(psRecord != NULL)
+      return psRecord;
+
+   /* adopt the record of a thread that has exited, if any */
+   for(psRecord = __atomic_load_n(&psRecords, __ATOMIC_ACQUIRE);
+       psRecord != NULL; psRecord = psRecord->psNext) {
+      iFree = 0;
+      if(__atomic_compare_exchange_n(&psRecord->iInUse, &iFree, 1, 0,
+                                     __ATOMIC_ACQ_REL,
+                                     __ATOMIC_RELAXED))
+         break;
+   }
+
+   if(psRecord == NULL) {
+      psRecord = malloc(sizeof(struct record));
+      if(psRecord == NULL)
+         return NULL;
+      psRecord->ulEpoch = 0;
+      psRecord->uDepth = 0;
+      psRecord->iInUse = 1;
+      psRecord->psNext = __atomic_load_n(&psRecords, __ATOMIC_RELAXED);
+      while(!__atomic_compare_exchange_n(&psRecords, &psRecord->psNext,
+                                         psRecord, 0, __ATOMIC_RELEASE,
+                                         __ATOMIC_RELAXED))
+         ;
+   }
+
+   if(pthread_setspecific(oRecordKey, psRecord) != 0) {
+      __atomic_store_n(&psRecord->iInUse, 0, __ATOMIC_RELEASE);
+      return NULL;
+   }
+   return psRecord;
+}
+
+/*
+  Advances the global epoch if every thread in a critical section has
+  observed its current value. Then detaches from the list of retired
+  objects those that were retired at least two epochs ago, which no
+  reader can still see, and returns them. The caller must hold
+  oLimboLock.
+*/
+static struct retired *Epoch_collect(void) {
+   struct record *psRecord;
+   struct retired *psFreeable;
+   struct retired *psCurr;
+   struct retired **ppsLink;
+   unsigned long ulEpoch;
+   unsigned long ulSeen;
+
+   ulEpoch = __atomic_load_n(&ulGlobalEpoch, __ATOMIC_SEQ_CST);
+   for(psRecord = __atomic_load_n(&psRecords, __ATOMIC_ACQUIRE);
+       psRecord != NULL; psRecord = psRecord->psNext) {
+      ulSeen = __atomic_load_n(&psRecord->ulEpoch, __ATOMIC_SEQ_CST);
+      if(ulSeen != 0 && ulSeen != ulEpoch)
+         break;
+   }
+   if(psRecord == NULL) {
+      ulEpoch++;
+      __atomic_store_n(&ulGlobalEpoch, ulEpoch, __ATOMIC_SEQ_CST);
+   }
+
+   /* the list is ordered newest first, so the objects old enough to
+      free form a suffix of it */
+   ppsLink = &psLimbo;
+   while(*ppsLink != NULL && (*ppsLink)->ulEpoch + 2 > ulEpoch)
+      ppsLink = &(*ppsLink)->psNext;
+   psFreeable = *ppsLink;
+   *ppsLink = NULL;
+   for(psCurr = psFreeable; psCurr != NULL; psCurr = psCurr->psNext)
+      uLimboLength--;
+   return psFreeable;
+}
+
+/* Frees every object in the list psFreeable, and the list itself. */
+static void Epoch_free(struct retired *psFreeable) {
+   struct retired *psNext;
+
+   while(psFreeable != NULL) {
+      psNext = psFreeable->psNext;
+      (*psFreeable->pfFree)(psFreeable->pvObject);
+      free(psFreeable);
+      psFreeable = psNext;
+   }
+}
+
+int Epoch_enter(void) {
+   struct record *psRecord;
+
+   psRecord = Epoch_getRecord();
+   if(psRecord == NULL)
+      return MEMORY_ERROR;
+
+   if(psRecord->uDepth++ == 0) {
+      /* the fence orders this store before every load that the
+         critical section makes from the shared data structure */
+      __atomic_store_n(&psRecord->ulEpoch,
+                       __atomic_load_n(&ulGlobalEpoch, __ATOMIC_SEQ_CST),
+                       __ATOMIC_RELAXED);
+      __atomic_thread_fence(__ATOMIC_SEQ_CST);
+   }
+   return SUCCESS;
+}
+
+void Epoch_exit(void) {
+   struct record *psRecord;
+
+   psRecord = pthread_getspecific(oRecordKey);
+   assert(psRecord != NULL);
+   assert(psRecord->uDepth > 0);
+
+   if(--psRecord->uDepth == 0)
+      __atomic_store_n(&psRecord->ulEpoch, 0UL, __ATOMIC_RELEASE);
+}
+
+void Epoch_retire(void *pvObject, void (*pfFree)(void *pvObject)) {
+   struct retired *psRetired;
+   struct retired *psFreeable = NULL;
+
+   assert(pfFree != NULL);
+
+   psRetired = malloc(sizeof(struct retired));
+   if(psRetired == NULL) {
+      Epoch_synchronize();
+      (*pfFree)(pvObject);
+      return;
+   }
+   psRetired->pvObject = pvObject;
+   psRetired->pfFree = pfFree;
+
+   (void) pthread_mutex_lock(&oLimboLock);
+   psRetired->ulEpoch = __atomic_load_n(&ulGlobalEpoch,
+                                        __ATOMIC_SEQ_CST);
+   psRetired->psNext = psLimbo;
+   psLimbo = psRetired;
+   if(++uLimboLength >= RECLAIM_THRESHOLD)
+      psFreeable = Epoch_collect();
+   (void) pthread_mutex_unlock(&oLimboLock);
+
+   Epoch_free(psFreeable);
+}
+
+void Epoch_synchronize(void) {
+   struct retired *psFreeable;
+   unsigned long ulTarget;
+   boolean bDone;
+
+   (void) pthread_mutex_lock(&oLimboLock);
+   ulTarget = __atomic_load_n(&ulGlobalEpoch, __ATOMIC_SEQ_CST) + 2;
+   (void) pthread_mutex_unlock(&oLimboLock);
+
+   do {
+      (void) pthread_mutex_lock(&oLimboLock);
+      psFreeable = Epoch_collect();
+      bDone = (boolean) (__atomic_load_n(&ulGlobalEpoch,
+                                         __ATOMIC_SEQ_CST) >= ulTarget);
+      (void) pthread_mutex_unlock(&oLimboLock);
+
+      Epoch_free(psFreeable);
+      if(!bDone)
+         (void) sched_yield();
+   } while(!bDone);
+}
@@ -0,0 +1,55 @@
+/*--------------------------------------------------------------------*/
+/* epoch.h                                                            */
+/* Author: Ishaan Javali & Jack Zhang                                 */
+/*--------------------------------------------------------------------*/
+
+#ifndef EPOCH_INCLUDED
+#define EPOCH_INCLUDED
+
+#include "a4def.h"
+
+/*
+  Epoch-based reclamation lets threads read a linked data structure
+  without taking any lock, while writers unlink parts of it. A reader
+  brackets every access with Epoch_enter and Epoch_exit. A writer that
+  unlinks an object passes it to Epoch_retire instead of freeing it,
+  and the object is freed only once every reader that might still hold
+  a pointer to it has called Epoch_exit. Readers never write to memory
+  that other threads read, except for one word of their own per
+  thread, so they do not contend with each other or with writers.
+
+  All of the functions are safe to call from any number of threads at
+  once. Readers and writers of every data structure in the process
+  share one set of epochs.
+*/
+
+/*
+  Begins a read-side critical section for the calling thread. Until
+  the matching Epoch_exit, no object retired by another thread can be
+  freed. Critical sections may nest. Returns SUCCESS, or MEMORY_ERROR
+  (without entering) if memory for the thread's bookkeeping could not
+  be allocated on its first call.
+*/
+int Epoch_enter(void);
+
+/* Ends the calling thread's innermost read-side critical section. */
+void Epoch_exit(void);
+
+/*
+  Arranges for (*pfFree)(pvObject) to be called once every read-side
+  critical section that was active when this function was called has
+  ended. pvObject must already be unreachable for readers that enter
+  from now on. The object may be freed by this call or by a later
+  call of Epoch_retire or Epoch_synchronize on any thread. If memory
+  to record the object could not be allocated, waits as
+  Epoch_synchronize does and frees the object before returning.
+*/
+void Epoch_retire(void *pvObject, void (*pfFree)(void *pvObject));
+
+/*
+  Waits until every object retired before this call has been freed.
+  Must not be called from inside a read-side critical section.
+*/
+void Epoch_synchronize(void);
+
+#endif
@@ -234,6 +234,85 @@ int Path_prefix(Path_T oPPath, size_t ulDepth, Path_T *poPResult) {
    return SUCCESS;
 }
 
+int Path_child(Path_T oPParent, const char *pcName, size_t ulLength,
+               Path_T *poPResult) {
+   struct path *psNew;
+   size_t ulDepth = 0;
+   size_t ulIndex;
+   const char *pcComponent;
+   char *pcCopy;
+   char *pcBuild;
+
+   assert(pcName != NULL);
+   assert(poPResult != NULL);
+
+   /* the new component must be non-empty and a single component */
+   if(ulLength == 0 || memchr(pcName, '/', ulLength) != NULL ||
+      memchr(pcName, '\0', ulLength) != NULL) {
+      *poPResult = NULL;
+      return BAD_PATH;
+   }
+
+   psNew = calloc(1, sizeof(struct path));
+   if(psNew == NULL) {
+      *poPResult = NULL;
+      return MEMORY_ERROR;
+   }
+
+   if(oPParent != NULL)
+      ulDepth = Path_getDepth(oPParent);
+   psNew->oDComponents = DynArray_new(ulDepth + 1);
+   if(psNew->oDComponents == NULL) {
+      Path_free(psNew);
+      *poPResult = NULL;
+      return MEMORY_ERROR;
+   }
+
+   /* deep copy each of the parent's components, then the new one */
+   for(ulIndex = 0; ulIndex <= ulDepth; ulIndex++) {
+      if(ulIndex < ulDepth) {
+         pcComponent = Path_getComponent(oPParent, ulIndex);
+         pcCopy = malloc(strlen(pcComponent) + 1);
+         if(pcCopy != NULL)
+            strcpy(pcCopy, pcComponent);
+      }
+      else {
+         pcCopy = malloc(ulLength + 1);
+         if(pcCopy != NULL) {
+            memcpy(pcCopy, pcName, ulLength);
+            pcCopy[ulLength] = '\0';
+         }
+      }
+      if(pcCopy == NULL) {
+         Path_free(psNew);
+         *poPResult = NULL;
+         return MEMORY_ERROR;
+      }
+      (void) DynArray_set(psNew->oDComponents, ulIndex, pcCopy);
+   }
+
+   /* construct the child's pathname string */
+   psNew->ulLength = ulLength;
+   if(oPParent != NULL)
+      psNew->ulLength += oPParent->ulLength + 1;
+   pcBuild = malloc(psNew->ulLength + 1);
+   if(pcBuild == NULL) {
+      Path_free(psNew);
+      *poPResult = NULL;
+      return MEMORY_ERROR;
+   }
+   if(oPParent != NULL) {
+      memcpy(pcBuild, oPParent->pcPath, oPParent->ulLength);
+      pcBuild[oPParent->ulLength] = '/';
+   }
+   memcpy(pcBuild + psNew->ulLength - ulLength, pcName, ulLength);
+   pcBuild[psNew->ulLength] = '\0';
+   psNew->pcPath = pcBuild;
+
+   *poPResult = psNew;
+   return SUCCESS;
+}
+
 int Path_dup(Path_T oPPath, Path_T *poPResult) {
    assert(oPPath != NULL);
    assert(poPResult != NULL);
@@ -43,6 +43,20 @@ int Path_dup(Path_T oPPath, Path_T *poPResult);
 */
 int Path_prefix(Path_T oPPath, size_t ulDepth, Path_T *poPResult);
 
+/*
+  Creates a new path object representing the child of oPParent whose
+  last component is the ulLength characters at pcName, which need not
+  be terminated, or representing the root pcName if oPParent is NULL.
+  Unlike Path_new, it copies the parent's components as they are
+  rather than splitting a whole path string.
+  Returns an int SUCCESS status and sets *poPResult to be the new path
+  if successful. Otherwise, sets *poPResult to NULL and returns status:
+  * MEMORY_ERROR if memory could not be allocated to complete request
+  * BAD_PATH if the component is empty or contains a '/' or a '\0'
+*/
+int Path_child(Path_T oPParent, const char *pcName, size_t ulLength,
+               Path_T *poPResult);
+
 /* Destroys and frees all memory allocated for oPPath. */
 void Path_free(Path_T oPPath);
 
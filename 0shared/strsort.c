@@ -0,0 +1,249 @@
+/*--------------------------------------------------------------------*/
+/* strsort.c                                                          */
+/* Author: Ishaan Javali & Jack Zhang                                 */
+/*--------------------------------------------------------------------*/
+
+#include <assert.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "strsort.h"
+
+/* Subarrays at most this long are finished with insertion sort. */
+static const size_t INSERTION_CUTOFF = 12;
+
+/*
+  A string being sorted, together with what is needed to compute its
+  sort key one character at a time.
+*/
+struct key {
+   /* the string itself */
+   const char *pcString;
+   /* if sorting paths and the string names a file, the '/' that
+      precedes the file's own name; otherwise NULL */
+   const char *pcFileSlash;
+   /* the client's element that the string belongs to */
+   void *pvElement;
+};
+
+/*
+  Returns the sort key of the character at index ulDepth of psKey's
+  string. When not bPaths, this is just the character's value, so
+  that the order is that of strcmp. When bPaths, every '/' is mapped
+  below every other character, so that a directory and its
+  descendants sort before any sibling whose name merely extends the
+  directory's name, and the '/' that precedes a file's own name is
+  mapped below every other '/', so that at each level file children
+  sort before directory children.
+*/
+static int StrSort_keyChar(const struct key *psKey, size_t ulDepth,
+                           boolean bPaths) {
+   unsigned char c;
+
+   assert(psKey != NULL);
+
+   c = (unsigned char) psKey->pcString[ulDepth];
+   if(!bPaths)
+      return (int) c;
+   if(c == '\0')
+      return 0;
+   if(c == '/')
+      return (psKey->pcString + ulDepth == psKey->pcFileSlash) ? 1 : 2;
+   return (int) c + 2;
+}
+
+/*
+  Compares the keys of psFirst and psSecond starting at index
+  ulDepth, which both keys are known to agree on up to.
+  Returns <0, 0, or >0 if psFirst is "less than", "equal to", or
+  "greater than" psSecond, respectively.
+*/
+static int StrSort_compareFrom(const struct key *psFirst,
+                               const struct key *psSecond,
+                               size_t ulDepth, boolean bPaths) {
+   int iFirst;
+   int iSecond;
+
+   assert(psFirst != NULL);
+   assert(psSecond != NULL);
+
+   for(;;) {
+      iFirst = StrSort_keyChar(psFirst, ulDepth, bPaths);
+      iSecond = StrSort_keyChar(psSecond, ulDepth, bPaths);
+      if(iFirst != iSecond || iFirst == 0)
+         return iFirst - iSecond;
+      ulDepth++;
+   }
+}
+
+/* Swaps the keys at psFirst and psSecond. */
+static void StrSort_swap(struct key *psFirst, struct key *psSecond) {
+   struct key sTemp;
+
+   assert(psFirst != NULL);
+   assert(psSecond != NULL);
+
+   sTemp = *psFirst;
+   *psFirst = *psSecond;
+   *psSecond = sTemp;
+}
+
+/*
+  Sorts the ulCount keys in psKeys, all of which agree on their first
+  ulDepth characters, by insertion sort.
+*/
+static void StrSort_insertion(struct key *psKeys, size_t ulCount,
+                              size_t ulDepth, boolean bPaths) {
+   size_t i, j;
+
+   assert(psKeys != NULL);
+
+   for(i = 1; i < ulCount; i++)
+      for(j = i; j > 0 && StrSort_compareFrom(&psKeys[j-1], &psKeys[j],
+                                              ulDepth, bPaths) > 0; j--)
+         StrSort_swap(&psKeys[j-1], &psKeys[j]);
+}
+
+/*
+  Sorts the ulCount keys in psKeys, all of which agree on their first
+  ulDepth characters, by multikey quicksort: partitions the keys
+  three ways on their character at ulDepth, sorts the "less" and
+  "greater" parts at the same depth, and sorts the "equal" part at
+  the next depth, so that no character is examined again once every
+  key in a part is known to share it.
+*/
+static void StrSort_multikey(struct key *psKeys, size_t ulCount,
+                             size_t ulDepth, boolean bPaths) {
+   size_t ulLess, ulScan, ulGreater;
+   int iPivot;
+   int iChar;
+
+   assert(psKeys != NULL || ulCount == 0);
+
+   while(ulCount > INSERTION_CUTOFF) {
+      /* median of three, to avoid quadratic behavior on input that
+         is already sorted */
+      {
+         int iLo = StrSort_keyChar(&psKeys[0], ulDepth, bPaths);
+         int iMid = StrSort_keyChar(&psKeys[ulCount/2], ulDepth, bPaths);
+         int iHi = StrSort_keyChar(&psKeys[ulCount-1], ulDepth, bPaths);
+         if((iLo <= iMid && iMid <= iHi) || (iHi <= iMid && iMid <= iLo))
+            iPivot = iMid;
+         else if((iMid <= iLo && iLo <= iHi) ||
+                 (iHi <= iLo && iLo <= iMid))
+            iPivot = iLo;
+         else
+            iPivot = iHi;
+      }
+
+      /* keys [0, ulLess) are less than the pivot, [ulLess, ulScan)
+         equal it, and [ulGreater, ulCount) are greater than it */
+      ulLess = 0;
+      ulScan = 0;
+      ulGreater = ulCount;
+      while(ulScan < ulGreater) {
+         iChar = StrSort_keyChar(&psKeys[ulScan], ulDepth, bPaths);
+         if(iChar < iPivot)
+            StrSort_swap(&psKeys[ulLess++], &psKeys[ulScan++]);
+         else if(iChar > iPivot)
+            StrSort_swap(&psKeys[ulScan], &psKeys[--ulGreater]);
+         else
+            ulScan++;
+      }
+
+      StrSort_multikey(psKeys, ulLess, ulDepth, bPaths);
+      StrSort_multikey(&psKeys[ulGreater], ulCount - ulGreater,
+                       ulDepth, bPaths);
+
+      /* keys that have all ended at ulDepth are equal */
+      if(iPivot == 0)
+         return;
+      psKeys += ulLess;
+      ulCount = ulGreater - ulLess;
+      ulDepth++;
+   }
+
+   StrSort_insertion(psKeys, ulCount, ulDepth, bPaths);
+}
+
+int StrSort_sort(const char **ppcStrings, size_t ulCount) {
+   struct key *psKeys;
+   size_t i;
+
+   assert(ppcStrings != NULL || ulCount == 0);
+
+   if(ulCount < 2)
+      return SUCCESS;
+
+   psKeys = malloc(ulCount * sizeof(struct key));
+   if(psKeys == NULL)
+      return MEMORY_ERROR;
+
+   for(i = 0; i < ulCount; i++) {
+      psKeys[i].pcString = ppcStrings[i];
+      psKeys[i].pcFileSlash = NULL;
+      psKeys[i].pvElement = NULL;
+   }
+
+   StrSort_multikey(psKeys, ulCount, 0, FALSE);
+
+   for(i = 0; i < ulCount; i++)
+      ppcStrings[i] = psKeys[i].pcString;
+
+   free(psKeys);
+   return SUCCESS;
+}
+
+int StrSort_sortPaths(void **ppvElements, size_t ulCount,
+                      const char *(*pfGetPath)(const void *pvElement),
+                      boolean (*pfIsFile)(const void *pvElement)) {
+   struct key *psKeys;
+   size_t i;
+
+   assert(ppvElements != NULL || ulCount == 0);
+   assert(pfGetPath != NULL);
+   assert(pfIsFile != NULL);
+
+   if(ulCount < 2)
+      return SUCCESS;
+
+   psKeys = malloc(ulCount * sizeof(struct key));
+   if(psKeys == NULL)
+      return MEMORY_ERROR;
+
+   for(i = 0; i < ulCount; i++) {
+      psKeys[i].pvElement = ppvElements[i];
+      psKeys[i].pcString = (*pfGetPath)(ppvElements[i]);
+      assert(psKeys[i].pcString != NULL);
+      if((*pfIsFile)(ppvElements[i]))
+         psKeys[i].pcFileSlash = strrchr(psKeys[i].pcString, '/');
+      else
+         psKeys[i].pcFileSlash = NULL;
+   }
+
+   StrSort_multikey(psKeys, ulCount, 0, TRUE);
+
+   for(i = 0; i < ulCount; i++)
+      ppvElements[i] = psKeys[i].pvElement;
+
+   free(psKeys);
+   return SUCCESS;
+}
+
+int StrSort_comparePaths(const char *pcPath1, boolean bIsFile1,
+                         const char *pcPath2, boolean bIsFile2) {
+   struct key sFirst;
+   struct key sSecond;
+
+   assert(pcPath1 != NULL);
+   assert(pcPath2 != NULL);
+
+   sFirst.pcString = pcPath1;
+   sFirst.pcFileSlash = bIsFile1 ? strrchr(pcPath1, '/') : NULL;
+   sFirst.pvElement = NULL;
+   sSecond.pcString = pcPath2;
+   sSecond.pcFileSlash = bIsFile2 ? strrchr(pcPath2, '/') : NULL;
+   sSecond.pvElement = NULL;
+
+   return StrSort_compareFrom(&sFirst, &sSecond, 0, TRUE);
+}
@@ -0,0 +1,49 @@
+/*--------------------------------------------------------------------*/
+/* strsort.h                                                          */
+/* Author: Ishaan Javali & Jack Zhang                                 */
+/*--------------------------------------------------------------------*/
+
+#ifndef STRSORT_INCLUDED
+#define STRSORT_INCLUDED
+
+#include <stddef.h>
+#include "a4def.h"
+
+/*
+  Sorts the ulCount strings in ppcStrings in place into the order
+  determined by strcmp. Uses multikey quicksort, which looks at each
+  character of a common prefix only once per partitioning step
+  instead of re-comparing the prefix in every comparison.
+  Returns SUCCESS, or MEMORY_ERROR (leaving ppcStrings unchanged)
+  if memory could not be allocated to complete request.
+*/
+int StrSort_sort(const char **ppcStrings, size_t ulCount);
+
+/*
+  Sorts the ulCount elements in ppvElements in place into the
+  canonical order of a File Tree: depth-first, with every directory
+  before its descendants, and at any given level the file children
+  before the directory children, with children of the same type
+  ordered lexicographically. (*pfGetPath)(pvElement) must return the
+  absolute path of pvElement, and (*pfIsFile)(pvElement) must return
+  TRUE if pvElement names a file and FALSE if it names a directory.
+  Uses multikey quicksort, as StrSort_sort does.
+  Returns SUCCESS, or MEMORY_ERROR (leaving ppvElements unchanged)
+  if memory could not be allocated to complete request.
+*/
+int StrSort_sortPaths(void **ppvElements, size_t ulCount,
+                      const char *(*pfGetPath)(const void *pvElement),
+                      boolean (*pfIsFile)(const void *pvElement));
+
+/*
+  Compares absolute path pcPath1, which names a file if bIsFile1 is
+  TRUE and a directory otherwise, with pcPath2, which names a file if
+  bIsFile2 is TRUE and a directory otherwise, in the canonical order
+  used by StrSort_sortPaths.
+  Returns <0, 0, or >0 if pcPath1 is "less than", "equal to", or
+  "greater than" pcPath2, respectively.
+*/
+int StrSort_comparePaths(const char *pcPath1, boolean bIsFile1,
+                         const char *pcPath2, boolean bIsFile2);
+
+#endif
@@ -0,0 +1,625 @@
+/*--------------------------------------------------------------------*/
+/* threadpool.c                                                       */
+/* Author: Ishaan Javali & Jack Zhang                                 */
+/*--------------------------------------------------------------------*/
+
+#include <assert.h>
+#include <stdlib.h>
+#include <pthread.h>
+#include "threadpool.h"
+
+/*--------------------------------------------------------------------*/
+
+/* The states of a task that is joined: not yet run, not yet run with
+   a joining thread asleep waiting for it, and run. */
+
+enum {TASK_PENDING, TASK_AWAITED, TASK_DONE};
+
+/*--------------------------------------------------------------------*/
+
+/* The number of tasks a deque can hold before it first grows. */
+
+static const size_t MIN_DEQUE_CAPACITY = 16;
+
+/*--------------------------------------------------------------------*/
+
+/* How many ranges per thread ThreadPool_parallelFor aims for when the
+   client does not choose a grain. */
+
+static const size_t RANGES_PER_THREAD = 8;
+
+/*--------------------------------------------------------------------*/
+
+/* A spawned task. */
+
+struct ThreadPool_Task
+{
+   /* the function the task calls, and its argument */
+   void (*pfRun)(void *pvArg);
+   void *pvArg;
+   /* TASK_PENDING, TASK_AWAITED, or TASK_DONE */
+   int iState;
+   /* 1 if the task is never joined and frees itself once it has run */
+   int iDetached;
+};
+
+/*--------------------------------------------------------------------*/
+
+/* A double-ended queue of tasks, used as a ring buffer. Its owner
+   pushes and pops at the bottom, and thieves steal from the top. */
+
+struct deque
+{
+   /* a lock guarding the other fields */
+   pthread_mutex_t oLock;
+   /* the ring buffer of tasks, and its capacity */
+   struct ThreadPool_Task **ppsTasks;
+   size_t uCapacity;
+   /* the index of the oldest task, and the number of tasks */
+   size_t uTop;
+   size_t uLength;
+};
+
+/*--------------------------------------------------------------------*/
+
+/* A worker thread. */
+
+struct worker
+{
+   /* the pool that the worker belongs to */
+   ThreadPool_T oPool;
+   /* the index of the worker's deque in the pool */
+   size_t uDeque;
+   /* the thread itself */
+   pthread_t oThread;
+};
+
+/*--------------------------------------------------------------------*/
+
+/* A pool has one deque per worker, and deque 0, which is shared by the
+   client threads that spawn tasks or join them from outside the
+   pool. */
+
+struct ThreadPool
+{
+   /* the deques, and how many there are (one more than workers) */
+   struct deque *psDeques;
+   size_t uDeques;
+   /* the workers, and how many of their threads have started */
+   struct worker *psWorkers;
+   size_t uStarted;
+   /* the number of tasks queued in all deques */
+   size_t uQueued;
+   /* 1 once ThreadPool_free has asked the workers to stop */
+   int iShutdown;
+   /* a lock and condition that idle workers, and joining threads
+      that have nothing left to run, sleep on */
+   pthread_mutex_t oIdleLock;
+   pthread_cond_t oWorkCond;
+};
+
+/*--------------------------------------------------------------------*/
+
+/* The arguments of one range of ThreadPool_parallelFor. */
+
+struct range
+{
+   ThreadPool_T oPool;
+   size_t uLo;
+   size_t uHi;
+   size_t uGrain;
+   void (*pfBody)(size_t uLo, size_t uHi, void *pvExtra);
+   void *pvExtra;
+};
+
+/*--------------------------------------------------------------------*/
+
+/* The key under which each worker thread finds its struct worker. */
+
+static pthread_key_t oWorkerKey;
+
+/*--------------------------------------------------------------------*/
+
+/* Ensures that oWorkerKey is created exactly once. */
+
+static pthread_once_t oKeyOnce = PTHREAD_ONCE_INIT;
+
+/*--------------------------------------------------------------------*/
+
+/* Creates the key under which each worker finds its struct worker. */
+
+static void ThreadPool_createKey(void)
+{
+   (void) pthread_key_create(&oWorkerKey, NULL);
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Returns the index of the calling thread's deque in oPool. */
+
+static size_t ThreadPool_ownDeque(ThreadPool_T oPool)
+{
+   struct worker *psWorker;
+
+   assert(oPool != NULL);
+
+   psWorker = pthread_getspecific(oWorkerKey);
+   if (psWorker != NULL && psWorker->oPool == oPool)
+      return psWorker->uDeque;
+   return 0;
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Pushes psTask onto the bottom of psDeque, growing it if it is full.
+   Returns 1 (TRUE), or 0 (FALSE) if insufficient memory is
+   available. */
+
+static int ThreadPool_push(struct deque *psDeque,
+                           struct ThreadPool_Task *psTask)
+{
+   struct ThreadPool_Task **ppsNew;
+   size_t uNewCapacity;
+   size_t u;
+
+   assert(psDeque != NULL);
+   assert(psTask != NULL);
+
+   (void) pthread_mutex_lock(&psDeque->oLock);
+   if (psDeque->uLength == psDeque->uCapacity)
+   {
+      uNewCapacity = psDeque->uCapacity * 2;
+      ppsNew = malloc(uNewCapacity * sizeof(struct ThreadPool_Task *));
+      if (ppsNew == NULL)
+      {
+         (void) pthread_mutex_unlock(&psDeque->oLock);
+         return 0;
+      }
+      for (u = 0; u < psDeque->uLength; u++)
+         ppsNew[u] = psDeque->ppsTasks[(psDeque->uTop + u) %
+                                       psDeque->uCapacity];
+      free(psDeque->ppsTasks);
+      psDeque->ppsTasks = ppsNew;
+      psDeque->uCapacity = uNewCapacity;
+      psDeque->uTop = 0;
+   }
+   psDeque->ppsTasks[(psDeque->uTop + psDeque->uLength) %
+                     psDeque->uCapacity] = psTask;
+   psDeque->uLength++;
+   (void) pthread_mutex_unlock(&psDeque->oLock);
+   return 1;
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Removes and returns the task at the bottom of psDeque if bBottom, or
+   at its top otherwise. Returns NULL if psDeque is empty. */
+
+static struct ThreadPool_Task *ThreadPool_take(struct deque *psDeque,
+                                               int bBottom)
+{
+   struct ThreadPool_Task *psTask = NULL;
+
+   assert(psDeque != NULL);
+
+   (void) pthread_mutex_lock(&psDeque->oLock);
+   if (psDeque->uLength > 0)
+   {
+      psDeque->uLength--;
+      if (bBottom)
+         psTask = psDeque->ppsTasks[(psDeque->uTop + psDeque->uLength) %
+                                    psDeque->uCapacity];
+      else
+      {
+         psTask = psDeque->ppsTasks[psDeque->uTop];
+         psDeque->uTop = (psDeque->uTop + 1) % psDeque->uCapacity;
+      }
+   }
+   (void) pthread_mutex_unlock(&psDeque->oLock);
+   return psTask;
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Returns a queued task of oPool for the thread that owns deque uDeque:
+   the newest task of its own deque if there is one, or else the oldest
+   task of the next deque that has any. Returns NULL if every deque is
+   empty. */
+
+static struct ThreadPool_Task *ThreadPool_find(ThreadPool_T oPool,
+                                               size_t uDeque)
+{
+   struct ThreadPool_Task *psTask;
+   size_t u;
+
+   assert(oPool != NULL);
+
+   if (__atomic_load_n(&oPool->uQueued, __ATOMIC_ACQUIRE) == 0)
+      return NULL;
+
+   psTask = ThreadPool_take(&oPool->psDeques[uDeque], 1);
+   for (u = 1; psTask == NULL && u < oPool->uDeques; u++)
+      psTask = ThreadPool_take(
+                  &oPool->psDeques[(uDeque + u) % oPool->uDeques], 0);
+   if (psTask != NULL)
+      (void) __atomic_sub_fetch(&oPool->uQueued, 1, __ATOMIC_ACQ_REL);
+   return psTask;
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Runs psTask of oPool, then frees it if it is detached, or else marks
+   it done and wakes the threads sleeping on oPool if its joiner is
+   among them. psTask must not be touched once it is marked done, since
+   its joiner may free it at once. */
+
+static void ThreadPool_run(ThreadPool_T oPool,
+                           struct ThreadPool_Task *psTask)
+{
+   assert(oPool != NULL);
+   assert(psTask != NULL);
+
+   (*psTask->pfRun)(psTask->pvArg);
+   if (psTask->iDetached)
+      free(psTask);
+   else if (__atomic_exchange_n(&psTask->iState, TASK_DONE,
+                                __ATOMIC_ACQ_REL) == TASK_AWAITED)
+   {
+      (void) pthread_mutex_lock(&oPool->oIdleLock);
+      (void) pthread_cond_broadcast(&oPool->oWorkCond);
+      (void) pthread_mutex_unlock(&oPool->oIdleLock);
+   }
+}
+
+/*--------------------------------------------------------------------*/
+
+/* The body of a worker thread pvWorker: runs tasks until the pool shuts
+   down, sleeping whenever no task is queued. */
+
+static void *ThreadPool_work(void *pvWorker)
+{
+   struct worker *psWorker = pvWorker;
+   ThreadPool_T oPool;
+   struct ThreadPool_Task *psTask;
+
+   assert(psWorker != NULL);
+
+   oPool = psWorker->oPool;
+   (void) pthread_setspecific(oWorkerKey, psWorker);
+   for (;;)
+   {
+      psTask = ThreadPool_find(oPool, psWorker->uDeque);
+      if (psTask != NULL)
+      {
+         ThreadPool_run(oPool, psTask);
+         continue;
+      }
+
+      (void) pthread_mutex_lock(&oPool->oIdleLock);
+      while (__atomic_load_n(&oPool->uQueued, __ATOMIC_ACQUIRE) == 0 &&
+             !oPool->iShutdown)
+         (void) pthread_cond_wait(&oPool->oWorkCond, &oPool->oIdleLock);
+      if (oPool->iShutdown &&
+          __atomic_load_n(&oPool->uQueued, __ATOMIC_ACQUIRE) == 0)
+      {
+         (void) pthread_mutex_unlock(&oPool->oIdleLock);
+         return NULL;
+      }
+      (void) pthread_mutex_unlock(&oPool->oIdleLock);
+   }
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Frees the deques of oPool, of which uDeques were initialized. */
+
+static void ThreadPool_freeDeques(ThreadPool_T oPool, size_t uDeques)
+{
+   size_t u;
+
+   assert(oPool != NULL);
+
+   for (u = 0; u < uDeques; u++)
+   {
+      (void) pthread_mutex_destroy(&oPool->psDeques[u].oLock);
+      free(oPool->psDeques[u].ppsTasks);
+   }
+   free(oPool->psDeques);
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Wakes every idle worker of oPool after setting iShutdown if
+   iShutdown is 1, or one idle worker otherwise. */
+
+static void ThreadPool_wake(ThreadPool_T oPool, int iShutdown)
+{
+   assert(oPool != NULL);
+
+   (void) pthread_mutex_lock(&oPool->oIdleLock);
+   if (iShutdown)
+   {
+      oPool->iShutdown = 1;
+      (void) pthread_cond_broadcast(&oPool->oWorkCond);
+   }
+   else
+      (void) pthread_cond_signal(&oPool->oWorkCond);
+   (void) pthread_mutex_unlock(&oPool->oIdleLock);
+}
+
+/*--------------------------------------------------------------------*/
+
+ThreadPool_T ThreadPool_new(size_t uWorkers)
+{
+   ThreadPool_T oPool;
+   size_t u;
+
+   (void) pthread_once(&oKeyOnce, ThreadPool_createKey);
+
+   oPool = malloc(sizeof(struct ThreadPool));
+   if (oPool == NULL)
+      return NULL;
+   oPool->uDeques = uWorkers + 1;
+   oPool->uStarted = 0;
+   oPool->uQueued = 0;
+   oPool->iShutdown = 0;
+
+   oPool->psDeques = malloc(oPool->uDeques * sizeof(struct deque));
+   if (oPool->psDeques == NULL)
+   {
+      free(oPool);
+      return NULL;
+   }
+   for (u = 0; u < oPool->uDeques; u++)
+   {
+      struct deque *psDeque = &oPool->psDeques[u];
+      psDeque->ppsTasks =
+         malloc(MIN_DEQUE_CAPACITY * sizeof(struct ThreadPool_Task *));
+      if (psDeque->ppsTasks == NULL ||
+          pthread_mutex_init(&psDeque->oLock, NULL) != 0)
+      {
+         free(psDeque->ppsTasks);
+         ThreadPool_freeDeques(oPool, u);
+         free(oPool);
+         return NULL;
+      }
+      psDeque->uCapacity = MIN_DEQUE_CAPACITY;
+      psDeque->uTop = 0;
+      psDeque->uLength = 0;
+   }
+
+   oPool->psWorkers = malloc((uWorkers > 0 ? uWorkers : 1) *
+                             sizeof(struct worker));
+   if (oPool->psWorkers == NULL ||
+       pthread_mutex_init(&oPool->oIdleLock, NULL) != 0)
+   {
+      free(oPool->psWorkers);
+      ThreadPool_freeDeques(oPool, oPool->uDeques);
+      free(oPool);
+      return NULL;
+   }
+   if (pthread_cond_init(&oPool->oWorkCond, NULL) != 0)
+   {
+      (void) pthread_mutex_destroy(&oPool->oIdleLock);
+      free(oPool->psWorkers);
+      ThreadPool_freeDeques(oPool, oPool->uDeques);
+      free(oPool);
+      return NULL;
+   }
+
+   for (u = 0; u < uWorkers; u++)
+   {
+      oPool->psWorkers[u].oPool = oPool;
+      oPool->psWorkers[u].uDeque = u + 1;
+      if (pthread_create(&oPool->psWorkers[u].oThread, NULL,
+                         ThreadPool_work, &oPool->psWorkers[u]) != 0)
+      {
+         /* stop the workers created so far, then give up */
+         ThreadPool_free(oPool);
+         return NULL;
+      }
+      oPool->uStarted++;
+   }
+   return oPool;
+}
+
+/*--------------------------------------------------------------------*/
+
+void ThreadPool_free(ThreadPool_T oPool)
+{
+   struct ThreadPool_Task *psTask;
+   size_t u;
+
+   if (oPool == NULL)
+      return;
+
+   ThreadPool_wake(oPool, 1);
+   for (u = 0; u < oPool->uStarted; u++)
+      (void) pthread_join(oPool->psWorkers[u].oThread, NULL);
+   /* without workers, detached tasks may still be queued */
+   while ((psTask = ThreadPool_find(oPool, 0)) != NULL)
+      ThreadPool_run(oPool, psTask);
+
+   (void) pthread_cond_destroy(&oPool->oWorkCond);
+   (void) pthread_mutex_destroy(&oPool->oIdleLock);
+   free(oPool->psWorkers);
+   ThreadPool_freeDeques(oPool, oPool->uDeques);
+   free(oPool);
+}
+
+/*--------------------------------------------------------------------*/
+
+size_t ThreadPool_getWorkers(ThreadPool_T oPool)
+{
+   assert(oPool != NULL);
+
+   return oPool->uDeques - 1;
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Queues a task of oPool that calls (*pfRun)(pvArg), and that frees
+   itself once it has run if iDetached is 1. Returns the task, or
+   instead calls (*pfRun)(pvArg) and returns NULL if memory for the task
+   could not be allocated. */
+
+static struct ThreadPool_Task *ThreadPool_queue(ThreadPool_T oPool,
+                                                void (*pfRun)(void *),
+                                                void *pvArg,
+                                                int iDetached)
+{
+   struct ThreadPool_Task *psTask;
+
+   assert(oPool != NULL);
+   assert(pfRun != NULL);
+
+   psTask = malloc(sizeof(struct ThreadPool_Task));
+   if (psTask == NULL)
+   {
+      (*pfRun)(pvArg);
+      return NULL;
+   }
+   psTask->pfRun = pfRun;
+   psTask->pvArg = pvArg;
+   psTask->iState = TASK_PENDING;
+   psTask->iDetached = iDetached;
+
+   /* count the task before a thief can take it, so that uQueued never
+      drops below the number of tasks in the deques */
+   (void) __atomic_add_fetch(&oPool->uQueued, 1, __ATOMIC_ACQ_REL);
+   if (!ThreadPool_push(&oPool->psDeques[ThreadPool_ownDeque(oPool)],
+                        psTask))
+   {
+      (void) __atomic_sub_fetch(&oPool->uQueued, 1, __ATOMIC_ACQ_REL);
+      free(psTask);
+      (*pfRun)(pvArg);
+      return NULL;
+   }
+   if (oPool->uDeques > 1)
+      ThreadPool_wake(oPool, 0);
+   return psTask;
+}
+
+/*--------------------------------------------------------------------*/
+
+ThreadPool_Task_T ThreadPool_spawn(ThreadPool_T oPool,
+                                   void (*pfRun)(void *pvArg),
+                                   void *pvArg)
+{
+   assert(oPool != NULL);
+   assert(pfRun != NULL);
+
+   return ThreadPool_queue(oPool, pfRun, pvArg, 0);
+}
+
+/*--------------------------------------------------------------------*/
+
+void ThreadPool_spawnDetached(ThreadPool_T oPool,
+                              void (*pfRun)(void *pvArg),
+                              void *pvArg)
+{
+   assert(oPool != NULL);
+   assert(pfRun != NULL);
+
+   (void) ThreadPool_queue(oPool, pfRun, pvArg, 1);
+}
+
+/*--------------------------------------------------------------------*/
+
+void ThreadPool_join(ThreadPool_T oPool, ThreadPool_Task_T oTask)
+{
+   struct ThreadPool_Task *psTask;
+   size_t uDeque;
+   int iPending;
+
+   assert(oPool != NULL);
+
+   if (oTask == NULL)
+      return;
+
+   uDeque = ThreadPool_ownDeque(oPool);
+   while (__atomic_load_n(&oTask->iState, __ATOMIC_ACQUIRE) !=
+          TASK_DONE)
+   {
+      psTask = ThreadPool_find(oPool, uDeque);
+      if (psTask != NULL)
+      {
+         ThreadPool_run(oPool, psTask);
+         continue;
+      }
+
+      /* oTask is running on another thread and nothing is left to
+         steal: sleep until it is done or more work is queued, with
+         oTask marked so that the thread running it wakes this one */
+      (void) pthread_mutex_lock(&oPool->oIdleLock);
+      iPending = TASK_PENDING;
+      (void) __atomic_compare_exchange_n(&oTask->iState, &iPending,
+                                         TASK_AWAITED, 0,
+                                         __ATOMIC_ACQ_REL,
+                                         __ATOMIC_ACQUIRE);
+      while (__atomic_load_n(&oTask->iState, __ATOMIC_ACQUIRE) !=
+             TASK_DONE &&
+             __atomic_load_n(&oPool->uQueued, __ATOMIC_ACQUIRE) == 0)
+         (void) pthread_cond_wait(&oPool->oWorkCond, &oPool->oIdleLock);
+      (void) pthread_mutex_unlock(&oPool->oIdleLock);
+   }
+   free(oTask);
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Runs the range pvRange of ThreadPool_parallelFor, splitting it in
+   halves while it is larger than its grain. */
+
+static void ThreadPool_runRange(void *pvRange)
+{
+   struct range *psRange = pvRange;
+   struct range sLeft, sRight;
+   ThreadPool_Task_T oTask;
+
+   assert(psRange != NULL);
+
+   if (psRange->uHi - psRange->uLo <= psRange->uGrain)
+   {
+      (*psRange->pfBody)(psRange->uLo, psRange->uHi, psRange->pvExtra);
+      return;
+   }
+
+   sLeft = *psRange;
+   sRight = *psRange;
+   sLeft.uHi = psRange->uLo + (psRange->uHi - psRange->uLo) / 2;
+   sRight.uLo = sLeft.uHi;
+   oTask = ThreadPool_spawn(psRange->oPool, ThreadPool_runRange,
+                            &sRight);
+   ThreadPool_runRange(&sLeft);
+   ThreadPool_join(psRange->oPool, oTask);
+}
+
+/*--------------------------------------------------------------------*/
+
+void ThreadPool_parallelFor(ThreadPool_T oPool, size_t uCount,
+                            void (*pfBody)(size_t uLo, size_t uHi,
+                                           void *pvExtra),
+                            void *pvExtra, size_t uGrain)
+{
+   struct range sRange;
+
+   assert(oPool != NULL);
+   assert(pfBody != NULL);
+
+   if (uCount == 0)
+      return;
+
+   if (uGrain == 0)
+      uGrain = uCount / (oPool->uDeques * RANGES_PER_THREAD);
+   if (uGrain == 0)
+      uGrain = 1;
+
+   sRange.oPool = oPool;
+   sRange.uLo = 0;
+   sRange.uHi = uCount;
+   sRange.uGrain = uGrain;
+   sRange.pfBody = pfBody;
+   sRange.pvExtra = pvExtra;
+   ThreadPool_runRange(&sRange);
+}
@@ -0,0 +1,102 @@
+/*--------------------------------------------------------------------*/
+/* threadpool.h                                                       */
+/* Author: Ishaan Javali & Jack Zhang                                 */
+/*--------------------------------------------------------------------*/
+
+#ifndef THREADPOOL_INCLUDED
+#define THREADPOOL_INCLUDED
+
+#include <stddef.h>
+
+/*--------------------------------------------------------------------*/
+
+/* A ThreadPool_T is a fixed set of worker threads that run tasks
+   spawned by its clients. Every worker keeps its own double-ended queue
+   of tasks: it pushes the tasks it spawns onto one end and takes its
+   next task from that same end, so that it works on the most recently
+   spawned, cache-warm task first, and an idle worker steals the oldest
+   task from the other end of a busy worker's queue. The oldest tasks
+   are usually the largest pieces of a divide-and-conquer computation,
+   so a steal tends to hand over plenty of work at once. A thread that
+   is waiting in ThreadPool_join runs other queued tasks, and blocks
+   only once none is left. */
+
+typedef struct ThreadPool *ThreadPool_T;
+
+/*--------------------------------------------------------------------*/
+
+/* A task that has been spawned and not yet joined. */
+
+typedef struct ThreadPool_Task *ThreadPool_Task_T;
+
+/*--------------------------------------------------------------------*/
+
+/* Returns a new ThreadPool_T with uWorkers worker threads, or NULL if
+   insufficient memory is available or the threads could not be created.
+   With no workers, spawned tasks run only when a client joins them or
+   runs ThreadPool_parallelFor. */
+
+ThreadPool_T ThreadPool_new(size_t uWorkers);
+
+/*--------------------------------------------------------------------*/
+
+/* Waits for the tasks still queued in oPool to run, then stops its
+   workers and frees oPool. Every task spawned with ThreadPool_spawn
+   must have been joined; detached tasks that are still queued run
+   before this function returns. */
+
+void ThreadPool_free(ThreadPool_T oPool);
+
+/*--------------------------------------------------------------------*/
+
+/* Returns the number of worker threads of oPool. */
+
+size_t ThreadPool_getWorkers(ThreadPool_T oPool);
+
+/*--------------------------------------------------------------------*/
+
+/* Queues a task that calls (*pfRun)(pvArg) on some thread of oPool, and
+   returns the task, which must be passed to ThreadPool_join exactly
+   once. May be called by a client thread or from inside a task. If
+   memory for the task could not be allocated, instead calls
+   (*pfRun)(pvArg) before returning, and returns NULL. */
+
+ThreadPool_Task_T ThreadPool_spawn(ThreadPool_T oPool,
+                                   void (*pfRun)(void *pvArg),
+                                   void *pvArg);
+
+/*--------------------------------------------------------------------*/
+
+/* Queues a task that calls (*pfRun)(pvArg) on some thread of oPool, as
+   ThreadPool_spawn does, but that is never joined: the task frees
+   itself once it has run. If memory for the task could not be
+   allocated, instead calls (*pfRun)(pvArg) before returning. */
+
+void ThreadPool_spawnDetached(ThreadPool_T oPool,
+                              void (*pfRun)(void *pvArg),
+                              void *pvArg);
+
+/*--------------------------------------------------------------------*/
+
+/* Waits until oTask has run, and frees it. While waiting, the calling
+   thread runs other tasks of oPool, starting with those that it spawned
+   itself. Does nothing if oTask is NULL. */
+
+void ThreadPool_join(ThreadPool_T oPool, ThreadPool_Task_T oTask);
+
+/*--------------------------------------------------------------------*/
+
+/* Calls (*pfBody)(uLo, uHi, pvExtra) on disjoint ranges [uLo, uHi) that
+   together cover [0, uCount), using the calling thread and the workers
+   of oPool, and returns once every call has returned. The range is
+   split in halves recursively, with one half spawned and the other run
+   at once, until ranges have at most uGrain elements; if uGrain is 0, a
+   grain is chosen automatically. *pfBody may be called concurrently, so
+   it must be safe to call from several threads at once. */
+
+void ThreadPool_parallelFor(ThreadPool_T oPool, size_t uCount,
+                            void (*pfBody)(size_t uLo, size_t uHi,
+                                           void *pvExtra),
+                            void *pvExtra, size_t uGrain);
+
+#endif
@@ -0,0 +1 @@
+../0shared/dynarraypar.c
\ No newline at end of file
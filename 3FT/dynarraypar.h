@@ -0,0 +1 @@
+../0shared/dynarraypar.h
\ No newline at end of file
@@ -0,0 +1 @@
+../0shared/epoch.h
\ No newline at end of file
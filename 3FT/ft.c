@@ -3,51 +3,326 @@
 /* Author: Ishaan Javali & Jack Zhang                                 */
 /*--------------------------------------------------------------------*/
 
+/* for pthread_rwlock_t, sched_yield, fileno, fsync and open, which
+   C90 mode does not expose by default */
+#define _POSIX_C_SOURCE 200112L
+
 #include <assert.h>
+#include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <pthread.h>
+#include <sched.h>
+#include <fcntl.h>
+#include <unistd.h>
 #include "path.h"
 #include "dynarray.h"
+#include "strsort.h"
+#include "epoch.h"
+#include "threadpool.h"
 #include "ft.h"
 #include "nodeFT.h"
+#include "ftimage.h"
+#include "ftarena.h"
+#include "ftfrozen.h"
+
+
+/*
+  A File Tree is a representation of a hierarchy of directories and
+  files, represented as an ADT with 14 state variables:
+*/
+struct FT {
+   /* 1. a pointer to the root node in the hierarchy */
+   Node_T oNRoot;
+   /* 2. a counter of the number of nodes in the hierarchy, plus those
+      of removed subtrees that psFreed has not yet accounted for */
+   size_t ulCount;
+   /* 3. a lock that inserts hold shared and every other change to the
+      hierarchy holds exclusively, or NULL if the File Tree is not
+      shared between threads */
+   pthread_rwlock_t *psWriteLock;
+   /* 4. the pool that frees removed subtrees, or NULL if they are
+      freed before the removing call returns */
+   ThreadPool_T oReclaimPool;
+   /* 5. the nodes that oReclaimPool has freed, or NULL if no pool was
+      ever set */
+   struct FT_Freed *psFreed;
+   /* 6. the operations on the hierarchy, which depend on how it is
+      held (see FT_getBackend) */
+   const struct FT_Backend *psBackend;
+   /* 7. the image, arena or frozen form that the hierarchy is held
+      in, or NULL if it is made of nodes */
+   void *pvStore;
+   /* 8. the paths of the nodes removed since the last checkpoint that
+      existed at it, in the order of their removal, or NULL if there
+      are none (see FT_saveDeltaIn) */
+   DynArray_T oDRemoved;
+   /* 9. the number of deltas saved or applied since the hierarchy
+      was last saved or loaded whole */
+   size_t ulDeltas;
+   /* 10. the versions that the hierarchy shares with its snapshots,
+      or NULL if no snapshot of it was ever taken */
+   struct FT_Versions *psVersions;
+   /* 11. TRUE if the File Tree is a read-only snapshot of another
+      (see FT_snapshotIn), FALSE otherwise */
+   boolean bIsSnapshot;
+   /* 12. for a snapshot, the generation of the other File Tree that
+      it shows */
+   unsigned long ulGeneration;
+   /* 13. the image that the hierarchy's directories are loaded from
+      on demand, shared with the tree's snapshots, or NULL if the
+      whole hierarchy is in memory (see FT_newLazy) */
+   struct FT_Lazy *psLazy;
+   /* 14. the save of a snapshot of the hierarchy that a background
+      thread is making, or NULL if there is none (see
+      FT_beginSaveIn) */
+   struct FT_Save *psSave;
+};
+
+/*
+  The operations on a File Tree's hierarchy, which differ with how it
+  is held: in nodes, or read-only in nodes that a snapshot shares, or
+  in an image (see FT_newFromImage), an arena (see FT_newArena) or a
+  frozen form (see FT_freezeIn). Each File Tree's table is chosen
+  once, when the tree is made, opened or frozen, and the FT_*Unlocked
+  functions hand each call to it.
+*/
+struct FT_Backend {
+   /* FT_statIn, also setting *ppvContents to a file's contents if
+      ppvContents is not NULL */
+   int (*pfStat)(FT_T oFTree, const char *pcPath, boolean *pbIsFile,
+                 size_t *pulSize, void **ppvContents);
+   /* FT_containsFileIn if bIsFile, FT_containsDirIn otherwise */
+   boolean (*pfContains)(FT_T oFTree, const char *pcPath,
+                         boolean bIsFile);
+   /* FT_toStringIn */
+   char *(*pfToString)(FT_T oFTree);
+   /* FT_insertFileIn if bIsFile, FT_insertDirIn otherwise */
+   int (*pfInsert)(FT_T oFTree, const char *pcPath, boolean bIsFile,
+                   void *pvContents, size_t ulLength);
+   /* FT_rmFileIn if bIsFile, FT_rmDirIn otherwise */
+   int (*pfRemove)(FT_T oFTree, const char *pcPath, boolean bIsFile);
+   /* FT_replaceFileContentsIn, setting *ppvOldContents and returning
+      SUCCESS, or returning the status that it failed with */
+   int (*pfReplace)(FT_T oFTree, const char *pcPath,
+                    void *pvNewContents, size_t ulNewLength,
+                    void **ppvOldContents);
+   /* FT_syncIn */
+   int (*pfSync)(FT_T oFTree);
+   /* frees pvStore */
+   void (*pfFreeStore)(FT_T oFTree);
+   /* TRUE if the hierarchy may not be changed */
+   boolean bReadOnly;
+   /* SUCCESS if the hierarchy is made of nodes, or the status that
+      saving it, snapshotting it or freezing it fails with otherwise */
+   int iNodesStatus;
+};
+
+/* The backends, defined after the functions that they are made of. */
+static const struct FT_Backend sNodeBackend;
+static const struct FT_Backend sSnapshotBackend;
+static const struct FT_Backend sImageBackend;
+static const struct FT_Backend sArenaBackend;
+static const struct FT_Backend sFrozenBackend;
+
+/*
+  The bookkeeping that a File Tree shares with its snapshots. The
+  tree's nodes are made in generations: taking a snapshot starts a
+  new one, and a node of an older generation may be seen by a
+  snapshot, so while any snapshot is live, a change copies such nodes
+  rather than changing them (see FT_ownNode). The nodes that the
+  changes unlink are kept until no live snapshot can see them.
+*/
+struct FT_Versions {
+   /* the generation of the nodes that changes make now */
+   unsigned long ulGeneration;
+   /* the live snapshots */
+   DynArray_T oDSnapshots;
+   /* the number of live snapshots, which writers read without oLock */
+   size_t ulLive;
+   /* the unlinked nodes, oldest first */
+   struct FT_Retired *psRetiredFirst;
+   struct FT_Retired *psRetiredLast;
+   /* the lock that guards the snapshots and the unlinked nodes */
+   pthread_mutex_t oLock;
+};
+
+/* A node, or a subtree, that a change unlinked from a File Tree. */
+struct FT_Retired {
+   /* the node, and whether its subtree goes with it */
+   Node_T oNNode;
+   boolean bSubtree;
+   /* the generation in which it was unlinked: only snapshots of older
+      generations can see it */
+   unsigned long ulGeneration;
+   /* the next node unlinked */
+   struct FT_Retired *psNext;
+};
+
+/*
+  The bookkeeping of a File Tree whose directories are loaded on
+  demand from an image. Each directory starts as a stub, its children
+  are loaded the first time a traversal descends into it, and the
+  directories that no traversal has passed through lately, and whose
+  subtrees have not changed since they were loaded, are turned back
+  into stubs once the tree holds too many nodes (see FT_evict).
+*/
+struct FT_Lazy {
+   /* the image */
+   FTImage_T oImage;
+   /* the number of nodes the tree aims to hold, or 0 for no limit */
+   size_t ulBudget;
+   /* the number of nodes loaded since the last eviction, plus the
+      number of nodes in the tree after it */
+   size_t ulLoaded;
+   /* the value of ulLoaded beyond which the next traversal evicts */
+   size_t ulLimit;
+   /* the number of traversals so far, with which each one stamps the
+      directories that it passes */
+   unsigned long ulClock;
+};
 
+/*
+  A count of the nodes that a reclaim pool has freed for a File Tree
+  and that the tree's ulCount still includes. The tree and each
+  subtree awaiting reclamation hold a reference to it, so that the
+  tree may be freed while its subtrees are still being reclaimed.
+*/
+struct FT_Freed {
+   /* the number of nodes freed since the tree last looked */
+   size_t ulNodes;
+   /* the number of references */
+   size_t ulRefs;
+};
+
+/* A removed subtree awaiting reclamation by a pool. */
+struct FT_Reclaim {
+   /* the root of the detached subtree */
+   Node_T oNRoot;
+   /* the pool that frees it */
+   ThreadPool_T oPool;
+   /* where to count the nodes freed */
+   struct FT_Freed *psFreed;
+};
+
+/*
+  A save that a background thread is making of a snapshot of a File
+  Tree. The thread writes the snapshot to a temporary file beside
+  the target, syncs it, and renames it over the target.
+*/
+struct FT_Save {
+   /* the snapshot, until the thread has written and freed it */
+   FT_T oFSnapshot;
+   /* the target file, and the temporary file written first */
+   char *pcFilename;
+   char *pcTemp;
+   /* the thread */
+   pthread_t oThread;
+   /* the status that the thread finished with */
+   int iStatus;
+};
 
 /*
-  A Directory Tree is a representation of a hierarchy of directories,
-  represented as an AO with 3 state variables:
+  The FT_* functions that take no FT_T operate on a default File
+  Tree, represented as an AO with 2 state variables:
 */
 
 /* 1. a flag for being in an initialized state (TRUE) or not (FALSE) */
 static boolean bIsInitialized;
-/* 2. a pointer to the root node in the hierarchy */
-static Node_T oNRoot;
-/* 3. a counter of the number of nodes in the hierarchy */
-static size_t ulCount;
+/* 2. the default File Tree, meaningful only when initialized */
+static struct FT sDefault;
+
+/*
+  How many nodes ahead FT_toString prefetches while walking the
+  pre-order array of nodes.
+*/
+static const size_t FT_PREFETCH_DISTANCE = 8;
+
+/*
+  How many chunks per thread FT_toStringParallel aims to split a File
+  Tree into, and the fewest nodes a File Tree must have before
+  FT_toStringParallel uses more than one thread.
+*/
+static const size_t FT_CHUNKS_PER_THREAD = 8;
+static const size_t FT_MIN_PARALLEL_NODES = 1024;
+
+/*
+  How many lookups FT_lookupMany advances in turn. Each one waits for
+  a node, a name, or a slot of a children array to arrive from memory
+  while the others make progress, so many cache misses are in flight
+  at a time.
+*/
+enum { FT_LOOKUP_WIDTH = 16 };
+
+/*
+  The layout of a snapshot file (see FT_saveIn): every number is a
+  word of 8 bytes, least significant byte first. The header holds the
+  magic string FT_SNAPSHOT_MAGIC followed by the number of nodes and
+  the sizes of the name pool and of the contents blob. Each node's
+  record holds its depth shifted left twice, ORed with
+  FT_SNAPSHOT_FILE if it is a file and FT_SNAPSHOT_CONTENTS if its
+  contents are not NULL, then the length of its name and the length
+  of its contents.
+*/
+enum { FT_SNAPSHOT_WORD = 8, FT_SNAPSHOT_HEADER_WORDS = 4,
+       FT_SNAPSHOT_RECORD_WORDS = 3 };
+enum { FT_SNAPSHOT_FILE = 1, FT_SNAPSHOT_CONTENTS = 2 };
+static const char FT_SNAPSHOT_MAGIC[] = "FTSNAP01";
+
+/*
+  The layout of a delta file (see FT_saveDeltaIn), in the words of a
+  snapshot: the header holds the magic string FT_DELTA_MAGIC followed
+  by the delta's sequence number, the number of records and the sizes
+  of the path pool and of the contents blob. Each record holds one of
+  the FT_DELTA_* kinds, ORed with FT_DELTA_CONTENTS if it carries
+  contents that are not NULL, then the length of its path and the
+  length of its contents. The removals come first, in the order they
+  were made, and then the new and changed nodes in pre-order, so that
+  every directory is inserted before its children.
+*/
+enum { FT_DELTA_HEADER_WORDS = 5 };
+enum { FT_DELTA_RM, FT_DELTA_INSERT_DIR, FT_DELTA_INSERT_FILE,
+       FT_DELTA_REPLACE };
+enum { FT_DELTA_CONTENTS = 8 };
+static const char FT_DELTA_MAGIC[] = "FTDELT01";
 
 /*
   Alternate version of strlen that uses pulAcc as an in-out parameter
   to accumulate a string length, rather than returning the length of
   oNNode's path, and also always adds one addition byte to the sum.
+  Returns FALSE, so that DynArray_mapUntil visits every node.
 */
-static void FT_strlenAccumulate(Node_T oNNode, size_t *pulAcc) {
+static int FT_strlenAccumulate(Node_T oNNode, size_t *pulAcc) {
    assert(pulAcc != NULL);
 
    if(oNNode != NULL)
       *pulAcc += (Path_getStrLength(Node_getPath(oNNode)) + 1);
+   return FALSE;
 }
 
 /*
   Alternate version of strcat that inverts the typical argument
-  order, appending oNNode's path onto pcAcc, and also always adds one
-  newline at the end of the concatenated string.
+  order, appending oNNode's path onto *ppcAcc, and also always adds
+  one newline at the end of the concatenated string. *ppcAcc is
+  advanced to the new end of the string, so that each append is
+  O(1) in the length of what came before. The string is not
+  terminated, so that the caller can append to several parts of one
+  buffer at once; the caller terminates it after the last append.
+  Returns FALSE, so that DynArray_mapUntil visits every node.
 */
-static void FT_strcatAccumulate(Node_T oNNode, char *pcAcc) {
-   assert(pcAcc != NULL);
+static int FT_strcatAccumulate(Node_T oNNode, char **ppcAcc) {
+   size_t ulLength;
+
+   assert(ppcAcc != NULL);
+   assert(*ppcAcc != NULL);
 
    if(oNNode != NULL) {
-      strcat(pcAcc, Path_getPathname(Node_getPath(oNNode)));
-      strcat(pcAcc, "\n");
+      ulLength = Path_getStrLength(Node_getPath(oNNode));
+      memcpy(*ppcAcc, Path_getPathname(Node_getPath(oNNode)), ulLength);
+      (*ppcAcc)[ulLength] = '\n';
+      *ppcAcc += ulLength + 1;
    }
+   return FALSE;
 }
 
 /*
@@ -60,32 +335,302 @@ static void Path_freeString(char *pcStr, void *pvExtra) {
    free(pcStr);
 }
 
+/* Returns TRUE if a snapshot of oFTree is live, FALSE otherwise. */
+static boolean FT_hasSnapshots(FT_T oFTree) {
+   assert(oFTree != NULL);
+
+   return (boolean) (oFTree->psVersions != NULL &&
+                     __atomic_load_n(&oFTree->psVersions->ulLive,
+                                     __ATOMIC_ACQUIRE) != 0);
+}
+
+/*
+  Creates the node for record ulIndex of oFTree's image: as the root
+  if oNParent is NULL, and otherwise after oNParent's children of its
+  type, which must be a file if bIsFile and a directory otherwise. A
+  directory with children becomes a stub. Sets *poNResult to the node
+  and returns SUCCESS. Otherwise, sets *poNResult to NULL and returns
+  CORRUPT_FILE if the record does not fit the hierarchy, or
+  MEMORY_ERROR.
+*/
+static int FT_newImageNode(FT_T oFTree, size_t ulIndex, Node_T oNParent,
+                           boolean bIsFile, Node_T *poNResult) {
+   struct FTImage_Entry sEntry;
+   Path_T oPPath = NULL;
+   size_t ulChildID;
+   int iStatus;
+
+   assert(oFTree != NULL);
+   assert(oFTree->psLazy != NULL);
+   assert(poNResult != NULL);
+
+   *poNResult = NULL;
+   if(!FTImage_getEntry(oFTree->psLazy->oImage, ulIndex, &sEntry) ||
+      sEntry.bIsFile != bIsFile)
+      return CORRUPT_FILE;
+
+   iStatus = Path_child(oNParent == NULL ? NULL : Node_getPath(oNParent),
+                        sEntry.pcName, sEntry.ulNameLength, &oPPath);
+   if(iStatus != SUCCESS)
+      return iStatus == BAD_PATH ? CORRUPT_FILE : iStatus;
+   if(oNParent == NULL)
+      iStatus = Node_new(oPPath, NULL, poNResult, FALSE, NULL, 0);
+   /* files precede directories, so a file sibling with the same name
+      would already have been appended */
+   else if(!bIsFile &&
+           Node_hasChild(oNParent, oPPath, TRUE, &ulChildID))
+      iStatus = CORRUPT_FILE;
+   else
+      iStatus = Node_append(oPPath, oNParent, poNResult, bIsFile,
+                            sEntry.pvContents, sEntry.ulLength);
+   Path_free(oPPath);
+   if(iStatus != SUCCESS) {
+      *poNResult = NULL;
+      return iStatus == MEMORY_ERROR ? MEMORY_ERROR : CORRUPT_FILE;
+   }
+
+   Node_setRecord(*poNResult, ulIndex + 1);
+   Node_setStub(*poNResult,
+                (boolean) (sEntry.ulNumFiles + sEntry.ulNumDirs != 0));
+   /* a snapshot that sees the parent sees its children too */
+   if(oNParent != NULL)
+      Node_setGeneration(*poNResult, Node_getGeneration(oNParent));
+   return SUCCESS;
+}
+
+/*
+  Stamps oNNode, a directory of oFTree, as passed by the current
+  traversal and, if it is a stub, loads its children from oFTree's
+  image. Returns SUCCESS, or CORRUPT_FILE or MEMORY_ERROR, leaving
+  oNNode a stub.
+*/
+static int FT_pageIn(FT_T oFTree, Node_T oNNode) {
+   struct FTImage_Entry sEntry;
+   Node_T oNChild;
+   size_t ulNumChildren;
+   int iStatus = SUCCESS;
+   size_t i;
+
+   assert(oFTree != NULL);
+   assert(oFTree->psLazy != NULL);
+   assert(oNNode != NULL);
+
+   Node_setStamp(oNNode, oFTree->psLazy->ulClock);
+   if(!Node_isStub(oNNode))
+      return SUCCESS;
+
+   /* a stub's subtree cannot have changed, so it keeps its record,
+      which was read once already */
+   assert(Node_getRecord(oNNode) != 0);
+   (void) FTImage_getEntry(oFTree->psLazy->oImage,
+                           Node_getRecord(oNNode) - 1, &sEntry);
+   ulNumChildren = sEntry.ulNumFiles + sEntry.ulNumDirs;
+   for(i = 0; i < ulNumChildren && iStatus == SUCCESS; i++)
+      iStatus = FT_newImageNode(oFTree, sEntry.ulFirstChild + i, oNNode,
+                                (boolean) (i < sEntry.ulNumFiles),
+                                &oNChild);
+   if(iStatus != SUCCESS) {
+      (void) Node_evict(oNNode);
+      return iStatus;
+   }
+
+   Node_setStub(oNNode, FALSE);
+   oFTree->psLazy->ulLoaded += ulNumChildren;
+   oFTree->ulCount += ulNumChildren;
+   return SUCCESS;
+}
+
+/*
+  Loads every stub in the subtree rooted at oNNode, a directory of
+  oFTree. Returns SUCCESS, or CORRUPT_FILE or MEMORY_ERROR.
+*/
+static int FT_pageInSubtree(FT_T oFTree, Node_T oNNode) {
+   Node_T oNChild = NULL;
+   int iStatus;
+   size_t i;
+
+   assert(oFTree != NULL);
+   assert(oNNode != NULL);
+
+   iStatus = FT_pageIn(oFTree, oNNode);
+   for(i = 0; i < Node_getNumDirChildren(oNNode) && iStatus == SUCCESS;
+       i++) {
+      (void) Node_getChild(oNNode, i, FALSE, &oNChild);
+      iStatus = FT_pageInSubtree(oFTree, oNChild);
+   }
+   return iStatus;
+}
+
+/*
+  Brings the whole hierarchy of oFTree into memory, if its
+  directories are loaded on demand, for an operation that visits
+  every node. Returns SUCCESS, or CORRUPT_FILE or MEMORY_ERROR.
+*/
+static int FT_pageInAll(FT_T oFTree) {
+   size_t ulCount;
+   int iStatus;
+
+   assert(oFTree != NULL);
+
+   if(oFTree->psLazy == NULL || oFTree->oNRoot == NULL)
+      return SUCCESS;
+   oFTree->psLazy->ulClock++;
+   iStatus = FT_pageInSubtree(oFTree, oFTree->oNRoot);
+   /* stubs are shared with snapshots, so one of them may have loaded
+      nodes that this tree has not counted */
+   ulCount = Node_countSubtree(oFTree->oNRoot);
+   if(oFTree->ulCount < ulCount)
+      oFTree->ulCount = ulCount;
+   return iStatus;
+}
+
+/*
+  Orders directories oNFirst and oNSecond for eviction: the one that a
+  traversal last passed through longer ago first, and of two passed
+  through by the same traversal, the deeper one first.
+*/
+static int FT_compareCold(Node_T oNFirst, Node_T oNSecond) {
+   size_t ulFirstDepth;
+   size_t ulSecondDepth;
+
+   assert(oNFirst != NULL);
+   assert(oNSecond != NULL);
+
+   if(Node_getStamp(oNFirst) != Node_getStamp(oNSecond))
+      return Node_getStamp(oNFirst) < Node_getStamp(oNSecond) ? -1 : 1;
+   ulFirstDepth = Path_getDepth(Node_getPath(oNFirst));
+   ulSecondDepth = Path_getDepth(Node_getPath(oNSecond));
+   if(ulFirstDepth != ulSecondDepth)
+      return ulFirstDepth > ulSecondDepth ? -1 : 1;
+   return 0;
+}
+
+/*
+  Adds to *pulCount the number of nodes in the subtree rooted at
+  oNNode, a directory, and appends to oDCold every directory in it
+  that could be evicted: one with children in memory whose subtree
+  still matches the image. Returns TRUE, or FALSE if oDCold could not
+  grow.
+*/
+static boolean FT_gatherEvictable(Node_T oNNode, DynArray_T oDCold,
+                                  size_t *pulCount) {
+   Node_T oNChild = NULL;
+   size_t i;
+
+   assert(oNNode != NULL);
+   assert(oDCold != NULL);
+   assert(pulCount != NULL);
+
+   *pulCount += 1 + Node_getNumFileChildren(oNNode);
+   if(Node_getRecord(oNNode) != 0 && !Node_isStub(oNNode) &&
+      Node_getNumFileChildren(oNNode) + Node_getNumDirChildren(oNNode)
+      != 0 && !DynArray_add(oDCold, oNNode))
+      return FALSE;
+   for(i = 0; i < Node_getNumDirChildren(oNNode); i++) {
+      (void) Node_getChild(oNNode, i, FALSE, &oNChild);
+      if(!FT_gatherEvictable(oNChild, oDCold, pulCount))
+         return FALSE;
+   }
+   return TRUE;
+}
+
+/*
+  Once oFTree, whose directories are loaded on demand, has loaded
+  nodes beyond its limit, turns the coldest of its evictable
+  directories back into stubs until it holds three quarters of its
+  budget or none is left. A traversal stamps every directory that it
+  passes, so no directory is colder than one below it, and a
+  directory is only evicted after every colder one, including those
+  below it, which are then freed with it. Afterwards, the limit is
+  the budget, or more if the nodes that could not be evicted take up
+  most of it, so that the next eviction is not due at once. Does
+  nothing while a snapshot of oFTree is live, as it may see the
+  nodes, or if memory to list the directories could not be
+  allocated. The caller must hold no node of oFTree.
+*/
+static void FT_evict(FT_T oFTree) {
+   struct FT_Lazy *psLazy;
+   DynArray_T oDCold;
+   size_t ulCount = 0;
+   size_t ulFreed = 0;
+   size_t ulEvicted;
+   size_t ulTarget;
+   size_t i;
+
+   assert(oFTree != NULL);
+   assert(oFTree->psLazy != NULL);
+
+   psLazy = oFTree->psLazy;
+   if(psLazy->ulLoaded <= psLazy->ulLimit || oFTree->oNRoot == NULL ||
+      FT_hasSnapshots(oFTree))
+      return;
+   oDCold = DynArray_new(0);
+   if(oDCold == NULL)
+      return;
+   if(!FT_gatherEvictable(oFTree->oNRoot, oDCold, &ulCount)) {
+      DynArray_free(oDCold);
+      return;
+   }
+   DynArray_sort(oDCold, (int (*)(const void *, const void *))
+                         FT_compareCold);
+
+   ulTarget = psLazy->ulBudget - psLazy->ulBudget / 4;
+   for(i = 0; i < DynArray_getLength(oDCold) && ulCount > ulTarget;
+       i++) {
+      ulEvicted = Node_evict(DynArray_get(oDCold, i));
+      ulCount -= ulEvicted;
+      ulFreed += ulEvicted;
+   }
+   DynArray_free(oDCold);
+
+   /* a snapshot, since freed, may have loaded nodes uncounted */
+   if(oFTree->ulCount < ulCount + ulFreed)
+      oFTree->ulCount = ulCount + ulFreed;
+   oFTree->ulCount -= ulFreed;
+   psLazy->ulLoaded = ulCount;
+   psLazy->ulLimit = ulCount + (psLazy->ulBudget - ulTarget);
+   if(psLazy->ulLimit < psLazy->ulBudget)
+      psLazy->ulLimit = psLazy->ulBudget;
+}
+
 /*
-  Traverses the FT starting at the root as far as possible towards
+  Traverses oFTree starting at the root as far as possible towards
   absolute path oPPath. Uses isFile
   to search in either a file or directory child array.
   If able to traverse, returns an int SUCCESS
   status and sets *poNFurthest to the furthest node reached (which may
   be only a prefix of oPPath, or even NULL if the root is NULL).
+  In a tree loaded on demand, each stub that the traversal descends
+  into is loaded, after the tree first evicts if it is due to, so the
+  caller must hold no node of oFTree.
   Otherwise, sets *poNFurthest to NULL and returns with status:
   * CONFLICTING_PATH if the root's path is not a prefix of oPPath
+  * CORRUPT_FILE if a stub's records in the image are not well-formed
   * MEMORY_ERROR if memory could not be allocated to complete request
 */
-static int FT_traversePath(Path_T oPPath, boolean isFile, Node_T *poNFurthest) {
+static int FT_traversePath(FT_T oFTree, Path_T oPPath, boolean isFile,
+                           Node_T *poNFurthest) {
    int iStatus;
    Path_T oPPrefix = NULL;
    Node_T oNCurr;
    Node_T oNChild = NULL;
    size_t ulDepth;
    size_t i;
-   size_t ulChildID;
    boolean origIsFile;
 
+   assert(oFTree != NULL);
    assert(oPPath != NULL);
    assert(poNFurthest != NULL);
 
+   /* a tree loaded on demand makes room before it loads more */
+   if(oFTree->psLazy != NULL) {
+      FT_evict(oFTree);
+      oFTree->psLazy->ulClock++;
+   }
+
    /* root is NULL -> won't find anything */
-   if(oNRoot == NULL) {
+   oNCurr = __atomic_load_n(&oFTree->oNRoot, __ATOMIC_ACQUIRE);
+   if(oNCurr == NULL) {
       *poNFurthest = NULL;
       return SUCCESS;
    }
@@ -98,7 +643,7 @@ static int FT_traversePath(Path_T oPPath, boolean isFile, Node_T *poNFurthest) {
       return iStatus;
    }
 
-   if(Path_comparePath(Node_getPath(oNRoot), oPPrefix)) {
+   if(Path_comparePath(Node_getPath(oNCurr), oPPrefix)) {
       Path_free(oPPrefix);
       *poNFurthest = NULL;
       return CONFLICTING_PATH;
@@ -106,12 +651,18 @@ static int FT_traversePath(Path_T oPPath, boolean isFile, Node_T *poNFurthest) {
    Path_free(oPPrefix);
    oPPrefix = NULL;
 
-   oNCurr = oNRoot;
    ulDepth = Path_getDepth(oPPath);
    origIsFile = isFile;
    for(i = 2; i <= ulDepth; i++) {
       if(origIsFile)
          isFile = (boolean) (i == ulDepth);
+      if(oFTree->psLazy != NULL) {
+         iStatus = FT_pageIn(oFTree, oNCurr);
+         if(iStatus != SUCCESS) {
+            *poNFurthest = NULL;
+            return iStatus;
+         }
+      }
       iStatus = Path_prefix(oPPath, i, &oPPrefix);
       if(iStatus != SUCCESS) {
          if(oPPrefix != NULL)
@@ -119,15 +670,10 @@ static int FT_traversePath(Path_T oPPath, boolean isFile, Node_T *poNFurthest) {
          *poNFurthest = NULL;
          return iStatus;
       }
-      if(Node_hasChild(oNCurr, oPPrefix, isFile, &ulChildID)) {
+      if(Node_findChild(oNCurr, oPPrefix, isFile, &oNChild)) {
          /* go to that child and continue with next prefix */
          Path_free(oPPrefix);
          oPPrefix = NULL;
-         iStatus = Node_getChild(oNCurr, ulChildID, isFile, &oNChild);
-         if(iStatus != SUCCESS) {
-            *poNFurthest = NULL;
-            return iStatus;
-         }
          oNCurr = oNChild;
       }
       else {
@@ -137,16 +683,11 @@ static int FT_traversePath(Path_T oPPath, boolean isFile, Node_T *poNFurthest) {
                   *poNFurthest = NULL;
                   return iStatus;
                }
-               if(Node_hasChild(oNCurr, oPPrefix, isFile, &ulChildID)) {
+               if(Node_findChild(oNCurr, oPPrefix, isFile, &oNChild)) {
                   /* go to that child and continue with next prefix */
                   if(oPPrefix != NULL)
                   Path_free(oPPrefix);
                   oPPrefix = NULL;
-                  iStatus = Node_getChild(oNCurr, ulChildID, isFile, &oNChild);
-                  if(iStatus != SUCCESS) {
-                     *poNFurthest = NULL;
-                     return iStatus;
-                  }
                   oNCurr = oNChild;
                   /* If the only path forward is to enter
                   into a file prematurely (in oPPath, 
@@ -173,30 +714,27 @@ static int FT_traversePath(Path_T oPPath, boolean isFile, Node_T *poNFurthest) {
 }
 
 /*
-  Traverses the FT to find a node with absolute path pcPath. Uses isFile
+  Traverses oFTree to find a node with absolute path pcPath. Uses isFile
   to search in either a file or directory child array. Returns a
   int SUCCESS status and sets *poNResult to be the node, if found.
   Otherwise, sets *poNResult to NULL and returns with status:
-  * INITIALIZATION_ERROR if the FT is not in an initialized state
   * BAD_PATH if pcPath does not represent a well-formatted path
   * CONFLICTING_PATH if the root's path is not a prefix of pcPath
   * NO_SUCH_PATH if no node with pcPath exists in the hierarchy
+  * CORRUPT_FILE if a stub's records in the image are not well-formed
   * MEMORY_ERROR if memory could not be allocated to complete request
  */
 
-static int FT_findNode(const char *pcPath, Node_T *poNResult, boolean isFile) {
+static int FT_findNode(FT_T oFTree, const char *pcPath,
+                       Node_T *poNResult, boolean isFile) {
    Path_T oPPath = NULL;
    Node_T oNFound = NULL;
    int iStatus;
 
+   assert(oFTree != NULL);
    assert(pcPath != NULL);
    assert(poNResult != NULL);
 
-   if(!bIsInitialized) {
-      *poNResult = NULL;
-      return INITIALIZATION_ERROR;
-   }
-
    iStatus = Path_new(pcPath, &oPPath);
    if(iStatus != SUCCESS) {
       *poNResult = NULL;
@@ -204,7 +742,7 @@ static int FT_findNode(const char *pcPath, Node_T *poNResult, boolean isFile) {
          Path_free(oPPath);
       return iStatus;
    }
-   iStatus = FT_traversePath(oPPath, isFile, &oNFound);
+   iStatus = FT_traversePath(oFTree, oPPath, isFile, &oNFound);
    if(iStatus != SUCCESS)
    {
       Path_free(oPPath);
@@ -274,19 +812,124 @@ static size_t FT_preOrderTraversal(Node_T n, DynArray_T d, size_t i) {
    return i;
 }
 
-char *FT_toString(void) {
+/*
+  Returns oFTree's backend. A lookup in a tree returned by
+  FT_newConcurrent takes no lock, so it may run while FT_freezeIn
+  publishes the frozen backend.
+*/
+static const struct FT_Backend *FT_getBackend(FT_T oFTree) {
+   assert(oFTree != NULL);
+
+   return __atomic_load_n(&oFTree->psBackend, __ATOMIC_ACQUIRE);
+}
+
+/*
+  FT_containsDirIn, for a caller that has already synchronized with
+  other threads.
+*/
+static boolean FT_containsDirUnlocked(FT_T oFTree, const char *pcPath) {
+   assert(oFTree != NULL);
+   assert(pcPath != NULL);
+
+   return (*FT_getBackend(oFTree)->pfContains)(oFTree, pcPath, FALSE);
+}
+
+/*
+  FT_containsFileIn, for a caller that has already synchronized with
+  other threads.
+*/
+static boolean FT_containsFileUnlocked(FT_T oFTree,
+                                       const char *pcPath) {
+   assert(oFTree != NULL);
+   assert(pcPath != NULL);
+
+   return (*FT_getBackend(oFTree)->pfContains)(oFTree, pcPath, TRUE);
+}
+
+/*
+  Returns TRUE if oFTree, which is made of nodes, contains pcPath as a
+  file if bIsFile or as a directory otherwise, FALSE if not.
+*/
+static boolean FT_containsNodes(FT_T oFTree, const char *pcPath,
+                                boolean bIsFile) {
+   Node_T oNFound = NULL;
+
+   assert(oFTree != NULL);
+   assert(pcPath != NULL);
+
+   return (boolean) (FT_findNode(oFTree, pcPath, &oNFound, bIsFile) ==
+                     SUCCESS);
+}
+
+/*
+  Returns TRUE if oFTree, which is held other than in nodes, contains
+  pcPath as a file if bIsFile or as a directory otherwise, FALSE if
+  not.
+*/
+static boolean FT_containsStored(FT_T oFTree, const char *pcPath,
+                                 boolean bIsFile) {
+   boolean bFoundFile;
+   size_t ulSize;
+
+   assert(oFTree != NULL);
+   assert(pcPath != NULL);
+
+   return (boolean) ((*FT_getBackend(oFTree)->pfStat)(
+                        oFTree, pcPath, &bFoundFile, &ulSize, NULL) ==
+                     SUCCESS && bFoundFile == bIsFile);
+}
+
+/* Drops a reference to psFreed, freeing it if it was the last. */
+static void FT_releaseFreed(struct FT_Freed *psFreed) {
+   if(psFreed != NULL &&
+      __atomic_sub_fetch(&psFreed->ulRefs, 1, __ATOMIC_ACQ_REL) == 0)
+      free(psFreed);
+}
+
+/*
+  Subtracts from oFTree's node count the nodes that its reclaim pool
+  has freed since the last call. The caller must exclude every other
+  writer.
+*/
+static void FT_foldFreed(FT_T oFTree) {
+   assert(oFTree != NULL);
+
+   if(oFTree->psFreed != NULL)
+      oFTree->ulCount -= __atomic_exchange_n(&oFTree->psFreed->ulNodes,
+                                             0, __ATOMIC_ACQ_REL);
+}
+
+/*
+  FT_toStringIn, for a caller that has already synchronized with other
+  threads.
+*/
+static char *FT_toStringUnlocked(FT_T oFTree) {
+   assert(oFTree != NULL);
+
+   return (*FT_getBackend(oFTree)->pfToString)(oFTree);
+}
+
+/* FT_toStringUnlocked, for oFTree made of nodes. */
+static char *FT_toStringNodes(FT_T oFTree) {
    DynArray_T nodes;
    size_t totalStrlen = 1;
    char *result = NULL;
+   char *pcEnd;
 
-   if(!bIsInitialized)
+   assert(oFTree != NULL);
+
+   if(FT_pageInAll(oFTree) != SUCCESS)
       return NULL;
 
-   nodes = DynArray_new(ulCount);
-   (void) FT_preOrderTraversal(oNRoot, nodes, 0);
+   FT_foldFreed(oFTree);
+   nodes = DynArray_new(oFTree->ulCount);
+   if(nodes == NULL)
+      return NULL;
+   (void) FT_preOrderTraversal(oFTree->oNRoot, nodes, 0);
 
-   DynArray_map(nodes, (void (*)(void *, void*)) FT_strlenAccumulate,
-                (void*) &totalStrlen);
+   (void) DynArray_mapUntil(nodes,
+                (int (*)(void *, void*)) FT_strlenAccumulate,
+                (void*) &totalStrlen, FT_PREFETCH_DISTANCE);
 
    result = malloc(totalStrlen);
    if(result == NULL) {
@@ -295,93 +938,1074 @@ char *FT_toString(void) {
    }
    *result = '\0';
 
-   DynArray_map(nodes, (void (*)(void *, void*)) FT_strcatAccumulate,
-                (void *) result);
+   pcEnd = result;
+   (void) DynArray_mapUntil(nodes,
+                (int (*)(void *, void*)) FT_strcatAccumulate,
+                (void *) &pcEnd, FT_PREFETCH_DISTANCE);
+   *pcEnd = '\0';
 
    DynArray_free(nodes);
 
    return result;
 }
 
+/*
+  A piece of the string representation of a File Tree that
+  FT_toStringParallel builds independently of the other pieces: the
+  line of a single node, or the lines of a node's whole subtree.
+*/
+struct FT_Chunk {
+   /* the node whose line or subtree the chunk covers */
+   Node_T oNNode;
+   /* TRUE if the chunk covers oNNode's whole subtree, FALSE if only
+      oNNode's own line */
+   boolean bSubtree;
+   /* the chunk's nodes in pre-order, or NULL if they could not be
+      collected */
+   DynArray_T oDNodes;
+   /* the number of characters in the chunk's lines */
+   size_t ulLength;
+   /* where the chunk's lines start in the result */
+   char *pcStart;
+};
 
-int FT_rmDir(const char *pcPath) {
+/*
+  Appends the nodes of the subtree rooted at oNNode to oDNodes in
+  pre-order. Returns SUCCESS, or MEMORY_ERROR if oDNodes could not
+  grow.
+*/
+static int FT_appendPreOrder(Node_T oNNode, DynArray_T oDNodes) {
+   Node_T oNChild = NULL;
+   size_t c;
    int iStatus;
-   Node_T oNFound = NULL;
 
-   assert(pcPath != NULL);
-   if(FT_containsFile(pcPath)){
-      return NOT_A_DIRECTORY;
-   }
-   iStatus = FT_findNode(pcPath, &oNFound, FALSE);
+   assert(oNNode != NULL);
+   assert(oDNodes != NULL);
 
-   if(iStatus != SUCCESS){
-       return iStatus;
-   } 
-   if(Node_isFile(oNFound))
-       return NOT_A_DIRECTORY;
-   ulCount -= Node_free(oNFound);
-   if(ulCount == 0)
-      oNRoot = NULL;
-   
+   if(!DynArray_add(oDNodes, oNNode))
+      return MEMORY_ERROR;
+   for(c = 0; c < Node_getNumFileChildren(oNNode); c++) {
+      iStatus = Node_getChild(oNNode, c, TRUE, &oNChild);
+      assert(iStatus == SUCCESS);
+      if(!DynArray_add(oDNodes, oNChild))
+         return MEMORY_ERROR;
+   }
+   for(c = 0; c < Node_getNumDirChildren(oNNode); c++) {
+      iStatus = Node_getChild(oNNode, c, FALSE, &oNChild);
+      assert(iStatus == SUCCESS);
+      iStatus = FT_appendPreOrder(oNChild, oDNodes);
+      if(iStatus != SUCCESS)
+         return iStatus;
+   }
    return SUCCESS;
 }
 
-int FT_rmFile(const char *pcPath) {
-   int iStatus;
-   Node_T oNFound = NULL;
+/*
+  Collects the nodes of psChunk in pre-order and adds up the length
+  of their lines. This is the first pass of FT_toStringParallel, run
+  on many chunks at once.
+*/
+static void FT_measureChunk(struct FT_Chunk *psChunk) {
+   int iStatus = SUCCESS;
 
-   assert(pcPath != NULL);
-   
-   if(FT_containsDir(pcPath)){
-      return NOT_A_FILE;
+   assert(psChunk != NULL);
+
+   psChunk->ulLength = 0;
+   psChunk->oDNodes = DynArray_new(0);
+   if(psChunk->oDNodes == NULL)
+      return;
+
+   if(psChunk->bSubtree)
+      iStatus = FT_appendPreOrder(psChunk->oNNode, psChunk->oDNodes);
+   else if(!DynArray_add(psChunk->oDNodes, psChunk->oNNode))
+      iStatus = MEMORY_ERROR;
+   if(iStatus != SUCCESS) {
+      DynArray_free(psChunk->oDNodes);
+      psChunk->oDNodes = NULL;
+      return;
    }
 
-   iStatus = FT_findNode(pcPath, &oNFound, TRUE);
-   
-   if(iStatus != SUCCESS)
-       return iStatus;
-   if(!(Node_isFile(oNFound)))
-       return NOT_A_FILE;
+   (void) DynArray_mapUntil(psChunk->oDNodes,
+                (int (*)(void *, void*)) FT_strlenAccumulate,
+                (void*) &psChunk->ulLength, FT_PREFETCH_DISTANCE);
+}
 
-   ulCount -= Node_free(oNFound);
-   if(ulCount == 0)
-      oNRoot = NULL;
- 
-   return SUCCESS;
+/*
+  Writes the lines of psChunk's nodes starting at psChunk->pcStart.
+  This is the second pass of FT_toStringParallel, run on many chunks
+  at once; as the chunks' lines do not overlap, no two threads write
+  the same memory.
+*/
+static void FT_writeChunk(struct FT_Chunk *psChunk) {
+   char *pcEnd;
+
+   assert(psChunk != NULL);
+   assert(psChunk->oDNodes != NULL);
+
+   pcEnd = psChunk->pcStart;
+   (void) DynArray_mapUntil(psChunk->oDNodes,
+                (int (*)(void *, void*)) FT_strcatAccumulate,
+                (void *) &pcEnd, FT_PREFETCH_DISTANCE);
+}
+
+/* Runs FT_measureChunk on the chunks of pvChunks with indices in
+   [uLo, uHi). */
+static void FT_measureChunks(size_t uLo, size_t uHi, void *pvChunks) {
+   for(; uLo < uHi; uLo++)
+      FT_measureChunk(DynArray_get((DynArray_T) pvChunks, uLo));
 }
-int FT_init(void) {
 
-    if (bIsInitialized) return INITIALIZATION_ERROR;
+/* Runs FT_writeChunk on the chunks of pvChunks with indices in
+   [uLo, uHi). */
+static void FT_writeChunks(size_t uLo, size_t uHi, void *pvChunks) {
+   for(; uLo < uHi; uLo++)
+      FT_writeChunk(DynArray_get((DynArray_T) pvChunks, uLo));
+}
 
-    bIsInitialized = TRUE;
-    oNRoot = NULL;
-    ulCount = 0;
+/* Frees psChunk and the nodes array it holds, if any. pvExtra is
+   unused. */
+static void FT_freeChunk(struct FT_Chunk *psChunk, void *pvExtra) {
+   (void) pvExtra;
 
-    return SUCCESS;
+   if(psChunk == NULL)
+      return;
+   if(psChunk->oDNodes != NULL)
+      DynArray_free(psChunk->oDNodes);
+   free(psChunk);
 }
 
-int FT_stat(const char *pcPath, boolean *pbIsFile, size_t *pulSize) {
-    int iStatus;
-    Node_T oNFound = NULL;
-    DynArray_T oDSubstrings;
-    const char *pcStart = pcPath;
-    const char *pcEnd = pcPath;
-    assert(pcPath != NULL);
-    assert(pbIsFile != NULL);
-    assert(pulSize != NULL);
+/*
+  Adds to oDChunks a new chunk covering oNNode's subtree if bSubtree
+  or only oNNode's line otherwise. Returns SUCCESS, or MEMORY_ERROR
+  if allocation fails.
+*/
+static int FT_addChunk(DynArray_T oDChunks, Node_T oNNode,
+                       boolean bSubtree) {
+   struct FT_Chunk *psChunk;
 
-    if (!bIsInitialized) {
-        return INITIALIZATION_ERROR;
-    }
+   assert(oDChunks != NULL);
+   assert(oNNode != NULL);
 
-    if (*pcPath == '\0') {
-        return BAD_PATH;
-    }
+   psChunk = malloc(sizeof(struct FT_Chunk));
+   if(psChunk == NULL)
+      return MEMORY_ERROR;
+   psChunk->oNNode = oNNode;
+   psChunk->bSubtree = bSubtree;
+   psChunk->oDNodes = NULL;
+   psChunk->ulLength = 0;
+   psChunk->pcStart = NULL;
+   if(!DynArray_add(oDChunks, psChunk)) {
+      free(psChunk);
+      return MEMORY_ERROR;
+   }
+   return SUCCESS;
+}
 
-    oDSubstrings = DynArray_new(0);
-    if (oDSubstrings == NULL) {
-        return MEMORY_ERROR;
-    }
+/*
+  Splits the tree rooted at oNRoot into at least ulTarget chunks, or
+  as many as it has nodes if that is fewer, that cover the tree's
+  lines in canonical order. Starting from one chunk for the whole
+  tree, each round replaces every subtree chunk by its root's line
+  followed by a subtree chunk per child. Returns SUCCESS and sets
+  *poDChunks to the chunks, or returns MEMORY_ERROR.
+*/
+static int FT_splitChunks(Node_T oNRoot, size_t ulTarget,
+                          DynArray_T *poDChunks) {
+   DynArray_T oDChunks;
+   DynArray_T oDSplit;
+   struct FT_Chunk *psChunk;
+   Node_T oNChild = NULL;
+   boolean bSplit = TRUE;
+   size_t i, c;
+   int iStatus = SUCCESS;
+
+   assert(oNRoot != NULL);
+   assert(poDChunks != NULL);
+
+   *poDChunks = NULL;
+   oDChunks = DynArray_new(0);
+   if(oDChunks == NULL)
+      return MEMORY_ERROR;
+   iStatus = FT_addChunk(oDChunks, oNRoot, TRUE);
+
+   while(iStatus == SUCCESS && bSplit &&
+         DynArray_getLength(oDChunks) < ulTarget) {
+      oDSplit = DynArray_new(0);
+      if(oDSplit == NULL) {
+         iStatus = MEMORY_ERROR;
+         break;
+      }
+      bSplit = FALSE;
+      for(i = 0; i < DynArray_getLength(oDChunks) && iStatus == SUCCESS;
+          i++) {
+         psChunk = DynArray_get(oDChunks, i);
+         if(!psChunk->bSubtree ||
+            (Node_getNumFileChildren(psChunk->oNNode) == 0 &&
+             Node_getNumDirChildren(psChunk->oNNode) == 0)) {
+            iStatus = FT_addChunk(oDSplit, psChunk->oNNode,
+                                  psChunk->bSubtree);
+            continue;
+         }
+         bSplit = TRUE;
+         iStatus = FT_addChunk(oDSplit, psChunk->oNNode, FALSE);
+         for(c = 0; c < Node_getNumFileChildren(psChunk->oNNode) &&
+                iStatus == SUCCESS; c++) {
+            (void) Node_getChild(psChunk->oNNode, c, TRUE, &oNChild);
+            iStatus = FT_addChunk(oDSplit, oNChild, TRUE);
+         }
+         for(c = 0; c < Node_getNumDirChildren(psChunk->oNNode) &&
+                iStatus == SUCCESS; c++) {
+            (void) Node_getChild(psChunk->oNNode, c, FALSE, &oNChild);
+            iStatus = FT_addChunk(oDSplit, oNChild, TRUE);
+         }
+      }
+      DynArray_map(oDChunks, (void (*)(void *, void *)) FT_freeChunk,
+                   NULL);
+      DynArray_free(oDChunks);
+      oDChunks = oDSplit;
+   }
+
+   if(iStatus != SUCCESS) {
+      DynArray_map(oDChunks, (void (*)(void *, void *)) FT_freeChunk,
+                   NULL);
+      DynArray_free(oDChunks);
+      return iStatus;
+   }
+   *poDChunks = oDChunks;
+   return SUCCESS;
+}
+
+/*
+  FT_toStringParallel, for a caller that has already synchronized
+  with other threads.
+*/
+static char *FT_toStringParallelUnlocked(FT_T oFTree,
+                                         size_t ulThreads) {
+   DynArray_T oDChunks;
+   struct FT_Chunk *psChunk;
+   ThreadPool_T oPool;
+   size_t ulTotal = 1;
+   size_t i;
+   char *pcResult;
+
+   assert(oFTree != NULL);
+
+   if(FT_pageInAll(oFTree) != SUCCESS)
+      return NULL;
+   FT_foldFreed(oFTree);
+   if(ulThreads <= 1 || oFTree->ulCount < FT_MIN_PARALLEL_NODES)
+      return FT_toStringUnlocked(oFTree);
+
+   /* the calling thread works alongside the pool's workers, and both
+      passes share the pool's threads */
+   oPool = ThreadPool_new(ulThreads - 1);
+   if(oPool == NULL)
+      return FT_toStringUnlocked(oFTree);
+
+   if(FT_splitChunks(oFTree->oNRoot, ulThreads * FT_CHUNKS_PER_THREAD,
+                     &oDChunks) != SUCCESS) {
+      ThreadPool_free(oPool);
+      return NULL;
+   }
+
+   /* first pass: collect and measure the chunks in parallel, one
+      chunk per task, so that threads that draw small subtrees go on
+      to steal the remaining ones */
+   ThreadPool_parallelFor(oPool, DynArray_getLength(oDChunks),
+                          FT_measureChunks, oDChunks, 1);
+
+   for(i = 0; i < DynArray_getLength(oDChunks); i++) {
+      psChunk = DynArray_get(oDChunks, i);
+      if(psChunk->oDNodes == NULL)
+         break;
+      ulTotal += psChunk->ulLength;
+   }
+   pcResult = NULL;
+   if(i == DynArray_getLength(oDChunks))
+      pcResult = malloc(ulTotal);
+
+   if(pcResult != NULL) {
+      /* each chunk's lines go right after the previous chunk's, which
+         keeps the canonical order */
+      ulTotal = 0;
+      for(i = 0; i < DynArray_getLength(oDChunks); i++) {
+         psChunk = DynArray_get(oDChunks, i);
+         psChunk->pcStart = pcResult + ulTotal;
+         ulTotal += psChunk->ulLength;
+      }
+      /* second pass: write the chunks in parallel */
+      ThreadPool_parallelFor(oPool, DynArray_getLength(oDChunks),
+                             FT_writeChunks, oDChunks, 1);
+      pcResult[ulTotal] = '\0';
+   }
+   ThreadPool_free(oPool);
+
+   DynArray_map(oDChunks, (void (*)(void *, void *)) FT_freeChunk,
+                NULL);
+   DynArray_free(oDChunks);
+   return pcResult;
+}
+
+
+/* Returns TRUE if oFTree may not be changed, FALSE otherwise. */
+static boolean FT_isReadOnly(FT_T oFTree) {
+   assert(oFTree != NULL);
+
+   return FT_getBackend(oFTree)->bReadOnly;
+}
+
+/* Returns the generation of the nodes that changes to oFTree make. */
+static unsigned long FT_getGeneration(FT_T oFTree) {
+   assert(oFTree != NULL);
+
+   if(oFTree->psVersions == NULL)
+      return 0;
+   return oFTree->psVersions->ulGeneration;
+}
+
+/*
+  Frees every node unlinked from the tree of psVersions that no live
+  snapshot can see any more, for a caller that holds its lock.
+*/
+static void FT_freeRetired(struct FT_Versions *psVersions) {
+   struct FT_Retired *psRetired;
+   unsigned long ulOldest = (unsigned long) -1;
+   FT_T oFSnapshot;
+   size_t i;
+
+   assert(psVersions != NULL);
+
+   for(i = 0; i < DynArray_getLength(psVersions->oDSnapshots); i++) {
+      oFSnapshot = DynArray_get(psVersions->oDSnapshots, i);
+      if(oFSnapshot->ulGeneration < ulOldest)
+         ulOldest = oFSnapshot->ulGeneration;
+   }
+
+   /* a node unlinked in generation g is seen only by snapshots of
+      generations before g */
+   while(psVersions->psRetiredFirst != NULL &&
+         (DynArray_getLength(psVersions->oDSnapshots) == 0 ||
+          psVersions->psRetiredFirst->ulGeneration <= ulOldest)) {
+      psRetired = psVersions->psRetiredFirst;
+      psVersions->psRetiredFirst = psRetired->psNext;
+      Node_freeRetired(psRetired->oNNode, psRetired->bSubtree);
+      free(psRetired);
+   }
+   if(psVersions->psRetiredFirst == NULL)
+      psVersions->psRetiredLast = NULL;
+}
+
+/*
+  Records that oNNode, and its subtree if bSubtree, has been unlinked
+  from oFTree, using psRetired, and frees it at once if no snapshot
+  is live.
+*/
+static void FT_retire(FT_T oFTree, struct FT_Retired *psRetired,
+                      Node_T oNNode, boolean bSubtree) {
+   struct FT_Versions *psVersions;
+
+   assert(oFTree != NULL);
+   assert(oFTree->psVersions != NULL);
+   assert(psRetired != NULL);
+   assert(oNNode != NULL);
+
+   psVersions = oFTree->psVersions;
+   psRetired->oNNode = oNNode;
+   psRetired->bSubtree = bSubtree;
+   psRetired->ulGeneration = psVersions->ulGeneration;
+   psRetired->psNext = NULL;
+
+   (void) pthread_mutex_lock(&psVersions->oLock);
+   if(psVersions->psRetiredLast == NULL)
+      psVersions->psRetiredFirst = psRetired;
+   else
+      psVersions->psRetiredLast->psNext = psRetired;
+   psVersions->psRetiredLast = psRetired;
+   /* the last snapshot may have been freed since the caller looked */
+   FT_freeRetired(psVersions);
+   (void) pthread_mutex_unlock(&psVersions->oLock);
+}
+
+/*
+  Makes oNNode, a node of oFTree, safe to change, and sets *poNOwned
+  to the node to change in its place. That is oNNode itself unless a
+  live snapshot may see it, in which case it is a copy, and so are
+  those of its ancestors that a snapshot may see: the copy of the
+  root becomes oFTree's root, each other copy takes the place of its
+  original below its parent's copy, and the originals are retired.
+  Only the path from the root to oNNode is copied, and a node is
+  copied at most once per snapshot. Returns SUCCESS, or MEMORY_ERROR,
+  leaving oFTree showing the same hierarchy as before.
+*/
+static int FT_ownNode(FT_T oFTree, Node_T oNNode, Node_T *poNOwned) {
+   Node_T oNParent;
+   Node_T oNCopy = NULL;
+   struct FT_Retired *psRetired;
+   int iStatus;
+
+   assert(oFTree != NULL);
+   assert(oNNode != NULL);
+   assert(poNOwned != NULL);
+   /* parents are those of the newest version (see nodeFT.h) */
+   assert(!oFTree->bIsSnapshot);
+
+   *poNOwned = oNNode;
+   if(!FT_hasSnapshots(oFTree) ||
+      Node_getGeneration(oNNode) == FT_getGeneration(oFTree))
+      return SUCCESS;
+
+   oNParent = Node_getParent(oNNode);
+   if(oNParent != NULL) {
+      iStatus = FT_ownNode(oFTree, oNParent, &oNParent);
+      if(iStatus != SUCCESS)
+         return iStatus;
+   }
+
+   psRetired = malloc(sizeof(struct FT_Retired));
+   if(psRetired == NULL)
+      return MEMORY_ERROR;
+   iStatus = Node_copy(oNNode, oNParent, FT_getGeneration(oFTree),
+                       &oNCopy);
+   if(iStatus == SUCCESS && oNParent != NULL) {
+      iStatus = Node_replaceChild(oNParent, oNNode, oNCopy);
+      if(iStatus != SUCCESS)
+         Node_freeRetired(oNCopy, FALSE);
+   }
+   if(iStatus != SUCCESS) {
+      free(psRetired);
+      return iStatus;
+   }
+   if(oNParent == NULL)
+      __atomic_store_n(&oFTree->oNRoot, oNCopy, __ATOMIC_RELEASE);
+
+   Node_adoptChildren(oNCopy);
+   FT_retire(oFTree, psRetired, oNNode, FALSE);
+   *poNOwned = oNCopy;
+   return SUCCESS;
+}
+
+/* Frees the bookkeeping of oFTree's versions, none of which may be
+   live. */
+static void FT_freeVersions(FT_T oFTree) {
+   assert(oFTree != NULL);
+
+   if(oFTree->psVersions == NULL)
+      return;
+   assert(oFTree->psVersions->ulLive == 0);
+   FT_freeRetired(oFTree->psVersions);
+   DynArray_free(oFTree->psVersions->oDSnapshots);
+   (void) pthread_mutex_destroy(&oFTree->psVersions->oLock);
+   free(oFTree->psVersions);
+   oFTree->psVersions = NULL;
+}
+
+/*
+  Frees snapshot oFSnapshot, and every node unlinked from its tree
+  that no other live snapshot can see.
+*/
+static void FT_releaseSnapshot(FT_T oFSnapshot) {
+   struct FT_Versions *psVersions;
+   size_t i;
+
+   assert(oFSnapshot != NULL);
+   assert(oFSnapshot->bIsSnapshot);
+
+   psVersions = oFSnapshot->psVersions;
+   (void) pthread_mutex_lock(&psVersions->oLock);
+   for(i = 0; DynArray_get(psVersions->oDSnapshots, i) != oFSnapshot;
+       i++)
+      ;
+   (void) DynArray_removeAt(psVersions->oDSnapshots, i);
+   __atomic_store_n(&psVersions->ulLive,
+                    DynArray_getLength(psVersions->oDSnapshots),
+                    __ATOMIC_RELEASE);
+   FT_freeRetired(psVersions);
+   (void) pthread_mutex_unlock(&psVersions->oLock);
+   free(oFSnapshot);
+}
+
+/*
+  Waits for the background save psSave to finish, then frees it.
+  Returns the status it finished with.
+*/
+static int FT_finishSave(struct FT_Save *psSave) {
+   int iStatus;
+
+   assert(psSave != NULL);
+
+   (void) pthread_join(psSave->oThread, NULL);
+   iStatus = psSave->iStatus;
+   free(psSave->pcFilename);
+   free(psSave->pcTemp);
+   free(psSave);
+   return iStatus;
+}
+
+/* Frees the subtree of the FT_Reclaim pvReclaim, and pvReclaim
+   itself; a ThreadPool task. */
+static void FT_reclaim(void *pvReclaim) {
+   struct FT_Reclaim *psReclaim = pvReclaim;
+   size_t ulFreed;
+
+   assert(psReclaim != NULL);
+
+   ulFreed = Node_freeDetached(psReclaim->oNRoot, psReclaim->oPool);
+   (void) __atomic_add_fetch(&psReclaim->psFreed->ulNodes, ulFreed,
+                             __ATOMIC_ACQ_REL);
+   FT_releaseFreed(psReclaim->psFreed);
+   free(psReclaim);
+}
+
+/* Hands the FT_Reclaim pvReclaim to its pool, once no reader can
+   still be inside its subtree; a callback for Epoch_retire. */
+static void FT_queueReclaim(void *pvReclaim) {
+   struct FT_Reclaim *psReclaim = pvReclaim;
+
+   assert(psReclaim != NULL);
+
+   ThreadPool_spawnDetached(psReclaim->oPool, FT_reclaim, psReclaim);
+}
+
+/*
+  Removes the subtree rooted at oNNode from oFTree. Without a reclaim
+  pool, or if memory to describe the subtree to the pool could not be
+  allocated, frees it before returning. Otherwise only detaches it,
+  in time independent of its size, and leaves it to the pool. While
+  a snapshot of oFTree is live, detaches it and retires it instead,
+  and oNNode's parent must be safe to change (see FT_ownNode). Returns
+  SUCCESS, or MEMORY_ERROR, leaving oFTree unchanged, if a shared
+  parent's new children array could not be allocated.
+*/
+static int FT_removeSubtree(FT_T oFTree, Node_T oNNode) {
+   struct FT_Reclaim *psReclaim = NULL;
+   struct FT_Retired *psRetired;
+   size_t ulFreed;
+
+   assert(oFTree != NULL);
+   assert(oNNode != NULL);
+
+   FT_foldFreed(oFTree);
+   /* a snapshot may still see the subtree */
+   if(FT_hasSnapshots(oFTree)) {
+      psRetired = malloc(sizeof(struct FT_Retired));
+      if(psRetired == NULL)
+         return MEMORY_ERROR;
+      if(oNNode == oFTree->oNRoot)
+         __atomic_store_n(&oFTree->oNRoot, NULL, __ATOMIC_RELEASE);
+      else if(!Node_detach(oNNode)) {
+         free(psRetired);
+         return MEMORY_ERROR;
+      }
+      oFTree->ulCount -= Node_countSubtree(oNNode);
+      FT_retire(oFTree, psRetired, oNNode, TRUE);
+      return SUCCESS;
+   }
+   if(oFTree->oReclaimPool != NULL)
+      psReclaim = malloc(sizeof(struct FT_Reclaim));
+
+   /* unlink the root before freeing it, as the node layer unlinks any
+      other node, so that readers cannot reach a retired subtree */
+   if(oNNode == oFTree->oNRoot)
+      __atomic_store_n(&oFTree->oNRoot, NULL, __ATOMIC_RELEASE);
+
+   if(psReclaim == NULL) {
+      ulFreed = Node_free(oNNode);
+      if(ulFreed == 0)
+         return MEMORY_ERROR;
+      oFTree->ulCount -= ulFreed;
+      return SUCCESS;
+   }
+
+   if(!Node_detach(oNNode)) {
+      free(psReclaim);
+      return MEMORY_ERROR;
+   }
+   psReclaim->oNRoot = oNNode;
+   psReclaim->oPool = oFTree->oReclaimPool;
+   psReclaim->psFreed = oFTree->psFreed;
+   (void) __atomic_add_fetch(&oFTree->psFreed->ulRefs, 1,
+                             __ATOMIC_ACQ_REL);
+   /* readers of a shared tree may still be inside the subtree */
+   if(oFTree->psWriteLock != NULL)
+      Epoch_retire(psReclaim, FT_queueReclaim);
+   else
+      ThreadPool_spawnDetached(psReclaim->oPool, FT_reclaim, psReclaim);
+   return SUCCESS;
+}
+
+/* Frees the record of oFTree's removals since its last checkpoint. */
+static void FT_forgetRemoved(FT_T oFTree) {
+   size_t i;
+
+   assert(oFTree != NULL);
+
+   if(oFTree->oDRemoved == NULL)
+      return;
+   for(i = 0; i < DynArray_getLength(oFTree->oDRemoved); i++)
+      free(DynArray_get(oFTree->oDRemoved, i));
+   DynArray_free(oFTree->oDRemoved);
+   oFTree->oDRemoved = NULL;
+}
+
+/*
+  Clears the marks of oNNode and of every marked node below it. Only
+  dirty nodes are descended into, so this takes time in proportion
+  to the marked part of the subtree and the children of its nodes.
+*/
+static void FT_clearMarks(Node_T oNNode) {
+   Node_T oNChild = NULL;
+   size_t i;
+
+   assert(oNNode != NULL);
+
+   if(Node_getMarks(oNNode) == 0)
+      return;
+   Node_clearMarks(oNNode);
+   for(i = 0; i < Node_getNumFileChildren(oNNode); i++) {
+      (void) Node_getChild(oNNode, i, TRUE, &oNChild);
+      FT_clearMarks(oNChild);
+   }
+   for(i = 0; i < Node_getNumDirChildren(oNNode); i++) {
+      (void) Node_getChild(oNNode, i, FALSE, &oNChild);
+      FT_clearMarks(oNChild);
+   }
+}
+
+/*
+  Makes oFTree's current hierarchy its last checkpoint, from which
+  later changes are tracked.
+*/
+static void FT_startCheckpoint(FT_T oFTree) {
+   assert(oFTree != NULL);
+
+   if(oFTree->oNRoot != NULL)
+      FT_clearMarks(oFTree->oNRoot);
+   FT_forgetRemoved(oFTree);
+}
+
+/*
+  Removes the subtree rooted at oNNode from oFTree, as
+  FT_removeSubtree does, first recording oNNode's path as removed if
+  oNNode existed at the last checkpoint. Returns SUCCESS, or
+  MEMORY_ERROR, leaving oFTree unchanged.
+*/
+static int FT_removeTracked(FT_T oFTree, Node_T oNNode) {
+   const char *pcPath;
+   char *pcCopy = NULL;
+   Node_T oNParent;
+   int iStatus;
+
+   assert(oFTree != NULL);
+   assert(oNNode != NULL);
+   assert(!oFTree->bIsSnapshot);
+
+   /* a snapshot may see the parent, which is about to lose a child */
+   oNParent = Node_getParent(oNNode);
+   if(oNParent != NULL) {
+      iStatus = FT_ownNode(oFTree, oNParent, &oNParent);
+      if(iStatus != SUCCESS)
+         return iStatus;
+   }
+
+   /* nodes below a new node are new themselves */
+   if(!(Node_getMarks(oNNode) & NODE_NEW)) {
+      if(oFTree->oDRemoved == NULL) {
+         oFTree->oDRemoved = DynArray_new(0);
+         if(oFTree->oDRemoved == NULL)
+            return MEMORY_ERROR;
+      }
+      pcPath = Path_getPathname(Node_getPath(oNNode));
+      pcCopy = malloc(strlen(pcPath) + 1);
+      if(pcCopy == NULL)
+         return MEMORY_ERROR;
+      strcpy(pcCopy, pcPath);
+      if(!DynArray_add(oFTree->oDRemoved, pcCopy)) {
+         free(pcCopy);
+         return MEMORY_ERROR;
+      }
+   }
+
+   iStatus = FT_removeSubtree(oFTree, oNNode);
+   if(iStatus != SUCCESS && pcCopy != NULL) {
+      (void) DynArray_removeAt(oFTree->oDRemoved,
+                               DynArray_getLength(oFTree->oDRemoved)
+                               - 1);
+      free(pcCopy);
+   }
+   if(iStatus == SUCCESS && oNParent != NULL)
+      Node_clearRecord(oNParent);
+   return iStatus;
+}
+
+/*
+  FT_rmDirIn, for a caller that has already synchronized with other
+  threads.
+*/
+static int FT_rmDirUnlocked(FT_T oFTree, const char *pcPath) {
+   assert(oFTree != NULL);
+   assert(pcPath != NULL);
+
+   return (*FT_getBackend(oFTree)->pfRemove)(oFTree, pcPath, FALSE);
+}
+
+/*
+  FT_rmFileIn, for a caller that has already synchronized with other
+  threads.
+*/
+static int FT_rmFileUnlocked(FT_T oFTree, const char *pcPath) {
+   assert(oFTree != NULL);
+   assert(pcPath != NULL);
+
+   return (*FT_getBackend(oFTree)->pfRemove)(oFTree, pcPath, TRUE);
+}
+
+/* FT_rmDirUnlocked, for oFTree made of nodes. */
+static int FT_rmDirNodes(FT_T oFTree, const char *pcPath) {
+   int iStatus;
+   Node_T oNFound = NULL;
+
+   assert(oFTree != NULL);
+   assert(pcPath != NULL);
+   if(FT_containsFileUnlocked(oFTree, pcPath)){
+      return NOT_A_DIRECTORY;
+   }
+   iStatus = FT_findNode(oFTree, pcPath, &oNFound, FALSE);
+
+   if(iStatus != SUCCESS){
+       return iStatus;
+   } 
+   if(Node_isFile(oNFound))
+       return NOT_A_DIRECTORY;
+   return FT_removeTracked(oFTree, oNFound);
+}
+
+/* FT_rmFileUnlocked, for oFTree made of nodes. */
+static int FT_rmFileNodes(FT_T oFTree, const char *pcPath) {
+   int iStatus;
+   Node_T oNFound = NULL;
+
+   assert(oFTree != NULL);
+   assert(pcPath != NULL);
+   
+   if(FT_containsDirUnlocked(oFTree, pcPath)){
+      return NOT_A_FILE;
+   }
+
+   iStatus = FT_findNode(oFTree, pcPath, &oNFound, TRUE);
+   
+   if(iStatus != SUCCESS)
+       return iStatus;
+   if(!(Node_isFile(oNFound)))
+       return NOT_A_FILE;
+   return FT_removeTracked(oFTree, oNFound);
+}
+
+/* Unmaps the image that oFTree loads its directories from, if any. */
+static void FT_freeLazy(FT_T oFTree) {
+   assert(oFTree != NULL);
+
+   if(oFTree->psLazy == NULL)
+      return;
+   FTImage_close(oFTree->psLazy->oImage);
+   free(oFTree->psLazy);
+   oFTree->psLazy = NULL;
+}
+
+FT_T FT_new(void) {
+   FT_T oFTree;
+
+   oFTree = malloc(sizeof(struct FT));
+   if(oFTree == NULL)
+      return NULL;
+
+   oFTree->oNRoot = NULL;
+   oFTree->ulCount = 0;
+   oFTree->psWriteLock = NULL;
+   oFTree->oReclaimPool = NULL;
+   oFTree->psFreed = NULL;
+   oFTree->psBackend = &sNodeBackend;
+   oFTree->pvStore = NULL;
+   oFTree->oDRemoved = NULL;
+   oFTree->ulDeltas = 0;
+   oFTree->psVersions = NULL;
+   oFTree->bIsSnapshot = FALSE;
+   oFTree->ulGeneration = 0;
+   oFTree->psLazy = NULL;
+   oFTree->psSave = NULL;
+   return oFTree;
+}
+
+FT_T FT_newConcurrent(void) {
+   FT_T oFTree;
+
+   oFTree = FT_new();
+   if(oFTree == NULL)
+      return NULL;
+
+   oFTree->psWriteLock = malloc(sizeof(pthread_rwlock_t));
+   if(oFTree->psWriteLock == NULL) {
+      free(oFTree);
+      return NULL;
+   }
+   if(pthread_rwlock_init(oFTree->psWriteLock, NULL) != 0) {
+      free(oFTree->psWriteLock);
+      free(oFTree);
+      return NULL;
+   }
+   return oFTree;
+}
+
+void FT_free(FT_T oFTree) {
+   if(oFTree == NULL)
+      return;
+
+   if(oFTree->psSave != NULL)
+      (void) FT_finishSave(oFTree->psSave);
+   if(oFTree->bIsSnapshot) {
+      FT_releaseSnapshot(oFTree);
+      return;
+   }
+
+   if(oFTree->oNRoot != NULL)
+      (void) FT_removeSubtree(oFTree, oFTree->oNRoot);
+   if(oFTree->psWriteLock != NULL) {
+      /* return the retired nodes' memory now rather than whenever
+         some later writer gets around to it */
+      Epoch_synchronize();
+      (void) pthread_rwlock_destroy(oFTree->psWriteLock);
+      free(oFTree->psWriteLock);
+   }
+   FT_releaseFreed(oFTree->psFreed);
+   (*oFTree->psBackend->pfFreeStore)(oFTree);
+   FT_forgetRemoved(oFTree);
+   FT_freeVersions(oFTree);
+   FT_freeLazy(oFTree);
+   free(oFTree);
+}
+
+/*
+  Adds the node for psRecord, and for any of its ancestors that do not
+  exist yet, to the tree being built by FT_buildFromSorted. oDOpen
+  holds the tree's open directories: the root and the chain of most
+  recently added directories below it, in order of depth. Every new
+  node is appended after its siblings, so psRecord must sort after
+  every record added so far. Sets *poNBuiltRoot if a root is created,
+  adds the number of new nodes to *pulNewNodes, and updates oDOpen to
+  end with the deepest new directory.
+  Returns SUCCESS or any of the statuses of FT_newFromSorted.
+*/
+static int FT_appendRecord(const struct FT_Record *psRecord,
+                           DynArray_T oDOpen, Node_T *poNBuiltRoot,
+                           size_t *pulNewNodes) {
+   int iStatus;
+   Path_T oPPath = NULL;
+   Path_T oPPrefix = NULL;
+   Node_T oNNew = NULL;
+   Node_T oNParent;
+   size_t ulDepth, ulLevel, ulOpen, ulShared, ulChildID;
+   boolean bIsFile;
+
+   assert(psRecord != NULL);
+   assert(psRecord->pcPath != NULL);
+   assert(oDOpen != NULL);
+   assert(poNBuiltRoot != NULL);
+   assert(pulNewNodes != NULL);
+
+   iStatus = Path_new(psRecord->pcPath, &oPPath);
+   if(iStatus != SUCCESS)
+      return iStatus;
+   ulDepth = Path_getDepth(oPPath);
+
+   /* putting a file at the root is illegal */
+   if(ulDepth == 1 && psRecord->bIsFile) {
+      Path_free(oPPath);
+      return CONFLICTING_PATH;
+   }
+
+   /* close the open directories that are not proper prefixes of
+      this record's path */
+   ulOpen = DynArray_getLength(oDOpen);
+   if(ulOpen > 0) {
+      ulShared = Path_getSharedPrefixDepth(oPPath,
+                   Node_getPath(DynArray_get(oDOpen, ulOpen - 1)));
+      if(ulShared == 0) {
+         Path_free(oPPath);
+         return CONFLICTING_PATH;
+      }
+      if(ulDepth == 1) {
+         Path_free(oPPath);
+         return ALREADY_IN_TREE;
+      }
+      if(ulShared > ulDepth - 1)
+         ulShared = ulDepth - 1;
+      while(ulOpen > ulShared) {
+         (void) DynArray_removeAt(oDOpen, ulOpen - 1);
+         ulOpen--;
+      }
+   }
+
+   /* starting below the deepest open directory, append the rest of
+      the path one level at a time */
+   for(ulLevel = ulOpen + 1; ulLevel <= ulDepth; ulLevel++) {
+      bIsFile = (boolean) (ulLevel == ulDepth && psRecord->bIsFile);
+      iStatus = Path_prefix(oPPath, ulLevel, &oPPrefix);
+      if(iStatus != SUCCESS) {
+         Path_free(oPPath);
+         return iStatus;
+      }
+
+      if(ulLevel == 1) {
+         iStatus = Node_new(oPPrefix, NULL, &oNNew, FALSE, NULL, 0);
+         if(iStatus == SUCCESS)
+            *poNBuiltRoot = oNNew;
+      }
+      else {
+         oNParent = DynArray_get(oDOpen, ulLevel - 2);
+         /* files precede directories, so a file sibling with the
+            same name would already have been appended */
+         if(!bIsFile &&
+            Node_hasChild(oNParent, oPPrefix, TRUE, &ulChildID))
+            iStatus = (ulLevel == ulDepth) ? ALREADY_IN_TREE
+                                           : NOT_A_DIRECTORY;
+         else
+            iStatus = Node_append(oPPrefix, oNParent, &oNNew, bIsFile,
+                                  psRecord->pvContents,
+                                  psRecord->ulLength);
+      }
+      Path_free(oPPrefix);
+      oPPrefix = NULL;
+      if(iStatus != SUCCESS) {
+         Path_free(oPPath);
+         return iStatus;
+      }
+
+      (*pulNewNodes)++;
+      if(!bIsFile && !DynArray_add(oDOpen, oNNew)) {
+         Path_free(oPPath);
+         return MEMORY_ERROR;
+      }
+   }
+
+   Path_free(oPPath);
+   return SUCCESS;
+}
+
+/*
+  Fills oFTree, which must be empty, with the nodes described by the
+  ulNumRecords records in psRecords, as FT_newFromSorted does.
+  Returns SUCCESS, or leaves oFTree empty and returns any of the
+  statuses of FT_newFromSorted.
+*/
+static int FT_build(FT_T oFTree, const struct FT_Record *psRecords,
+                    size_t ulNumRecords) {
+   int iStatus = SUCCESS;
+   DynArray_T oDOpen;
+   Node_T oNBuiltRoot = NULL;
+   size_t ulNewNodes = 0;
+   size_t i;
+   int iCompare;
+
+   assert(oFTree != NULL);
+   assert(oFTree->oNRoot == NULL);
+   assert(psRecords != NULL || ulNumRecords == 0);
+
+   oDOpen = DynArray_new(0);
+   if(oDOpen == NULL)
+      return MEMORY_ERROR;
+
+   for(i = 0; i < ulNumRecords && iStatus == SUCCESS; i++) {
+      assert(psRecords[i].pcPath != NULL);
+
+      if(i > 0) {
+         iCompare = StrSort_comparePaths(psRecords[i-1].pcPath,
+                                         psRecords[i-1].bIsFile,
+                                         psRecords[i].pcPath,
+                                         psRecords[i].bIsFile);
+         if(iCompare == 0) {
+            iStatus = ALREADY_IN_TREE;
+            break;
+         }
+         if(iCompare > 0) {
+            iStatus = BAD_PATH;
+            break;
+         }
+      }
+
+      iStatus = FT_appendRecord(&psRecords[i], oDOpen, &oNBuiltRoot,
+                                &ulNewNodes);
+   }
+   DynArray_free(oDOpen);
+
+   if(iStatus != SUCCESS) {
+      if(oNBuiltRoot != NULL)
+         (void) Node_free(oNBuiltRoot);
+      return iStatus;
+   }
+
+   oFTree->oNRoot = oNBuiltRoot;
+   oFTree->ulCount += ulNewNodes;
+   return SUCCESS;
+}
+
+int FT_newFromSorted(const struct FT_Record *psRecords,
+                     size_t ulNumRecords, FT_T *poFResult) {
+   int iStatus;
+
+   assert(psRecords != NULL || ulNumRecords == 0);
+   assert(poFResult != NULL);
+
+   *poFResult = FT_new();
+   if(*poFResult == NULL)
+      return MEMORY_ERROR;
+
+   iStatus = FT_build(*poFResult, psRecords, ulNumRecords);
+   if(iStatus != SUCCESS) {
+      FT_free(*poFResult);
+      *poFResult = NULL;
+   }
+   return iStatus;
+}
+
+/*
+  FT_statIn, for a caller that has already synchronized with other
+  threads.
+*/
+static int FT_statUnlocked(FT_T oFTree, const char *pcPath,
+                           boolean *pbIsFile, size_t *pulSize) {
+   assert(oFTree != NULL);
+   assert(pcPath != NULL);
+   assert(pbIsFile != NULL);
+   assert(pulSize != NULL);
+
+   return (*FT_getBackend(oFTree)->pfStat)(oFTree, pcPath, pbIsFile,
+                                           pulSize, NULL);
+}
+
+/*
+  FT_statUnlocked, for oFTree made of nodes, also setting *ppvContents
+  to a file's contents if ppvContents is not NULL.
+*/
+static int FT_statNodes(FT_T oFTree, const char *pcPath,
+                        boolean *pbIsFile, size_t *pulSize,
+                        void **ppvContents) {
+    int iStatus;
+    Node_T oNFound = NULL;
+    DynArray_T oDSubstrings;
+    const char *pcStart = pcPath;
+    const char *pcEnd = pcPath;
+    assert(oFTree != NULL);
+    assert(pcPath != NULL);
+    assert(pbIsFile != NULL);
+    assert(pulSize != NULL);
+
+    if (*pcPath == '\0') {
+        return BAD_PATH;
+    }
+
+    oDSubstrings = DynArray_new(0);
+    if (oDSubstrings == NULL) {
+        return MEMORY_ERROR;
+    }
 
     /* validate and split pcPath */
     while (*pcEnd != '\0') {
@@ -391,379 +2015,2889 @@ int FT_stat(const char *pcPath, boolean *pbIsFile, size_t *pulSize) {
             DynArray_map(oDSubstrings,
                          (void (*)(void *, void *))Path_freeString, NULL);
             DynArray_free(oDSubstrings);
-            return BAD_PATH;
-        }
+            return BAD_PATH;
+        }
+
+        /* advance pcEnd to end of next token */
+        while (*pcEnd != '/' && *pcEnd != '\0') pcEnd++;
+
+        /* final component can't end with slash */
+        if (*pcEnd == '\0' && *(pcEnd - 1) == '/') {
+            DynArray_map(oDSubstrings,
+                         (void (*)(void *, void *))Path_freeString, NULL);
+            DynArray_free(oDSubstrings);
+            return BAD_PATH;
+        }
+
+        while (pcStart != pcEnd) {
+            pcStart++;
+        }
+
+        pcStart++;
+    }
+
+
+    /* *pbIsFile is only an output, so try a file first, then a
+       directory */
+    iStatus = FT_findNode(oFTree, pcPath, &oNFound, TRUE);
+    if(iStatus != SUCCESS){
+        iStatus = FT_findNode(oFTree, pcPath, &oNFound, FALSE);
+         if(iStatus != SUCCESS){
+            DynArray_map(oDSubstrings,
+                         (void (*)(void *, void *))Path_freeString, NULL);
+            DynArray_free(oDSubstrings);
+            return iStatus;
+         }
+    }
+    *pbIsFile = Node_isFile(oNFound);
+    if(Node_isFile(oNFound)){
+        *pulSize = Node_getUlLength(oNFound);
+        if(ppvContents != NULL)
+            *ppvContents = Node_getValue(oNFound);
+    }
+   DynArray_map(oDSubstrings,
+                         (void (*)(void *, void *))Path_freeString, NULL);
+   DynArray_free(oDSubstrings);
+    return SUCCESS;
+}
+
+/*
+  FT_getFileContentsIn, for a caller that has already synchronized
+  with other threads.
+*/
+static void *FT_getFileContentsUnlocked(FT_T oFTree,
+                                       const char *pcPath) {
+   boolean bIsFile;
+   size_t ulSize;
+   void *pvContents = NULL;
+
+   assert(oFTree != NULL);
+   assert(pcPath != NULL);
+
+   if((*FT_getBackend(oFTree)->pfStat)(oFTree, pcPath, &bIsFile,
+                                       &ulSize, &pvContents) !=
+      SUCCESS || !bIsFile)
+      return NULL;
+   return pvContents;
+}
+
+/*
+  FT_replaceFileContentsIn, for a caller that has already synchronized
+  with other threads.
+*/
+static void *FT_replaceFileContentsUnlocked(FT_T oFTree,
+                                           const char *pcPath,
+                                           void *pvNewContents,
+                                           size_t ulNewLength) {
+   void *pvOldContents;
+
+   assert(oFTree != NULL);
+   assert(pcPath != NULL);
+
+   if((*FT_getBackend(oFTree)->pfReplace)(oFTree, pcPath,
+                                          pvNewContents, ulNewLength,
+                                          &pvOldContents) != SUCCESS)
+      return NULL;
+   return pvOldContents;
+}
+
+/* FT_replaceFileContentsUnlocked, for oFTree made of nodes. */
+static int FT_replaceNodes(FT_T oFTree, const char *pcPath,
+                           void *pvNewContents, size_t ulNewLength,
+                           void **ppvOldContents) {
+    int iStatus;
+    Node_T oNFound = NULL;
+    assert(oFTree != NULL);
+    assert(pcPath != NULL);
+    assert(ppvOldContents != NULL);
+    if(!FT_containsFileUnlocked(oFTree, pcPath)){
+        return NO_SUCH_PATH;
+    }
+    iStatus = FT_findNode(oFTree, pcPath, &oNFound, TRUE);
+    if(iStatus != SUCCESS){
+        return iStatus;
+    }
+    
+    if(Node_isFile(oNFound)){
+        void* oldContent = Node_getValue(oNFound);
+        iStatus = FT_ownNode(oFTree, oNFound, &oNFound);
+        if(iStatus != SUCCESS)
+            return iStatus;
+        Node_setValue(oNFound, pvNewContents);
+        Node_setUlLength(oNFound, ulNewLength);
+        Node_mark(oNFound, NODE_CHANGED);
+        Node_clearRecord(oNFound);
+        *ppvOldContents = oldContent;
+        return SUCCESS;
+    }
+    return NOT_A_FILE;
+}
+
+
+/*
+  Creates the nodes for levels ulLevel through the depth of oPPath:
+  the first as a child of oNParent, or as oFTree's new root if
+  oNParent is NULL, and each other one as a child of the one before.
+  The last node is a file with contents pvContents of ulLength bytes
+  if bIsFile, and every other node is a directory. If oNParent is
+  locked, the new nodes are born locked (see Node_getVersion) and are
+  unlocked, deepest first, once the whole chain is in place.
+  Sets *poNFirstNew to the first new node and *pulNewNodes to the
+  number of nodes created, and returns SUCCESS. Otherwise, frees any
+  nodes already created and returns any status of Node_new.
+*/
+static int FT_buildChain(FT_T oFTree, Path_T oPPath, size_t ulLevel,
+                         Node_T oNParent, boolean bIsFile,
+                         void *pvContents, size_t ulLength,
+                         Node_T *poNFirstNew, size_t *pulNewNodes) {
+   int iStatus = SUCCESS;
+   Path_T oPPrefix = NULL;
+   Node_T oNCurr = oNParent;
+   Node_T oNNewNode = NULL;
+   size_t ulDepth;
+
+   assert(oFTree != NULL);
+   assert(oPPath != NULL);
+   assert(poNFirstNew != NULL);
+   assert(pulNewNodes != NULL);
+   assert(!oFTree->bIsSnapshot);
+
+   *poNFirstNew = NULL;
+   *pulNewNodes = 0;
+   ulDepth = Path_getDepth(oPPath);
+   for(; ulLevel <= ulDepth; ulLevel++) {
+      /* generate a Path_T for this level */
+      iStatus = Path_prefix(oPPath, ulLevel, &oPPrefix);
+      if(iStatus != SUCCESS)
+         break;
+
+      /* insert the new node for this level: directories, except
+         possibly the last */
+      iStatus = Node_new(oPPrefix, oNCurr, &oNNewNode,
+                         (boolean) (bIsFile && ulLevel == ulDepth),
+                         pvContents, ulLength);
+      Path_free(oPPrefix);
+      oPPrefix = NULL;
+      if(iStatus != SUCCESS)
+         break;
+
+      /* nodes below the root of a concurrent tree inherit its
+         sharing */
+      if(oNCurr == NULL && oFTree->psWriteLock != NULL)
+         Node_setShared(oNNewNode);
+      Node_setGeneration(oNNewNode, FT_getGeneration(oFTree));
+      Node_mark(oNNewNode, NODE_NEW);
+
+      /* set up for next level */
+      oNCurr = oNNewNode;
+      (*pulNewNodes)++;
+      if(*poNFirstNew == NULL)
+         *poNFirstNew = oNCurr;
+   }
+
+   if(iStatus != SUCCESS) {
+      if(*poNFirstNew != NULL)
+         (void) Node_free(*poNFirstNew);
+      *poNFirstNew = NULL;
+      *pulNewNodes = 0;
+      return iStatus;
+   }
+
+   if(oNParent != NULL)
+      Node_clearRecord(oNParent);
+   /* unlocking from the bottom up keeps other writers out of the
+      chain until it is complete */
+   if(oNParent != NULL && (Node_getVersion(oNParent) & 1))
+      for(; oNCurr != oNParent; oNCurr = Node_getParent(oNCurr))
+         Node_unlock(oNCurr);
+   return SUCCESS;
+}
+
+/*
+  FT_insertDirIn, for a caller that has already synchronized with other
+  threads.
+*/
+static int FT_insertDirUnlocked(FT_T oFTree, const char *pcPath) {
+   assert(oFTree != NULL);
+   assert(pcPath != NULL);
+
+   return (*FT_getBackend(oFTree)->pfInsert)(oFTree, pcPath, FALSE,
+                                             NULL, 0);
+}
+
+/*
+  FT_insertFileIn, for a caller that has already synchronized with other
+  threads.
+*/
+static int FT_insertFileUnlocked(FT_T oFTree, const char *pcPath,
+                                void *pvContents, size_t ulLength) {
+   assert(oFTree != NULL);
+   assert(pcPath != NULL);
+
+   return (*FT_getBackend(oFTree)->pfInsert)(oFTree, pcPath, TRUE,
+                                             pvContents, ulLength);
+}
+
+/* FT_insertDirUnlocked, for oFTree made of nodes. */
+static int FT_insertDirNodes(FT_T oFTree, const char *pcPath) {
+   int iStatus;
+   Path_T oPPath = NULL, zPPath = NULL;
+   Node_T oNFirstNew = NULL;
+   Node_T oNCurr = NULL;
+   size_t ulDepth, ulIndex;
+   size_t ulNewNodes = 0;
+
+   assert(oFTree != NULL);
+   assert(pcPath != NULL);
+
+   /* validate pcPath and generate a Path_T for it */
+   iStatus = Path_new(pcPath, &oPPath);
+   if(iStatus != SUCCESS)
+      return iStatus;
+
+   /* find the closest ancestor of oPPath already in the tree */
+   iStatus = FT_traversePath(oFTree, oPPath, FALSE, &oNCurr);
+   if(iStatus != SUCCESS)
+   {
+      Path_free(oPPath);
+      return iStatus;
+   }
+
+   /* no ancestor node found, so if root is not NULL,
+      pcPath isn't underneath root. */
+   if(oNCurr == NULL && oFTree->oNRoot != NULL) {
+      Path_free(oPPath);
+      return CONFLICTING_PATH;
+   }
+
+   iStatus = Path_new(pcPath, &zPPath);
+   if(iStatus != SUCCESS){
+      Path_free(oPPath);
+      Path_free(zPPath);
+      return iStatus;
+   }
+
+   iStatus = FT_traversePath(oFTree, zPPath, TRUE, &oNCurr);
+   if(iStatus != SUCCESS) {
+      Path_free(oPPath);
+      Path_free(zPPath);
+      return iStatus;
+   }
+   ulDepth = Path_getDepth(zPPath);
+   if(oNCurr == NULL) /* new root! */
+      ulIndex = 1;
+   else {
+      ulIndex = Path_getDepth(Node_getPath(oNCurr))+1;
+      /* oNCurr is the node we're trying to insert */
+      if(ulIndex == ulDepth+1 && !Path_comparePath(zPPath,
+                                       Node_getPath(oNCurr))) {
+         Path_free(oPPath);
+         Path_free(zPPath);
+         return ALREADY_IN_TREE;
+      }
+   }
+   iStatus = FT_traversePath(oFTree, oPPath, FALSE, &oNCurr);
+   if(iStatus != SUCCESS) {
+      Path_free(oPPath);
+      Path_free(zPPath);
+      return iStatus;
+   }
+   ulDepth = Path_getDepth(oPPath);
+   if(oNCurr == NULL) /* new root! */
+      ulIndex = 1;
+   else {
+      ulIndex = Path_getDepth(Node_getPath(oNCurr))+1;
+      if(ulIndex == ulDepth+1 && !Path_comparePath(oPPath,
+                                       Node_getPath(oNCurr))) {
+         Path_free(oPPath);
+         Path_free(zPPath);
+         return ALREADY_IN_TREE;
+      }
+   }
+
+   /* a snapshot may see oNCurr, which is about to gain a child */
+   if(oNCurr != NULL) {
+      iStatus = FT_ownNode(oFTree, oNCurr, &oNCurr);
+      if(iStatus != SUCCESS) {
+         Path_free(oPPath);
+         Path_free(zPPath);
+         return iStatus;
+      }
+   }
+
+   /* starting at oNCurr, build rest of the path one level at a time */
+   iStatus = FT_buildChain(oFTree, oPPath, ulIndex, oNCurr, FALSE,
+                           NULL, 0, &oNFirstNew, &ulNewNodes);
+   Path_free(oPPath);
+   Path_free(zPPath);
+   if(iStatus != SUCCESS)
+      return iStatus;
+   /* update FT state variables to reflect insertion */
+   if(oFTree->oNRoot == NULL)
+      __atomic_store_n(&oFTree->oNRoot, oNFirstNew, __ATOMIC_RELEASE);
+   oFTree->ulCount += ulNewNodes;
+
+   return SUCCESS;
+}
+
+/* FT_insertFileUnlocked, for oFTree made of nodes. */
+static int FT_insertFileNodes(FT_T oFTree, const char *pcPath,
+                              void *pvContents, size_t ulLength) {
+   int iStatus;
+   Path_T oPPath = NULL, zPPath = NULL;
+   Node_T oNFirstNew = NULL;
+   Node_T oNCurr = NULL;
+   size_t ulDepth, ulIndex;
+   size_t ulNewNodes = 0;
+
+   assert(oFTree != NULL);
+   assert(pcPath != NULL);
+
+   /* validate pcPath and generate a Path_T for it */
+   iStatus = Path_new(pcPath, &oPPath);
+   if(iStatus != SUCCESS){
+      Path_free(oPPath);
+      return iStatus;
+   }
+
+   /* find the closest ancestor of oPPath already in the tree */
+   iStatus = FT_traversePath(oFTree, oPPath, TRUE, &oNCurr);
+   if(iStatus != SUCCESS)
+   {
+      Path_free(oPPath);
+      return iStatus;
+   }
+  
+   /*oNCurr is at the root*/
+   if(oNCurr == NULL && oFTree->oNRoot == NULL && Path_getDepth(oPPath) == 1)
+   {
+      Path_free(oPPath);
+      return CONFLICTING_PATH;
+   }
+   /* no ancestor node found, so if root is not NULL,
+      pcPath isn't underneath root. */
+   if(oNCurr == NULL && oFTree->oNRoot != NULL) {
+      Path_free(oPPath);
+      return CONFLICTING_PATH;
+   }
+   /* ulDepth = Path_getDepth(oPPath); */
+   iStatus = Path_new(pcPath, &zPPath);
+   if(iStatus != SUCCESS){
+      Path_free(oPPath);
+      Path_free(zPPath);
+      return iStatus;
+   }
+
+   /* find the closest ancestor of oPPath already in the tree */
+   iStatus = FT_traversePath(oFTree, zPPath, FALSE, &oNCurr);
+   if(iStatus != SUCCESS) {
+      Path_free(oPPath);
+      Path_free(zPPath);
+      return iStatus;
+   }
+   ulDepth = Path_getDepth(zPPath);
+   if(oNCurr == NULL) /* new root! */
+      ulIndex = 1;
+   else {
+      ulIndex = Path_getDepth(Node_getPath(oNCurr))+1;
+      /* oNCurr is the node we're trying to insert */
+      if(ulIndex == ulDepth+1 && !Path_comparePath(zPPath,
+                                       Node_getPath(oNCurr))) {
+         Path_free(oPPath);
+         Path_free(zPPath);
+         return ALREADY_IN_TREE;
+      }
+   }
+   iStatus = FT_traversePath(oFTree, oPPath, TRUE, &oNCurr);
+   if(iStatus != SUCCESS) {
+      Path_free(oPPath);
+      Path_free(zPPath);
+      return iStatus;
+   }
+   ulDepth = Path_getDepth(oPPath);
+   if(oNCurr == NULL) /* new root! */
+      ulIndex = 1;
+   else {
+      ulIndex = Path_getDepth(Node_getPath(oNCurr))+1;
+      if(ulIndex == ulDepth+1 && !Path_comparePath(oPPath,
+                                       Node_getPath(oNCurr))) {
+         Path_free(oPPath);
+         Path_free(zPPath);
+         return ALREADY_IN_TREE;
+      }
+   }
+
+   /* a snapshot may see oNCurr, which is about to gain a child */
+   if(oNCurr != NULL) {
+      iStatus = FT_ownNode(oFTree, oNCurr, &oNCurr);
+      if(iStatus != SUCCESS) {
+         Path_free(oPPath);
+         Path_free(zPPath);
+         return iStatus;
+      }
+   }
+
+   /* starting at oNCurr, build rest of the path one level at a time */
+   iStatus = FT_buildChain(oFTree, oPPath, ulIndex, oNCurr, TRUE,
+                           pvContents, ulLength, &oNFirstNew,
+                           &ulNewNodes);
+   Path_free(zPPath);
+   Path_free(oPPath);
+   if(iStatus != SUCCESS)
+      return iStatus;
+   /* update FT state variables to reflect insertion */
+   if(oFTree->oNRoot == NULL)
+      __atomic_store_n(&oFTree->oNRoot, oNFirstNew, __ATOMIC_RELEASE);
+   oFTree->ulCount += ulNewNodes;
+
+   return SUCCESS;
+}
+
+/*
+  FT_insertFileUnlocked if bIsFile, or FT_insertDirUnlocked otherwise,
+  for oFTree made of nodes.
+*/
+static int FT_insertNodes(FT_T oFTree, const char *pcPath,
+                          boolean bIsFile, void *pvContents,
+                          size_t ulLength) {
+   assert(oFTree != NULL);
+   assert(pcPath != NULL);
+
+   if(bIsFile)
+      return FT_insertFileNodes(oFTree, pcPath, pvContents, ulLength);
+   return FT_insertDirNodes(oFTree, pcPath);
+}
+
+/*
+  FT_rmFileUnlocked if bIsFile, or FT_rmDirUnlocked otherwise, for
+  oFTree made of nodes.
+*/
+static int FT_removeNodes(FT_T oFTree, const char *pcPath,
+                          boolean bIsFile) {
+   assert(oFTree != NULL);
+   assert(pcPath != NULL);
+
+   if(bIsFile)
+      return FT_rmFileNodes(oFTree, pcPath);
+   return FT_rmDirNodes(oFTree, pcPath);
+}
+
+/*
+  FT_syncIn, for oFTree with nothing to sync: one made of nodes, or
+  one that may not be changed.
+*/
+static int FT_syncNothing(FT_T oFTree) {
+   assert(oFTree != NULL);
+
+   return SUCCESS;
+}
+
+/*
+  Frees the store of oFTree made of nodes, which has none: FT_free
+  frees the nodes themselves.
+*/
+static void FT_freeNodes(FT_T oFTree) {
+   assert(oFTree != NULL);
+   assert(oFTree->pvStore == NULL);
+}
+
+/* The pfInsert of a read-only File Tree. */
+static int FT_refuseInsert(FT_T oFTree, const char *pcPath,
+                           boolean bIsFile, void *pvContents,
+                           size_t ulLength) {
+   assert(oFTree != NULL);
+   assert(pcPath != NULL);
+
+   (void) bIsFile;
+   (void) pvContents;
+   (void) ulLength;
+   return READ_ONLY_TREE;
+}
+
+/* The pfRemove of a read-only File Tree. */
+static int FT_refuseRemove(FT_T oFTree, const char *pcPath,
+                           boolean bIsFile) {
+   assert(oFTree != NULL);
+   assert(pcPath != NULL);
+
+   (void) bIsFile;
+   return READ_ONLY_TREE;
+}
+
+/* The pfReplace of a read-only File Tree. */
+static int FT_refuseReplace(FT_T oFTree, const char *pcPath,
+                            void *pvNewContents, size_t ulNewLength,
+                            void **ppvOldContents) {
+   assert(oFTree != NULL);
+   assert(pcPath != NULL);
+
+   (void) pvNewContents;
+   (void) ulNewLength;
+   (void) ppvOldContents;
+   return READ_ONLY_TREE;
+}
+
+/* FT_statNodes, for oFTree held in an image. */
+static int FT_statImage(FT_T oFTree, const char *pcPath,
+                        boolean *pbIsFile, size_t *pulSize,
+                        void **ppvContents) {
+   assert(oFTree != NULL);
+
+   return FTImage_stat((FTImage_T) oFTree->pvStore, pcPath, pbIsFile,
+                       pulSize, ppvContents);
+}
+
+/* FT_toStringNodes, for oFTree held in an image. */
+static char *FT_toStringImage(FT_T oFTree) {
+   assert(oFTree != NULL);
+
+   return FTImage_toString((FTImage_T) oFTree->pvStore);
+}
+
+/* Unmaps the image that oFTree is held in. */
+static void FT_freeImage(FT_T oFTree) {
+   assert(oFTree != NULL);
+
+   FTImage_close((FTImage_T) oFTree->pvStore);
+}
+
+/* FT_statNodes, for oFTree held in an arena. */
+static int FT_statArena(FT_T oFTree, const char *pcPath,
+                        boolean *pbIsFile, size_t *pulSize,
+                        void **ppvContents) {
+   assert(oFTree != NULL);
+
+   return FTArena_stat((FTArena_T) oFTree->pvStore, pcPath, pbIsFile,
+                       pulSize, ppvContents);
+}
+
+/* FT_toStringNodes, for oFTree held in an arena. */
+static char *FT_toStringArena(FT_T oFTree) {
+   assert(oFTree != NULL);
+
+   return FTArena_toString((FTArena_T) oFTree->pvStore);
+}
+
+/* FT_insertNodes, for oFTree held in an arena. */
+static int FT_insertArena(FT_T oFTree, const char *pcPath,
+                          boolean bIsFile, void *pvContents,
+                          size_t ulLength) {
+   assert(oFTree != NULL);
+
+   return FTArena_insert((FTArena_T) oFTree->pvStore, pcPath, bIsFile,
+                         pvContents, ulLength);
+}
+
+/* FT_removeNodes, for oFTree held in an arena. */
+static int FT_removeArena(FT_T oFTree, const char *pcPath,
+                          boolean bIsFile) {
+   assert(oFTree != NULL);
+
+   return FTArena_remove((FTArena_T) oFTree->pvStore, pcPath, bIsFile);
+}
+
+/* FT_replaceNodes, for oFTree held in an arena. */
+static int FT_replaceArena(FT_T oFTree, const char *pcPath,
+                           void *pvNewContents, size_t ulNewLength,
+                           void **ppvOldContents) {
+   assert(oFTree != NULL);
+
+   return FTArena_replace((FTArena_T) oFTree->pvStore, pcPath,
+                          pvNewContents, ulNewLength, ppvOldContents);
+}
+
+/* FT_syncIn, for oFTree held in an arena. */
+static int FT_syncArena(FT_T oFTree) {
+   assert(oFTree != NULL);
+
+   return FTArena_sync((FTArena_T) oFTree->pvStore);
+}
+
+/* Closes the arena that oFTree is held in. */
+static void FT_freeArena(FT_T oFTree) {
+   assert(oFTree != NULL);
+
+   FTArena_close((FTArena_T) oFTree->pvStore);
+}
+
+/* FT_statNodes, for oFTree held in a frozen form. */
+static int FT_statFrozen(FT_T oFTree, const char *pcPath,
+                         boolean *pbIsFile, size_t *pulSize,
+                         void **ppvContents) {
+   assert(oFTree != NULL);
+
+   return FTFrozen_stat((FTFrozen_T) oFTree->pvStore, pcPath, pbIsFile,
+                        pulSize, ppvContents);
+}
+
+/* FT_toStringNodes, for oFTree held in a frozen form. */
+static char *FT_toStringFrozen(FT_T oFTree) {
+   assert(oFTree != NULL);
+
+   return FTFrozen_toString((FTFrozen_T) oFTree->pvStore);
+}
+
+/* Frees the frozen form that oFTree is held in. */
+static void FT_freeFrozen(FT_T oFTree) {
+   assert(oFTree != NULL);
+
+   FTFrozen_free((FTFrozen_T) oFTree->pvStore);
+}
+
+/* The operations on a File Tree made of nodes. */
+static const struct FT_Backend sNodeBackend = {
+   FT_statNodes, FT_containsNodes, FT_toStringNodes, FT_insertNodes,
+   FT_removeNodes, FT_replaceNodes, FT_syncNothing, FT_freeNodes,
+   FALSE, SUCCESS
+};
+
+/*
+  The operations on a snapshot, which is made of nodes that it shares
+  with the File Tree that it is of (see FT_snapshotIn).
+*/
+static const struct FT_Backend sSnapshotBackend = {
+   FT_statNodes, FT_containsNodes, FT_toStringNodes, FT_refuseInsert,
+   FT_refuseRemove, FT_refuseReplace, FT_syncNothing, FT_freeNodes,
+   TRUE, SUCCESS
+};
+
+/* The operations on a File Tree held in an image (see ftimage.h). */
+static const struct FT_Backend sImageBackend = {
+   FT_statImage, FT_containsStored, FT_toStringImage, FT_refuseInsert,
+   FT_refuseRemove, FT_refuseReplace, FT_syncNothing, FT_freeImage,
+   TRUE, READ_ONLY_TREE
+};
+
+/* The operations on a File Tree held in an arena (see ftarena.h). */
+static const struct FT_Backend sArenaBackend = {
+   FT_statArena, FT_containsStored, FT_toStringArena, FT_insertArena,
+   FT_removeArena, FT_replaceArena, FT_syncArena, FT_freeArena,
+   FALSE, NOT_SUPPORTED
+};
+
+/*
+  The operations on a File Tree held in a frozen form (see
+  ftfrozen.h).
+*/
+static const struct FT_Backend sFrozenBackend = {
+   FT_statFrozen, FT_containsStored, FT_toStringFrozen,
+   FT_refuseInsert, FT_refuseRemove, FT_refuseReplace, FT_syncNothing,
+   FT_freeFrozen, TRUE, READ_ONLY_TREE
+};
+
+
+/* The progress of one lookup that FT_lookupManyUnlocked advances. */
+struct FT_Cursor {
+   /* the lookup, which is FT_OP_STAT or FT_OP_GET_CONTENTS */
+   struct FT_Op *psOp;
+   /* the deepest node on the lookup's path reached so far */
+   Node_T oNCurr;
+   /* the length of oNCurr's path, as a prefix of psOp->pcPath */
+   size_t ulEnd;
+   /* the length of the path of the child of oNCurr being sought */
+   size_t ulNext;
+   /* 0 while oNCurr is being loaded, then 1 or 2 while the first or
+      second of its children arrays is being searched */
+   int iStage;
+   /* the search of oNCurr's children under way */
+   struct Node_Search sSearch;
+};
+
+/*
+  Completes the lookup of psCursor with status iStatus, having found
+  oNFound if iStatus is SUCCESS.
+*/
+static void FT_finishLookup(struct FT_Cursor *psCursor, int iStatus,
+                            Node_T oNFound) {
+   struct FT_Op *psOp;
+
+   assert(psCursor != NULL);
+
+   psOp = psCursor->psOp;
+   psOp->pvResult = NULL;
+   if(iStatus == SUCCESS) {
+      psOp->bIsFile = Node_isFile(oNFound);
+      if(psOp->bIsFile) {
+         psOp->ulSize = Node_getUlLength(oNFound);
+         if(psOp->eKind == FT_OP_GET_CONTENTS)
+            psOp->pvResult = Node_getValue(oNFound);
+      }
+      else if(psOp->eKind == FT_OP_GET_CONTENTS)
+         iStatus = NOT_A_FILE;
+   }
+   psOp->iStatus = iStatus;
+   psCursor->psOp = NULL;
+}
+
+/*
+  Starts the lookup psOp in oFTree with psCursor: validates its path
+  and matches its first component against the root. Returns TRUE if
+  that already completes the lookup, or FALSE if it goes on at the
+  root's children.
+*/
+static boolean FT_startLookup(FT_T oFTree, struct FT_Cursor *psCursor,
+                              struct FT_Op *psOp) {
+   const char *pcPath;
+   Node_T oNRoot;
+   size_t i;
+
+   assert(oFTree != NULL);
+   assert(psCursor != NULL);
+   assert(psOp != NULL);
+   assert(psOp->eKind == FT_OP_STAT ||
+          psOp->eKind == FT_OP_GET_CONTENTS);
+
+   psCursor->psOp = psOp;
+   pcPath = psOp->pcPath;
+
+   /* the path must be non-empty with no empty components, as
+      Path_new requires */
+   for(i = 0; pcPath[i] != '\0'; i++)
+      if(pcPath[i] == '/' && (i == 0 || pcPath[i - 1] == '/'))
+         break;
+   if(i == 0 || pcPath[i] != '\0' || pcPath[i - 1] == '/') {
+      FT_finishLookup(psCursor, BAD_PATH, NULL);
+      return TRUE;
+   }
+
+   oNRoot = __atomic_load_n(&oFTree->oNRoot, __ATOMIC_ACQUIRE);
+   if(oNRoot == NULL) {
+      FT_finishLookup(psCursor, NO_SUCH_PATH, NULL);
+      return TRUE;
+   }
+   for(i = 0; pcPath[i] != '\0' && pcPath[i] != '/'; i++)
+      ;
+   if(strncmp(Path_getPathname(Node_getPath(oNRoot)), pcPath, i) != 0 ||
+      Path_getPathname(Node_getPath(oNRoot))[i] != '\0') {
+      FT_finishLookup(psCursor, CONFLICTING_PATH, NULL);
+      return TRUE;
+   }
+   if(pcPath[i] == '\0') {
+      FT_finishLookup(psCursor, SUCCESS, oNRoot);
+      return TRUE;
+   }
+
+   psCursor->oNCurr = oNRoot;
+   psCursor->ulEnd = i;
+   psCursor->iStage = 0;
+   return FALSE;
+}
+
+/*
+  Advances the lookup of psCursor by one step, which ends by starting
+  to load whatever the next step reads first. Returns TRUE if the
+  lookup is complete, or FALSE otherwise.
+*/
+static boolean FT_stepLookup(struct FT_Cursor *psCursor) {
+   const char *pcPath;
+   Node_T oNChild;
+   boolean bLast;
+
+   assert(psCursor != NULL);
+   assert(psCursor->psOp != NULL);
+
+   pcPath = psCursor->psOp->pcPath;
+
+   /* oNCurr arrived during the other lookups' steps; now start
+      searching its children, first those of the kind that the next
+      component should name: a file if it is the last component, and
+      a directory otherwise */
+   if(psCursor->iStage == 0) {
+      for(psCursor->ulNext = psCursor->ulEnd + 1;
+          pcPath[psCursor->ulNext] != '\0' &&
+          pcPath[psCursor->ulNext] != '/'; psCursor->ulNext++)
+         ;
+      Node_searchBegin(&psCursor->sSearch, psCursor->oNCurr,
+                       pcPath[psCursor->ulNext] == '\0', pcPath,
+                       psCursor->ulNext);
+      psCursor->iStage = 1;
+      return FALSE;
+   }
+
+   if(!Node_searchStep(&psCursor->sSearch, &oNChild))
+      return FALSE;
+   bLast = (boolean) (pcPath[psCursor->ulNext] == '\0');
+
+   /* only the last component may also name a directory */
+   if(oNChild == NULL) {
+      if(!bLast || psCursor->iStage == 2) {
+         FT_finishLookup(psCursor, NO_SUCH_PATH, NULL);
+         return TRUE;
+      }
+      Node_searchBegin(&psCursor->sSearch, psCursor->oNCurr, FALSE,
+                       pcPath, psCursor->ulNext);
+      psCursor->iStage = 2;
+      return FALSE;
+   }
+   if(bLast) {
+      FT_finishLookup(psCursor, SUCCESS, oNChild);
+      return TRUE;
+   }
+
+   Node_prefetch(oNChild);
+   psCursor->oNCurr = oNChild;
+   psCursor->ulEnd = psCursor->ulNext;
+   psCursor->iStage = 0;
+   return FALSE;
+}
+
+/*
+  Carries out the lookup psOp in oFTree, as FT_finishLookup reports
+  it, with a single call to oFTree's pfStat.
+*/
+static void FT_lookupOne(FT_T oFTree, struct FT_Op *psOp) {
+   void *pvContents = NULL;
+
+   assert(oFTree != NULL);
+   assert(psOp != NULL);
+
+   psOp->iStatus = (*FT_getBackend(oFTree)->pfStat)(oFTree,
+                                                    psOp->pcPath,
+                                                    &psOp->bIsFile,
+                                                    &psOp->ulSize,
+                                                    &pvContents);
+   psOp->pvResult = NULL;
+   if(psOp->iStatus != SUCCESS || psOp->eKind != FT_OP_GET_CONTENTS)
+      return;
+   if(psOp->bIsFile)
+      psOp->pvResult = pvContents;
+   else
+      psOp->iStatus = NOT_A_FILE;
+}
+
+/*
+  FT_lookupMany, for a caller that has already synchronized with other
+  threads. Keeps up to FT_LOOKUP_WIDTH lookups under way, advancing
+  each by one step in turn, and starts the next lookup in a slot as
+  soon as the one in it completes.
+*/
+static void FT_lookupManyUnlocked(FT_T oFTree, struct FT_Op *psOps,
+                                  size_t ulNumOps) {
+   struct FT_Cursor asCursors[FT_LOOKUP_WIDTH];
+   size_t ulNext = 0;
+   size_t ulActive = 0;
+   size_t i;
+
+   assert(oFTree != NULL);
+   assert(psOps != NULL || ulNumOps == 0);
+
+   /* a lookup that reaches a stub loads it, which may first evict
+      nodes that other lookups under way are holding, and a hierarchy
+      held other than in nodes is looked up where it lies, one lookup
+      at a time */
+   if(oFTree->psLazy != NULL ||
+      FT_getBackend(oFTree)->iNodesStatus != SUCCESS) {
+      for(i = 0; i < ulNumOps; i++)
+         FT_lookupOne(oFTree, &psOps[i]);
+      return;
+   }
+
+   for(i = 0; i < FT_LOOKUP_WIDTH; i++) {
+      asCursors[i].psOp = NULL;
+      while(asCursors[i].psOp == NULL && ulNext < ulNumOps)
+         (void) FT_startLookup(oFTree, &asCursors[i], &psOps[ulNext++]);
+      if(asCursors[i].psOp != NULL)
+         ulActive++;
+   }
+
+   while(ulActive > 0) {
+      for(i = 0; i < FT_LOOKUP_WIDTH; i++) {
+         if(asCursors[i].psOp == NULL || !FT_stepLookup(&asCursors[i]))
+            continue;
+         while(asCursors[i].psOp == NULL && ulNext < ulNumOps)
+            (void) FT_startLookup(oFTree, &asCursors[i],
+                                  &psOps[ulNext++]);
+         if(asCursors[i].psOp == NULL)
+            ulActive--;
+      }
+   }
+}
+
+
+/*
+  Stores ulValue in the snapshot word at pucWord.
+*/
+static void FT_putWord(unsigned char *pucWord, size_t ulValue) {
+   size_t i;
+
+   assert(pucWord != NULL);
+
+   for(i = 0; i < FT_SNAPSHOT_WORD; i++) {
+      pucWord[i] = (unsigned char) (ulValue & 0xff);
+      ulValue >>= 8;
+   }
+}
+
+/*
+  Returns the snapshot word at pucWord, or sets *pbOverflow to TRUE
+  if it does not fit in a size_t.
+*/
+static size_t FT_getWord(const unsigned char *pucWord,
+                         boolean *pbOverflow) {
+   size_t ulValue = 0;
+   size_t i;
+
+   assert(pucWord != NULL);
+   assert(pbOverflow != NULL);
+
+   for(i = FT_SNAPSHOT_WORD; i > 0; i--) {
+      if(ulValue > ((size_t) -1 >> 8))
+         *pbOverflow = TRUE;
+      ulValue = (ulValue << 8) | pucWord[i - 1];
+   }
+   return ulValue;
+}
+
+/*
+  Writes the ulNumWords words in aulWords to psFile. Returns SUCCESS,
+  or IO_ERROR if they could not be written.
+*/
+static int FT_writeWords(FILE *psFile, const size_t *aulWords,
+                         size_t ulNumWords) {
+   unsigned char aucWords[FT_SNAPSHOT_WORD * FT_SNAPSHOT_HEADER_WORDS];
+   size_t i;
+
+   assert(psFile != NULL);
+   assert(aulWords != NULL);
+   assert(ulNumWords <= FT_SNAPSHOT_HEADER_WORDS);
+
+   for(i = 0; i < ulNumWords; i++)
+      FT_putWord(&aucWords[i * FT_SNAPSHOT_WORD], aulWords[i]);
+   if(fwrite(aucWords, FT_SNAPSHOT_WORD, ulNumWords, psFile) !=
+      ulNumWords)
+      return IO_ERROR;
+   return SUCCESS;
+}
+
+/*
+  Returns the name of oNNode, the last component of its path, and
+  sets *pulLength to its length.
+*/
+static const char *FT_getName(Node_T oNNode, size_t *pulLength) {
+   Path_T oPPath;
+   const char *pcName;
+
+   assert(oNNode != NULL);
+   assert(pulLength != NULL);
+
+   oPPath = Node_getPath(oNNode);
+   pcName = Path_getComponent(oPPath, Path_getDepth(oPPath) - 1);
+   *pulLength = strlen(pcName);
+   return pcName;
+}
+
+/*
+  Writes oFTree, whose whole hierarchy must be in memory, to the file
+  pcFilename in the format of FT_saveIn, and then, if bDurable, waits
+  for the file's data to reach stable storage. Gathers the nodes in
+  canonical order, as FT_toStringIn does, then writes the node table,
+  the name pool and the contents blob in three sequential passes over
+  them. Returns SUCCESS, or IO_ERROR or MEMORY_ERROR.
+*/
+static int FT_writeSnapshot(FT_T oFTree, const char *pcFilename,
+                            boolean bDurable) {
+   DynArray_T oDNodes;
+   FILE *psFile;
+   Node_T oNNode;
+   const char *pcName;
+   size_t aulWords[FT_SNAPSHOT_HEADER_WORDS];
+   size_t ulNumNodes;
+   size_t ulNamesSize = 0;
+   size_t ulContentsSize = 0;
+   size_t ulLength;
+   int iStatus = SUCCESS;
+   size_t i;
+
+   assert(oFTree != NULL);
+   assert(pcFilename != NULL);
+
+   FT_foldFreed(oFTree);
+   oDNodes = DynArray_new(oFTree->ulCount);
+   if(oDNodes == NULL)
+      return MEMORY_ERROR;
+   ulNumNodes = FT_preOrderTraversal(oFTree->oNRoot, oDNodes, 0);
+
+   for(i = 0; i < ulNumNodes; i++) {
+      oNNode = DynArray_get(oDNodes, i);
+      (void) FT_getName(oNNode, &ulLength);
+      ulNamesSize += ulLength;
+      if(Node_isFile(oNNode) && Node_getValue(oNNode) != NULL)
+         ulContentsSize += Node_getUlLength(oNNode);
+   }
+
+   psFile = fopen(pcFilename, "wb");
+   if(psFile == NULL) {
+      DynArray_free(oDNodes);
+      return IO_ERROR;
+   }
+
+   /* the header */
+   if(fwrite(FT_SNAPSHOT_MAGIC, 1, FT_SNAPSHOT_WORD, psFile) !=
+      FT_SNAPSHOT_WORD)
+      iStatus = IO_ERROR;
+   aulWords[0] = ulNumNodes;
+   aulWords[1] = ulNamesSize;
+   aulWords[2] = ulContentsSize;
+   if(iStatus == SUCCESS)
+      iStatus = FT_writeWords(psFile, aulWords,
+                              FT_SNAPSHOT_HEADER_WORDS - 1);
+
+   /* the node table */
+   for(i = 0; i < ulNumNodes && iStatus == SUCCESS; i++) {
+      oNNode = DynArray_get(oDNodes, i);
+      (void) FT_getName(oNNode, &ulLength);
+      aulWords[0] = Path_getDepth(Node_getPath(oNNode)) << 2;
+      aulWords[2] = 0;
+      if(Node_isFile(oNNode)) {
+         aulWords[0] |= FT_SNAPSHOT_FILE;
+         if(Node_getValue(oNNode) != NULL)
+            aulWords[0] |= FT_SNAPSHOT_CONTENTS;
+         aulWords[2] = Node_getUlLength(oNNode);
+      }
+      aulWords[1] = ulLength;
+      iStatus = FT_writeWords(psFile, aulWords,
+                              FT_SNAPSHOT_RECORD_WORDS);
+   }
+
+   /* the name pool */
+   for(i = 0; i < ulNumNodes && iStatus == SUCCESS; i++) {
+      pcName = FT_getName(DynArray_get(oDNodes, i), &ulLength);
+      if(fwrite(pcName, 1, ulLength, psFile) != ulLength)
+         iStatus = IO_ERROR;
+   }
+
+   /* the contents blob */
+   for(i = 0; i < ulNumNodes && iStatus == SUCCESS; i++) {
+      oNNode = DynArray_get(oDNodes, i);
+      if(!Node_isFile(oNNode) || Node_getValue(oNNode) == NULL)
+         continue;
+      ulLength = Node_getUlLength(oNNode);
+      if(fwrite(Node_getValue(oNNode), 1, ulLength, psFile) != ulLength)
+         iStatus = IO_ERROR;
+   }
+
+   if(bDurable && iStatus == SUCCESS &&
+      (fflush(psFile) != 0 || fsync(fileno(psFile)) != 0))
+      iStatus = IO_ERROR;
+   if(fclose(psFile) != 0 && iStatus == SUCCESS)
+      iStatus = IO_ERROR;
+   DynArray_free(oDNodes);
+   return iStatus;
+}
+
+/*
+  FT_saveIn, for a caller that has already synchronized with other
+  threads.
+*/
+static int FT_saveUnlocked(FT_T oFTree, const char *pcFilename) {
+   int iStatus;
+
+   assert(oFTree != NULL);
+   assert(pcFilename != NULL);
+
+   iStatus = FT_getBackend(oFTree)->iNodesStatus;
+   if(iStatus == SUCCESS)
+      iStatus = FT_pageInAll(oFTree);
+   if(iStatus == SUCCESS)
+      iStatus = FT_writeSnapshot(oFTree, pcFilename, FALSE);
+   /* a snapshot shares its nodes' marks with the tree it is of */
+   if(iStatus == SUCCESS && !oFTree->bIsSnapshot) {
+      FT_startCheckpoint(oFTree);
+      oFTree->ulDeltas = 0;
+   }
+   return iStatus;
+}
+
+/*
+  Reads the rest of psFile, which must be ulTableSize bytes of record
+  table and pool followed by ulContentsSize bytes of contents: sets
+  *ppucTable to a new array holding the former and *ppvContents to a
+  new array holding the latter, or to NULL if ulContentsSize is 0.
+  The sizes, which come from the file's header, are checked against
+  the length of the rest of the file before anything is allocated.
+  Returns SUCCESS, or returns IO_ERROR, CORRUPT_FILE or MEMORY_ERROR,
+  leaving nothing allocated.
+*/
+static int FT_readSections(FILE *psFile, size_t ulTableSize,
+                           size_t ulContentsSize,
+                           unsigned char **ppucTable,
+                           void **ppvContents) {
+   long lStart;
+   long lEnd;
+
+   assert(psFile != NULL);
+   assert(ppucTable != NULL);
+   assert(ppvContents != NULL);
+
+   /* the sections must fill the rest of the file exactly */
+   lStart = ftell(psFile);
+   if(lStart < 0 || fseek(psFile, 0, SEEK_END) != 0)
+      return IO_ERROR;
+   lEnd = ftell(psFile);
+   if(lEnd < lStart || fseek(psFile, lStart, SEEK_SET) != 0)
+      return IO_ERROR;
+   if(ulTableSize > (size_t) (lEnd - lStart) ||
+      ulContentsSize != (size_t) (lEnd - lStart) - ulTableSize)
+      return CORRUPT_FILE;
+
+   *ppucTable = malloc(ulTableSize + 1);
+   if(*ppucTable == NULL)
+      return MEMORY_ERROR;
+   *ppvContents = NULL;
+   if(ulContentsSize != 0) {
+      *ppvContents = malloc(ulContentsSize);
+      if(*ppvContents == NULL) {
+         free(*ppucTable);
+         return MEMORY_ERROR;
+      }
+   }
+
+   /* the rest of the file, in order, and nothing after it */
+   if(fread(*ppucTable, 1, ulTableSize, psFile) != ulTableSize ||
+      (ulContentsSize != 0 &&
+       fread(*ppvContents, 1, ulContentsSize, psFile) !=
+       ulContentsSize) || fgetc(psFile) != EOF) {
+      free(*ppucTable);
+      free(*ppvContents);
+      return ferror(psFile) ? IO_ERROR : CORRUPT_FILE;
+   }
+   return SUCCESS;
+}
+
+/*
+  Reads the snapshot in psFile: sets *ppucTable to a new array holding
+  its node table followed by its name pool, and *ppvContents to a new
+  array holding its contents blob, or to NULL if the blob is empty,
+  and sets the last three to the number of nodes and the sizes of the
+  name pool and the blob. Returns SUCCESS, or returns IO_ERROR,
+  CORRUPT_FILE or MEMORY_ERROR, leaving nothing allocated.
+*/
+static int FT_readSnapshot(FILE *psFile, unsigned char **ppucTable,
+                           void **ppvContents, size_t *pulNumNodes,
+                           size_t *pulNamesSize,
+                           size_t *pulContentsSize) {
+   unsigned char aucHeader[FT_SNAPSHOT_WORD * FT_SNAPSHOT_HEADER_WORDS];
+   boolean bOverflow = FALSE;
+   size_t ulTableSize;
+
+   assert(psFile != NULL);
+   assert(ppucTable != NULL);
+   assert(ppvContents != NULL);
+
+   if(fread(aucHeader, 1, sizeof(aucHeader), psFile) !=
+      sizeof(aucHeader))
+      return ferror(psFile) ? IO_ERROR : CORRUPT_FILE;
+   if(memcmp(aucHeader, FT_SNAPSHOT_MAGIC, FT_SNAPSHOT_WORD) != 0)
+      return CORRUPT_FILE;
+   *pulNumNodes = FT_getWord(&aucHeader[FT_SNAPSHOT_WORD], &bOverflow);
+   *pulNamesSize = FT_getWord(&aucHeader[2 * FT_SNAPSHOT_WORD],
+                              &bOverflow);
+   *pulContentsSize = FT_getWord(&aucHeader[3 * FT_SNAPSHOT_WORD],
+                                 &bOverflow);
+   if(bOverflow || *pulNumNodes > ((size_t) -1 - *pulNamesSize) /
+      (FT_SNAPSHOT_WORD * FT_SNAPSHOT_RECORD_WORDS))
+      return CORRUPT_FILE;
+   ulTableSize = *pulNumNodes * FT_SNAPSHOT_WORD *
+                 FT_SNAPSHOT_RECORD_WORDS + *pulNamesSize;
+   return FT_readSections(psFile, ulTableSize, *pulContentsSize,
+                          ppucTable, ppvContents);
+}
+
+/*
+  Adds the node described by the snapshot record at pucRecord, with
+  name pcName and contents at pvContents, to the tree being rebuilt:
+  oDOpen holds the directories on the path from the root to the
+  previous node, and *poNBuiltRoot is the root so far. Returns
+  SUCCESS, or CORRUPT_FILE or MEMORY_ERROR.
+*/
+static int FT_appendSnapshotNode(const unsigned char *pucRecord,
+                                 const char *pcName, void *pvContents,
+                                 DynArray_T oDOpen,
+                                 Node_T *poNBuiltRoot) {
+   boolean bOverflow = FALSE;
+   size_t ulFlags;
+   size_t ulDepth;
+   size_t ulChildID;
+   boolean bIsFile;
+   Node_T oNParent = NULL;
+   Node_T oNNew = NULL;
+   Path_T oPPath = NULL;
+   int iStatus;
+
+   assert(pucRecord != NULL);
+   assert(pcName != NULL);
+   assert(oDOpen != NULL);
+   assert(poNBuiltRoot != NULL);
+
+   ulFlags = FT_getWord(pucRecord, &bOverflow);
+   ulDepth = ulFlags >> 2;
+   bIsFile = (boolean) ((ulFlags & FT_SNAPSHOT_FILE) != 0);
+
+   /* the root comes first and is a directory; every other node is one
+      level below a directory on the path to the previous node */
+   if((ulDepth == 1) != (*poNBuiltRoot == NULL) ||
+      (ulDepth == 1 && bIsFile) || ulDepth == 0 ||
+      ulDepth - 1 > DynArray_getLength(oDOpen))
+      return CORRUPT_FILE;
+   while(DynArray_getLength(oDOpen) > ulDepth - 1)
+      (void) DynArray_removeAt(oDOpen, DynArray_getLength(oDOpen) - 1);
+   if(ulDepth > 1)
+      oNParent = DynArray_get(oDOpen, ulDepth - 2);
+
+   iStatus = Path_child(oNParent == NULL ? NULL : Node_getPath(oNParent),
+                        pcName,
+                        FT_getWord(&pucRecord[FT_SNAPSHOT_WORD],
+                                   &bOverflow),
+                        &oPPath);
+   if(iStatus != SUCCESS)
+      return iStatus == BAD_PATH ? CORRUPT_FILE : iStatus;
+
+   if(oNParent == NULL) {
+      iStatus = Node_new(oPPath, NULL, &oNNew, FALSE, NULL, 0);
+      if(iStatus == SUCCESS)
+         *poNBuiltRoot = oNNew;
+   }
+   /* files precede directories, so a file sibling with the same name
+      would already have been appended */
+   else if(!bIsFile &&
+           Node_hasChild(oNParent, oPPath, TRUE, &ulChildID))
+      iStatus = CORRUPT_FILE;
+   else
+      iStatus = Node_append(oPPath, oNParent, &oNNew, bIsFile,
+                            pvContents,
+                            FT_getWord(&pucRecord[2 * FT_SNAPSHOT_WORD],
+                                       &bOverflow));
+   Path_free(oPPath);
+   if(iStatus != SUCCESS)
+      return iStatus == MEMORY_ERROR ? MEMORY_ERROR : CORRUPT_FILE;
+
+   if(!bIsFile && !DynArray_add(oDOpen, oNNew))
+      return MEMORY_ERROR;
+   return SUCCESS;
+}
+
+/*
+  Fills oFTree, which must be empty, from the snapshot file
+  pcFilename, as FT_newFromFile does. Returns SUCCESS, or leaves
+  oFTree empty and returns any of the statuses of FT_newFromFile.
+*/
+static int FT_loadSnapshot(FT_T oFTree, const char *pcFilename,
+                           void **ppvContents) {
+   FILE *psFile;
+   unsigned char *pucTable = NULL;
+   unsigned char *pucRecord;
+   char *pcContents = NULL;
+   const char *pcName;
+   DynArray_T oDOpen;
+   Node_T oNBuiltRoot = NULL;
+   boolean bOverflow = FALSE;
+   size_t ulNumNodes, ulNamesSize, ulContentsSize;
+   size_t ulNamesUsed = 0;
+   size_t ulContentsUsed = 0;
+   size_t ulNameLength, ulLength, ulFlags;
+   void *pvNodeContents;
+   int iStatus;
+   size_t i;
+
+   assert(oFTree != NULL);
+   assert(oFTree->oNRoot == NULL);
+   assert(pcFilename != NULL);
+   assert(ppvContents != NULL);
+
+   psFile = fopen(pcFilename, "rb");
+   if(psFile == NULL)
+      return IO_ERROR;
+   iStatus = FT_readSnapshot(psFile, &pucTable, (void **) &pcContents,
+                             &ulNumNodes, &ulNamesSize,
+                             &ulContentsSize);
+   (void) fclose(psFile);
+   if(iStatus != SUCCESS)
+      return iStatus;
+
+   oDOpen = DynArray_new(0);
+   if(oDOpen == NULL)
+      iStatus = MEMORY_ERROR;
+
+   /* the name pool follows the table, and both are in the nodes'
+      order, so each node's name and contents start where the
+      previous node's ended */
+   pcName = (const char *) pucTable +
+            ulNumNodes * FT_SNAPSHOT_WORD * FT_SNAPSHOT_RECORD_WORDS;
+   for(i = 0; i < ulNumNodes && iStatus == SUCCESS; i++) {
+      pucRecord = &pucTable[i * FT_SNAPSHOT_WORD *
+                            FT_SNAPSHOT_RECORD_WORDS];
+      ulNameLength = FT_getWord(&pucRecord[FT_SNAPSHOT_WORD],
+                                &bOverflow);
+      ulLength = FT_getWord(&pucRecord[2 * FT_SNAPSHOT_WORD],
+                            &bOverflow);
+      ulFlags = FT_getWord(pucRecord, &bOverflow);
+      if(bOverflow || ulNameLength > ulNamesSize - ulNamesUsed) {
+         iStatus = CORRUPT_FILE;
+         break;
+      }
+      pvNodeContents = NULL;
+      if(ulFlags & FT_SNAPSHOT_CONTENTS) {
+         if(ulLength > ulContentsSize - ulContentsUsed) {
+            iStatus = CORRUPT_FILE;
+            break;
+         }
+         pvNodeContents = pcContents + ulContentsUsed;
+         ulContentsUsed += ulLength;
+      }
+      iStatus = FT_appendSnapshotNode(pucRecord, pcName, pvNodeContents,
+                                      oDOpen, &oNBuiltRoot);
+      pcName += ulNameLength;
+      ulNamesUsed += ulNameLength;
+   }
+   if(iStatus == SUCCESS && (ulNamesUsed != ulNamesSize ||
+                             ulContentsUsed != ulContentsSize))
+      iStatus = CORRUPT_FILE;
+
+   if(oDOpen != NULL)
+      DynArray_free(oDOpen);
+   free(pucTable);
+   if(iStatus != SUCCESS) {
+      if(oNBuiltRoot != NULL)
+         (void) Node_free(oNBuiltRoot);
+      free(pcContents);
+      return iStatus;
+   }
+
+   oFTree->oNRoot = oNBuiltRoot;
+   oFTree->ulCount += ulNumNodes;
+   *ppvContents = pcContents;
+   return SUCCESS;
+}
+
+int FT_newFromFile(const char *pcFilename, FT_T *poFResult,
+                   void **ppvContents) {
+   int iStatus;
+
+   assert(pcFilename != NULL);
+   assert(poFResult != NULL);
+   assert(ppvContents != NULL);
+
+   *ppvContents = NULL;
+   *poFResult = FT_new();
+   if(*poFResult == NULL)
+      return MEMORY_ERROR;
+
+   iStatus = FT_loadSnapshot(*poFResult, pcFilename, ppvContents);
+   if(iStatus != SUCCESS) {
+      FT_free(*poFResult);
+      *poFResult = NULL;
+   }
+   return iStatus;
+}
+
+int FT_newFromImage(const char *pcFilename, FT_T *poFResult) {
+   FTImage_T oImage;
+   int iStatus;
+
+   assert(pcFilename != NULL);
+   assert(poFResult != NULL);
+
+   *poFResult = FT_new();
+   if(*poFResult == NULL)
+      return MEMORY_ERROR;
+
+   iStatus = FTImage_open(pcFilename, &oImage);
+   if(iStatus != SUCCESS) {
+      FT_free(*poFResult);
+      *poFResult = NULL;
+      return iStatus;
+   }
+   (*poFResult)->pvStore = oImage;
+   (*poFResult)->psBackend = &sImageBackend;
+   return SUCCESS;
+}
+
+/*
+  Makes oFTree, which must be empty, load its directories on demand
+  from the image file pcFilename, as FT_newLazy does, loading just its
+  root for now. Returns SUCCESS, or leaves oFTree empty and returns
+  any of the statuses of FT_newLazy.
+*/
+static int FT_openLazy(FT_T oFTree, const char *pcFilename,
+                       size_t ulBudget) {
+   struct FT_Lazy *psLazy;
+   struct FTImage_Entry sEntry;
+   Node_T oNRoot = NULL;
+   int iStatus;
+
+   assert(oFTree != NULL);
+   assert(oFTree->oNRoot == NULL);
+   assert(pcFilename != NULL);
+
+   psLazy = malloc(sizeof(struct FT_Lazy));
+   if(psLazy == NULL)
+      return MEMORY_ERROR;
+   iStatus = FTImage_open(pcFilename, &psLazy->oImage);
+   if(iStatus != SUCCESS) {
+      free(psLazy);
+      return iStatus;
+   }
+   psLazy->ulBudget = ulBudget;
+   psLazy->ulLoaded = 0;
+   psLazy->ulLimit = ulBudget == 0 ? (size_t) -1 : ulBudget;
+   psLazy->ulClock = 0;
+   oFTree->psLazy = psLazy;
+
+   /* an image without a root is an empty hierarchy */
+   if(!FTImage_getEntry(psLazy->oImage, 0, &sEntry))
+      return SUCCESS;
+   iStatus = FT_newImageNode(oFTree, 0, NULL, FALSE, &oNRoot);
+   if(iStatus != SUCCESS) {
+      FT_freeLazy(oFTree);
+      return iStatus;
+   }
+   oFTree->oNRoot = oNRoot;
+   oFTree->ulCount++;
+   psLazy->ulLoaded++;
+   return SUCCESS;
+}
+
+int FT_newLazy(const char *pcFilename, size_t ulBudget,
+               FT_T *poFResult) {
+   int iStatus;
+
+   assert(pcFilename != NULL);
+   assert(poFResult != NULL);
+
+   *poFResult = FT_new();
+   if(*poFResult == NULL)
+      return MEMORY_ERROR;
+
+   iStatus = FT_openLazy(*poFResult, pcFilename, ulBudget);
+   if(iStatus != SUCCESS) {
+      FT_free(*poFResult);
+      *poFResult = NULL;
+   }
+   return iStatus;
+}
+
+int FT_newArena(const char *pcFilename, FT_T *poFResult) {
+   FTArena_T oArena;
+   int iStatus;
+
+   assert(pcFilename != NULL);
+   assert(poFResult != NULL);
+
+   *poFResult = FT_new();
+   if(*poFResult == NULL)
+      return MEMORY_ERROR;
+
+   iStatus = FTArena_open(pcFilename, &oArena);
+   if(iStatus != SUCCESS) {
+      FT_free(*poFResult);
+      *poFResult = NULL;
+      return iStatus;
+   }
+   (*poFResult)->pvStore = oArena;
+   (*poFResult)->psBackend = &sArenaBackend;
+   return SUCCESS;
+}
+
+/*
+  Appends to oDNodes, in pre-order, every node at or below oNNode that
+  is new or whose contents changed since the last checkpoint,
+  descending only into marked nodes. Returns TRUE, or FALSE if memory
+  could not be allocated.
+*/
+static boolean FT_gatherChanged(Node_T oNNode, DynArray_T oDNodes) {
+   Node_T oNChild = NULL;
+   size_t i;
+
+   assert(oNNode != NULL);
+   assert(oDNodes != NULL);
+
+   if(Node_getMarks(oNNode) == 0)
+      return TRUE;
+   if((Node_getMarks(oNNode) & (NODE_NEW | NODE_CHANGED)) &&
+      !DynArray_add(oDNodes, oNNode))
+      return FALSE;
+   for(i = 0; i < Node_getNumFileChildren(oNNode); i++) {
+      (void) Node_getChild(oNNode, i, TRUE, &oNChild);
+      if(!FT_gatherChanged(oNChild, oDNodes))
+         return FALSE;
+   }
+   for(i = 0; i < Node_getNumDirChildren(oNNode); i++) {
+      (void) Node_getChild(oNNode, i, FALSE, &oNChild);
+      if(!FT_gatherChanged(oNChild, oDNodes))
+         return FALSE;
+   }
+   return TRUE;
+}
+
+/*
+  FT_saveDeltaIn, for a caller that has already synchronized with
+  other threads. Writes the record table, the path pool and the
+  contents blob in three passes over the removed paths and the
+  gathered nodes, as FT_saveUnlocked does over every node.
+*/
+static int FT_saveDeltaUnlocked(FT_T oFTree, const char *pcFilename) {
+   DynArray_T oDNodes;
+   FILE *psFile;
+   Node_T oNNode;
+   const char *pcPath;
+   size_t aulWords[FT_DELTA_HEADER_WORDS];
+   size_t ulNumRemoved = 0;
+   size_t ulNumNodes;
+   size_t ulPathsSize = 0;
+   size_t ulContentsSize = 0;
+   size_t ulLength;
+   int iStatus = SUCCESS;
+   size_t i;
+
+   assert(oFTree != NULL);
+   assert(pcFilename != NULL);
+
+   if(FT_getBackend(oFTree)->iNodesStatus != SUCCESS)
+      return FT_getBackend(oFTree)->iNodesStatus;
+   if(FT_isReadOnly(oFTree))
+      return READ_ONLY_TREE;
+
+   oDNodes = DynArray_new(0);
+   if(oDNodes == NULL)
+      return MEMORY_ERROR;
+   if(oFTree->oNRoot != NULL &&
+      !FT_gatherChanged(oFTree->oNRoot, oDNodes)) {
+      DynArray_free(oDNodes);
+      return MEMORY_ERROR;
+   }
+   ulNumNodes = DynArray_getLength(oDNodes);
+
+   if(oFTree->oDRemoved != NULL)
+      ulNumRemoved = DynArray_getLength(oFTree->oDRemoved);
+   for(i = 0; i < ulNumRemoved; i++)
+      ulPathsSize += strlen(DynArray_get(oFTree->oDRemoved, i));
+   for(i = 0; i < ulNumNodes; i++) {
+      oNNode = DynArray_get(oDNodes, i);
+      ulPathsSize += Path_getStrLength(Node_getPath(oNNode));
+      if(Node_isFile(oNNode) && Node_getValue(oNNode) != NULL)
+         ulContentsSize += Node_getUlLength(oNNode);
+   }
+
+   psFile = fopen(pcFilename, "wb");
+   if(psFile == NULL) {
+      DynArray_free(oDNodes);
+      return IO_ERROR;
+   }
+
+   /* the header */
+   if(fwrite(FT_DELTA_MAGIC, 1, FT_SNAPSHOT_WORD, psFile) !=
+      FT_SNAPSHOT_WORD)
+      iStatus = IO_ERROR;
+   aulWords[0] = oFTree->ulDeltas + 1;
+   aulWords[1] = ulNumRemoved + ulNumNodes;
+   aulWords[2] = ulPathsSize;
+   aulWords[3] = ulContentsSize;
+   if(iStatus == SUCCESS)
+      iStatus = FT_writeWords(psFile, aulWords,
+                              FT_DELTA_HEADER_WORDS - 1);
+
+   /* the record table */
+   for(i = 0; i < ulNumRemoved && iStatus == SUCCESS; i++) {
+      aulWords[0] = FT_DELTA_RM;
+      aulWords[1] = strlen(DynArray_get(oFTree->oDRemoved, i));
+      aulWords[2] = 0;
+      iStatus = FT_writeWords(psFile, aulWords,
+                              FT_SNAPSHOT_RECORD_WORDS);
+   }
+   for(i = 0; i < ulNumNodes && iStatus == SUCCESS; i++) {
+      oNNode = DynArray_get(oDNodes, i);
+      aulWords[2] = 0;
+      if(!Node_isFile(oNNode))
+         aulWords[0] = FT_DELTA_INSERT_DIR;
+      else {
+         aulWords[0] = (Node_getMarks(oNNode) & NODE_NEW) ?
+                       FT_DELTA_INSERT_FILE : FT_DELTA_REPLACE;
+         if(Node_getValue(oNNode) != NULL)
+            aulWords[0] |= FT_DELTA_CONTENTS;
+         aulWords[2] = Node_getUlLength(oNNode);
+      }
+      aulWords[1] = Path_getStrLength(Node_getPath(oNNode));
+      iStatus = FT_writeWords(psFile, aulWords,
+                              FT_SNAPSHOT_RECORD_WORDS);
+   }
+
+   /* the path pool */
+   for(i = 0; i < ulNumRemoved && iStatus == SUCCESS; i++) {
+      pcPath = DynArray_get(oFTree->oDRemoved, i);
+      ulLength = strlen(pcPath);
+      if(fwrite(pcPath, 1, ulLength, psFile) != ulLength)
+         iStatus = IO_ERROR;
+   }
+   for(i = 0; i < ulNumNodes && iStatus == SUCCESS; i++) {
+      oNNode = DynArray_get(oDNodes, i);
+      ulLength = Path_getStrLength(Node_getPath(oNNode));
+      if(fwrite(Path_getPathname(Node_getPath(oNNode)), 1, ulLength,
+                psFile) != ulLength)
+         iStatus = IO_ERROR;
+   }
+
+   /* the contents blob */
+   for(i = 0; i < ulNumNodes && iStatus == SUCCESS; i++) {
+      oNNode = DynArray_get(oDNodes, i);
+      if(!Node_isFile(oNNode) || Node_getValue(oNNode) == NULL)
+         continue;
+      ulLength = Node_getUlLength(oNNode);
+      if(fwrite(Node_getValue(oNNode), 1, ulLength, psFile) != ulLength)
+         iStatus = IO_ERROR;
+   }
+
+   if(fclose(psFile) != 0 && iStatus == SUCCESS)
+      iStatus = IO_ERROR;
+   DynArray_free(oDNodes);
+   if(iStatus == SUCCESS) {
+      FT_startCheckpoint(oFTree);
+      oFTree->ulDeltas++;
+   }
+   return iStatus;
+}
+
+/*
+  Makes the change of one delta record, of kind ulKind, to pcPath in
+  oFTree, with contents pvContents of ulLength bytes for a file.
+  Returns SUCCESS, or the status of the change that failed.
+*/
+static int FT_applyDeltaRecord(FT_T oFTree, size_t ulKind,
+                               const char *pcPath, void *pvContents,
+                               size_t ulLength) {
+   assert(oFTree != NULL);
+   assert(pcPath != NULL);
+
+   switch(ulKind) {
+      case FT_DELTA_RM:
+         if(FT_containsFileUnlocked(oFTree, pcPath))
+            return FT_rmFileUnlocked(oFTree, pcPath);
+         return FT_rmDirUnlocked(oFTree, pcPath);
+      case FT_DELTA_INSERT_DIR:
+         return FT_insertDirUnlocked(oFTree, pcPath);
+      case FT_DELTA_INSERT_FILE:
+         return FT_insertFileUnlocked(oFTree, pcPath, pvContents,
+                                      ulLength);
+      case FT_DELTA_REPLACE:
+         if(!FT_containsFileUnlocked(oFTree, pcPath))
+            return NO_SUCH_PATH;
+         (void) FT_replaceFileContentsUnlocked(oFTree, pcPath,
+                                               pvContents, ulLength);
+         return SUCCESS;
+      default:
+         return CORRUPT_FILE;
+   }
+}
+
+/*
+  Reads the header of the delta in psFile and then the rest of it, as
+  FT_readSnapshot reads a snapshot, setting *pulSequence and
+  *pulNumRecords to its sequence number and number of records.
+*/
+static int FT_readDelta(FILE *psFile, unsigned char **ppucTable,
+                        void **ppvContents, size_t *pulSequence,
+                        size_t *pulNumRecords, size_t *pulPathsSize,
+                        size_t *pulContentsSize) {
+   unsigned char aucHeader[FT_SNAPSHOT_WORD * FT_DELTA_HEADER_WORDS];
+   boolean bOverflow = FALSE;
+
+   assert(psFile != NULL);
+   assert(ppucTable != NULL);
+   assert(ppvContents != NULL);
+
+   if(fread(aucHeader, 1, sizeof(aucHeader), psFile) !=
+      sizeof(aucHeader))
+      return ferror(psFile) ? IO_ERROR : CORRUPT_FILE;
+   if(memcmp(aucHeader, FT_DELTA_MAGIC, FT_SNAPSHOT_WORD) != 0)
+      return CORRUPT_FILE;
+   *pulSequence = FT_getWord(&aucHeader[FT_SNAPSHOT_WORD], &bOverflow);
+   *pulNumRecords = FT_getWord(&aucHeader[2 * FT_SNAPSHOT_WORD],
+                               &bOverflow);
+   *pulPathsSize = FT_getWord(&aucHeader[3 * FT_SNAPSHOT_WORD],
+                              &bOverflow);
+   *pulContentsSize = FT_getWord(&aucHeader[4 * FT_SNAPSHOT_WORD],
+                                 &bOverflow);
+   if(bOverflow || *pulNumRecords > ((size_t) -1 - *pulPathsSize) /
+      (FT_SNAPSHOT_WORD * FT_SNAPSHOT_RECORD_WORDS))
+      return CORRUPT_FILE;
+   return FT_readSections(psFile,
+                          *pulNumRecords * FT_SNAPSHOT_WORD *
+                          FT_SNAPSHOT_RECORD_WORDS + *pulPathsSize,
+                          *pulContentsSize, ppucTable, ppvContents);
+}
+
+/*
+  FT_applyDeltaIn, for a caller that has already synchronized with
+  other threads.
+*/
+static int FT_applyDeltaUnlocked(FT_T oFTree, const char *pcFilename,
+                                 void **ppvContents) {
+   FILE *psFile;
+   unsigned char *pucTable = NULL;
+   unsigned char *pucRecord;
+   char *pcContents = NULL;
+   const char *pcPool;
+   char *pcPath = NULL;
+   boolean bOverflow = FALSE;
+   size_t ulSequence, ulNumRecords, ulPathsSize, ulContentsSize;
+   size_t ulPathsUsed = 0;
+   size_t ulContentsUsed = 0;
+   size_t ulApplied = 0;
+   size_t ulFlags, ulKind, ulPathLength, ulLength;
+   void *pvRecordContents;
+   int iStatus;
+   size_t i;
+
+   assert(oFTree != NULL);
+   assert(pcFilename != NULL);
+   assert(ppvContents != NULL);
+
+   *ppvContents = NULL;
+   if(FT_isReadOnly(oFTree))
+      return READ_ONLY_TREE;
+
+   psFile = fopen(pcFilename, "rb");
+   if(psFile == NULL)
+      return IO_ERROR;
+   iStatus = FT_readDelta(psFile, &pucTable, (void **) &pcContents,
+                          &ulSequence, &ulNumRecords, &ulPathsSize,
+                          &ulContentsSize);
+   (void) fclose(psFile);
+   if(iStatus != SUCCESS)
+      return iStatus;
+
+   /* a delta applies only to the tree as the one before it left it */
+   if(ulSequence != oFTree->ulDeltas + 1)
+      iStatus = CORRUPT_FILE;
+   else {
+      pcPath = malloc(ulPathsSize + 1);
+      if(pcPath == NULL)
+         iStatus = MEMORY_ERROR;
+   }
+
+   pcPool = (const char *) pucTable +
+            ulNumRecords * FT_SNAPSHOT_WORD * FT_SNAPSHOT_RECORD_WORDS;
+   for(i = 0; i < ulNumRecords && iStatus == SUCCESS; i++) {
+      pucRecord = &pucTable[i * FT_SNAPSHOT_WORD *
+                            FT_SNAPSHOT_RECORD_WORDS];
+      ulFlags = FT_getWord(pucRecord, &bOverflow);
+      ulPathLength = FT_getWord(&pucRecord[FT_SNAPSHOT_WORD],
+                                &bOverflow);
+      ulLength = FT_getWord(&pucRecord[2 * FT_SNAPSHOT_WORD],
+                            &bOverflow);
+      ulKind = ulFlags & ~(size_t) FT_DELTA_CONTENTS;
+      if(bOverflow || ulPathLength > ulPathsSize - ulPathsUsed) {
+         iStatus = CORRUPT_FILE;
+         break;
+      }
+      pvRecordContents = NULL;
+      if(ulFlags & FT_DELTA_CONTENTS) {
+         if(ulLength > ulContentsSize - ulContentsUsed ||
+            (ulKind != FT_DELTA_INSERT_FILE &&
+             ulKind != FT_DELTA_REPLACE)) {
+            iStatus = CORRUPT_FILE;
+            break;
+         }
+         pvRecordContents = pcContents + ulContentsUsed;
+         ulContentsUsed += ulLength;
+      }
+      memcpy(pcPath, pcPool + ulPathsUsed, ulPathLength);
+      pcPath[ulPathLength] = '\0';
+      ulPathsUsed += ulPathLength;
+
+      iStatus = FT_applyDeltaRecord(oFTree, ulKind, pcPath,
+                                    pvRecordContents, ulLength);
+      if(iStatus == SUCCESS)
+         ulApplied++;
+      else if(iStatus != MEMORY_ERROR)
+         iStatus = CORRUPT_FILE;
+   }
+   if(iStatus == SUCCESS && (ulPathsUsed != ulPathsSize ||
+                             ulContentsUsed != ulContentsSize))
+      iStatus = CORRUPT_FILE;
+
+   free(pcPath);
+   free(pucTable);
+   /* contents already in the tree must outlive the failure */
+   if(iStatus != SUCCESS && ulApplied == 0) {
+      free(pcContents);
+      return iStatus;
+   }
+   *ppvContents = pcContents;
+   if(iStatus == SUCCESS) {
+      FT_startCheckpoint(oFTree);
+      oFTree->ulDeltas = ulSequence;
+   }
+   return iStatus;
+}
+
+
+/*--------------------------------------------------------------------*/
+/* Synchronization                                                    */
+/*--------------------------------------------------------------------*/
+
+/*
+  Begins a lookup in oFTree. Lookups in a concurrent File Tree take no
+  lock: they only announce themselves to the epoch-based reclamation
+  of the nodes and children arrays that writers replace or remove.
+  Returns SUCCESS, or MEMORY_ERROR if the calling thread could not be
+  registered with the epochs.
+*/
+static int FT_beginRead(FT_T oFTree) {
+   assert(oFTree != NULL);
+
+   if(oFTree->psWriteLock == NULL)
+      return SUCCESS;
+   return Epoch_enter();
+}
+
+/* Ends a lookup in oFTree that FT_beginRead began. */
+static void FT_endRead(FT_T oFTree) {
+   assert(oFTree != NULL);
+
+   if(oFTree->psWriteLock != NULL)
+      Epoch_exit();
+}
+
+/*
+  Acquires oFTree's write lock exclusively, if it has one, excluding
+  every other writer but no reader.
+*/
+static void FT_lockWrite(FT_T oFTree) {
+   assert(oFTree != NULL);
+
+   if(oFTree->psWriteLock != NULL)
+      (void) pthread_rwlock_wrlock(oFTree->psWriteLock);
+}
+
+/* Releases oFTree's write lock, if it has one. */
+static void FT_unlockWrite(FT_T oFTree) {
+   assert(oFTree != NULL);
+
+   if(oFTree->psWriteLock != NULL)
+      (void) pthread_rwlock_unlock(oFTree->psWriteLock);
+}
+
+/*
+  Walks concurrent File Tree oFTree from the root towards absolute
+  path oPPath, which is to be inserted, as far as directories on the
+  path exist. Before searching each node's children, reads the node's
+  version, so that the caller can later lock the node only if its
+  children are still as they were seen. Returns SUCCESS and sets
+  *poNParent to the deepest existing directory, *pulVersion to its
+  version and *pulLevel to the level of oPPath that is missing below
+  it, or sets *poNParent to NULL if the tree is empty. Otherwise,
+  returns the status that inserting oPPath should fail with:
+  * CONFLICTING_PATH if the root's path is not a prefix of oPPath
+  * NOT_A_DIRECTORY if a proper prefix of oPPath is a file
+  * ALREADY_IN_TREE if oPPath is already a directory or a file
+  * MEMORY_ERROR if memory could not be allocated to complete request
+*/
+static int FT_findParent(FT_T oFTree, Path_T oPPath,
+                         Node_T *poNParent, unsigned long *pulVersion,
+                         size_t *pulLevel) {
+   int iStatus;
+   Path_T oPPrefix = NULL;
+   Node_T oNCurr;
+   Node_T oNChild = NULL;
+   unsigned long ulVersion;
+   size_t ulDepth;
+   size_t i;
+
+   assert(oFTree != NULL);
+   assert(oPPath != NULL);
+   assert(poNParent != NULL);
+   assert(pulVersion != NULL);
+   assert(pulLevel != NULL);
+
+   *poNParent = NULL;
+   *pulVersion = 0;
+   *pulLevel = 1;
+
+   oNCurr = __atomic_load_n(&oFTree->oNRoot, __ATOMIC_ACQUIRE);
+   if(oNCurr == NULL)
+      return SUCCESS;
+
+   iStatus = Path_prefix(oPPath, 1, &oPPrefix);
+   if(iStatus != SUCCESS)
+      return iStatus;
+   iStatus = Path_comparePath(Node_getPath(oNCurr), oPPrefix);
+   Path_free(oPPrefix);
+   if(iStatus != 0)
+      return CONFLICTING_PATH;
+
+   ulDepth = Path_getDepth(oPPath);
+   for(i = 2; i <= ulDepth; i++) {
+      ulVersion = Node_getVersion(oNCurr);
+      iStatus = Path_prefix(oPPath, i, &oPPrefix);
+      if(iStatus != SUCCESS)
+         return iStatus;
+
+      if(Node_findChild(oNCurr, oPPrefix, FALSE, &oNChild)) {
+         Path_free(oPPrefix);
+         oNCurr = oNChild;
+         continue;
+      }
+      if(Node_findChild(oNCurr, oPPrefix, TRUE, &oNChild)) {
+         Path_free(oPPrefix);
+         return (i < ulDepth) ? NOT_A_DIRECTORY : ALREADY_IN_TREE;
+      }
+
+      Path_free(oPPrefix);
+      *poNParent = oNCurr;
+      *pulVersion = ulVersion;
+      *pulLevel = i;
+      return SUCCESS;
+   }
+
+   /* every level of oPPath is already a directory */
+   return ALREADY_IN_TREE;
+}
+
+/*
+  Inserts pcPath into concurrent File Tree oFTree, as a file with
+  contents pvContents of ulLength bytes if bIsFile or as a directory
+  otherwise, while other inserts proceed in parallel: the caller holds
+  oFTree's write lock shared and is in an epoch read-side critical
+  section. The walk down the tree takes no lock; only the directory
+  that gains a child is locked, and only if its version shows that
+  its children have not changed since the walk saw them. If they
+  have, or another writer holds the lock, the walk starts over.
+  Sets *pbExclusive to TRUE and returns SUCCESS without inserting if
+  the tree is empty, as a new root must be inserted with the lock
+  held exclusively. Otherwise sets *pbExclusive to FALSE and returns
+  as FT_insertDirIn or FT_insertFileIn does.
+*/
+static int FT_insertShared(FT_T oFTree, const char *pcPath,
+                           boolean bIsFile, void *pvContents,
+                           size_t ulLength, boolean *pbExclusive) {
+   int iStatus;
+   Path_T oPPath = NULL;
+   Node_T oNParent = NULL;
+   Node_T oNFirstNew = NULL;
+   unsigned long ulVersion;
+   size_t ulLevel;
+   size_t ulNewNodes = 0;
+
+   assert(oFTree != NULL);
+   assert(pcPath != NULL);
+   assert(pbExclusive != NULL);
+
+   *pbExclusive = FALSE;
+
+   /* validate pcPath and generate a Path_T for it */
+   iStatus = Path_new(pcPath, &oPPath);
+   if(iStatus != SUCCESS)
+      return iStatus;
+
+   for(;;) {
+      iStatus = FT_findParent(oFTree, oPPath, &oNParent, &ulVersion,
+                              &ulLevel);
+      if(iStatus != SUCCESS)
+         break;
+      if(oNParent == NULL) {
+         *pbExclusive = TRUE;
+         break;
+      }
+      if(Node_tryLock(oNParent, ulVersion)) {
+         iStatus = FT_buildChain(oFTree, oPPath, ulLevel, oNParent,
+                                 bIsFile, pvContents, ulLength,
+                                 &oNFirstNew, &ulNewNodes);
+         Node_unlock(oNParent);
+         if(iStatus == SUCCESS)
+            (void) __atomic_add_fetch(&oFTree->ulCount, ulNewNodes,
+                                      __ATOMIC_RELAXED);
+         break;
+      }
+      /* another writer got to oNParent first */
+      (void) sched_yield();
+   }
+
+   Path_free(oPPath);
+   return iStatus;
+}
+
+/*
+  Inserts pcPath into oFTree, as FT_insertShared does, if oFTree is
+  concurrent, not empty and without live snapshots, or else as
+  FT_insertFileUnlocked does if bIsFile and as FT_insertDirUnlocked
+  does otherwise, holding oFTree's write lock exclusively if it has
+  one.
+*/
+static int FT_insert(FT_T oFTree, const char *pcPath, boolean bIsFile,
+                     void *pvContents, size_t ulLength) {
+   int iStatus;
+   boolean bExclusive = TRUE;
+
+   assert(oFTree != NULL);
+   assert(pcPath != NULL);
+
+   if(FT_isReadOnly(oFTree))
+      return READ_ONLY_TREE;
+
+   if(oFTree->psWriteLock != NULL) {
+      (void) pthread_rwlock_rdlock(oFTree->psWriteLock);
+      /* while a snapshot is live, an insert copies the path above it,
+         which takes the lock held exclusively */
+      if(!FT_hasSnapshots(oFTree) && Epoch_enter() == SUCCESS) {
+         iStatus = FT_insertShared(oFTree, pcPath, bIsFile, pvContents,
+                                   ulLength, &bExclusive);
+         Epoch_exit();
+      }
+      (void) pthread_rwlock_unlock(oFTree->psWriteLock);
+      if(!bExclusive)
+         return iStatus;
+   }
+
+   FT_lockWrite(oFTree);
+   /* the tree may have been frozen since the check above */
+   if(FT_isReadOnly(oFTree))
+      iStatus = READ_ONLY_TREE;
+   else if(bIsFile)
+      iStatus = FT_insertFileUnlocked(oFTree, pcPath, pvContents,
+                                      ulLength);
+   else
+      iStatus = FT_insertDirUnlocked(oFTree, pcPath);
+   FT_unlockWrite(oFTree);
+   return iStatus;
+}
+
+int FT_insertDirIn(FT_T oFTree, const char *pcPath) {
+   assert(oFTree != NULL);
+   assert(pcPath != NULL);
+
+   return FT_insert(oFTree, pcPath, FALSE, NULL, 0);
+}
+
+boolean FT_containsDirIn(FT_T oFTree, const char *pcPath) {
+   boolean bFound;
+
+   assert(oFTree != NULL);
+   assert(pcPath != NULL);
+
+   if(FT_beginRead(oFTree) != SUCCESS)
+      return FALSE;
+   bFound = FT_containsDirUnlocked(oFTree, pcPath);
+   FT_endRead(oFTree);
+   return bFound;
+}
+
+int FT_rmDirIn(FT_T oFTree, const char *pcPath) {
+   int iStatus;
+
+   assert(oFTree != NULL);
+   assert(pcPath != NULL);
+
+   FT_lockWrite(oFTree);
+   iStatus = FT_rmDirUnlocked(oFTree, pcPath);
+   FT_unlockWrite(oFTree);
+   return iStatus;
+}
+
+int FT_insertFileIn(FT_T oFTree, const char *pcPath,
+                    void *pvContents, size_t ulLength) {
+   assert(oFTree != NULL);
+   assert(pcPath != NULL);
+
+   return FT_insert(oFTree, pcPath, TRUE, pvContents, ulLength);
+}
+
+boolean FT_containsFileIn(FT_T oFTree, const char *pcPath) {
+   boolean bFound;
+
+   assert(oFTree != NULL);
+   assert(pcPath != NULL);
 
-        /* advance pcEnd to end of next token */
-        while (*pcEnd != '/' && *pcEnd != '\0') pcEnd++;
+   if(FT_beginRead(oFTree) != SUCCESS)
+      return FALSE;
+   bFound = FT_containsFileUnlocked(oFTree, pcPath);
+   FT_endRead(oFTree);
+   return bFound;
+}
 
-        /* final component can't end with slash */
-        if (*pcEnd == '\0' && *(pcEnd - 1) == '/') {
-            DynArray_map(oDSubstrings,
-                         (void (*)(void *, void *))Path_freeString, NULL);
-            DynArray_free(oDSubstrings);
-            return BAD_PATH;
-        }
+int FT_rmFileIn(FT_T oFTree, const char *pcPath) {
+   int iStatus;
 
-        while (pcStart != pcEnd) {
-            pcStart++;
-        }
+   assert(oFTree != NULL);
+   assert(pcPath != NULL);
 
-        pcStart++;
-    }
+   FT_lockWrite(oFTree);
+   iStatus = FT_rmFileUnlocked(oFTree, pcPath);
+   FT_unlockWrite(oFTree);
+   return iStatus;
+}
 
+void *FT_getFileContentsIn(FT_T oFTree, const char *pcPath) {
+   void *pvContents;
 
-    iStatus = FT_findNode(pcPath, &oNFound, *pbIsFile);
-    if(iStatus != SUCCESS){
-        iStatus = FT_findNode(pcPath, &oNFound, 1 - *pbIsFile);
-         if(iStatus != SUCCESS){
-            DynArray_map(oDSubstrings,
-                         (void (*)(void *, void *))Path_freeString, NULL);
-            DynArray_free(oDSubstrings);
-            return iStatus;
-         }
-    }
-    *pbIsFile = Node_isFile(oNFound);
-    if(Node_isFile(oNFound)){
-        *pulSize = Node_getUlLength(oNFound);
-    }
-   DynArray_map(oDSubstrings,
-                         (void (*)(void *, void *))Path_freeString, NULL);
-   DynArray_free(oDSubstrings);
-    return SUCCESS;
+   assert(oFTree != NULL);
+   assert(pcPath != NULL);
+
+   if(FT_beginRead(oFTree) != SUCCESS)
+      return NULL;
+   pvContents = FT_getFileContentsUnlocked(oFTree, pcPath);
+   FT_endRead(oFTree);
+   return pvContents;
 }
 
-void *FT_getFileContents(const char *pcPath){
-    int iStatus;
-    Node_T oNFound = NULL;
-    assert(pcPath != NULL);
-    if(!FT_containsFile(pcPath)){
-        return NULL;
-    }
-    iStatus = FT_findNode(pcPath, &oNFound, TRUE);
-    if(iStatus != SUCCESS){
-        return NULL;
-    }
-    if(Node_isFile(oNFound)){
-        return Node_getValue(oNFound);
-    }
-    return NULL;
+void *FT_replaceFileContentsIn(FT_T oFTree, const char *pcPath,
+                               void *pvNewContents,
+                               size_t ulNewLength) {
+   void *pvOldContents;
+
+   assert(oFTree != NULL);
+   assert(pcPath != NULL);
+
+   FT_lockWrite(oFTree);
+   pvOldContents = FT_replaceFileContentsUnlocked(oFTree, pcPath,
+                                                  pvNewContents,
+                                                  ulNewLength);
+   FT_unlockWrite(oFTree);
+   return pvOldContents;
 }
 
-void *FT_replaceFileContents(const char *pcPath, void *pvNewContents,
-                             size_t ulNewLength) {
-    int iStatus;
-    Node_T oNFound = NULL;
-    assert(pcPath != NULL);
-    if(!FT_containsFile(pcPath)){
-        return NULL;
-    }
-    iStatus = FT_findNode(pcPath, &oNFound, TRUE);
-    if(iStatus != SUCCESS){
-        return NULL;
-    }
-    
-    if(Node_isFile(oNFound)){
-        void* oldContent = Node_getValue(oNFound);
-        Node_setValue(oNFound, pvNewContents);
-        Node_setUlLength(oNFound, ulNewLength);
-        return oldContent;
-    }
-    return NULL;
+int FT_statIn(FT_T oFTree, const char *pcPath, boolean *pbIsFile,
+              size_t *pulSize) {
+   int iStatus;
+
+   assert(oFTree != NULL);
+   assert(pcPath != NULL);
+   assert(pbIsFile != NULL);
+   assert(pulSize != NULL);
+
+   if(FT_beginRead(oFTree) != SUCCESS)
+      return MEMORY_ERROR;
+   iStatus = FT_statUnlocked(oFTree, pcPath, pbIsFile, pulSize);
+   FT_endRead(oFTree);
+   return iStatus;
+}
+
+char *FT_toStringIn(FT_T oFTree) {
+   char *pcResult;
+
+   assert(oFTree != NULL);
+
+   /* the traversal must see one consistent version of the
+      hierarchy, so it keeps writers out for its duration */
+   FT_lockWrite(oFTree);
+   pcResult = FT_toStringUnlocked(oFTree);
+   FT_unlockWrite(oFTree);
+   return pcResult;
+}
+
+int FT_saveIn(FT_T oFTree, const char *pcFilename) {
+   int iStatus;
+
+   assert(oFTree != NULL);
+   assert(pcFilename != NULL);
+
+   /* as FT_toStringIn, the snapshot is of one consistent version */
+   FT_lockWrite(oFTree);
+   iStatus = FT_saveUnlocked(oFTree, pcFilename);
+   FT_unlockWrite(oFTree);
+   return iStatus;
+}
+
+int FT_saveDeltaIn(FT_T oFTree, const char *pcFilename) {
+   int iStatus;
+
+   assert(oFTree != NULL);
+   assert(pcFilename != NULL);
+
+   FT_lockWrite(oFTree);
+   iStatus = FT_saveDeltaUnlocked(oFTree, pcFilename);
+   FT_unlockWrite(oFTree);
+   return iStatus;
+}
+
+int FT_applyDeltaIn(FT_T oFTree, const char *pcFilename,
+                    void **ppvContents) {
+   int iStatus;
+
+   assert(oFTree != NULL);
+   assert(pcFilename != NULL);
+   assert(ppvContents != NULL);
+
+   FT_lockWrite(oFTree);
+   iStatus = FT_applyDeltaUnlocked(oFTree, pcFilename, ppvContents);
+   FT_unlockWrite(oFTree);
+   return iStatus;
+}
+
+/*
+  Creates the bookkeeping for the versions of oFTree, if it has none
+  yet. Returns SUCCESS, or MEMORY_ERROR.
+*/
+static int FT_startVersions(FT_T oFTree) {
+   struct FT_Versions *psVersions;
+
+   assert(oFTree != NULL);
+
+   if(oFTree->psVersions != NULL)
+      return SUCCESS;
+   psVersions = malloc(sizeof(struct FT_Versions));
+   if(psVersions == NULL)
+      return MEMORY_ERROR;
+   psVersions->oDSnapshots = DynArray_new(0);
+   if(psVersions->oDSnapshots == NULL) {
+      free(psVersions);
+      return MEMORY_ERROR;
+   }
+   if(pthread_mutex_init(&psVersions->oLock, NULL) != 0) {
+      DynArray_free(psVersions->oDSnapshots);
+      free(psVersions);
+      return MEMORY_ERROR;
+   }
+   psVersions->ulGeneration = 0;
+   psVersions->ulLive = 0;
+   psVersions->psRetiredFirst = NULL;
+   psVersions->psRetiredLast = NULL;
+   oFTree->psVersions = psVersions;
+   return SUCCESS;
+}
+
+/*
+  Makes oFSnapshot, a new File Tree, a snapshot of oFTree, for a caller
+  that holds oFTree's write lock, so that no change is halfway done.
+  Returns SUCCESS, or READ_ONLY_TREE if oFTree is frozen, or
+  MEMORY_ERROR.
+*/
+static int FT_snapshotUnlocked(FT_T oFTree, FT_T oFSnapshot) {
+   int iStatus;
+
+   assert(oFTree != NULL);
+   assert(oFSnapshot != NULL);
+
+   iStatus = FT_getBackend(oFTree)->iNodesStatus;
+   if(iStatus != SUCCESS)
+      return iStatus;
+   iStatus = FT_startVersions(oFTree);
+   if(iStatus != SUCCESS)
+      return iStatus;
+   (void) pthread_mutex_lock(&oFTree->psVersions->oLock);
+   if(!DynArray_add(oFTree->psVersions->oDSnapshots, oFSnapshot))
+      iStatus = MEMORY_ERROR;
+   else {
+      FT_foldFreed(oFTree);
+      oFSnapshot->oNRoot = oFTree->oNRoot;
+      oFSnapshot->ulCount = oFTree->ulCount;
+      oFSnapshot->psVersions = oFTree->psVersions;
+      oFSnapshot->psLazy = oFTree->psLazy;
+      oFSnapshot->bIsSnapshot = TRUE;
+      oFSnapshot->psBackend = &sSnapshotBackend;
+      /* the snapshot sees the nodes made so far, and changes from now
+         on make nodes of a new generation */
+      if(oFTree->bIsSnapshot)
+         oFSnapshot->ulGeneration = oFTree->ulGeneration;
+      else
+         oFSnapshot->ulGeneration = oFTree->psVersions->ulGeneration++;
+      __atomic_store_n(&oFTree->psVersions->ulLive,
+               DynArray_getLength(oFTree->psVersions->oDSnapshots),
+               __ATOMIC_RELEASE);
+   }
+   (void) pthread_mutex_unlock(&oFTree->psVersions->oLock);
+   return iStatus;
+}
+
+int FT_snapshotIn(FT_T oFTree, FT_T *poFSnapshot) {
+   FT_T oFSnapshot;
+   int iStatus;
+
+   assert(oFTree != NULL);
+   assert(poFSnapshot != NULL);
+
+   *poFSnapshot = NULL;
+   iStatus = FT_getBackend(oFTree)->iNodesStatus;
+   if(iStatus != SUCCESS)
+      return iStatus;
+   oFSnapshot = FT_new();
+   if(oFSnapshot == NULL)
+      return MEMORY_ERROR;
+
+   FT_lockWrite(oFTree);
+   iStatus = FT_snapshotUnlocked(oFTree, oFSnapshot);
+   FT_unlockWrite(oFTree);
+
+   if(iStatus != SUCCESS) {
+      FT_free(oFSnapshot);
+      return iStatus;
+   }
+   *poFSnapshot = oFSnapshot;
+   return SUCCESS;
+}
+
+/*
+  Syncs the directory holding pcPath, so that a file renamed into it
+  is durable. Returns SUCCESS, or IO_ERROR or MEMORY_ERROR.
+*/
+static int FT_syncDirectory(const char *pcPath) {
+   const char *pcSlash;
+   char *pcDirectory;
+   size_t ulLength;
+   int iFd;
+   int iStatus = SUCCESS;
+
+   assert(pcPath != NULL);
+
+   pcSlash = strrchr(pcPath, '/');
+   ulLength = pcSlash == NULL ? 1 :
+              pcSlash == pcPath ? 1 : (size_t) (pcSlash - pcPath);
+   pcDirectory = malloc(ulLength + 1);
+   if(pcDirectory == NULL)
+      return MEMORY_ERROR;
+   if(pcSlash == NULL)
+      strcpy(pcDirectory, ".");
+   else {
+      memcpy(pcDirectory, pcPath, ulLength);
+      pcDirectory[ulLength] = '\0';
+   }
+
+   iFd = open(pcDirectory, O_RDONLY);
+   free(pcDirectory);
+   if(iFd < 0)
+      return IO_ERROR;
+   if(fsync(iFd) != 0)
+      iStatus = IO_ERROR;
+   (void) close(iFd);
+   return iStatus;
+}
+
+/*
+  Writes the snapshot of the FT_Save pvSave to its temporary file,
+  frees the snapshot, and, once the file is on stable storage,
+  renames it over the target and syncs the rename; a pthread start
+  routine. The target thus holds either the old file or the whole
+  new one, whenever the system stops. Records the status in pvSave.
+*/
+static void *FT_runSave(void *pvSave) {
+   struct FT_Save *psSave = pvSave;
+   int iStatus;
+
+   assert(psSave != NULL);
+
+   iStatus = FT_writeSnapshot(psSave->oFSnapshot, psSave->pcTemp, TRUE);
+   /* the tree stops copying nodes for the snapshot as soon as it can */
+   FT_free(psSave->oFSnapshot);
+   psSave->oFSnapshot = NULL;
+   if(iStatus == SUCCESS &&
+      rename(psSave->pcTemp, psSave->pcFilename) != 0)
+      iStatus = IO_ERROR;
+   if(iStatus == SUCCESS)
+      iStatus = FT_syncDirectory(psSave->pcFilename);
+   else
+      (void) remove(psSave->pcTemp);
+   psSave->iStatus = iStatus;
+   return NULL;
+}
+
+int FT_beginSaveIn(FT_T oFTree, const char *pcFilename) {
+   struct FT_Save *psSave;
+   struct FT_Save *psPrevious;
+   size_t ulLength;
+   int iStatus;
+
+   assert(oFTree != NULL);
+   assert(pcFilename != NULL);
+
+   iStatus = FT_getBackend(oFTree)->iNodesStatus;
+   if(iStatus != SUCCESS)
+      return iStatus;
+
+   ulLength = strlen(pcFilename);
+   psSave = malloc(sizeof(struct FT_Save));
+   if(psSave == NULL)
+      return MEMORY_ERROR;
+   psSave->pcFilename = malloc(ulLength + 1);
+   psSave->pcTemp = malloc(ulLength + sizeof(".tmp"));
+   psSave->oFSnapshot = FT_new();
+   if(psSave->pcFilename == NULL || psSave->pcTemp == NULL ||
+      psSave->oFSnapshot == NULL) {
+      FT_free(psSave->oFSnapshot);
+      free(psSave->pcFilename);
+      free(psSave->pcTemp);
+      free(psSave);
+      return MEMORY_ERROR;
+   }
+   strcpy(psSave->pcFilename, pcFilename);
+   strcpy(psSave->pcTemp, pcFilename);
+   strcat(psSave->pcTemp, ".tmp");
+   psSave->iStatus = SUCCESS;
+
+   FT_lockWrite(oFTree);
+   /* one save at a time: wait for the previous one without holding
+      changes off */
+   while(oFTree->psSave != NULL) {
+      psPrevious = oFTree->psSave;
+      oFTree->psSave = NULL;
+      FT_unlockWrite(oFTree);
+      (void) FT_finishSave(psPrevious);
+      FT_lockWrite(oFTree);
+   }
+   /* the thread must not load directories that the tree shares */
+   iStatus = FT_pageInAll(oFTree);
+   if(iStatus == SUCCESS)
+      iStatus = FT_snapshotUnlocked(oFTree, psSave->oFSnapshot);
+   if(iStatus == SUCCESS &&
+      pthread_create(&psSave->oThread, NULL, FT_runSave, psSave) != 0)
+      iStatus = MEMORY_ERROR;
+   if(iStatus == SUCCESS)
+      oFTree->psSave = psSave;
+   FT_unlockWrite(oFTree);
+
+   if(iStatus != SUCCESS) {
+      FT_free(psSave->oFSnapshot);
+      free(psSave->pcFilename);
+      free(psSave->pcTemp);
+      free(psSave);
+   }
+   return iStatus;
+}
+
+int FT_endSaveIn(FT_T oFTree) {
+   struct FT_Save *psSave;
+
+   assert(oFTree != NULL);
+
+   FT_lockWrite(oFTree);
+   psSave = oFTree->psSave;
+   oFTree->psSave = NULL;
+   FT_unlockWrite(oFTree);
+
+   if(psSave == NULL)
+      return SUCCESS;
+   return FT_finishSave(psSave);
+}
+
+int FT_saveImageIn(FT_T oFTree, const char *pcFilename) {
+   int iStatus;
+
+   assert(oFTree != NULL);
+   assert(pcFilename != NULL);
+
+   iStatus = FT_getBackend(oFTree)->iNodesStatus;
+   if(iStatus != SUCCESS)
+      return iStatus;
+
+   FT_lockWrite(oFTree);
+   /* the tree may have been frozen since the check above */
+   iStatus = FT_getBackend(oFTree)->iNodesStatus;
+   if(iStatus == SUCCESS)
+      iStatus = FT_pageInAll(oFTree);
+   if(iStatus == SUCCESS)
+      iStatus = FTImage_write(oFTree->oNRoot, pcFilename);
+   FT_unlockWrite(oFTree);
+   return iStatus;
+}
+
+int FT_freezeIn(FT_T oFTree) {
+   FTFrozen_T oFrozen;
+   int iStatus;
+
+   assert(oFTree != NULL);
+
+   FT_lockWrite(oFTree);
+   iStatus = FT_getBackend(oFTree)->iNodesStatus;
+   if(iStatus == SUCCESS && FT_isReadOnly(oFTree))
+      iStatus = READ_ONLY_TREE;
+   if(iStatus == SUCCESS)
+      iStatus = FT_pageInAll(oFTree);
+   if(iStatus == SUCCESS)
+      iStatus = FTFrozen_new(oFTree->oNRoot, &oFrozen);
+   if(iStatus == SUCCESS) {
+      /* a lookup that sees the frozen backend sees pvStore too */
+      oFTree->pvStore = oFrozen;
+      __atomic_store_n(&oFTree->psBackend, &sFrozenBackend,
+                       __ATOMIC_RELEASE);
+      /* lookups that began before the freeze may still be walking
+         the nodes */
+      if(oFTree->psWriteLock != NULL)
+         Epoch_synchronize();
+      /* if the nodes cannot all be freed now, FT_free frees the rest */
+      if(oFTree->oNRoot != NULL)
+         (void) FT_removeSubtree(oFTree, oFTree->oNRoot);
+      FT_forgetRemoved(oFTree);
+   }
+   FT_unlockWrite(oFTree);
+   return iStatus;
+}
+
+int FT_syncIn(FT_T oFTree) {
+   int iStatus;
+
+   assert(oFTree != NULL);
+
+   FT_lockWrite(oFTree);
+   iStatus = (*FT_getBackend(oFTree)->pfSync)(oFTree);
+   FT_unlockWrite(oFTree);
+   return iStatus;
+}
+
+char *FT_toStringParallel(FT_T oFTree, size_t ulThreads) {
+   char *pcResult;
+
+   assert(oFTree != NULL);
+
+   FT_lockWrite(oFTree);
+   pcResult = FT_toStringParallelUnlocked(oFTree, ulThreads);
+   FT_unlockWrite(oFTree);
+   return pcResult;
+}
+
+int FT_setReclaimPoolIn(FT_T oFTree, ThreadPool_T oPool) {
+   int iStatus = SUCCESS;
+
+   assert(oFTree != NULL);
+
+   FT_lockWrite(oFTree);
+   if(oPool != NULL && oFTree->psFreed == NULL) {
+      oFTree->psFreed = malloc(sizeof(struct FT_Freed));
+      if(oFTree->psFreed == NULL)
+         iStatus = MEMORY_ERROR;
+      else {
+         oFTree->psFreed->ulNodes = 0;
+         oFTree->psFreed->ulRefs = 1;
+      }
+   }
+   if(iStatus == SUCCESS)
+      oFTree->oReclaimPool = oPool;
+   FT_unlockWrite(oFTree);
+   return iStatus;
+}
+
+/*
+  Carries out psOp, which changes the tree rather than looking a path
+  up, on oFTree, for a caller that has already synchronized with other
+  threads.
+*/
+static void FT_applyUnlocked(FT_T oFTree, struct FT_Op *psOp) {
+   assert(oFTree != NULL);
+   assert(psOp != NULL);
+   assert(psOp->pcPath != NULL);
+
+   if(FT_isReadOnly(oFTree)) {
+      psOp->iStatus = READ_ONLY_TREE;
+      return;
+   }
+
+   switch(psOp->eKind) {
+      case FT_OP_INSERT_DIR:
+         psOp->iStatus = FT_insertDirUnlocked(oFTree, psOp->pcPath);
+         break;
+      case FT_OP_INSERT_FILE:
+         psOp->iStatus = FT_insertFileUnlocked(oFTree, psOp->pcPath,
+                                               psOp->pvContents,
+                                               psOp->ulLength);
+         break;
+      case FT_OP_RM_DIR:
+         psOp->iStatus = FT_rmDirUnlocked(oFTree, psOp->pcPath);
+         break;
+      case FT_OP_RM_FILE:
+         psOp->iStatus = FT_rmFileUnlocked(oFTree, psOp->pcPath);
+         break;
+      default:
+         assert(FALSE);
+   }
+}
+
+/* Returns TRUE if psOp only looks a path up. */
+static boolean FT_isLookup(const struct FT_Op *psOp) {
+   assert(psOp != NULL);
+
+   return (boolean) (psOp->eKind == FT_OP_STAT ||
+                     psOp->eKind == FT_OP_GET_CONTENTS);
+}
+
+void FT_applyBatch(FT_T oFTree, struct FT_Op *psOps, size_t ulNumOps) {
+   size_t i = 0;
+   size_t ulEnd;
+
+   assert(oFTree != NULL);
+   assert(psOps != NULL || ulNumOps == 0);
+
+   FT_lockWrite(oFTree);
+   while(i < ulNumOps) {
+      /* runs of lookups are interleaved with each other */
+      for(ulEnd = i; ulEnd < ulNumOps && FT_isLookup(&psOps[ulEnd]);
+          ulEnd++)
+         ;
+      if(ulEnd > i) {
+         FT_lookupManyUnlocked(oFTree, &psOps[i], ulEnd - i);
+         i = ulEnd;
+      }
+      else
+         FT_applyUnlocked(oFTree, &psOps[i++]);
+   }
+   FT_unlockWrite(oFTree);
+}
+
+int FT_lookupMany(FT_T oFTree, struct FT_Op *psOps, size_t ulNumOps) {
+   assert(oFTree != NULL);
+   assert(psOps != NULL || ulNumOps == 0);
+
+   if(FT_beginRead(oFTree) != SUCCESS)
+      return MEMORY_ERROR;
+   FT_lookupManyUnlocked(oFTree, psOps, ulNumOps);
+   FT_endRead(oFTree);
+   return SUCCESS;
+}
+
+
+/*--------------------------------------------------------------------*/
+/* The default File Tree                                              */
+/*--------------------------------------------------------------------*/
+
+int FT_init(void) {
+   if(bIsInitialized)
+      return INITIALIZATION_ERROR;
+
+   bIsInitialized = TRUE;
+   sDefault.oNRoot = NULL;
+   sDefault.psBackend = &sNodeBackend;
+   return SUCCESS;
+}
+
+int FT_buildFromSorted(const struct FT_Record *psRecords,
+                       size_t ulNumRecords) {
+   int iStatus;
+
+   assert(psRecords != NULL || ulNumRecords == 0);
+
+   if(bIsInitialized)
+      return INITIALIZATION_ERROR;
+
+   sDefault.oNRoot = NULL;
+   sDefault.psBackend = &sNodeBackend;
+   iStatus = FT_build(&sDefault, psRecords, ulNumRecords);
+   if(iStatus == SUCCESS)
+      bIsInitialized = TRUE;
+   return iStatus;
+}
+
+int FT_destroy(void) {
+   if(!bIsInitialized)
+      return INITIALIZATION_ERROR;
+
+   if(sDefault.psSave != NULL)
+      (void) FT_finishSave(sDefault.psSave);
+   sDefault.psSave = NULL;
+   if(sDefault.oNRoot != NULL)
+      (void) FT_removeSubtree(&sDefault, sDefault.oNRoot);
+   FT_forgetRemoved(&sDefault);
+   FT_freeVersions(&sDefault);
+   FT_freeLazy(&sDefault);
+   (*sDefault.psBackend->pfFreeStore)(&sDefault);
+   sDefault.psBackend = &sNodeBackend;
+   sDefault.pvStore = NULL;
+   sDefault.ulDeltas = 0;
+
+   bIsInitialized = FALSE;
+   return SUCCESS;
+}
+
+int FT_insertDir(const char *pcPath) {
+   assert(pcPath != NULL);
+
+   if(!bIsInitialized)
+      return INITIALIZATION_ERROR;
+   return FT_insertDirIn(&sDefault, pcPath);
+}
+
+boolean FT_containsDir(const char *pcPath) {
+   assert(pcPath != NULL);
+
+   if(!bIsInitialized)
+      return FALSE;
+   return FT_containsDirIn(&sDefault, pcPath);
+}
+
+int FT_rmDir(const char *pcPath) {
+   assert(pcPath != NULL);
+
+   if(!bIsInitialized)
+      return INITIALIZATION_ERROR;
+   return FT_rmDirIn(&sDefault, pcPath);
 }
 
+int FT_insertFile(const char *pcPath, void *pvContents,
+                  size_t ulLength) {
+   assert(pcPath != NULL);
 
-boolean FT_containsDir(const char *pcPath) {
-   int iStatus;
-   Node_T oNFound = NULL;
+   if(!bIsInitialized)
+      return INITIALIZATION_ERROR;
+   return FT_insertFileIn(&sDefault, pcPath, pvContents, ulLength);
+}
 
+boolean FT_containsFile(const char *pcPath) {
    assert(pcPath != NULL);
 
-   iStatus = FT_findNode(pcPath, &oNFound, FALSE);
-   return (boolean) (iStatus == SUCCESS);
+   if(!bIsInitialized)
+      return FALSE;
+   return FT_containsFileIn(&sDefault, pcPath);
 }
 
-boolean FT_containsFile(const char *pcPath) {
-   int iStatus;
-   Node_T oNFound = NULL;
+int FT_rmFile(const char *pcPath) {
+   assert(pcPath != NULL);
+
+   if(!bIsInitialized)
+      return INITIALIZATION_ERROR;
+   return FT_rmFileIn(&sDefault, pcPath);
+}
 
+void *FT_getFileContents(const char *pcPath) {
    assert(pcPath != NULL);
 
-   iStatus = FT_findNode(pcPath, &oNFound, TRUE);
-   return (boolean) (iStatus == SUCCESS);
+   if(!bIsInitialized)
+      return NULL;
+   return FT_getFileContentsIn(&sDefault, pcPath);
 }
 
-int FT_insertDir(const char *pcPath) {
-   int iStatus;
-   Path_T oPPath = NULL, zPPath = NULL;
-   Node_T oNFirstNew = NULL;
-   Node_T oNCurr = NULL;
-   size_t ulDepth, ulIndex;
-   size_t ulNewNodes = 0;
+void *FT_replaceFileContents(const char *pcPath, void *pvNewContents,
+                             size_t ulNewLength) {
+   assert(pcPath != NULL);
+
+   if(!bIsInitialized)
+      return NULL;
+   return FT_replaceFileContentsIn(&sDefault, pcPath, pvNewContents,
+                                   ulNewLength);
+}
 
+int FT_stat(const char *pcPath, boolean *pbIsFile, size_t *pulSize) {
    assert(pcPath != NULL);
+   assert(pbIsFile != NULL);
+   assert(pulSize != NULL);
 
-   /* validate pcPath and generate a Path_T for it */
    if(!bIsInitialized)
       return INITIALIZATION_ERROR;
+   return FT_statIn(&sDefault, pcPath, pbIsFile, pulSize);
+}
 
-   iStatus = Path_new(pcPath, &oPPath);
-   if(iStatus != SUCCESS)
-      return iStatus;
+char *FT_toString(void) {
+   if(!bIsInitialized)
+      return NULL;
+   return FT_toStringIn(&sDefault);
+}
 
-   /* find the closest ancestor of oPPath already in the tree */
-   iStatus = FT_traversePath(oPPath, FALSE, &oNCurr);
-   if(iStatus != SUCCESS)
-   {
-      Path_free(oPPath);
-      return iStatus;
-   }
+int FT_setReclaimPool(ThreadPool_T oPool) {
+   return FT_setReclaimPoolIn(&sDefault, oPool);
+}
 
-   /* no ancestor node found, so if root is not NULL,
-      pcPath isn't underneath root. */
-   if(oNCurr == NULL && oNRoot != NULL) {
-      Path_free(oPPath);
-      return CONFLICTING_PATH;
-   }
+int FT_save(const char *pcFilename) {
+   assert(pcFilename != NULL);
 
-   iStatus = Path_new(pcPath, &zPPath);
-   if(iStatus != SUCCESS){
-      Path_free(oPPath);
-      Path_free(zPPath);
-      return iStatus;
-   }
+   if(!bIsInitialized)
+      return INITIALIZATION_ERROR;
+   return FT_saveIn(&sDefault, pcFilename);
+}
 
-   iStatus = FT_traversePath(zPPath, TRUE, &oNCurr);
-   if(iStatus != SUCCESS) {
-      Path_free(oPPath);
-      Path_free(zPPath);
-      return iStatus;
-   }
-   ulDepth = Path_getDepth(zPPath);
-   if(oNCurr == NULL) /* new root! */
-      ulIndex = 1;
-   else {
-      ulIndex = Path_getDepth(Node_getPath(oNCurr))+1;
-      /* oNCurr is the node we're trying to insert */
-      if(ulIndex == ulDepth+1 && !Path_comparePath(zPPath,
-                                       Node_getPath(oNCurr))) {
-         Path_free(oPPath);
-         Path_free(zPPath);
-         return ALREADY_IN_TREE;
-      }
-   }
-   iStatus = FT_traversePath(oPPath, FALSE, &oNCurr);
-   if(iStatus != SUCCESS) {
-      Path_free(oPPath);
-      Path_free(zPPath);
-      return iStatus;
-   }
-   ulDepth = Path_getDepth(oPPath);
-   if(oNCurr == NULL) /* new root! */
-      ulIndex = 1;
-   else {
-      ulIndex = Path_getDepth(Node_getPath(oNCurr))+1;
-      if(ulIndex == ulDepth+1 && !Path_comparePath(oPPath,
-                                       Node_getPath(oNCurr))) {
-         Path_free(oPPath);
-         Path_free(zPPath);
-         return ALREADY_IN_TREE;
-      }
-   }
+int FT_saveDelta(const char *pcFilename) {
+   assert(pcFilename != NULL);
 
-   /* starting at oNCurr, build rest of the path one level at a time */
-   while(ulIndex <= ulDepth) {
-      Path_T oPPrefix = NULL;
-      Node_T oNNewNode = NULL;
+   if(!bIsInitialized)
+      return INITIALIZATION_ERROR;
+   return FT_saveDeltaIn(&sDefault, pcFilename);
+}
 
-      /* generate a Path_T for this level */
-      iStatus = Path_prefix(oPPath, ulIndex, &oPPrefix);
-      if(iStatus != SUCCESS) {
-         Path_free(oPPath);
-         Path_free(zPPath);
-         Path_free(oPPrefix);
-         if(oNFirstNew != NULL)
-            (void) Node_free(oNFirstNew);
-         return iStatus;
-      }
+int FT_applyDelta(const char *pcFilename, void **ppvContents) {
+   assert(pcFilename != NULL);
+   assert(ppvContents != NULL);
 
-      /* insert the new node for this level */
-      iStatus = Node_new(oPPrefix, oNCurr, &oNNewNode, FALSE, NULL, 0);
-      if(iStatus != SUCCESS) {
-         Path_free(oPPath);
-         Path_free(zPPath);
-         Path_free(oPPrefix);
-         if(oNFirstNew != NULL)
-            (void) Node_free(oNFirstNew);
-         return iStatus;
-      }
+   *ppvContents = NULL;
+   if(!bIsInitialized)
+      return INITIALIZATION_ERROR;
+   return FT_applyDeltaIn(&sDefault, pcFilename, ppvContents);
+}
 
-      /* set up for next level */
-      Path_free(oPPrefix);
-      oNCurr = oNNewNode;
-      ulNewNodes++;
-      if(oNFirstNew == NULL)
-         oNFirstNew = oNCurr;
-      ulIndex++;
-   }
+int FT_snapshot(FT_T *poFSnapshot) {
+   assert(poFSnapshot != NULL);
 
-   Path_free(oPPath);
-   Path_free(zPPath);
-   /* update FT state variables to reflect insertion */
-   if(oNRoot == NULL)
-      oNRoot = oNFirstNew;
-   ulCount += ulNewNodes;
+   *poFSnapshot = NULL;
+   if(!bIsInitialized)
+      return INITIALIZATION_ERROR;
+   return FT_snapshotIn(&sDefault, poFSnapshot);
+}
 
-   return SUCCESS;
+int FT_beginSave(const char *pcFilename) {
+   assert(pcFilename != NULL);
+
+   if(!bIsInitialized)
+      return INITIALIZATION_ERROR;
+   return FT_beginSaveIn(&sDefault, pcFilename);
 }
 
-int FT_insertFile(const char *pcPath, void *pvContents, size_t ulLength) {
-   int iStatus;
-   Path_T oPPath = NULL, zPPath = NULL;
-   Node_T oNFirstNew = NULL;
-   Node_T oNCurr = NULL;
-   size_t ulDepth, ulIndex;
-   size_t ulNewNodes = 0;
+int FT_endSave(void) {
+   if(!bIsInitialized)
+      return INITIALIZATION_ERROR;
+   return FT_endSaveIn(&sDefault);
+}
 
-   assert(pcPath != NULL);
+int FT_saveImage(const char *pcFilename) {
+   assert(pcFilename != NULL);
 
-   /* validate pcPath and generate a Path_T for it */
    if(!bIsInitialized)
       return INITIALIZATION_ERROR;
+   return FT_saveImageIn(&sDefault, pcFilename);
+}
 
-   iStatus = Path_new(pcPath, &oPPath);
-   if(iStatus != SUCCESS){
-      Path_free(oPPath);
-      return iStatus;
-   }
+int FT_sync(void) {
+   if(!bIsInitialized)
+      return INITIALIZATION_ERROR;
+   return FT_syncIn(&sDefault);
+}
 
-   /* find the closest ancestor of oPPath already in the tree */
-   iStatus = FT_traversePath(oPPath, TRUE, &oNCurr);
-   if(iStatus != SUCCESS)
-   {
-      Path_free(oPPath);
-      return iStatus;
-   }
-  
-   /*oNCurr is at the root*/
-   if(oNCurr == NULL && ulCount == 0 && Path_getDepth(oPPath) == 1)
-   {
-      Path_free(oPPath);
-      return CONFLICTING_PATH;
-   }
-   /* no ancestor node found, so if root is not NULL,
-      pcPath isn't underneath root. */
-   if(oNCurr == NULL && oNRoot != NULL) {
-      Path_free(oPPath);
-      return CONFLICTING_PATH;
-   }
-   /* ulDepth = Path_getDepth(oPPath); */
-   iStatus = Path_new(pcPath, &zPPath);
-   if(iStatus != SUCCESS){
-      Path_free(oPPath);
-      Path_free(zPPath);
-      return iStatus;
-   }
+int FT_freeze(void) {
+   if(!bIsInitialized)
+      return INITIALIZATION_ERROR;
+   return FT_freezeIn(&sDefault);
+}
 
-   /* find the closest ancestor of oPPath already in the tree */
-   iStatus = FT_traversePath(zPPath, FALSE, &oNCurr);
-   if(iStatus != SUCCESS) {
-      Path_free(oPPath);
-      Path_free(zPPath);
-      return iStatus;
-   }
-   ulDepth = Path_getDepth(zPPath);
-   if(oNCurr == NULL) /* new root! */
-      ulIndex = 1;
-   else {
-      ulIndex = Path_getDepth(Node_getPath(oNCurr))+1;
-      /* oNCurr is the node we're trying to insert */
-      if(ulIndex == ulDepth+1 && !Path_comparePath(zPPath,
-                                       Node_getPath(oNCurr))) {
-         Path_free(oPPath);
-         Path_free(zPPath);
-         return ALREADY_IN_TREE;
-      }
-   }
-   iStatus = FT_traversePath(oPPath, TRUE, &oNCurr);
-   if(iStatus != SUCCESS) {
-      Path_free(oPPath);
-      Path_free(zPPath);
-      return iStatus;
-   }
-   ulDepth = Path_getDepth(oPPath);
-   if(oNCurr == NULL) /* new root! */
-      ulIndex = 1;
-   else {
-      ulIndex = Path_getDepth(Node_getPath(oNCurr))+1;
-      if(ulIndex == ulDepth+1 && !Path_comparePath(oPPath,
-                                       Node_getPath(oNCurr))) {
-         Path_free(oPPath);
-         Path_free(zPPath);
-         return ALREADY_IN_TREE;
-      }
-   }
+int FT_load(const char *pcFilename, void **ppvContents) {
+   int iStatus;
 
+   assert(pcFilename != NULL);
+   assert(ppvContents != NULL);
 
-   /* starting at oNCurr, build rest of the path one level at a time */
-   while(ulIndex <= ulDepth) {
-      Path_T oPPrefix = NULL;
-      Node_T oNNewNode = NULL;
+   *ppvContents = NULL;
+   if(bIsInitialized)
+      return INITIALIZATION_ERROR;
 
-      /* generate a Path_T for this level */
-      iStatus = Path_prefix(oPPath, ulIndex, &oPPrefix);
-      if(iStatus != SUCCESS) {
-         Path_free(oPPath);
-         Path_free(zPPath);
-         Path_free(oPPrefix);
-         if(oNFirstNew != NULL)
-            (void) Node_free(oNFirstNew);
-         return iStatus;
-      }
+   sDefault.oNRoot = NULL;
+   sDefault.psBackend = &sNodeBackend;
+   iStatus = FT_loadSnapshot(&sDefault, pcFilename, ppvContents);
+   if(iStatus == SUCCESS)
+      bIsInitialized = TRUE;
+   return iStatus;
+}
 
-      /* insert the new node for this level */
-      /* Insert the directories first */
-      if(ulIndex < ulDepth) 
-         iStatus = Node_new(oPPrefix, oNCurr, &oNNewNode, FALSE, pvContents, ulLength);
-      else
-         iStatus = Node_new(oPPrefix, oNCurr, &oNNewNode, TRUE, pvContents, ulLength);
-      if(iStatus != SUCCESS) {
-         Path_free(oPPath);
-         Path_free(zPPath);
-         Path_free(oPPrefix);
-         if(oNFirstNew != NULL)
-            (void) Node_free(oNFirstNew);
-         return iStatus;
-      }
+int FT_loadLazy(const char *pcFilename, size_t ulBudget) {
+   int iStatus;
 
-      /* set up for next level */
-      Path_free(oPPrefix);
-      oNCurr = oNNewNode;
-      ulNewNodes++;
-      if(oNFirstNew == NULL)
-         oNFirstNew = oNCurr;
-      ulIndex++;
-   }
-   Path_free(zPPath);
-   Path_free(oPPath);
-   /* update FT state variables to reflect insertion */
-   if(oNRoot == NULL)
-      oNRoot = oNFirstNew;
-   ulCount += ulNewNodes;
+   assert(pcFilename != NULL);
 
-   return SUCCESS;
+   if(bIsInitialized)
+      return INITIALIZATION_ERROR;
+
+   sDefault.oNRoot = NULL;
+   sDefault.psBackend = &sNodeBackend;
+   iStatus = FT_openLazy(&sDefault, pcFilename, ulBudget);
+   if(iStatus == SUCCESS)
+      bIsInitialized = TRUE;
+   return iStatus;
 }
 
+int FT_loadArena(const char *pcFilename) {
+   FTArena_T oArena;
+   int iStatus;
+
+   assert(pcFilename != NULL);
 
-int FT_destroy(void) {
-   if(!bIsInitialized)
+   if(bIsInitialized)
       return INITIALIZATION_ERROR;
 
-   if(oNRoot) {
-      ulCount -= Node_free(oNRoot);
-      oNRoot = NULL;
-   }
-
-   bIsInitialized = FALSE;
+   sDefault.oNRoot = NULL;
+   iStatus = FTArena_open(pcFilename, &oArena);
+   if(iStatus != SUCCESS)
+      return iStatus;
+   sDefault.pvStore = oArena;
+   sDefault.psBackend = &sArenaBackend;
+   bIsInitialized = TRUE;
    return SUCCESS;
 }
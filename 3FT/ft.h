@@ -14,6 +14,22 @@
 
 #include <stddef.h>
 #include "a4def.h"
+#include "threadpool.h"
+
+/*
+  A description of one directory or file in an FT, as consumed by
+  FT_buildFromSorted. pvContents and ulLength are ignored for
+  directories.
+*/
+struct FT_Record {
+   /* the absolute path of the directory or file */
+   const char *pcPath;
+   /* TRUE for a file, FALSE for a directory */
+   boolean bIsFile;
+   /* the file's contents and their size in bytes */
+   void *pvContents;
+   size_t ulLength;
+};
 
 /*
    Inserts a new directory into the FT with absolute path pcPath.
@@ -127,9 +143,34 @@ int FT_stat(const char *pcPath, boolean *pbIsFile, size_t *pulSize);
 */
 int FT_init(void);
 
+/*
+  Sets the FT data structure to an initialized state containing
+  exactly the directories and files described by the ulNumRecords
+  records in psRecords, plus any directory that is a proper prefix of
+  one of their paths. The records must be in the canonical order of
+  FT_toString (e.g., as sorted by StrSort_sortPaths), which lets every
+  node be appended after its siblings in one linear pass, instead of
+  traversing from the root and inserting into sorted child arrays
+  once per record.
+  Returns SUCCESS if the FT is built successfully. Otherwise, leaves
+  the FT uninitialized and returns:
+  * INITIALIZATION_ERROR if the FT is already in an initialized state
+  * BAD_PATH if a record's path is not well-formatted, or if the
+             records are not in strictly increasing canonical order
+  * CONFLICTING_PATH if the records' paths do not all share a root,
+                     or if a file would be the FT root
+  * NOT_A_DIRECTORY if a proper prefix of a record's path is a file
+  * ALREADY_IN_TREE if a path is described both as a directory and as
+                    a file, or more than once
+  * MEMORY_ERROR if memory could not be allocated to complete request
+*/
+int FT_buildFromSorted(const struct FT_Record *psRecords,
+                       size_t ulNumRecords);
+
 /*
   Removes all contents of the data structure and
-  returns it to an uninitialized state.
+  returns it to an uninitialized state. Any snapshot of it (see
+  FT_snapshot) must have been freed first.
   Returns INITIALIZATION_ERROR if not already initialized,
   and SUCCESS otherwise.
 */
@@ -149,4 +190,556 @@ int FT_destroy(void);
 */
 char *FT_toString(void);
 
+/*
+  Makes FT_rmDir, FT_rmFile and FT_destroy hand the subtrees they
+  remove to oPool rather than free them before returning. Each such
+  subtree is unlinked at once, in time that does not depend on its
+  size, and tasks of oPool then free its nodes in the background,
+  spreading a large subtree over the pool's threads. If oPool is
+  NULL, removed subtrees are freed before the removing call returns,
+  as by default. The setting may be changed whether or not the
+  default File Tree is initialized, and outlasts FT_destroy. oPool
+  must not be freed while it may still be handed subtrees; freeing
+  it finishes the subtrees already handed to it (see
+  ThreadPool_free). Returns SUCCESS, or MEMORY_ERROR, leaving the
+  setting unchanged, if memory for its bookkeeping could not be
+  allocated.
+*/
+int FT_setReclaimPool(ThreadPool_T oPool);
+
+/*
+  Writes a snapshot of the FT to the file pcFilename, replacing any
+  previous contents, in a compact binary format that FT_load reads
+  back. The snapshot is a short header followed by three sections,
+  each in the canonical order of FT_toString: a table with one
+  fixed-size record per directory or file (its depth, its type, and
+  the lengths of its name and contents), a pool of the names, and a
+  blob of the files' contents, copied byte for byte.
+  Returns SUCCESS, or:
+  * INITIALIZATION_ERROR if the FT is not in an initialized state
+  * IO_ERROR if the file could not be opened or written
+  * MEMORY_ERROR if memory could not be allocated to complete request
+*/
+int FT_save(const char *pcFilename);
+
+/*
+  Sets the FT data structure to an initialized state containing
+  exactly the directories and files in the snapshot file pcFilename
+  that FT_save wrote. The file is read sequentially, once, and the
+  hierarchy is rebuilt in one linear pass: each node is appended
+  under its parent, which is found from its depth alone, so no path
+  is parsed or searched for. The files' contents are restored into
+  a single new array, which *ppvContents is set to (or to NULL if it
+  would be empty) and which the client owns: it must free it once
+  it no longer needs the contents. On failure, sets *ppvContents to
+  NULL, leaves the FT uninitialized, and returns:
+  * INITIALIZATION_ERROR if the FT is already in an initialized state
+  * IO_ERROR if the file could not be opened or read
+  * CORRUPT_FILE if the file is not a well-formed snapshot
+  * MEMORY_ERROR if memory could not be allocated to complete request
+*/
+int FT_load(const char *pcFilename, void **ppvContents);
+
+/*
+  Starts saving the FT to the file pcFilename in the background, as
+  FT_beginSaveIn does. Returns SUCCESS, or INITIALIZATION_ERROR if the
+  FT is not in an initialized state, or any other status that
+  FT_beginSaveIn returns. FT_destroy waits for the save to finish.
+*/
+int FT_beginSave(const char *pcFilename);
+
+/*
+  Waits for the background save of the FT to finish, as FT_endSaveIn
+  does. Returns its status, or INITIALIZATION_ERROR if the FT is not
+  in an initialized state.
+*/
+int FT_endSave(void);
+
+/*
+  Writes a delta of the FT to the file pcFilename, replacing any
+  previous contents: the changes made to it since its last
+  checkpoint, which is when it was last saved by FT_save or
+  FT_saveDelta, loaded by FT_load, or brought up to date by
+  FT_applyDelta, or else when it was initialized. The FT keeps track
+  of its changes as it goes: each new directory or file, and each
+  file whose contents were replaced, is marked, as are the
+  directories above it, and the path of each directory or file
+  removed that existed at the checkpoint is kept. Only the marked
+  part of the hierarchy is visited, and the delta holds just the
+  removed paths, the new nodes and the changed contents, so its size
+  and the time it takes depend on what changed rather than on the
+  size of the FT. The delta then becomes the FT's checkpoint.
+  Returns SUCCESS, or:
+  * INITIALIZATION_ERROR if the FT is not in an initialized state
+  * IO_ERROR if the file could not be opened or written
+  * MEMORY_ERROR if memory could not be allocated to complete request
+  On failure the changes stay tracked, so a later delta includes
+  them.
+*/
+int FT_saveDelta(const char *pcFilename);
+
+/*
+  Applies the delta in the file pcFilename to the FT, which must be
+  in the state of the checkpoint the delta was taken from: a
+  snapshot is restored by FT_load, or by FT_init if it was of an
+  empty FT, followed by each delta saved after it, in order. Each
+  delta is numbered, counting from 1 after the snapshot, and one that
+  is not the next in the chain is rejected. As for FT_load, the
+  contents of the delta's new and changed files are restored into a
+  single new array, which *ppvContents is set to (or to NULL if it
+  would be empty) and which the client owns; contents that the delta
+  replaces are not freed. The delta then becomes the FT's
+  checkpoint. Returns SUCCESS, or:
+  * INITIALIZATION_ERROR if the FT is not in an initialized state
+  * IO_ERROR if the file could not be opened or read
+  * CORRUPT_FILE if the file is not a well-formed delta, or is not the
+                 next delta for the FT, or does not fit its hierarchy
+  * MEMORY_ERROR if memory could not be allocated to complete request
+  A delta that turns out not to fit partway through leaves the
+  changes before that point made, with their contents in
+  *ppvContents; otherwise *ppvContents is set to NULL on failure.
+*/
+int FT_applyDelta(const char *pcFilename, void **ppvContents);
+
+/*
+  Writes a read-only image of the FT to the file pcFilename,
+  replacing any previous contents, for FT_newFromImage to map. Unlike
+  a snapshot, an image is laid out to be queried where it lies: its
+  nodes are fixed-size records in breadth-first order, each naming
+  its children by index rather than by pointer, so that each
+  directory's children are consecutive and sorted, with names and
+  contents in pools of their own (see ftimage.h).
+  Returns SUCCESS, or:
+  * INITIALIZATION_ERROR if the FT is not in an initialized state
+  * IO_ERROR if the file could not be opened or written
+  * MEMORY_ERROR if memory could not be allocated to complete request
+*/
+int FT_saveImage(const char *pcFilename);
+
+/*
+  Sets the FT data structure to an initialized state containing the
+  directories and files in the image file pcFilename that
+  FT_saveImage wrote, loading them on demand, as FT_newLazy does,
+  with a budget of ulBudget nodes. Returns SUCCESS, or leaves the FT
+  uninitialized and returns INITIALIZATION_ERROR if the FT is already
+  in an initialized state, or any other status that FT_newLazy
+  returns.
+*/
+int FT_loadLazy(const char *pcFilename, size_t ulBudget);
+
+/*
+  Sets the FT data structure to an initialized state holding its
+  hierarchy in the arena file pcFilename, as FT_newArena does, which
+  is created with an empty hierarchy if it does not exist. Returns
+  SUCCESS, or leaves the FT uninitialized and returns
+  INITIALIZATION_ERROR if the FT is already in an initialized state,
+  or any other status that FT_newArena returns. FT_destroy unmaps the
+  arena, leaving the hierarchy in the file for the next FT_loadArena.
+*/
+int FT_loadArena(const char *pcFilename);
+
+/*
+  Flushes the changes to the default File Tree to its arena file, as
+  FT_syncIn does. Returns SUCCESS, or INITIALIZATION_ERROR if the FT is
+  not in an initialized state, or IO_ERROR if the writes failed.
+*/
+int FT_sync(void);
+
+/*
+  Freezes the FT, as FT_freezeIn does. Returns SUCCESS, or
+  INITIALIZATION_ERROR if the FT is not in an initialized state, or
+  any other status that FT_freezeIn returns. FT_destroy frees the
+  frozen form, and the FT is made of nodes again once it is next
+  initialized.
+*/
+int FT_freeze(void);
+
+/*--------------------------------------------------------------------*/
+
+/*
+  The functions above operate on a single, default File Tree. The
+  functions below operate on any number of independent File Trees,
+  each represented by an FT_T object. An FT_T object is always in an
+  initialized state, so none of them return INITIALIZATION_ERROR;
+  otherwise each FT_xIn function behaves exactly as FT_x does on the
+  default File Tree.
+*/
+typedef struct FT *FT_T;
+
+/*
+  Returns a new, empty FT_T object, or NULL if insufficient memory is
+  available.
+*/
+FT_T FT_new(void);
+
+/*
+  Returns a new, empty FT_T object that may be used by several threads
+  at once, or NULL if insufficient memory is available or a lock could
+  not be created. Lookups (FT_containsDirIn, FT_containsFileIn,
+  FT_getFileContentsIn and FT_statIn) take no lock and write no shared
+  memory, so they run in parallel with one another and with writers.
+  Inserts into a non-empty tree also run in parallel with one another:
+  each walks the tree without locking and then locks only the
+  directory that gains a child, retrying if that directory changed
+  after the walk saw it. Every other operation excludes all other
+  writers. A writer replaces a directory's children array with an
+  updated copy rather than changing it in place, and nodes and arrays
+  that readers might still be using are freed only after those
+  readers finish (see epoch.h). Each insert or removal therefore
+  copies every child of the same type in its directory, so filling a
+  directory with n children one at a time takes time, and leaves
+  arrays for the epochs to free, proportional to n squared; a tree
+  with wide directories that need not be shared between threads is
+  better built by FT_newFromSorted, in linear time. A lookup may
+  return MEMORY_ERROR, FALSE or NULL if its thread's bookkeeping
+  cannot be allocated on its first lookup. FT_free must not overlap
+  any other use of the object. The File Trees returned by FT_new and
+  FT_newFromSorted, and the default File Tree, do no synchronization
+  and must not be shared between threads without external
+  synchronization.
+*/
+FT_T FT_newConcurrent(void);
+
+/*
+  Returns an int SUCCESS status and sets *poFResult to be a new FT_T
+  object containing exactly the directories and files described by
+  the ulNumRecords records in psRecords, as FT_buildFromSorted does
+  for the default File Tree. Otherwise, sets *poFResult to NULL and
+  returns any status that FT_buildFromSorted returns, other than
+  INITIALIZATION_ERROR.
+*/
+int FT_newFromSorted(const struct FT_Record *psRecords,
+                     size_t ulNumRecords, FT_T *poFResult);
+
+/*
+  Returns an int SUCCESS status and sets *poFResult to be a new FT_T
+  object containing exactly the directories and files in the snapshot
+  file pcFilename, as FT_load does for the default File Tree, and
+  sets *ppvContents as FT_load does. Otherwise, sets *poFResult and
+  *ppvContents to NULL and returns any status that FT_load returns,
+  other than INITIALIZATION_ERROR.
+*/
+int FT_newFromFile(const char *pcFilename, FT_T *poFResult,
+                   void **ppvContents);
+
+/*
+  Returns an int SUCCESS status and sets *poFResult to be a new,
+  read-only FT_T object over the image file pcFilename that
+  FT_saveImage or FT_saveImageIn wrote. The file is mapped into
+  memory rather than read, so this takes the same short time however
+  large the image is; lookups then read only the pages they touch,
+  and processes that map the same image share one copy of it in the
+  page cache. FT_containsDirIn, FT_containsFileIn, FT_statIn,
+  FT_getFileContentsIn, FT_lookupMany, FT_toStringIn and
+  FT_toStringParallel work as for any File Tree, without taking locks,
+  so any number of threads may call them at once. The contents they
+  return point into the mapping: they must not be written to, and are
+  valid until the tree is freed. Every change, FT_applyBatch change,
+  FT_saveIn, FT_beginSaveIn, FT_saveDeltaIn, FT_applyDeltaIn and
+  FT_saveImageIn fails with READ_ONLY_TREE, and
+  FT_replaceFileContentsIn returns NULL. Otherwise, sets *poFResult
+  to NULL and returns:
+  * IO_ERROR if the file could not be opened or mapped
+  * CORRUPT_FILE if the file is not the size that its header claims
+  * MEMORY_ERROR if memory could not be allocated to complete request
+*/
+int FT_newFromImage(const char *pcFilename, FT_T *poFResult);
+
+/*
+  Returns an int SUCCESS status and sets *poFResult to be a new FT_T
+  object containing the directories and files in the image file
+  pcFilename that FT_saveImage or FT_saveImageIn wrote, for a
+  hierarchy too large to hold in memory at once. The image is mapped
+  as by FT_newFromImage, and only its root is loaded: each directory
+  is a stub until a lookup or change first descends into it, which
+  loads its children, the directories among them as stubs in turn,
+  by reading the one range of records that the image keeps for them.
+  Once more than ulBudget nodes have been loaded, the next lookup or
+  change first evicts the directories that lookups and changes have
+  not passed through for longest, turning them back into stubs, until
+  the tree holds three quarters of ulBudget nodes; a ulBudget of 0
+  sets no limit. A directory with something changed, added or
+  removed below it since it was loaded is never evicted, so the
+  tree's changes always stay in memory, nor is anything evicted while
+  a snapshot of the tree is live. FT_toStringIn,
+  FT_toStringParallel, FT_saveIn and FT_saveImageIn load the whole
+  hierarchy first. The tree is changed as any other is, but its
+  lookups change it too, so it must not be shared between threads
+  without external synchronization, even for lookups; its snapshots
+  load stubs of the tree, and so must not be used at the same time as
+  it either. The contents of files loaded from the image point into
+  the mapping: they must not be written to or freed, and are valid
+  until the tree is freed. pcFilename must not be overwritten while
+  the tree is in use, even by FT_saveImageIn of the tree itself.
+  A lookup or change that must load a directory whose records are
+  not well-formed fails with CORRUPT_FILE. Otherwise, sets *poFResult
+  to NULL and returns any status that FT_newFromImage returns.
+*/
+int FT_newLazy(const char *pcFilename, size_t ulBudget,
+               FT_T *poFResult);
+
+/*
+  Returns an int SUCCESS status and sets *poFResult to be a new FT_T
+  object whose hierarchy lives in the persistent arena file
+  pcFilename, which is created with an empty hierarchy if it does not
+  exist (see ftarena.h). Every node, name, children array and file
+  contents of the tree is a block of the file, mapped shared, and the
+  blocks refer to each other by offsets rather than pointers, so the
+  mapping is the tree: opening it checks its blocks but rebuilds
+  nothing, changes are made in place, FT_syncIn makes them durable,
+  and FT_free leaves them in the file for the next FT_newArena.
+  Inserts and replacements copy file contents into the arena, so the
+  caller keeps its own. The contents that lookups return point into
+  the mapping and, like the old contents that FT_replaceFileContentsIn
+  returns, are valid until the next change to the tree, which may
+  move the mapping as the file grows. Every operation works as for
+  any File Tree, without synchronization, except that FT_saveIn,
+  FT_beginSaveIn, FT_saveDeltaIn, FT_saveImageIn, FT_snapshotIn and
+  FT_freezeIn fail with NOT_SUPPORTED: the arena file is itself the
+  saved tree. Changes that need the file to grow fail with IO_ERROR
+  if it cannot. Otherwise, sets *poFResult to NULL and returns:
+  * IO_ERROR if the file could not be created, opened or mapped
+  * CORRUPT_FILE if the file is not a well-formed arena made on a
+                 machine with the same words
+  * MEMORY_ERROR if memory could not be allocated to complete request
+*/
+int FT_newArena(const char *pcFilename, FT_T *poFResult);
+
+/*
+  Destroys and frees all memory allocated for oFTree, first waiting
+  for any save of it under way (see FT_beginSaveIn). Any snapshot of
+  oFTree must have been freed first (see FT_snapshotIn).
+*/
+void FT_free(FT_T oFTree);
+
+/* Inserts a new directory into oFTree, as FT_insertDir does. */
+int FT_insertDirIn(FT_T oFTree, const char *pcPath);
+
+/* Returns TRUE if oFTree contains directory pcPath, else FALSE. */
+boolean FT_containsDirIn(FT_T oFTree, const char *pcPath);
+
+/* Removes a directory subtree from oFTree, as FT_rmDir does. */
+int FT_rmDirIn(FT_T oFTree, const char *pcPath);
+
+/* Inserts a new file into oFTree, as FT_insertFile does. */
+int FT_insertFileIn(FT_T oFTree, const char *pcPath,
+                    void *pvContents, size_t ulLength);
+
+/* Returns TRUE if oFTree contains file pcPath, else FALSE. */
+boolean FT_containsFileIn(FT_T oFTree, const char *pcPath);
+
+/* Removes a file from oFTree, as FT_rmFile does. */
+int FT_rmFileIn(FT_T oFTree, const char *pcPath);
+
+/* Returns the contents of a file in oFTree, as FT_getFileContents
+   does. */
+void *FT_getFileContentsIn(FT_T oFTree, const char *pcPath);
+
+/* Replaces the contents of a file in oFTree, as
+   FT_replaceFileContents does. */
+void *FT_replaceFileContentsIn(FT_T oFTree, const char *pcPath,
+                               void *pvNewContents,
+                               size_t ulNewLength);
+
+/* Reports on a path in oFTree, as FT_stat does. */
+int FT_statIn(FT_T oFTree, const char *pcPath, boolean *pbIsFile,
+              size_t *pulSize);
+
+/*
+  Returns a string representation of oFTree, as FT_toString does, or
+  NULL if there is an allocation error. Allocates memory for the
+  returned string, which is then owned by client!
+*/
+char *FT_toStringIn(FT_T oFTree);
+
+/*
+  Returns the same string as FT_toStringIn(oFTree), or NULL if there
+  is an allocation error, but builds it with up to ulThreads threads.
+  The tree is split into subtrees, plus the lines of the directories
+  above them, in canonical order. Threads claim the pieces one at a
+  time, so a thread that draws a small subtree goes on to take more.
+  Each thread gathers and measures its pieces. Then every piece is
+  written at its offset in the result, again in parallel. Small trees
+  are handled by a single thread. Allocates memory for the returned
+  string, which is then owned by client!
+*/
+char *FT_toStringParallel(FT_T oFTree, size_t ulThreads);
+
+/* Writes a snapshot of oFTree to pcFilename, as FT_save does. */
+int FT_saveIn(FT_T oFTree, const char *pcFilename);
+
+/* Writes a delta of oFTree to pcFilename, as FT_saveDelta does. A tree
+   made by FT_new, FT_newConcurrent or FT_newFromSorted starts at a
+   checkpoint of its initial hierarchy. */
+int FT_saveDeltaIn(FT_T oFTree, const char *pcFilename);
+
+/* Applies the delta in pcFilename to oFTree, as FT_applyDelta does. */
+int FT_applyDeltaIn(FT_T oFTree, const char *pcFilename,
+                    void **ppvContents);
+
+/* Writes an image of oFTree to pcFilename, as FT_saveImage does. */
+int FT_saveImageIn(FT_T oFTree, const char *pcFilename);
+
+/*
+  Flushes every change to oFTree, if it was made by FT_newArena, to
+  its arena file, waiting for the writes to complete. A tree not in
+  an arena has nothing to flush. Returns SUCCESS, or IO_ERROR if the
+  writes failed. Until then, a crash of the system may leave the file
+  with only some of the changes, and not necessarily a consistent
+  hierarchy.
+*/
+int FT_syncIn(FT_T oFTree);
+
+/*
+  Freezes oFTree, for a tree that is to be looked up much more than it
+  is changed: replaces its nodes with a compact, read-only copy of its
+  hierarchy (see ftfrozen.h), whose shape is held in bit vectors at
+  about 4 bits per node and whose names are front-coded, so that the
+  names of siblings that share long prefixes take little more than
+  their differing tails, while a lookup still binary searches each
+  directory's children. FT_containsDirIn, FT_containsFileIn,
+  FT_statIn, FT_getFileContentsIn, FT_lookupMany, FT_toStringIn and
+  FT_toStringParallel then work as for any File Tree, and every other
+  call fails as for a tree made by FT_newFromImage. The frozen tree
+  points to the same file contents as the nodes did. A tree whose
+  directories are loaded on demand is first loaded whole. Returns
+  SUCCESS, or:
+  * READ_ONLY_TREE if oFTree is already frozen, or was made by
+                   FT_newFromImage, or is a snapshot
+  * NOT_SUPPORTED if oFTree was made by FT_newArena
+  * CORRUPT_FILE if a directory loaded on demand could not be read
+  * MEMORY_ERROR if memory could not be allocated to complete request
+  On failure, oFTree is left as it was.
+*/
+int FT_freezeIn(FT_T oFTree);
+
+/*
+  Returns an int SUCCESS status and sets *poFSnapshot to a new,
+  read-only FT_T object showing oFTree as it is now, in constant time
+  and without copying anything. oFTree's changes then proceed as
+  usual, and the snapshot keeps showing the hierarchy it was taken
+  of, so a long scan of it, such as FT_toStringIn, FT_saveIn or
+  FT_saveImageIn, sees one consistent version without holding
+  changes off. While a snapshot is live, a change to oFTree copies
+  the nodes it would modify that the snapshot may see, which are
+  those on the path from the root to the change that no change since
+  the snapshot has already copied, and leaves the originals to the
+  snapshot; every other node is shared. A node that a change unlinks
+  is freed once no live snapshot can see it. Inserts into a tree
+  returned by FT_newConcurrent hold its lock exclusively while a
+  snapshot is live. Lookups, FT_toStringIn, FT_toStringParallel,
+  FT_saveIn, FT_saveImageIn and FT_snapshotIn work on the snapshot
+  as on any File Tree, from any number of threads at once, while
+  oFTree is being changed; every change, FT_applyBatch change,
+  FT_saveDeltaIn and FT_applyDeltaIn fails with READ_ONLY_TREE, and
+  FT_replaceFileContentsIn returns NULL. The snapshot shares file
+  contents with oFTree. FT_free frees the snapshot, from any thread,
+  and must be called before oFTree is freed. Otherwise, sets
+  *poFSnapshot to NULL and returns:
+  * READ_ONLY_TREE if oFTree was made by FT_newFromImage, and thus
+                   never changes
+  * NOT_SUPPORTED if oFTree was made by FT_newArena
+  * MEMORY_ERROR if memory could not be allocated to complete request
+*/
+int FT_snapshotIn(FT_T oFTree, FT_T *poFSnapshot);
+
+/*
+  Takes a snapshot of the default File Tree, as FT_snapshotIn does,
+  or returns INITIALIZATION_ERROR if it is not in an initialized
+  state.
+*/
+int FT_snapshot(FT_T *poFSnapshot);
+
+/*
+  Starts writing oFTree to the file pcFilename, as FT_saveIn does,
+  from a thread of its own, and returns without waiting for it. The
+  thread writes a snapshot of oFTree, taken as FT_snapshotIn takes
+  one, so the file holds the hierarchy as it is now, while changes to
+  oFTree go ahead as the file is written. The file is crash-safe: the
+  thread writes a temporary file named pcFilename with ".tmp"
+  appended, waits for it to reach stable storage, and only then
+  renames it over pcFilename, so that pcFilename holds either its old
+  contents or the whole new snapshot whenever the system stops. A
+  tree whose directories are loaded on demand is first loaded whole.
+  Unlike FT_saveIn, the save is not a checkpoint for FT_saveDeltaIn.
+  File contents that oFTree shares with the snapshot must stay valid
+  until the save has finished (see FT_endSaveIn). One save of oFTree
+  runs at a time: if one is still under way, it is waited for first
+  and its status is lost. Returns SUCCESS once the save is under way,
+  or:
+  * READ_ONLY_TREE if oFTree was made by FT_newFromImage
+  * NOT_SUPPORTED if oFTree was made by FT_newArena
+  * CORRUPT_FILE if a directory loaded on demand could not be read
+  * MEMORY_ERROR if memory could not be allocated to complete request,
+                 or the thread could not be started
+*/
+int FT_beginSaveIn(FT_T oFTree, const char *pcFilename);
+
+/*
+  Waits for the save of oFTree that FT_beginSaveIn started to finish.
+  Returns SUCCESS if it succeeded or no save was under way, or:
+  * IO_ERROR if the file could not be opened, written, synced or
+             renamed, in which case pcFilename is unchanged
+  * MEMORY_ERROR if memory could not be allocated to complete request
+*/
+int FT_endSaveIn(FT_T oFTree);
+
+/*
+  Makes FT_rmDirIn, FT_rmFileIn and FT_free hand the subtrees they
+  remove from oFTree to oPool, as FT_setReclaimPool does for the
+  default File Tree. For a tree returned by FT_newConcurrent, a
+  subtree reaches oPool only once no lookup can still be inside it.
+*/
+int FT_setReclaimPoolIn(FT_T oFTree, ThreadPool_T oPool);
+
+/* The kinds of operation that FT_applyBatch carries out. */
+enum FT_OpKind { FT_OP_INSERT_DIR, FT_OP_INSERT_FILE,
+                 FT_OP_RM_DIR, FT_OP_RM_FILE,
+                 FT_OP_STAT, FT_OP_GET_CONTENTS };
+
+/*
+  One operation in a batch for FT_applyBatch. The client fills in the
+  first four fields, and FT_applyBatch the rest.
+*/
+struct FT_Op {
+   /* what to do, and to which absolute path */
+   enum FT_OpKind eKind;
+   const char *pcPath;
+   /* for FT_OP_INSERT_FILE, the new file's contents and their size in
+      bytes */
+   void *pvContents;
+   size_t ulLength;
+   /* the status that the matching FT_*In function would return; for
+      FT_OP_GET_CONTENTS, SUCCESS, or the status FT_statIn would
+      return, or NOT_A_FILE if pcPath is a directory */
+   int iStatus;
+   /* for FT_OP_STAT that succeeds, what FT_statIn stores */
+   boolean bIsFile;
+   size_t ulSize;
+   /* for FT_OP_GET_CONTENTS that succeeds, the file's contents */
+   void *pvResult;
+};
+
+/*
+  Carries out the ulNumOps operations in psOps on oFTree, in order,
+  storing each one's results in its struct FT_Op. Takes oFTree's lock,
+  if it has one, once for the whole batch rather than once per
+  operation, so other threads see the batch happen all at once.
+*/
+void FT_applyBatch(FT_T oFTree, struct FT_Op *psOps, size_t ulNumOps);
+
+/*
+  Looks up the paths of the ulNumOps operations in psOps, each of
+  which must be FT_OP_STAT or FT_OP_GET_CONTENTS, in oFTree, storing
+  each one's results as FT_applyBatch does. Several lookups are
+  under way at once: each one starts loading the next piece of the
+  tree that it needs into the cache and then lets the others take a
+  step while that arrives, which speeds up batches of lookups in
+  trees too large for the cache. Like the lookups of FT_statIn, these
+  take no lock in a tree returned by FT_newConcurrent. Returns
+  SUCCESS, or MEMORY_ERROR without looking anything up if the calling
+  thread's bookkeeping for such a tree could not be allocated.
+*/
+int FT_lookupMany(FT_T oFTree, struct FT_Op *psOps, size_t ulNumOps);
+
 #endif
@@ -0,0 +1,1131 @@
+/*--------------------------------------------------------------------*/
+/* ftarena.c                                                          */
+/* Author: Ishaan Javali & Jack Zhang                                 */
+/*--------------------------------------------------------------------*/
+
+/* for open, fstat, ftruncate, fsync, mmap, msync and munmap, which C90
+   mode does not expose by default */
+#define _POSIX_C_SOURCE 200112L
+
+#include <assert.h>
+#include <limits.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include "ftarena.h"
+
+/*
+  A block of size class c is FTARENA_MIN_BLOCK << c bytes long. A
+  directory's first children array has room for FTARENA_MIN_CHILDREN
+  children, and each one after it for twice as many as the last.
+*/
+enum { FTARENA_MIN_BLOCK = 16, FTARENA_CLASSES = 64,
+       FTARENA_MIN_CHILDREN = 4 };
+enum { FTARENA_FILE = 1, FTARENA_CONTENTS = 2 };
+static const size_t FTARENA_INITIAL_SIZE = 65536;
+static const char FTARENA_MAGIC[] = "FTARENA1";
+
+/* The header at the start of an arena. */
+struct FTArena_Header {
+   /* FTARENA_MAGIC, without its '\0' */
+   char acMagic[8];
+   /* the size of a word, and FTArena_check() as the machine that made
+      the arena computed it */
+   size_t ulWordSize;
+   size_t ulCheck;
+   /* the offset just past the last block carved from the file */
+   size_t ulUsed;
+   /* the offset of the root node, or 0 if the hierarchy is empty */
+   size_t ulRoot;
+   /* the offset of the contents that the last replacement displaced,
+      which the next change frees, or 0 */
+   size_t ulPending;
+   /* the offset of the first free block of each size class, or 0; a
+      free block's second word is the offset of the next one */
+   size_t aulFree[FTARENA_CLASSES];
+};
+
+/* A node, which is a block that the node's name follows, unended. */
+struct FTArena_Node {
+   /* the block's size class */
+   size_t ulClass;
+   /* FTARENA_FILE for a file, and FTARENA_CONTENTS for a file whose
+      contents are not NULL */
+   size_t ulFlags;
+   /* the length of the name */
+   size_t ulNameLength;
+   /* a file's contents block, or a directory's children array block,
+      or 0 if it has none */
+   size_t ulData;
+   /* the length of a file's contents, or the number of children that
+      a directory's children array has room for */
+   size_t ulLength;
+   /* the numbers of a directory's file and directory children */
+   size_t ulNumFiles;
+   size_t ulNumDirs;
+};
+
+/*
+  An arena is an ADT with 3 state variables:
+*/
+struct FTArena {
+   /* 1. the start of the mapping, which moves when the file grows */
+   unsigned char *pucMap;
+   /* 2. the size of the mapping, which is the size of the file */
+   size_t ulSize;
+   /* 3. the file, kept open to grow it */
+   int iFd;
+};
+
+/*
+  Returns a word whose bytes differ in every position, so that an
+  arena made with words of another size or order fails to match it.
+*/
+static size_t FTArena_check(void) {
+   /* two shifts, since one of 32 bits is undefined for 32-bit words */
+   return ((size_t) 0x01020304UL << 16 << 16) | (size_t) 0x05060708UL;
+}
+
+/* Returns the header of oArena. */
+static struct FTArena_Header *FTArena_header(FTArena_T oArena) {
+   assert(oArena != NULL);
+
+   return (struct FTArena_Header *) oArena->pucMap;
+}
+
+/* Returns the node at ulOffset in oArena. */
+static struct FTArena_Node *FTArena_node(FTArena_T oArena,
+                                         size_t ulOffset) {
+   assert(oArena != NULL);
+   assert(ulOffset != 0 && ulOffset < oArena->ulSize);
+
+   return (struct FTArena_Node *) &oArena->pucMap[ulOffset];
+}
+
+/* Returns the name of psNode, which is not terminated. */
+static const char *FTArena_name(const struct FTArena_Node *psNode) {
+   assert(psNode != NULL);
+
+   return (const char *) (psNode + 1);
+}
+
+/*
+  Returns the offsets of the children of the directory psNode in
+  oArena, files first, or NULL if it has no children array.
+*/
+static size_t *FTArena_children(FTArena_T oArena,
+                                struct FTArena_Node *psNode) {
+   assert(oArena != NULL);
+   assert(psNode != NULL);
+
+   if(psNode->ulData == 0)
+      return NULL;
+   return (size_t *) &oArena->pucMap[psNode->ulData] + 1;
+}
+
+/*
+  Returns the contents of the file psNode in oArena, or NULL if they
+  are NULL.
+*/
+static void *FTArena_contents(FTArena_T oArena,
+                              struct FTArena_Node *psNode) {
+   assert(oArena != NULL);
+   assert(psNode != NULL);
+
+   if(!(psNode->ulFlags & FTARENA_CONTENTS))
+      return NULL;
+   return &oArena->pucMap[psNode->ulData + sizeof(size_t)];
+}
+
+/*
+  Returns the size of the blocks that hold ulBytes bytes, or 0 if no
+  block can.
+*/
+static size_t FTArena_blockSize(size_t ulBytes) {
+   size_t ulSize = FTARENA_MIN_BLOCK;
+
+   if(ulBytes > (size_t) -1 / 2)
+      return 0;
+   while(ulSize < ulBytes)
+      ulSize *= 2;
+   return ulSize;
+}
+
+/*
+  Returns the size of the block that holds ulLength bytes of contents,
+  or 0 if no block can.
+*/
+static size_t FTArena_contentsBlock(size_t ulLength) {
+   if(ulLength > (size_t) -1 / 2)
+      return 0;
+   return FTArena_blockSize(sizeof(size_t) + ulLength);
+}
+
+/* Returns the size class of the blocks that hold ulBytes bytes. */
+static size_t FTArena_classOf(size_t ulBytes) {
+   size_t ulClass = 0;
+
+   while(((size_t) FTARENA_MIN_BLOCK << ulClass) < ulBytes)
+      ulClass++;
+   return ulClass;
+}
+
+/*
+  Returns the number of bytes in a children array block with room for
+  one more child than ulCapacity, the room of the array it replaces.
+*/
+static size_t FTArena_grownArray(size_t ulCapacity) {
+   if(ulCapacity == 0)
+      ulCapacity = FTARENA_MIN_CHILDREN;
+   else
+      ulCapacity *= 2;
+   return FTArena_blockSize((ulCapacity + 1) * sizeof(size_t));
+}
+
+/*
+  Grows the file and mapping of oArena, if need be, so that ulBytes
+  more bytes can be carved past its last block. The mapping may move,
+  so the caller must not hold pointers into it across this call.
+  Returns SUCCESS, or IO_ERROR if the file could not be grown or
+  mapped again, or MEMORY_ERROR if no file can be that large.
+*/
+static int FTArena_reserve(FTArena_T oArena, size_t ulBytes) {
+   size_t ulUsed;
+   size_t ulNewSize;
+   void *pvMap;
+
+   assert(oArena != NULL);
+
+   ulUsed = FTArena_header(oArena)->ulUsed;
+   if(ulBytes <= oArena->ulSize - ulUsed)
+      return SUCCESS;
+   if(ulBytes > (size_t) -1 / 2 - ulUsed)
+      return MEMORY_ERROR;
+   for(ulNewSize = oArena->ulSize; ulNewSize - ulUsed < ulBytes;
+       ulNewSize *= 2)
+      ;
+   if((off_t) ulNewSize < 0 || (size_t) (off_t) ulNewSize != ulNewSize)
+      return MEMORY_ERROR;
+
+   if(ftruncate(oArena->iFd, (off_t) ulNewSize) != 0)
+      return IO_ERROR;
+   /* the old mapping stays until the new one is in place, so a
+      failure leaves oArena as it was, over a larger file */
+   pvMap = mmap(NULL, ulNewSize, PROT_READ | PROT_WRITE, MAP_SHARED,
+                oArena->iFd, 0);
+   if(pvMap == MAP_FAILED)
+      return IO_ERROR;
+   (void) munmap(oArena->pucMap, oArena->ulSize);
+   oArena->pucMap = pvMap;
+   oArena->ulSize = ulNewSize;
+   return SUCCESS;
+}
+
+/*
+  Returns the offset of a new block of oArena that holds ulBytes
+  bytes, taken from the free list of its class if it has one and
+  carved past the last block otherwise, in which case FTArena_reserve
+  must have made room for it.
+*/
+static size_t FTArena_alloc(FTArena_T oArena, size_t ulBytes) {
+   struct FTArena_Header *psHeader;
+   size_t ulClass;
+   size_t ulOffset;
+   size_t *pulBlock;
+
+   assert(oArena != NULL);
+
+   psHeader = FTArena_header(oArena);
+   ulClass = FTArena_classOf(ulBytes);
+   ulOffset = psHeader->aulFree[ulClass];
+   if(ulOffset != 0) {
+      pulBlock = (size_t *) &oArena->pucMap[ulOffset];
+      psHeader->aulFree[ulClass] = pulBlock[1];
+   }
+   else {
+      ulOffset = psHeader->ulUsed;
+      assert(FTArena_blockSize(ulBytes) <= oArena->ulSize - ulOffset);
+      psHeader->ulUsed += FTArena_blockSize(ulBytes);
+      pulBlock = (size_t *) &oArena->pucMap[ulOffset];
+   }
+   pulBlock[0] = ulClass;
+   return ulOffset;
+}
+
+/* Puts the block at ulOffset in oArena, if not 0, on its free list. */
+static void FTArena_free(FTArena_T oArena, size_t ulOffset) {
+   struct FTArena_Header *psHeader;
+   size_t *pulBlock;
+
+   assert(oArena != NULL);
+
+   if(ulOffset == 0)
+      return;
+   psHeader = FTArena_header(oArena);
+   pulBlock = (size_t *) &oArena->pucMap[ulOffset];
+   assert(pulBlock[0] < FTARENA_CLASSES);
+   pulBlock[1] = psHeader->aulFree[pulBlock[0]];
+   psHeader->aulFree[pulBlock[0]] = ulOffset;
+}
+
+/* Frees the contents that the last replacement in oArena displaced. */
+static void FTArena_releasePending(FTArena_T oArena) {
+   struct FTArena_Header *psHeader;
+
+   assert(oArena != NULL);
+
+   psHeader = FTArena_header(oArena);
+   FTArena_free(oArena, psHeader->ulPending);
+   psHeader->ulPending = 0;
+}
+
+/*
+  Returns SUCCESS if pcPath is well-formed by the rules of Path_new,
+  or BAD_PATH otherwise.
+*/
+static int FTArena_checkPath(const char *pcPath) {
+   const char *pcEnd;
+
+   assert(pcPath != NULL);
+
+   if(*pcPath == '\0' || *pcPath == '/')
+      return BAD_PATH;
+   for(pcEnd = pcPath; *pcEnd != '\0'; pcEnd++)
+      if(*pcEnd == '/' && (pcEnd[1] == '/' || pcEnd[1] == '\0'))
+         return BAD_PATH;
+   return SUCCESS;
+}
+
+/* Returns the length of the path component that starts at pcPath. */
+static size_t FTArena_componentLength(const char *pcPath) {
+   const char *pcEnd;
+
+   assert(pcPath != NULL);
+
+   pcEnd = strchr(pcPath, '/');
+   return pcEnd == NULL ? strlen(pcPath) : (size_t) (pcEnd - pcPath);
+}
+
+/*
+  Compares the ulLength-byte name pcName with the name of the node at
+  ulOffset in oArena, as strcmp would compare them if each ended in
+  '\0'.
+*/
+static int FTArena_compareName(FTArena_T oArena, size_t ulOffset,
+                               const char *pcName, size_t ulLength) {
+   struct FTArena_Node *psNode;
+   int iCompare;
+
+   assert(oArena != NULL);
+   assert(pcName != NULL);
+
+   psNode = FTArena_node(oArena, ulOffset);
+   iCompare = memcmp(pcName, FTArena_name(psNode),
+                     ulLength < psNode->ulNameLength ?
+                     ulLength : psNode->ulNameLength);
+   if(iCompare != 0)
+      return iCompare;
+   if(ulLength < psNode->ulNameLength)
+      return -1;
+   return ulLength > psNode->ulNameLength;
+}
+
+/*
+  Binary searches the ulCount node offsets at pulNodes, whose nodes
+  are sorted by name, for the ulLength-byte name pcName. Returns TRUE
+  and sets *pulIndex to the index of its offset if it is found, or
+  returns FALSE and sets *pulIndex to the index at which it belongs.
+*/
+static boolean FTArena_search(FTArena_T oArena, const size_t *pulNodes,
+                              size_t ulCount, const char *pcName,
+                              size_t ulLength, size_t *pulIndex) {
+   size_t ulLo = 0;
+   size_t ulHi = ulCount;
+   size_t ulMid;
+   int iCompare;
+
+   assert(oArena != NULL);
+   assert(pulNodes != NULL || ulCount == 0);
+   assert(pcName != NULL);
+   assert(pulIndex != NULL);
+
+   while(ulLo < ulHi) {
+      ulMid = ulLo + (ulHi - ulLo) / 2;
+      iCompare = FTArena_compareName(oArena, pulNodes[ulMid], pcName,
+                                     ulLength);
+      if(iCompare == 0) {
+         *pulIndex = ulMid;
+         return TRUE;
+      }
+      if(iCompare < 0)
+         ulHi = ulMid;
+      else
+         ulLo = ulMid + 1;
+   }
+   *pulIndex = ulLo;
+   return FALSE;
+}
+
+/*
+  Walks oArena along the well-formed path pcPath as far as it exists.
+  Sets *pulNode to the offset of the deepest node reached, or 0 if
+  none, *pulParent to that of its parent, or 0 if none, and *ppcRest
+  to the first component of pcPath below that node. Returns:
+  * SUCCESS if that node is pcPath itself
+  * NO_SUCH_PATH if it is a directory without the next component of
+                 pcPath, or the hierarchy is empty
+  * NOT_A_DIRECTORY if it is a file that is a proper prefix of pcPath
+  * CONFLICTING_PATH if the root is not a prefix of pcPath
+*/
+static int FTArena_walk(FTArena_T oArena, const char *pcPath,
+                        size_t *pulNode, size_t *pulParent,
+                        const char **ppcRest) {
+   struct FTArena_Node *psNode;
+   size_t *pulChildren;
+   const char *pcComponent = pcPath;
+   size_t ulLength;
+   size_t ulIndex;
+   size_t ulChild;
+
+   assert(oArena != NULL);
+   assert(pcPath != NULL);
+   assert(pulNode != NULL);
+   assert(pulParent != NULL);
+   assert(ppcRest != NULL);
+
+   *pulNode = FTArena_header(oArena)->ulRoot;
+   *pulParent = 0;
+   *ppcRest = pcPath;
+   if(*pulNode == 0)
+      return NO_SUCH_PATH;
+   ulLength = FTArena_componentLength(pcComponent);
+   if(FTArena_compareName(oArena, *pulNode, pcComponent, ulLength) != 0) {
+      *pulNode = 0;
+      return CONFLICTING_PATH;
+   }
+
+   while(pcComponent[ulLength] == '/') {
+      pcComponent += ulLength + 1;
+      *ppcRest = pcComponent;
+      psNode = FTArena_node(oArena, *pulNode);
+      if(psNode->ulFlags & FTARENA_FILE)
+         return NOT_A_DIRECTORY;
+      ulLength = FTArena_componentLength(pcComponent);
+      pulChildren = FTArena_children(oArena, psNode);
+      if(FTArena_search(oArena, pulChildren, psNode->ulNumFiles,
+                        pcComponent, ulLength, &ulIndex))
+         ulChild = pulChildren[ulIndex];
+      else if(FTArena_search(oArena, pulChildren + psNode->ulNumFiles,
+                             psNode->ulNumDirs, pcComponent, ulLength,
+                             &ulIndex))
+         ulChild = pulChildren[psNode->ulNumFiles + ulIndex];
+      else
+         return NO_SUCH_PATH;
+      *pulParent = *pulNode;
+      *pulNode = ulChild;
+   }
+   return SUCCESS;
+}
+
+/*
+  Looks up pcPath in oArena, setting *pulNode and *pulParent to the
+  offsets of its node and of the node's parent, or 0 if it is the
+  root. Returns SUCCESS, or BAD_PATH, NO_SUCH_PATH or CONFLICTING_PATH
+  as FT_statIn does.
+*/
+static int FTArena_find(FTArena_T oArena, const char *pcPath,
+                        size_t *pulNode, size_t *pulParent) {
+   const char *pcRest;
+   int iStatus;
+
+   assert(oArena != NULL);
+   assert(pcPath != NULL);
+   assert(pulNode != NULL);
+   assert(pulParent != NULL);
+
+   iStatus = FTArena_checkPath(pcPath);
+   if(iStatus != SUCCESS)
+      return iStatus;
+   iStatus = FTArena_walk(oArena, pcPath, pulNode, pulParent, &pcRest);
+   /* a path through a file does not exist */
+   if(iStatus == NOT_A_DIRECTORY)
+      return NO_SUCH_PATH;
+   return iStatus;
+}
+
+/*
+  Returns the offset of a new node of oArena named with the ulLength
+  bytes at pcName, a file with a copy of the ulContentsLength bytes
+  at pvContents if bIsFile, or a directory without children
+  otherwise. FTArena_reserve must have made room for it.
+*/
+static size_t FTArena_newNode(FTArena_T oArena, const char *pcName,
+                              size_t ulLength, boolean bIsFile,
+                              const void *pvContents,
+                              size_t ulContentsLength) {
+   struct FTArena_Node *psNode;
+   size_t ulOffset;
+   size_t ulData = 0;
+
+   assert(oArena != NULL);
+   assert(pcName != NULL);
+
+   if(bIsFile && pvContents != NULL) {
+      ulData = FTArena_alloc(oArena, sizeof(size_t) + ulContentsLength);
+      memcpy(&oArena->pucMap[ulData + sizeof(size_t)], pvContents,
+             ulContentsLength);
+   }
+   ulOffset = FTArena_alloc(oArena,
+                            sizeof(struct FTArena_Node) + ulLength);
+   psNode = FTArena_node(oArena, ulOffset);
+   psNode->ulFlags = 0;
+   psNode->ulData = ulData;
+   psNode->ulLength = 0;
+   if(bIsFile) {
+      psNode->ulFlags = FTARENA_FILE;
+      psNode->ulLength = ulContentsLength;
+      if(pvContents != NULL)
+         psNode->ulFlags |= FTARENA_CONTENTS;
+   }
+   psNode->ulNameLength = ulLength;
+   psNode->ulNumFiles = 0;
+   psNode->ulNumDirs = 0;
+   memcpy(psNode + 1, pcName, ulLength);
+   return ulOffset;
+}
+
+/*
+  Links the node at ulChild into the children of the directory at
+  ulParent in oArena, in order, replacing the parent's children array
+  with a larger one if it is full. FTArena_reserve must have made
+  room for the larger one.
+*/
+static void FTArena_addChild(FTArena_T oArena, size_t ulParent,
+                             size_t ulChild) {
+   struct FTArena_Node *psParent;
+   struct FTArena_Node *psChild;
+   size_t *pulChildren;
+   size_t *pulOld;
+   size_t ulNumChildren;
+   size_t ulData;
+   size_t ulIndex;
+   boolean bIsFile;
+
+   assert(oArena != NULL);
+
+   psParent = FTArena_node(oArena, ulParent);
+   ulNumChildren = psParent->ulNumFiles + psParent->ulNumDirs;
+   if(ulNumChildren == psParent->ulLength) {
+      ulData = FTArena_alloc(oArena,
+                             FTArena_grownArray(psParent->ulLength));
+      pulChildren = (size_t *) &oArena->pucMap[ulData] + 1;
+      pulOld = FTArena_children(oArena, psParent);
+      if(pulOld != NULL)
+         memcpy(pulChildren, pulOld, ulNumChildren * sizeof(size_t));
+      FTArena_free(oArena, psParent->ulData);
+      psParent->ulData = ulData;
+      /* the block may have room for more than was asked */
+      psParent->ulLength =
+         ((size_t) FTARENA_MIN_BLOCK << pulChildren[-1]) /
+         sizeof(size_t) - 1;
+   }
+   pulChildren = FTArena_children(oArena, psParent);
+
+   psChild = FTArena_node(oArena, ulChild);
+   bIsFile = (boolean) ((psChild->ulFlags & FTARENA_FILE) != 0);
+   if(bIsFile)
+      (void) FTArena_search(oArena, pulChildren, psParent->ulNumFiles,
+                            FTArena_name(psChild),
+                            psChild->ulNameLength, &ulIndex);
+   else {
+      (void) FTArena_search(oArena, pulChildren + psParent->ulNumFiles,
+                            psParent->ulNumDirs, FTArena_name(psChild),
+                            psChild->ulNameLength, &ulIndex);
+      ulIndex += psParent->ulNumFiles;
+   }
+   memmove(&pulChildren[ulIndex + 1], &pulChildren[ulIndex],
+           (ulNumChildren - ulIndex) * sizeof(size_t));
+   pulChildren[ulIndex] = ulChild;
+   if(bIsFile)
+      psParent->ulNumFiles++;
+   else
+      psParent->ulNumDirs++;
+}
+
+/*
+  Unlinks the node at ulChild from the children of the directory at
+  ulParent in oArena. The children array keeps its room.
+*/
+static void FTArena_removeChild(FTArena_T oArena, size_t ulParent,
+                                size_t ulChild) {
+   struct FTArena_Node *psParent;
+   size_t *pulChildren;
+   size_t ulNumChildren;
+   size_t ulIndex;
+
+   assert(oArena != NULL);
+
+   psParent = FTArena_node(oArena, ulParent);
+   pulChildren = FTArena_children(oArena, psParent);
+   ulNumChildren = psParent->ulNumFiles + psParent->ulNumDirs;
+   for(ulIndex = 0; pulChildren[ulIndex] != ulChild; ulIndex++)
+      assert(ulIndex + 1 < ulNumChildren);
+   memmove(&pulChildren[ulIndex], &pulChildren[ulIndex + 1],
+           (ulNumChildren - ulIndex - 1) * sizeof(size_t));
+   if(ulIndex < psParent->ulNumFiles)
+      psParent->ulNumFiles--;
+   else
+      psParent->ulNumDirs--;
+}
+
+/*
+  Frees the node at ulOffset in oArena, its contents or children
+  array, and the subtrees of its children.
+*/
+static void FTArena_freeSubtree(FTArena_T oArena, size_t ulOffset) {
+   struct FTArena_Node *psNode;
+   size_t *pulChildren;
+   size_t i;
+
+   assert(oArena != NULL);
+
+   psNode = FTArena_node(oArena, ulOffset);
+   if(!(psNode->ulFlags & FTARENA_FILE)) {
+      pulChildren = FTArena_children(oArena, psNode);
+      for(i = 0; i < psNode->ulNumFiles + psNode->ulNumDirs; i++)
+         FTArena_freeSubtree(oArena, pulChildren[i]);
+   }
+   FTArena_free(oArena, psNode->ulData);
+   FTArena_free(oArena, ulOffset);
+}
+
+/*
+  Claims the block at ulOffset in oArena for FTArena_checkAll, which
+  marks in pucMarks each word of the arena that a checked block
+  covers. Sets *pulBlockSize to the block's size and returns TRUE, or
+  returns FALSE if ulOffset is not the aligned start of a block of a
+  valid class that lies within the carved part of the file, or if the
+  block overlaps one already claimed.
+*/
+static boolean FTArena_claim(FTArena_T oArena, unsigned char *pucMarks,
+                             size_t ulOffset, size_t *pulBlockSize) {
+   size_t ulUsed;
+   size_t ulClass;
+   size_t ulWord;
+
+   assert(oArena != NULL);
+   assert(pucMarks != NULL);
+   assert(pulBlockSize != NULL);
+
+   ulUsed = FTArena_header(oArena)->ulUsed;
+   if(ulOffset % sizeof(size_t) != 0 ||
+      ulOffset < sizeof(struct FTArena_Header) ||
+      ulOffset >= ulUsed || ulUsed - ulOffset < FTARENA_MIN_BLOCK)
+      return FALSE;
+   ulClass = *(size_t *) &oArena->pucMap[ulOffset];
+   if(ulClass >= FTARENA_CLASSES ||
+      ulClass >= CHAR_BIT * sizeof(size_t) ||
+      ((ulUsed - ulOffset) / FTARENA_MIN_BLOCK >> ulClass) == 0)
+      return FALSE;
+   *pulBlockSize = (size_t) FTARENA_MIN_BLOCK << ulClass;
+
+   for(ulWord = ulOffset / sizeof(size_t);
+       ulWord < (ulOffset + *pulBlockSize) / sizeof(size_t); ulWord++) {
+      if(pucMarks[ulWord / CHAR_BIT] & (1 << (ulWord % CHAR_BIT)))
+         return FALSE;
+      pucMarks[ulWord / CHAR_BIT] |=
+         (unsigned char) (1 << (ulWord % CHAR_BIT));
+   }
+   return TRUE;
+}
+
+/*
+  Checks the node at ulOffset in oArena, which must be a file if
+  bIsFile and a directory otherwise, and the subtrees of its children,
+  claiming their blocks as FTArena_claim does. Returns TRUE if every
+  offset, size class, name, contents and children array lies within
+  the carved part of the file, no two blocks overlap, and the children
+  are files and then directories, each sorted by name, or FALSE
+  otherwise.
+*/
+static boolean FTArena_checkNode(FTArena_T oArena,
+                                 unsigned char *pucMarks,
+                                 size_t ulOffset, boolean bIsFile) {
+   struct FTArena_Node *psNode;
+   struct FTArena_Node *psChild;
+   size_t *pulChildren;
+   size_t ulBlockSize;
+   size_t ulDataSize;
+   size_t i;
+
+   assert(oArena != NULL);
+   assert(pucMarks != NULL);
+
+   if(!FTArena_claim(oArena, pucMarks, ulOffset, &ulBlockSize) ||
+      ulBlockSize < sizeof(struct FTArena_Node))
+      return FALSE;
+   psNode = FTArena_node(oArena, ulOffset);
+   if(psNode->ulNameLength == 0 ||
+      psNode->ulNameLength > ulBlockSize - sizeof(struct FTArena_Node) ||
+      memchr(FTArena_name(psNode), '/', psNode->ulNameLength) != NULL)
+      return FALSE;
+
+   if(bIsFile) {
+      if(psNode->ulNumFiles != 0 || psNode->ulNumDirs != 0)
+         return FALSE;
+      if(psNode->ulFlags == FTARENA_FILE)
+         return psNode->ulData == 0;
+      return psNode->ulFlags == (FTARENA_FILE | FTARENA_CONTENTS) &&
+             FTArena_claim(oArena, pucMarks, psNode->ulData,
+                           &ulDataSize) &&
+             psNode->ulLength <= ulDataSize - sizeof(size_t);
+   }
+
+   if(psNode->ulFlags != 0)
+      return FALSE;
+   if(psNode->ulData == 0)
+      return psNode->ulLength == 0 && psNode->ulNumFiles == 0 &&
+             psNode->ulNumDirs == 0;
+   if(!FTArena_claim(oArena, pucMarks, psNode->ulData, &ulDataSize) ||
+      psNode->ulLength != ulDataSize / sizeof(size_t) - 1 ||
+      psNode->ulNumFiles > psNode->ulLength ||
+      psNode->ulNumDirs > psNode->ulLength - psNode->ulNumFiles)
+      return FALSE;
+   pulChildren = FTArena_children(oArena, psNode);
+   for(i = 0; i < psNode->ulNumFiles + psNode->ulNumDirs; i++) {
+      if(!FTArena_checkNode(oArena, pucMarks, pulChildren[i],
+                            (boolean) (i < psNode->ulNumFiles)))
+         return FALSE;
+      psChild = FTArena_node(oArena, pulChildren[i]);
+      if(i != 0 && i != psNode->ulNumFiles &&
+         FTArena_compareName(oArena, pulChildren[i - 1],
+                             FTArena_name(psChild),
+                             psChild->ulNameLength) <= 0)
+         return FALSE;
+   }
+   return TRUE;
+}
+
+/*
+  Checks the whole of oArena, whose header has been checked: the
+  hierarchy as FTArena_checkNode checks it, the block of displaced
+  contents, and the free lists, whose blocks must be of their list's
+  class, and which must not overlap any other block or loop. Returns
+  SUCCESS, or CORRUPT_FILE, or MEMORY_ERROR.
+*/
+static int FTArena_checkAll(FTArena_T oArena) {
+   struct FTArena_Header *psHeader;
+   unsigned char *pucMarks;
+   size_t ulBlockSize;
+   size_t ulOffset;
+   size_t ulClass;
+   boolean bValid;
+
+   assert(oArena != NULL);
+
+   psHeader = FTArena_header(oArena);
+   pucMarks = calloc(psHeader->ulUsed / sizeof(size_t) / CHAR_BIT + 1,
+                     1);
+   if(pucMarks == NULL)
+      return MEMORY_ERROR;
+
+   bValid = (boolean) (psHeader->ulUsed % sizeof(size_t) == 0);
+   if(bValid && psHeader->ulRoot != 0)
+      bValid = FTArena_checkNode(oArena, pucMarks, psHeader->ulRoot,
+                                 FALSE);
+   if(bValid && psHeader->ulPending != 0)
+      bValid = FTArena_claim(oArena, pucMarks, psHeader->ulPending,
+                             &ulBlockSize);
+   for(ulClass = 0; bValid && ulClass < FTARENA_CLASSES; ulClass++) {
+      ulOffset = psHeader->aulFree[ulClass];
+      while(bValid && ulOffset != 0) {
+         bValid = (boolean) (FTArena_claim(oArena, pucMarks, ulOffset,
+                                           &ulBlockSize) &&
+                             *(size_t *) &oArena->pucMap[ulOffset] ==
+                             ulClass);
+         if(bValid)
+            ulOffset = ((size_t *) &oArena->pucMap[ulOffset])[1];
+      }
+   }
+
+   free(pucMarks);
+   return bValid ? SUCCESS : CORRUPT_FILE;
+}
+
+int FTArena_open(const char *pcFilename, FTArena_T *poAResult) {
+   FTArena_T oArena;
+   struct FTArena_Header *psHeader;
+   struct stat sStat;
+   size_t ulSize;
+   void *pvMap;
+   boolean bIsNew;
+   int iStatus;
+   int iFd;
+
+   assert(pcFilename != NULL);
+   assert(poAResult != NULL);
+
+   *poAResult = NULL;
+
+   iFd = open(pcFilename, O_RDWR | O_CREAT, 0666);
+   if(iFd < 0)
+      return IO_ERROR;
+   if(fstat(iFd, &sStat) != 0 || sStat.st_size < 0 ||
+      (unsigned long) sStat.st_size > (size_t) -1) {
+      (void) close(iFd);
+      return IO_ERROR;
+   }
+   ulSize = (size_t) sStat.st_size;
+   bIsNew = (boolean) (ulSize == 0);
+   if(bIsNew) {
+      ulSize = FTARENA_INITIAL_SIZE;
+      if(ftruncate(iFd, (off_t) ulSize) != 0) {
+         (void) close(iFd);
+         return IO_ERROR;
+      }
+   }
+   else if(ulSize < sizeof(struct FTArena_Header)) {
+      (void) close(iFd);
+      return CORRUPT_FILE;
+   }
+   pvMap = mmap(NULL, ulSize, PROT_READ | PROT_WRITE, MAP_SHARED, iFd,
+                0);
+   if(pvMap == MAP_FAILED) {
+      (void) close(iFd);
+      return IO_ERROR;
+   }
+
+   oArena = malloc(sizeof(struct FTArena));
+   if(oArena == NULL) {
+      (void) munmap(pvMap, ulSize);
+      (void) close(iFd);
+      return MEMORY_ERROR;
+   }
+   oArena->pucMap = pvMap;
+   oArena->ulSize = ulSize;
+   oArena->iFd = iFd;
+
+   psHeader = FTArena_header(oArena);
+   iStatus = SUCCESS;
+   if(bIsNew) {
+      memset(psHeader, 0, sizeof(struct FTArena_Header));
+      memcpy(psHeader->acMagic, FTARENA_MAGIC, sizeof(psHeader->acMagic));
+      psHeader->ulWordSize = sizeof(size_t);
+      psHeader->ulCheck = FTArena_check();
+      psHeader->ulUsed = sizeof(struct FTArena_Header);
+   }
+   else if(memcmp(psHeader->acMagic, FTARENA_MAGIC,
+                  sizeof(psHeader->acMagic)) != 0 ||
+           psHeader->ulWordSize != sizeof(size_t) ||
+           psHeader->ulCheck != FTArena_check() ||
+           psHeader->ulUsed < sizeof(struct FTArena_Header) ||
+           psHeader->ulUsed > ulSize ||
+           psHeader->ulRoot >= psHeader->ulUsed ||
+           psHeader->ulPending >= psHeader->ulUsed)
+      iStatus = CORRUPT_FILE;
+   else
+      iStatus = FTArena_checkAll(oArena);
+   if(iStatus != SUCCESS) {
+      FTArena_close(oArena);
+      return iStatus;
+   }
+
+   /* nothing can still be using the contents displaced last time */
+   FTArena_releasePending(oArena);
+   *poAResult = oArena;
+   return SUCCESS;
+}
+
+int FTArena_sync(FTArena_T oArena) {
+   assert(oArena != NULL);
+
+   if(msync(oArena->pucMap, oArena->ulSize, MS_SYNC) != 0 ||
+      fsync(oArena->iFd) != 0)
+      return IO_ERROR;
+   return SUCCESS;
+}
+
+void FTArena_close(FTArena_T oArena) {
+   if(oArena == NULL)
+      return;
+   (void) munmap(oArena->pucMap, oArena->ulSize);
+   (void) close(oArena->iFd);
+   free(oArena);
+}
+
+int FTArena_insert(FTArena_T oArena, const char *pcPath,
+                   boolean bIsFile, const void *pvContents,
+                   size_t ulLength) {
+   struct FTArena_Node *psParent;
+   const char *pcRest;
+   const char *pcComponent;
+   size_t ulNode;
+   size_t ulParent;
+   size_t ulNeeded = 0;
+   size_t ulBlock;
+   size_t ulNameLength;
+   boolean bIsLast;
+   int iStatus;
+
+   assert(oArena != NULL);
+   assert(pcPath != NULL);
+
+   iStatus = FTArena_checkPath(pcPath);
+   if(iStatus != SUCCESS)
+      return iStatus;
+   FTArena_releasePending(oArena);
+
+   iStatus = FTArena_walk(oArena, pcPath, &ulNode, &ulParent, &pcRest);
+   if(iStatus == SUCCESS)
+      return ALREADY_IN_TREE;
+   if(iStatus != NO_SUCH_PATH)
+      return iStatus;
+   /* a file cannot be the root */
+   if(ulNode == 0 && bIsFile && strchr(pcRest, '/') == NULL)
+      return CONFLICTING_PATH;
+
+   /* make room for every block at once, so that nothing is linked in
+      unless everything is */
+   for(pcComponent = pcRest; pcComponent != NULL; ) {
+      ulNameLength = FTArena_componentLength(pcComponent);
+      bIsLast = (boolean) (pcComponent[ulNameLength] == '\0');
+      ulBlock = FTArena_blockSize(sizeof(struct FTArena_Node) +
+                                  ulNameLength);
+      if(!bIsLast && ulBlock != 0)
+         ulBlock += FTArena_grownArray(0);
+      if(bIsLast && bIsFile && pvContents != NULL && ulBlock != 0)
+         ulBlock = FTArena_contentsBlock(ulLength) == 0 ? 0 :
+                   ulBlock + FTArena_contentsBlock(ulLength);
+      if(ulBlock == 0 || ulBlock > (size_t) -1 / 2 - ulNeeded)
+         return MEMORY_ERROR;
+      ulNeeded += ulBlock;
+      pcComponent = bIsLast ? NULL : pcComponent + ulNameLength + 1;
+   }
+   if(ulNode != 0) {
+      psParent = FTArena_node(oArena, ulNode);
+      if(psParent->ulNumFiles + psParent->ulNumDirs == psParent->ulLength)
+         ulNeeded += FTArena_grownArray(psParent->ulLength);
+   }
+   iStatus = FTArena_reserve(oArena, ulNeeded);
+   if(iStatus != SUCCESS)
+      return iStatus;
+
+   for(pcComponent = pcRest; pcComponent != NULL; ) {
+      ulNameLength = FTArena_componentLength(pcComponent);
+      bIsLast = (boolean) (pcComponent[ulNameLength] == '\0');
+      ulParent = ulNode;
+      ulNode = FTArena_newNode(oArena, pcComponent, ulNameLength,
+                               (boolean) (bIsLast && bIsFile),
+                               pvContents, ulLength);
+      if(ulParent == 0)
+         FTArena_header(oArena)->ulRoot = ulNode;
+      else
+         FTArena_addChild(oArena, ulParent, ulNode);
+      pcComponent = bIsLast ? NULL : pcComponent + ulNameLength + 1;
+   }
+   return SUCCESS;
+}
+
+int FTArena_remove(FTArena_T oArena, const char *pcPath,
+                   boolean bIsFile) {
+   struct FTArena_Node *psNode;
+   const char *pcRest;
+   size_t ulNode;
+   size_t ulParent;
+   int iStatus;
+
+   assert(oArena != NULL);
+   assert(pcPath != NULL);
+
+   iStatus = FTArena_checkPath(pcPath);
+   if(iStatus != SUCCESS)
+      return iStatus;
+   FTArena_releasePending(oArena);
+
+   /* as in a File Tree, a path through a file is NOT_A_DIRECTORY
+      when removing a file, and does not exist otherwise */
+   iStatus = FTArena_walk(oArena, pcPath, &ulNode, &ulParent, &pcRest);
+   if(iStatus == NOT_A_DIRECTORY && !bIsFile)
+      return NO_SUCH_PATH;
+   if(iStatus != SUCCESS)
+      return iStatus;
+   psNode = FTArena_node(oArena, ulNode);
+   if(bIsFile && !(psNode->ulFlags & FTARENA_FILE))
+      return NOT_A_FILE;
+   if(!bIsFile && (psNode->ulFlags & FTARENA_FILE))
+      return NOT_A_DIRECTORY;
+
+   if(ulParent == 0)
+      FTArena_header(oArena)->ulRoot = 0;
+   else
+      FTArena_removeChild(oArena, ulParent, ulNode);
+   FTArena_freeSubtree(oArena, ulNode);
+   return SUCCESS;
+}
+
+int FTArena_stat(FTArena_T oArena, const char *pcPath,
+                 boolean *pbIsFile, size_t *pulSize,
+                 void **ppvContents) {
+   struct FTArena_Node *psNode;
+   size_t ulNode;
+   size_t ulParent;
+   int iStatus;
+
+   assert(oArena != NULL);
+   assert(pcPath != NULL);
+   assert(pbIsFile != NULL);
+   assert(pulSize != NULL);
+
+   iStatus = FTArena_find(oArena, pcPath, &ulNode, &ulParent);
+   if(iStatus != SUCCESS)
+      return iStatus;
+
+   psNode = FTArena_node(oArena, ulNode);
+   *pbIsFile = (boolean) ((psNode->ulFlags & FTARENA_FILE) != 0);
+   if(!*pbIsFile)
+      return SUCCESS;
+   *pulSize = psNode->ulLength;
+   if(ppvContents != NULL)
+      *ppvContents = FTArena_contents(oArena, psNode);
+   return SUCCESS;
+}
+
+int FTArena_replace(FTArena_T oArena, const char *pcPath,
+                    const void *pvContents, size_t ulLength,
+                    void **ppvOld) {
+   struct FTArena_Node *psNode;
+   size_t ulNode;
+   size_t ulParent;
+   size_t ulBlock;
+   size_t ulData = 0;
+   int iStatus;
+
+   assert(oArena != NULL);
+   assert(pcPath != NULL);
+   assert(ppvOld != NULL);
+
+   *ppvOld = NULL;
+   FTArena_releasePending(oArena);
+   iStatus = FTArena_find(oArena, pcPath, &ulNode, &ulParent);
+   if(iStatus != SUCCESS)
+      return iStatus;
+   if(!(FTArena_node(oArena, ulNode)->ulFlags & FTARENA_FILE))
+      return NOT_A_FILE;
+
+   if(pvContents != NULL) {
+      ulBlock = FTArena_contentsBlock(ulLength);
+      if(ulBlock == 0)
+         return MEMORY_ERROR;
+      iStatus = FTArena_reserve(oArena, ulBlock);
+      if(iStatus != SUCCESS)
+         return iStatus;
+      ulData = FTArena_alloc(oArena, sizeof(size_t) + ulLength);
+      memcpy(&oArena->pucMap[ulData + sizeof(size_t)], pvContents,
+             ulLength);
+   }
+
+   /* the mapping may have moved, but not the node's offset; the old
+      contents stay until the next change, for the caller */
+   psNode = FTArena_node(oArena, ulNode);
+   *ppvOld = FTArena_contents(oArena, psNode);
+   if(psNode->ulFlags & FTARENA_CONTENTS)
+      FTArena_header(oArena)->ulPending = psNode->ulData;
+   psNode->ulData = ulData;
+   psNode->ulLength = ulLength;
+   psNode->ulFlags = FTARENA_FILE;
+   if(pvContents != NULL)
+      psNode->ulFlags |= FTARENA_CONTENTS;
+   return SUCCESS;
+}
+
+/*
+  Returns the total length of the lines that FTArena_toString writes
+  for the subtree rooted at the node at ulOffset in oArena, whose
+  parent's path is ulParentLength characters long, or 0 for no
+  parent.
+*/
+static size_t FTArena_measure(FTArena_T oArena, size_t ulOffset,
+                              size_t ulParentLength) {
+   struct FTArena_Node *psNode;
+   size_t *pulChildren;
+   size_t ulLength;
+   size_t ulTotal;
+   size_t i;
+
+   assert(oArena != NULL);
+
+   psNode = FTArena_node(oArena, ulOffset);
+   ulLength = psNode->ulNameLength;
+   if(ulParentLength != 0)
+      ulLength += ulParentLength + 1;
+   ulTotal = ulLength + 1;
+   if(psNode->ulFlags & FTARENA_FILE)
+      return ulTotal;
+   pulChildren = FTArena_children(oArena, psNode);
+   for(i = 0; i < psNode->ulNumFiles + psNode->ulNumDirs; i++)
+      ulTotal += FTArena_measure(oArena, pulChildren[i], ulLength);
+   return ulTotal;
+}
+
+/*
+  Writes the lines of the subtree rooted at the node at ulOffset in
+  oArena at *ppcEnd, advancing *ppcEnd past them, as FTArena_measure
+  measures them. The parent's line begins at pcParent and is
+  ulParentLength characters long, not counting its newline.
+*/
+static void FTArena_writeLines(FTArena_T oArena, size_t ulOffset,
+                               const char *pcParent,
+                               size_t ulParentLength, char **ppcEnd) {
+   struct FTArena_Node *psNode;
+   size_t *pulChildren;
+   char *pcLine;
+   size_t ulLength;
+   size_t i;
+
+   assert(oArena != NULL);
+   assert(ppcEnd != NULL);
+
+   psNode = FTArena_node(oArena, ulOffset);
+   pcLine = *ppcEnd;
+   if(ulParentLength != 0) {
+      memcpy(*ppcEnd, pcParent, ulParentLength);
+      *ppcEnd += ulParentLength;
+      *(*ppcEnd)++ = '/';
+   }
+   memcpy(*ppcEnd, FTArena_name(psNode), psNode->ulNameLength);
+   *ppcEnd += psNode->ulNameLength;
+   *(*ppcEnd)++ = '\n';
+   ulLength = (size_t) (*ppcEnd - pcLine) - 1;
+
+   if(psNode->ulFlags & FTARENA_FILE)
+      return;
+   pulChildren = FTArena_children(oArena, psNode);
+   for(i = 0; i < psNode->ulNumFiles + psNode->ulNumDirs; i++)
+      FTArena_writeLines(oArena, pulChildren[i], pcLine, ulLength,
+                         ppcEnd);
+}
+
+char *FTArena_toString(FTArena_T oArena) {
+   char *pcResult;
+   char *pcEnd;
+   size_t ulRoot;
+   size_t ulTotal = 1;
+
+   assert(oArena != NULL);
+
+   ulRoot = FTArena_header(oArena)->ulRoot;
+   if(ulRoot != 0)
+      ulTotal += FTArena_measure(oArena, ulRoot, 0);
+   pcResult = malloc(ulTotal);
+   if(pcResult == NULL)
+      return NULL;
+   pcEnd = pcResult;
+   if(ulRoot != 0)
+      FTArena_writeLines(oArena, ulRoot, NULL, 0, &pcEnd);
+   *pcEnd = '\0';
+   return pcResult;
+}
@@ -0,0 +1,118 @@
+/*--------------------------------------------------------------------*/
+/* ftarena.h                                                          */
+/* Author: Ishaan Javali & Jack Zhang                                 */
+/*--------------------------------------------------------------------*/
+
+#ifndef FTARENA_INCLUDED
+#define FTARENA_INCLUDED
+
+#include <stddef.h>
+#include "a4def.h"
+
+/*
+  An FTArena_T is a File Tree hierarchy kept in a persistent arena: a
+  file, mapped shared and read-write, that holds every node, name,
+  children array and file contents of the hierarchy and nothing else.
+  Nothing in the arena is a pointer: each block refers to another by
+  its offset from the start of the file, so the arena means the same
+  wherever it is mapped. The hierarchy is thus changed in place, made
+  durable by flushing the mapping, and reopened by mapping the file
+  again and checking its blocks, without rebuilding anything.
+
+  The arena is a header, then blocks carved from the file in order.
+  Every block is a power of two bytes long, 16 or more, and starts
+  with a word giving its size class; a freed block goes on the free
+  list of its class, from which the next block of that class is
+  taken, and the file doubles when a block fits nowhere. A node's
+  children array holds the offsets of its files and then of its
+  directories, each sorted by name, so a lookup binary searches one
+  range of offsets per level. Words are size_t, in the byte order of
+  the machine that made the arena; an arena is not meant to move
+  between machines, and opening one made with other words fails.
+*/
+typedef struct FTArena *FTArena_T;
+
+/*
+  Maps the arena in the file pcFilename, first creating the file with
+  an empty hierarchy in it if it does not exist. Returns an int
+  SUCCESS status and sets *poAResult to be the new FTArena_T if
+  successful. Otherwise, sets *poAResult to NULL and returns status:
+  * IO_ERROR if the file could not be created, opened or mapped
+  * CORRUPT_FILE if the file's header does not describe an arena of
+                 the file's size made with this machine's words, or
+                 if any block that the hierarchy or a free list
+                 reaches lies outside the carved part of the file,
+                 has no valid size class, overlaps another block, or
+                 holds a name, contents or children array that does
+                 not fit it, or if a directory's children are not
+                 files and then directories, each sorted by name
+  * MEMORY_ERROR if memory could not be allocated to complete request
+  Every block is checked once, in time linear in the size of the
+  hierarchy, so that a file damaged or torn by a crash is rejected
+  here rather than trusted by later calls.
+*/
+int FTArena_open(const char *pcFilename, FTArena_T *poAResult);
+
+/*
+  Flushes every change to oArena to its file, waiting for the writes
+  to complete. Returns SUCCESS, or IO_ERROR if they failed.
+*/
+int FTArena_sync(FTArena_T oArena);
+
+/*
+  Unmaps and frees oArena. Changes not yet flushed by FTArena_sync
+  reach the file eventually, but a crash of the system before then
+  may leave the file with only some of them.
+*/
+void FTArena_close(FTArena_T oArena);
+
+/*
+  Inserts pcPath into oArena, as a file with a copy of the ulLength
+  bytes at pvContents, or NULL contents if pvContents is NULL, if
+  bIsFile, or as a directory otherwise, along with any missing
+  ancestors, with the statuses of FT_insertFile and FT_insertDir
+  other than INITIALIZATION_ERROR; additionally returns IO_ERROR if
+  the file could not be grown.
+*/
+int FTArena_insert(FTArena_T oArena, const char *pcPath,
+                   boolean bIsFile, const void *pvContents,
+                   size_t ulLength);
+
+/*
+  Removes the file pcPath from oArena if bIsFile, or the directory
+  subtree pcPath otherwise, with the statuses of FT_rmFile and
+  FT_rmDir other than INITIALIZATION_ERROR.
+*/
+int FTArena_remove(FTArena_T oArena, const char *pcPath,
+                   boolean bIsFile);
+
+/*
+  Looks up pcPath in oArena as FT_statIn does in a File Tree, with the
+  same statuses, and additionally sets *ppvContents, if ppvContents is
+  not NULL, to the contents of a file that is found. The contents lie
+  in the mapping, and are valid until the next change to oArena.
+*/
+int FTArena_stat(FTArena_T oArena, const char *pcPath,
+                 boolean *pbIsFile, size_t *pulSize,
+                 void **ppvContents);
+
+/*
+  Replaces the contents of the file pcPath in oArena with a copy of
+  the ulLength bytes at pvContents, or with NULL, and sets *ppvOld to
+  the old contents, which lie in the mapping and are valid until the
+  next change to oArena. Returns SUCCESS, or the status of
+  FTArena_stat, or NOT_A_FILE if pcPath is a directory, or IO_ERROR
+  if the file could not be grown.
+*/
+int FTArena_replace(FTArena_T oArena, const char *pcPath,
+                    const void *pvContents, size_t ulLength,
+                    void **ppvOld);
+
+/*
+  Returns the string representation of the hierarchy in oArena, which
+  is the string that FT_toString would return for it, or NULL if there
+  is an allocation error.
+*/
+char *FTArena_toString(FTArena_T oArena);
+
+#endif
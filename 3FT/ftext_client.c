@@ -0,0 +1,1584 @@
+/*--------------------------------------------------------------------*/
+/* ftext_client.c                                                     */
+/* Author: Ishaan Javali & Jack Zhang                                 */
+/*--------------------------------------------------------------------*/
+
+#include <assert.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <pthread.h>
+#include "ft.h"
+#include "ftqueue.h"
+#include "ftshard.h"
+#include "ftjournal.h"
+
+/* The number of threads that share a File Tree in the last test. */
+enum {NUM_THREADS = 4};
+
+/* The number of files each of those threads inserts. */
+enum {FILES_PER_THREAD = 50};
+
+/* The File Tree that a worker thread shares, and the digit that
+   names the directory of its own that it fills. */
+struct worker {
+  FT_T oFTree;
+  char cDigit;
+};
+
+/* Inserts and looks up files in the File Tree and directory given by
+   the struct worker that pvArg points to. Returns NULL. */
+static void *worker(void *pvArg) {
+  struct worker *psWorker = pvArg;
+  char acPath[] = "1root/2dirX/3fileXX";
+  int i;
+
+  assert(psWorker != NULL);
+
+  acPath[10] = psWorker->cDigit;
+  for(i = 0; i < FILES_PER_THREAD; i++) {
+    acPath[17] = (char) ('a' + i / 26);
+    acPath[18] = (char) ('a' + i % 26);
+    assert(FT_insertFileIn(psWorker->oFTree, acPath, NULL, 0) ==
+           SUCCESS);
+    assert(FT_containsFileIn(psWorker->oFTree, acPath) == TRUE);
+    assert(FT_containsDirIn(psWorker->oFTree, "1root") == TRUE);
+  }
+  return NULL;
+}
+
+/* The journal that a journaling thread changes, and the digit that
+   names the directory of its own that it fills. */
+struct journalWorker {
+  FTJournal_T oJournal;
+  char cDigit;
+};
+
+/* Inserts files through the journal and into the directory given by
+   the struct journalWorker that pvArg points to. Returns NULL. */
+static void *journalWorker(void *pvArg) {
+  struct journalWorker *psWorker = pvArg;
+  char acPath[] = "1root/2jX/3fileXX";
+  int i;
+
+  assert(psWorker != NULL);
+
+  acPath[8] = psWorker->cDigit;
+  for(i = 0; i < FILES_PER_THREAD; i++) {
+    acPath[15] = (char) ('a' + i / 26);
+    acPath[16] = (char) ('a' + i % 26);
+    assert(FTJournal_insertFile(psWorker->oJournal, acPath, NULL, 0) ==
+           SUCCESS);
+  }
+  return NULL;
+}
+
+/* A snapshot that a reading thread scans, and the string it must
+   show. */
+struct snapshotReader {
+  FT_T oFSnapshot;
+  const char *pcExpected;
+};
+
+/* Scans the snapshot given by the struct snapshotReader that pvArg
+   points to, over and over, checking that it does not change.
+   Returns NULL. */
+static void *snapshotReader(void *pvArg) {
+  struct snapshotReader *psReader = pvArg;
+  char *pcScan;
+  int i;
+
+  assert(psReader != NULL);
+
+  for(i = 0; i < FILES_PER_THREAD; i++) {
+    assert((pcScan = FT_toStringIn(psReader->oFSnapshot)) != NULL);
+    assert(!strcmp(pcScan, psReader->pcExpected));
+    free(pcScan);
+    assert(FT_containsDirIn(psReader->oFSnapshot, "1root/2dir0") ==
+           FALSE);
+  }
+  return NULL;
+}
+
+/* Counts in the size_t that pvCount points to the completion of psOp,
+   which must have succeeded; an FTQueue callback. */
+static void countDone(struct FT_Op *psOp, void *pvCount) {
+  assert(psOp->iStatus == SUCCESS);
+  (*(size_t *) pvCount)++;
+}
+
+/* Tests the parts of the FT interface beyond the one that sampleft
+   implements: bulk building, independent trees, queues, shards,
+   snapshots, images, arenas, frozen trees, and journals.
+   Prints the status of the data structure along the way to stderr.
+   Returns 0. */
+int main(void) {
+  char* temp;
+  boolean bIsFile;
+  size_t l;
+
+  /* Building from records in canonical order should produce the
+     same tree as inserting them one at a time, creating any missing
+     ancestor directories along the way. Out-of-order, duplicate,
+     or conflicting records should leave the FT uninitialized.
+  */
+  {
+    struct FT_Record asRecords[] = {
+      {"1root", FALSE, NULL, 0},
+      {"1root/x", FALSE, NULL, 0},
+      {"1root/x/B", TRUE, "Thompson", 9},
+      {"1root/x/C", TRUE, "Ritchie", 8},
+      {"1root/x/c++", FALSE, NULL, 0},
+      {"1root/y/CHILD1FILE", TRUE, NULL, 0},
+      {"1root/y/CHILD2FILE", TRUE, NULL, 0},
+      {"1root/y/CHILD1DIR", FALSE, NULL, 0},
+      {"1root/y/CHILD2DIR/CHILD4DIR", FALSE, NULL, 0},
+      {"1root/y/CHILD3DIR", FALSE, NULL, 0}
+    };
+    size_t ulNumRecords = sizeof(asRecords) / sizeof(asRecords[0]);
+    struct FT_Record sSaved;
+
+    assert(FT_buildFromSorted(asRecords, ulNumRecords) == SUCCESS);
+    assert(FT_buildFromSorted(asRecords, ulNumRecords) ==
+           INITIALIZATION_ERROR);
+    assert(FT_containsDir("1root/y/CHILD2DIR") == TRUE);
+    assert(!strcmp(FT_getFileContents("1root/x/C"), "Ritchie"));
+    assert((temp = FT_toString()) != NULL);
+    fprintf(stderr, "Checkpoint 5:\n%s\n", temp);
+    free(temp);
+    assert(FT_destroy() == SUCCESS);
+
+    sSaved = asRecords[3];
+    asRecords[3] = asRecords[2];
+    assert(FT_buildFromSorted(asRecords, ulNumRecords) ==
+           ALREADY_IN_TREE);
+    asRecords[2] = sSaved;
+    assert(FT_buildFromSorted(asRecords, ulNumRecords) == BAD_PATH);
+    asRecords[2] = asRecords[3];
+    asRecords[3] = sSaved;
+    asRecords[4].pcPath = "1root/x/C/d";
+    assert(FT_buildFromSorted(asRecords, ulNumRecords) ==
+           NOT_A_DIRECTORY);
+    asRecords[4].pcPath = "1root/x/c++";
+    asRecords[0].pcPath = "1other";
+    assert(FT_buildFromSorted(asRecords, ulNumRecords) ==
+           CONFLICTING_PATH);
+    assert(FT_containsDir("1root") == FALSE);
+    assert(FT_buildFromSorted(NULL, 0) == SUCCESS);
+    assert((temp = FT_toString()) != NULL);
+    assert(!strcmp(temp, ""));
+    free(temp);
+    assert(FT_destroy() == SUCCESS);
+  }
+
+  /* Independent File Trees don't share any state with each other or
+     with the default File Tree */
+  {
+    FT_T oFFirst, oFSecond;
+
+    assert((oFFirst = FT_new()) != NULL);
+    assert((oFSecond = FT_new()) != NULL);
+    assert(FT_insertDirIn(oFFirst, "1root/2child") == SUCCESS);
+    assert(FT_insertDirIn(oFSecond, "1other/2child") == SUCCESS);
+    assert(FT_insertFileIn(oFSecond, "1other/2file", "x", 2) == SUCCESS);
+    assert(FT_containsDirIn(oFFirst, "1root/2child") == TRUE);
+    assert(FT_containsDirIn(oFSecond, "1root/2child") == FALSE);
+    assert(FT_containsFileIn(oFSecond, "1other/2file") == TRUE);
+    assert(FT_containsDir("1root") == FALSE);
+    assert(FT_rmDirIn(oFFirst, "1root") == SUCCESS);
+    assert((temp = FT_toStringIn(oFFirst)) != NULL);
+    assert(!strcmp(temp, ""));
+    free(temp);
+    assert((temp = FT_toStringIn(oFSecond)) != NULL);
+    assert(!strcmp(temp, "1other\n1other/2file\n1other/2child\n"));
+    free(temp);
+    FT_free(oFFirst);
+    FT_free(oFSecond);
+  }
+
+  /* A File Tree's string representation is the same whether it is
+     built by one thread or by several */
+  {
+    FT_T oFTree;
+    char acPath[] = "1root/2dirX/3dirX/4fileXX";
+    char *pcParallel;
+    int i;
+
+    assert((oFTree = FT_new()) != NULL);
+    for(i = 0; i < 2000; i++) {
+      acPath[10] = (char) ('a' + i % 7);
+      acPath[16] = (char) ('a' + i % 13);
+      acPath[23] = (char) ('a' + i / 26 % 26);
+      acPath[24] = (char) ('a' + i % 26);
+      (void) FT_insertFileIn(oFTree, acPath, NULL, 0);
+    }
+    assert((temp = FT_toStringIn(oFTree)) != NULL);
+    assert((pcParallel = FT_toStringParallel(oFTree, 4)) != NULL);
+    assert(!strcmp(temp, pcParallel));
+    free(pcParallel);
+    free(temp);
+    FT_free(oFTree);
+  }
+
+  /* A concurrent File Tree may be updated and searched by several
+     threads at once */
+  {
+    FT_T oFTree;
+    pthread_t aThreads[NUM_THREADS];
+    struct worker asWorkers[NUM_THREADS];
+    int i;
+
+    assert((oFTree = FT_newConcurrent()) != NULL);
+    assert(FT_insertDirIn(oFTree, "1root") == SUCCESS);
+    for(i = 0; i < NUM_THREADS; i++) {
+      asWorkers[i].oFTree = oFTree;
+      asWorkers[i].cDigit = (char) ('0' + i);
+      assert(pthread_create(&aThreads[i], NULL, worker,
+                            &asWorkers[i]) == 0);
+    }
+    for(i = 0; i < NUM_THREADS; i++)
+      assert(pthread_join(aThreads[i], NULL) == 0);
+    assert(FT_stat("1root/2dir0/3fileaa", &bIsFile, &l) ==
+           INITIALIZATION_ERROR);
+    bIsFile = FALSE;
+    assert(FT_statIn(oFTree, "1root/2dir3/3filebx", &bIsFile, &l) ==
+           SUCCESS);
+    assert(bIsFile == TRUE);
+    assert(FT_rmDirIn(oFTree, "1root/2dir1") == SUCCESS);
+    assert(FT_containsFileIn(oFTree, "1root/2dir1/3fileaa") == FALSE);
+    FT_free(oFTree);
+  }
+
+  /* A wide directory of a concurrent File Tree keeps its children
+     in order however they arrive, since every insert and removal
+     publishes a new copy of the children array */
+  {
+    enum {WIDE_CHILDREN = 1000};
+    FT_T oFTree;
+    char acPath[] = "1root/2wide/3xxxxx";
+    int i;
+
+    assert((oFTree = FT_newConcurrent()) != NULL);
+    for(i = WIDE_CHILDREN - 1; i >= 0; i--) {
+      sprintf(acPath + 12, "%05d", i);
+      if(i % 2 == 0)
+        assert(FT_insertFileIn(oFTree, acPath, NULL, 0) == SUCCESS);
+      else
+        assert(FT_insertDirIn(oFTree, acPath) == SUCCESS);
+    }
+    for(i = 0; i < WIDE_CHILDREN; i += 3) {
+      sprintf(acPath + 12, "%05d", i);
+      if(i % 2 == 0)
+        assert(FT_rmFileIn(oFTree, acPath) == SUCCESS);
+      else
+        assert(FT_rmDirIn(oFTree, acPath) == SUCCESS);
+    }
+    for(i = 0; i < WIDE_CHILDREN; i++) {
+      sprintf(acPath + 12, "%05d", i);
+      assert(FT_containsFileIn(oFTree, acPath) ==
+             (i % 3 != 0 && i % 2 == 0));
+      assert(FT_containsDirIn(oFTree, acPath) ==
+             (i % 3 != 0 && i % 2 == 1));
+    }
+    FT_free(oFTree);
+  }
+
+  /* Subtrees removed from a File Tree with a reclaim pool are gone
+     at once, and the pool frees them later */
+  {
+    FT_T oFTree;
+    ThreadPool_T oPool;
+    char acPath[] = "1root/2dirX/3dirX/4fileX";
+    int i;
+
+    assert((oPool = ThreadPool_new(2)) != NULL);
+    assert((oFTree = FT_newConcurrent()) != NULL);
+    assert(FT_setReclaimPoolIn(oFTree, oPool) == SUCCESS);
+    for(i = 0; i < 500; i++) {
+      acPath[10] = (char) ('a' + i % 5);
+      acPath[16] = (char) ('a' + i / 5 % 10);
+      acPath[23] = (char) ('a' + i / 50);
+      assert(FT_insertFileIn(oFTree, acPath, NULL, 0) == SUCCESS);
+    }
+    assert(FT_rmDirIn(oFTree, "1root/2dirb") == SUCCESS);
+    assert(FT_containsDirIn(oFTree, "1root/2dirb") == FALSE);
+    assert(FT_rmFileIn(oFTree, "1root/2dira/3dira/4filea") == SUCCESS);
+    assert(FT_containsFileIn(oFTree, "1root/2dira/3dira/4filea")
+           == FALSE);
+    assert(FT_rmDirIn(oFTree, "1root/2dirb") == NO_SUCH_PATH);
+    assert(FT_rmDirIn(oFTree, "1root") == SUCCESS);
+    assert(FT_insertFileIn(oFTree, "1root", NULL, 0) == CONFLICTING_PATH);
+    assert(FT_insertDirIn(oFTree, "1root/2dira") == SUCCESS);
+    FT_free(oFTree);
+
+    assert(FT_setReclaimPool(oPool) == SUCCESS);
+    assert(FT_init() == SUCCESS);
+    assert(FT_insertDir("1root/2child/3gkid") == SUCCESS);
+    assert(FT_destroy() == SUCCESS);
+    assert(FT_init() == SUCCESS);
+    assert((temp = FT_toString()) != NULL);
+    assert(!strcmp(temp, ""));
+    free(temp);
+    assert(FT_destroy() == SUCCESS);
+    assert(FT_setReclaimPool(NULL) == SUCCESS);
+    ThreadPool_free(oPool);
+  }
+
+  /* Operations submitted to an FTQueue have the results they would
+     have had if carried out in order, one at a time */
+  {
+    FT_T oFTree;
+    FTQueue_T oQueue;
+    struct FT_Op asOps[8];
+    struct FT_Op asFiles[100];
+    char aacPaths[100][16];
+    size_t ulDone = 0;
+    int i;
+
+    assert((oFTree = FT_new()) != NULL);
+    assert((oQueue = FTQueue_new(oFTree, 16)) != NULL);
+    asOps[0].eKind = FT_OP_INSERT_DIR;
+    asOps[0].pcPath = "1root/2a";
+    asOps[1].eKind = FT_OP_INSERT_FILE;
+    asOps[1].pcPath = "1root/2a/3f";
+    asOps[1].pvContents = "x";
+    asOps[1].ulLength = 2;
+    asOps[2].eKind = FT_OP_STAT;
+    asOps[2].pcPath = "1root/2a/3f";
+    asOps[3].eKind = FT_OP_INSERT_DIR;
+    asOps[3].pcPath = "1root/2b";
+    asOps[4].eKind = FT_OP_RM_DIR;
+    asOps[4].pcPath = "1root/2a";
+    asOps[5].eKind = FT_OP_GET_CONTENTS;
+    asOps[5].pcPath = "1root/2a/3f";
+    asOps[6].eKind = FT_OP_INSERT_DIR;
+    asOps[6].pcPath = "1other";
+    asOps[7].eKind = FT_OP_GET_CONTENTS;
+    asOps[7].pcPath = "1root/2b";
+    for(i = 0; i < 8; i++)
+      FTQueue_submit(oQueue, &asOps[i], NULL, NULL);
+    for(i = 0; i < 8; i++)
+      assert(FTQueue_reap(oQueue, TRUE) != NULL);
+    assert(FTQueue_reap(oQueue, TRUE) == NULL);
+    assert(asOps[0].iStatus == SUCCESS);
+    assert(asOps[1].iStatus == SUCCESS);
+    assert(asOps[2].iStatus == SUCCESS);
+    assert(asOps[2].bIsFile == TRUE && asOps[2].ulSize == 2);
+    assert(asOps[3].iStatus == SUCCESS);
+    assert(asOps[4].iStatus == SUCCESS);
+    assert(asOps[5].iStatus == NO_SUCH_PATH);
+    assert(asOps[6].iStatus == CONFLICTING_PATH);
+    assert(asOps[7].iStatus == NOT_A_FILE);
+
+    for(i = 0; i < 100; i++) {
+      sprintf(aacPaths[i], "1root/2b/3f%02d", 99 - i);
+      asFiles[i].eKind = FT_OP_INSERT_FILE;
+      asFiles[i].pcPath = aacPaths[i];
+      asFiles[i].pvContents = NULL;
+      asFiles[i].ulLength = 0;
+      FTQueue_submit(oQueue, &asFiles[i], countDone, &ulDone);
+    }
+    FTQueue_flush(oQueue);
+    assert(ulDone == 100);
+    FTQueue_free(oQueue);
+    assert(FT_containsFileIn(oFTree, "1root/2b/3f00") == TRUE);
+    assert((temp = FT_toStringIn(oFTree)) != NULL);
+    assert(!strncmp(temp, "1root\n1root/2b\n1root/2b/3f00\n", 29));
+    free(temp);
+    FT_free(oFTree);
+  }
+
+  /* FT_lookupMany agrees with FT_statIn on every kind of path, with
+     more lookups than it keeps under way at once */
+  {
+    FT_T oFTree;
+    struct FT_Op asOps[40];
+    char aacPaths[40][24];
+    boolean bIsFile;
+    size_t ulSize;
+    int iStatus;
+    int i;
+
+    assert((oFTree = FT_new()) != NULL);
+    assert(FT_lookupMany(oFTree, NULL, 0) == SUCCESS);
+    for(i = 0; i < 40; i += 3) {
+      sprintf(aacPaths[i], "1root/2d%02d/3f", i);
+      assert(FT_insertFileIn(oFTree, aacPaths[i], "ab", 3) == SUCCESS);
+    }
+    for(i = 0; i < 40; i++) {
+      switch(i % 8) {
+        case 0: sprintf(aacPaths[i], "1root/2d%02d/3f", i); break;
+        case 1: sprintf(aacPaths[i], "1root/2d%02d", i); break;
+        case 2: sprintf(aacPaths[i], "1root/2d%02d/3f/4g", i); break;
+        case 3: sprintf(aacPaths[i], "1root/2d%02d/3g", i); break;
+        case 4: sprintf(aacPaths[i], "1other/2d%02d", i); break;
+        case 5: sprintf(aacPaths[i], "1root//2d%02d", i); break;
+        case 6: sprintf(aacPaths[i], "1root"); break;
+        default: sprintf(aacPaths[i], "1root/2d%02d/", i); break;
+      }
+      asOps[i].eKind = (i % 2 == 0) ? FT_OP_STAT : FT_OP_GET_CONTENTS;
+      asOps[i].pcPath = aacPaths[i];
+    }
+    assert(FT_lookupMany(oFTree, asOps, 40) == SUCCESS);
+    for(i = 0; i < 40; i++) {
+      iStatus = FT_statIn(oFTree, aacPaths[i], &bIsFile, &ulSize);
+      if(asOps[i].eKind == FT_OP_GET_CONTENTS && iStatus == SUCCESS &&
+         !bIsFile) {
+        assert(asOps[i].iStatus == NOT_A_FILE);
+        continue;
+      }
+      assert(asOps[i].iStatus == iStatus);
+      if(iStatus != SUCCESS)
+        continue;
+      assert(asOps[i].bIsFile == bIsFile);
+      if(bIsFile)
+        assert(asOps[i].ulSize == ulSize);
+      if(asOps[i].eKind == FT_OP_GET_CONTENTS)
+        assert(asOps[i].pvResult ==
+               FT_getFileContentsIn(oFTree, aacPaths[i]));
+    }
+    FT_free(oFTree);
+  }
+
+  /* An FTShard_T gives the same results as a single File Tree under
+     random operations, across the sharding depth and the root */
+  {
+    FT_T oFTree;
+    FTShard_T oShards;
+    static const char *apcNames[] = {"1r", "1s", "a", "b", "c"};
+    char acPath[32];
+    char *temp2;
+    boolean bIsFile2;
+    size_t ulSize, ulSize2;
+    int iDepth;
+    int i, j;
+
+    assert(FTShard_new(4, 1) == NULL);
+    assert((oFTree = FT_new()) != NULL);
+    assert((oShards = FTShard_new(3, 3)) != NULL);
+    assert(FTShard_getShards(oShards) == 3);
+    srand(217);
+    for(i = 0; i < 4000; i++) {
+      iDepth = 1 + rand() % 5;
+      strcpy(acPath, apcNames[i % 50 == 0 ? 1 : 0]);
+      for(j = 1; j < iDepth; j++) {
+        strcat(acPath, "/");
+        strcat(acPath, apcNames[2 + rand() % 3]);
+      }
+      switch(rand() % 6) {
+        case 0:
+          assert(FT_insertDirIn(oFTree, acPath) ==
+                 FTShard_insertDir(oShards, acPath));
+          break;
+        case 1:
+          assert(FT_insertFileIn(oFTree, acPath, acPath, 1) ==
+                 FTShard_insertFile(oShards, acPath, acPath, 1));
+          break;
+        case 2:
+          if(rand() % 8 == 0)
+            assert(FT_rmDirIn(oFTree, acPath) ==
+                   FTShard_rmDir(oShards, acPath));
+          break;
+        case 3:
+          assert(FT_rmFileIn(oFTree, acPath) ==
+                 FTShard_rmFile(oShards, acPath));
+          break;
+        case 4:
+          assert(FT_replaceFileContentsIn(oFTree, acPath, NULL, 2) ==
+                 FTShard_replaceFileContents(oShards, acPath, NULL, 2));
+          break;
+        default:
+          if(FT_statIn(oFTree, acPath, &bIsFile, &ulSize) == SUCCESS) {
+            assert(FTShard_stat(oShards, acPath, &bIsFile2, &ulSize2) ==
+                   SUCCESS);
+            assert(bIsFile == bIsFile2);
+            assert(!bIsFile || ulSize == ulSize2);
+          }
+          assert(FT_containsDirIn(oFTree, acPath) ==
+                 FTShard_containsDir(oShards, acPath));
+          assert(FT_containsFileIn(oFTree, acPath) ==
+                 FTShard_containsFile(oShards, acPath));
+          break;
+      }
+      if(i % 500 == 499) {
+        assert((temp = FT_toStringIn(oFTree)) != NULL);
+        assert((temp2 = FTShard_toString(oShards)) != NULL);
+        assert(!strcmp(temp, temp2));
+        free(temp);
+        free(temp2);
+      }
+    }
+    assert(FTShard_insertDir(oShards, "1r//a") == BAD_PATH);
+    assert(FTShard_insertFile(oShards, "1r/a/", NULL, 0) == BAD_PATH);
+    FTShard_free(oShards);
+    FT_free(oFTree);
+  }
+
+  /* A tree saved with FT_saveIn and read back with FT_newFromFile has
+     the same directories, files and contents, and a damaged snapshot
+     is rejected */
+  {
+    FT_T oFTree, oFTree2;
+    void *pvContents;
+    FILE *psFile;
+    char aacPaths[30][32];
+    char *temp2;
+    int i;
+
+    assert((oFTree = FT_new()) != NULL);
+    assert(FT_saveIn(oFTree, "ft_client.snap") == SUCCESS);
+    assert(FT_newFromFile("ft_client.snap", &oFTree2, &pvContents) ==
+           SUCCESS);
+    assert(pvContents == NULL);
+    assert((temp = FT_toStringIn(oFTree2)) != NULL);
+    assert(!strcmp(temp, ""));
+    free(temp);
+    FT_free(oFTree2);
+
+    assert(FT_insertDirIn(oFTree, "1root/2empty") == SUCCESS);
+    for(i = 0; i < 30; i++) {
+      sprintf(aacPaths[i], "1root/2d%d/3f%d", i % 4, i);
+      assert(FT_insertFileIn(oFTree, aacPaths[i],
+                             i % 3 ? aacPaths[i] : NULL,
+                             i % 3 ? strlen(aacPaths[i]) + 1 : 0) ==
+             SUCCESS);
+    }
+    assert(FT_insertDirIn(oFTree, "1root/2d1/3f1x/4deep") == SUCCESS);
+    assert(FT_saveIn(oFTree, "ft_client.snap") == SUCCESS);
+    assert(FT_newFromFile("ft_client.snap", &oFTree2, &pvContents) ==
+           SUCCESS);
+    assert(pvContents != NULL);
+    assert((temp = FT_toStringIn(oFTree)) != NULL);
+    assert((temp2 = FT_toStringIn(oFTree2)) != NULL);
+    assert(!strcmp(temp, temp2));
+    free(temp);
+    free(temp2);
+    for(i = 0; i < 30; i++) {
+      if(i % 3)
+        assert(!strcmp(FT_getFileContentsIn(oFTree2, aacPaths[i]),
+                       aacPaths[i]));
+      else
+        assert(FT_getFileContentsIn(oFTree2, aacPaths[i]) == NULL);
+    }
+    assert(FT_insertFileIn(oFTree2, "1root/2d0/3new", NULL, 0) ==
+           SUCCESS);
+    FT_free(oFTree2);
+    free(pvContents);
+
+    /* a header that claims far more than the file holds */
+    assert((psFile = fopen("ft_client.snap", "r+b")) != NULL);
+    assert(fseek(psFile, 30, SEEK_SET) == 0);
+    assert(fputc(0x7f, psFile) != EOF);
+    assert(fclose(psFile) == 0);
+    assert(FT_newFromFile("ft_client.snap", &oFTree2, &pvContents) ==
+           CORRUPT_FILE);
+    assert(oFTree2 == NULL && pvContents == NULL);
+
+    /* cut the snapshot short */
+    assert((psFile = fopen("ft_client.snap", "r+b")) != NULL);
+    assert(fseek(psFile, 40, SEEK_SET) == 0);
+    assert(fputc(0x7f, psFile) != EOF);
+    assert(fclose(psFile) == 0);
+    assert(FT_newFromFile("ft_client.snap", &oFTree2, &pvContents) ==
+           CORRUPT_FILE);
+    assert(oFTree2 == NULL && pvContents == NULL);
+    assert(remove("ft_client.snap") == 0);
+    assert(FT_newFromFile("ft_client.snap", &oFTree2, &pvContents) ==
+           IO_ERROR);
+    FT_free(oFTree);
+
+    /* the default File Tree */
+    assert(FT_save("ft_client.snap") == INITIALIZATION_ERROR);
+    assert(FT_init() == SUCCESS);
+    assert(FT_insertFile("1root/2a/3f", "abc", 4) == SUCCESS);
+    assert(FT_insertDir("1root/2b") == SUCCESS);
+    assert(FT_save("ft_client.snap") == SUCCESS);
+    assert(FT_load("ft_client.snap", &pvContents) ==
+           INITIALIZATION_ERROR);
+    assert((temp = FT_toString()) != NULL);
+    assert(FT_destroy() == SUCCESS);
+    assert(FT_load("ft_client.snap", &pvContents) == SUCCESS);
+    assert((temp2 = FT_toString()) != NULL);
+    assert(!strcmp(temp, temp2));
+    free(temp);
+    free(temp2);
+    assert(!strcmp(FT_getFileContents("1root/2a/3f"), "abc"));
+    assert(FT_destroy() == SUCCESS);
+    free(pvContents);
+    assert(remove("ft_client.snap") == 0);
+  }
+
+  /* A tree mapped with FT_newFromImage answers every lookup as the
+     tree its image was written from does, and refuses changes */
+  {
+    FT_T oFTree, oFTree2;
+    FILE *psFile;
+    struct FT_Op asOps[3];
+    char aacPaths[30][32];
+    const char *apcProbes[] = {"1root", "1root/2d1", "1root/2d1/3f5",
+                               "1root/2d1/3f5/4x", "1root/2d1/3f6",
+                               "1root/2empty", "1root/2d1/3f1x/4deep",
+                               "1root/2d", "1root/2d10", "2root/2d1",
+                               "1root//2d1", "1root/2d1/", ""};
+    char *temp2;
+    boolean bIsFile2;
+    size_t l2;
+    int i;
+
+    assert((oFTree = FT_new()) != NULL);
+    assert(FT_saveImageIn(oFTree, "ft_client.img") == SUCCESS);
+    assert(FT_newFromImage("ft_client.img", &oFTree2) == SUCCESS);
+    assert((temp = FT_toStringIn(oFTree2)) != NULL);
+    assert(!strcmp(temp, ""));
+    free(temp);
+    assert(FT_statIn(oFTree2, "1root", &bIsFile, &l) == NO_SUCH_PATH);
+    FT_free(oFTree2);
+
+    assert(FT_insertDirIn(oFTree, "1root/2empty") == SUCCESS);
+    for(i = 0; i < 30; i++) {
+      sprintf(aacPaths[i], "1root/2d%d/3f%d", i % 4, i);
+      assert(FT_insertFileIn(oFTree, aacPaths[i],
+                             i % 3 ? aacPaths[i] : NULL,
+                             i % 3 ? strlen(aacPaths[i]) + 1 : 0) ==
+             SUCCESS);
+    }
+    assert(FT_insertDirIn(oFTree, "1root/2d1/3f1x/4deep") == SUCCESS);
+    assert(FT_saveImageIn(oFTree, "ft_client.img") == SUCCESS);
+    assert(FT_newFromImage("ft_client.img", &oFTree2) == SUCCESS);
+    assert((temp = FT_toStringIn(oFTree)) != NULL);
+    assert((temp2 = FT_toStringIn(oFTree2)) != NULL);
+    assert(!strcmp(temp, temp2));
+    free(temp2);
+    assert((temp2 = FT_toStringParallel(oFTree2, 4)) != NULL);
+    assert(!strcmp(temp, temp2));
+    free(temp);
+    free(temp2);
+    for(i = 0; i < 30; i++) {
+      if(i % 3)
+        assert(!strcmp(FT_getFileContentsIn(oFTree2, aacPaths[i]),
+                       aacPaths[i]));
+      else
+        assert(FT_getFileContentsIn(oFTree2, aacPaths[i]) == NULL);
+    }
+    for(i = 0; i < (int) (sizeof(apcProbes) / sizeof(apcProbes[0]));
+        i++) {
+      assert(FT_statIn(oFTree2, apcProbes[i], &bIsFile2, &l2) ==
+             FT_statIn(oFTree, apcProbes[i], &bIsFile, &l));
+      assert(FT_containsDirIn(oFTree2, apcProbes[i]) ==
+             FT_containsDirIn(oFTree, apcProbes[i]));
+      assert(FT_containsFileIn(oFTree2, apcProbes[i]) ==
+             FT_containsFileIn(oFTree, apcProbes[i]));
+    }
+    asOps[0].eKind = FT_OP_GET_CONTENTS;
+    asOps[0].pcPath = aacPaths[5];
+    asOps[1].eKind = FT_OP_GET_CONTENTS;
+    asOps[1].pcPath = "1root/2d1";
+    asOps[2].eKind = FT_OP_STAT;
+    asOps[2].pcPath = aacPaths[10];
+    assert(FT_lookupMany(oFTree2, asOps, 3) == SUCCESS);
+    assert(asOps[0].iStatus == SUCCESS &&
+           !strcmp(asOps[0].pvResult, aacPaths[5]));
+    assert(asOps[1].iStatus == NOT_A_FILE);
+    assert(asOps[2].iStatus == SUCCESS && asOps[2].bIsFile &&
+           asOps[2].ulSize == strlen(aacPaths[10]) + 1);
+
+    assert(FT_insertDirIn(oFTree2, "1root/2new") == READ_ONLY_TREE);
+    assert(FT_insertFileIn(oFTree2, "1root/2new", NULL, 0) ==
+           READ_ONLY_TREE);
+    assert(FT_rmDirIn(oFTree2, "1root/2d1") == READ_ONLY_TREE);
+    assert(FT_rmFileIn(oFTree2, aacPaths[1]) == READ_ONLY_TREE);
+    assert(FT_replaceFileContentsIn(oFTree2, aacPaths[1], NULL, 0) ==
+           NULL);
+    assert(FT_saveIn(oFTree2, "ft_client.snap") == READ_ONLY_TREE);
+    assert(FT_containsFileIn(oFTree2, aacPaths[1]));
+    FT_free(oFTree2);
+    FT_free(oFTree);
+
+    /* lengthen the image past what its header describes */
+    assert((psFile = fopen("ft_client.img", "ab")) != NULL);
+    assert(fputc(0x7f, psFile) != EOF);
+    assert(fclose(psFile) == 0);
+    assert(FT_newFromImage("ft_client.img", &oFTree2) == CORRUPT_FILE);
+    assert(oFTree2 == NULL);
+    assert(remove("ft_client.img") == 0);
+    assert(FT_newFromImage("ft_client.img", &oFTree2) == IO_ERROR);
+  }
+
+  /* Changes made through a journal survive closing and reopening
+     it, with or without a checkpoint in between, and a record cut
+     short at the end of the journal is dropped */
+  {
+    FTJournal_T oJournal;
+    FILE *psFile;
+    struct FT_Op asOps[3];
+    struct journalWorker asJournalWorkers[NUM_THREADS];
+    pthread_t aoThreads[NUM_THREADS];
+    char aacPaths[30][32];
+    char *temp2;
+    void *pvOld;
+    int i;
+
+    (void) remove("ft_client.snap");
+    (void) remove("ft_client.jnl");
+    assert(FTJournal_open("ft_client.snap", "ft_client.jnl", &oJournal)
+           == SUCCESS);
+    assert(FTJournal_insertDir(oJournal, "1root/2empty") == SUCCESS);
+    for(i = 0; i < 30; i++) {
+      sprintf(aacPaths[i], "1root/2d%d/3f%d", i % 4, i);
+      assert(FTJournal_insertFile(oJournal, aacPaths[i],
+                                  i % 3 ? aacPaths[i] : NULL,
+                                  i % 3 ? strlen(aacPaths[i]) + 1 : 0)
+             == SUCCESS);
+    }
+    assert(FTJournal_insertFile(oJournal, aacPaths[0], NULL, 0) ==
+           ALREADY_IN_TREE);
+    assert(FTJournal_rmFile(oJournal, aacPaths[4]) == SUCCESS);
+    assert(FTJournal_rmDir(oJournal, "1root/2d3") == SUCCESS);
+    assert(FTJournal_replaceFileContents(oJournal, aacPaths[1],
+                                         aacPaths[2],
+                                         strlen(aacPaths[2]) + 1,
+                                         &pvOld) == SUCCESS);
+    assert(pvOld == aacPaths[1]);
+    assert(FTJournal_replaceFileContents(oJournal, "1root/2d1", NULL, 0,
+                                         &pvOld) == NOT_A_FILE);
+    /* NULL contents keep their length */
+    assert(FTJournal_insertFile(oJournal, "1root/2empty/3null", NULL,
+                                5) == SUCCESS);
+    assert(FTJournal_replaceFileContents(oJournal, aacPaths[5], NULL, 7,
+                                         &pvOld) == SUCCESS);
+    asOps[0].eKind = FT_OP_INSERT_DIR;
+    asOps[0].pcPath = "1root/2batch/3a";
+    asOps[1].eKind = FT_OP_STAT;
+    asOps[1].pcPath = "1root/2batch";
+    asOps[2].eKind = FT_OP_INSERT_FILE;
+    asOps[2].pcPath = "1root/2batch/3f";
+    asOps[2].pvContents = "batch";
+    asOps[2].ulLength = 6;
+    assert(FTJournal_applyBatch(oJournal, asOps, 3) == SUCCESS);
+    assert(asOps[1].iStatus == SUCCESS && asOps[2].iStatus == SUCCESS);
+    assert((temp = FT_toStringIn(FTJournal_getTree(oJournal))) != NULL);
+    FTJournal_close(oJournal);
+
+    assert(FTJournal_open("ft_client.snap", "ft_client.jnl", &oJournal)
+           == SUCCESS);
+    assert((temp2 = FT_toStringIn(FTJournal_getTree(oJournal))) != NULL);
+    assert(!strcmp(temp, temp2));
+    free(temp2);
+    assert(!strcmp(FT_getFileContentsIn(FTJournal_getTree(oJournal),
+                                        aacPaths[1]), aacPaths[2]));
+    assert(!strcmp(FT_getFileContentsIn(FTJournal_getTree(oJournal),
+                                        "1root/2batch/3f"), "batch"));
+    assert(FT_statIn(FTJournal_getTree(oJournal), "1root/2empty/3null",
+                     &bIsFile, &l) == SUCCESS);
+    assert(bIsFile && l == 5);
+    assert(FT_statIn(FTJournal_getTree(oJournal), aacPaths[5],
+                     &bIsFile, &l) == SUCCESS);
+    assert(bIsFile && l == 7);
+    assert(FT_getFileContentsIn(FTJournal_getTree(oJournal),
+                                aacPaths[5]) == NULL);
+
+    /* a checkpoint, then changes on top of it */
+    assert(FTJournal_checkpoint(oJournal) == SUCCESS);
+    assert(FTJournal_rmDir(oJournal, "1root/2batch") == SUCCESS);
+    for(i = 0; i < NUM_THREADS; i++) {
+      asJournalWorkers[i].oJournal = oJournal;
+      asJournalWorkers[i].cDigit = (char) ('0' + i);
+      assert(pthread_create(&aoThreads[i], NULL, journalWorker,
+                            &asJournalWorkers[i]) == 0);
+    }
+    for(i = 0; i < NUM_THREADS; i++)
+      assert(pthread_join(aoThreads[i], NULL) == 0);
+    free(temp);
+    assert((temp = FT_toStringIn(FTJournal_getTree(oJournal))) != NULL);
+    FTJournal_close(oJournal);
+
+    /* a record cut short by a crash */
+    assert((psFile = fopen("ft_client.jnl", "ab")) != NULL);
+    assert(fwrite("\001\0\0\0\0\0\0\0\077", 1, 9, psFile) == 9);
+    assert(fclose(psFile) == 0);
+    assert(FTJournal_open("ft_client.snap", "ft_client.jnl", &oJournal)
+           == SUCCESS);
+    assert((temp2 = FT_toStringIn(FTJournal_getTree(oJournal))) != NULL);
+    assert(!strcmp(temp, temp2));
+    free(temp2);
+    assert(FTJournal_insertDir(oJournal, "1root/2after") == SUCCESS);
+    FTJournal_close(oJournal);
+    assert(FTJournal_open("ft_client.snap", "ft_client.jnl", &oJournal)
+           == SUCCESS);
+    assert(FT_containsDirIn(FTJournal_getTree(oJournal),
+                            "1root/2after"));
+    assert(FT_statIn(FTJournal_getTree(oJournal), "1root/2empty/3null",
+                     &bIsFile, &l) == SUCCESS);
+    assert(bIsFile && l == 5);
+    assert(FT_statIn(FTJournal_getTree(oJournal), aacPaths[5],
+                     &bIsFile, &l) == SUCCESS);
+    assert(bIsFile && l == 7);
+    FTJournal_close(oJournal);
+    free(temp);
+
+    /* a journal whose snapshot is gone */
+    assert(remove("ft_client.snap") == 0);
+    assert(FTJournal_open("ft_client.snap", "ft_client.jnl", &oJournal)
+           == CORRUPT_FILE);
+    assert(oJournal == NULL);
+    assert(remove("ft_client.jnl") == 0);
+  }
+
+  /* A snapshot restored with FT_newFromFile and followed by each delta
+     saved after it with FT_saveDeltaIn gives back the tree, and a
+     delta out of turn is rejected */
+  {
+    FT_T oFTree, oFTree2;
+    void *pvContents, *pvDelta1, *pvDelta2, *pvDelta3;
+    FILE *psFile;
+    char aacPaths[30][32];
+    char *temp2;
+    int i;
+
+    assert((oFTree = FT_new()) != NULL);
+    for(i = 0; i < 30; i++) {
+      sprintf(aacPaths[i], "1root/2d%d/3f%d", i % 4, i);
+      assert(FT_insertFileIn(oFTree, aacPaths[i], aacPaths[i],
+                             strlen(aacPaths[i]) + 1) == SUCCESS);
+    }
+    assert(FT_saveIn(oFTree, "ft_client.snap") == SUCCESS);
+
+    /* nothing changed, so the delta is just its header */
+    assert(FT_saveDeltaIn(oFTree, "ft_client.d1") == SUCCESS);
+    assert((psFile = fopen("ft_client.d1", "rb")) != NULL);
+    assert(fseek(psFile, 0, SEEK_END) == 0);
+    assert(ftell(psFile) == 40);
+    assert(fclose(psFile) == 0);
+
+    /* removals, inserts below old and new directories, replaced
+       contents, and nodes made and removed between two deltas */
+    assert(FT_rmFileIn(oFTree, aacPaths[4]) == SUCCESS);
+    assert(FT_rmDirIn(oFTree, "1root/2d3") == SUCCESS);
+    assert(FT_insertFileIn(oFTree, "1root/2d3/3f3", "again", 6) ==
+           SUCCESS);
+    assert(FT_insertDirIn(oFTree, "1root/2new/3a/4b") == SUCCESS);
+    assert(FT_insertFileIn(oFTree, "1root/2new/3a/4f", NULL, 0) ==
+           SUCCESS);
+    assert(FT_insertDirIn(oFTree, "1root/2gone/3x") == SUCCESS);
+    assert(FT_rmDirIn(oFTree, "1root/2gone") == SUCCESS);
+    assert(FT_replaceFileContentsIn(oFTree, aacPaths[1], aacPaths[2],
+                                    strlen(aacPaths[2]) + 1) ==
+           aacPaths[1]);
+    assert(FT_saveDeltaIn(oFTree, "ft_client.d2") == SUCCESS);
+    assert(FT_rmDirIn(oFTree, "1root/2new/3a") == SUCCESS);
+    assert(FT_rmFileIn(oFTree, aacPaths[1]) == SUCCESS);
+    assert(FT_insertDirIn(oFTree, aacPaths[1]) == SUCCESS);
+    assert(FT_replaceFileContentsIn(oFTree, aacPaths[5], NULL, 0) ==
+           aacPaths[5]);
+    assert(FT_saveDeltaIn(oFTree, "ft_client.d3") == SUCCESS);
+
+    assert(FT_newFromFile("ft_client.snap", &oFTree2, &pvContents) ==
+           SUCCESS);
+    assert(FT_applyDeltaIn(oFTree2, "ft_client.d2", &pvDelta2) ==
+           CORRUPT_FILE);
+    assert(pvDelta2 == NULL);
+    assert(FT_applyDeltaIn(oFTree2, "ft_client.d1", &pvDelta1) ==
+           SUCCESS);
+    assert(pvDelta1 == NULL);
+    assert(FT_applyDeltaIn(oFTree2, "ft_client.d2", &pvDelta2) ==
+           SUCCESS);
+    assert(FT_applyDeltaIn(oFTree2, "ft_client.d3", &pvDelta3) ==
+           SUCCESS);
+    assert((temp = FT_toStringIn(oFTree)) != NULL);
+    assert((temp2 = FT_toStringIn(oFTree2)) != NULL);
+    assert(!strcmp(temp, temp2));
+    free(temp);
+    free(temp2);
+    assert(!strcmp(FT_getFileContentsIn(oFTree2, "1root/2d3/3f3"),
+                   "again"));
+    assert(FT_getFileContentsIn(oFTree2, aacPaths[5]) == NULL);
+    assert(!strcmp(FT_getFileContentsIn(oFTree2, aacPaths[9]),
+                   aacPaths[9]));
+    assert(FT_applyDeltaIn(oFTree2, "ft_client.d3", &pvDelta1) ==
+           CORRUPT_FILE);
+
+    /* a new snapshot starts a new chain */
+    assert(FT_insertDirIn(oFTree2, "1root/2later") == SUCCESS);
+    assert(FT_saveIn(oFTree2, "ft_client.snap") == SUCCESS);
+    assert(FT_rmDirIn(oFTree2, "1root/2later") == SUCCESS);
+    assert(FT_saveDeltaIn(oFTree2, "ft_client.d1") == SUCCESS);
+    FT_free(oFTree2);
+    free(pvContents);
+    free(pvDelta2);
+    free(pvDelta3);
+    assert(FT_newFromFile("ft_client.snap", &oFTree2, &pvContents) ==
+           SUCCESS);
+    assert(FT_applyDeltaIn(oFTree2, "ft_client.d1", &pvDelta1) ==
+           SUCCESS);
+    assert(!FT_containsDirIn(oFTree2, "1root/2later"));
+    FT_free(oFTree2);
+    free(pvContents);
+    FT_free(oFTree);
+
+    /* the default File Tree, from an empty start */
+    assert(FT_saveDelta("ft_client.d1") == INITIALIZATION_ERROR);
+    assert(FT_init() == SUCCESS);
+    assert(FT_insertFile("1root/2a/3f", "abc", 4) == SUCCESS);
+    assert(FT_saveDelta("ft_client.d1") == SUCCESS);
+    assert(FT_destroy() == SUCCESS);
+    assert(FT_init() == SUCCESS);
+    assert(FT_applyDelta("ft_client.d1", &pvDelta1) == SUCCESS);
+    assert(!strcmp(FT_getFileContents("1root/2a/3f"), "abc"));
+    assert(FT_destroy() == SUCCESS);
+    free(pvDelta1);
+
+    assert(remove("ft_client.snap") == 0);
+    assert(remove("ft_client.d1") == 0);
+    assert(remove("ft_client.d2") == 0);
+    assert(remove("ft_client.d3") == 0);
+  }
+
+  /* A snapshot taken with FT_snapshotIn keeps showing the tree as it
+     was while the tree goes on changing, including from other
+     threads, and is read-only */
+  {
+    FT_T oFTree, oFTree2, oFSnapshot, oFSnapshot2;
+    void *pvContents;
+    struct worker asWorkers[NUM_THREADS];
+    struct snapshotReader sReader;
+    pthread_t aoThreads[NUM_THREADS + 1];
+    char aacPaths[30][32];
+    char *temp2, *temp3;
+    boolean bIsFile2;
+    int i;
+
+    assert((oFTree = FT_new()) != NULL);
+    for(i = 0; i < 30; i++) {
+      sprintf(aacPaths[i], "1root/2d%d/3f%d", i % 4, i);
+      assert(FT_insertFileIn(oFTree, aacPaths[i], aacPaths[i],
+                             strlen(aacPaths[i]) + 1) == SUCCESS);
+    }
+    assert((temp = FT_toStringIn(oFTree)) != NULL);
+    assert(FT_snapshotIn(oFTree, &oFSnapshot) == SUCCESS);
+
+    assert(FT_rmDirIn(oFTree, "1root/2d3") == SUCCESS);
+    assert(FT_insertDirIn(oFTree, "1root/2d0/3new/4deeper") == SUCCESS);
+    assert(FT_rmFileIn(oFTree, aacPaths[1]) == SUCCESS);
+    assert(FT_replaceFileContentsIn(oFTree, aacPaths[2], "new", 4) ==
+           aacPaths[2]);
+    assert((temp2 = FT_toStringIn(oFSnapshot)) != NULL);
+    assert(!strcmp(temp, temp2));
+    free(temp2);
+    assert(!strcmp(FT_getFileContentsIn(oFSnapshot, aacPaths[2]),
+                   aacPaths[2]));
+    assert(!strcmp(FT_getFileContentsIn(oFTree, aacPaths[2]), "new"));
+    assert(FT_statIn(oFSnapshot, aacPaths[3], &bIsFile2, &l) ==
+           SUCCESS);
+    assert(bIsFile2 && l == strlen(aacPaths[3]) + 1);
+    assert(FT_containsFileIn(oFSnapshot, aacPaths[1]));
+    assert(!FT_containsFileIn(oFTree, aacPaths[1]));
+    assert(FT_insertDirIn(oFSnapshot, "1root/2x") == READ_ONLY_TREE);
+    assert(FT_rmDirIn(oFSnapshot, "1root/2d0") == READ_ONLY_TREE);
+    assert(FT_rmFileIn(oFSnapshot, aacPaths[0]) == READ_ONLY_TREE);
+    assert(FT_replaceFileContentsIn(oFSnapshot, aacPaths[0], NULL, 0)
+           == NULL);
+    assert(FT_saveDeltaIn(oFSnapshot, "ft_client.d1") ==
+           READ_ONLY_TREE);
+
+    /* a second snapshot, then the first is freed */
+    assert((temp2 = FT_toStringIn(oFTree)) != NULL);
+    assert(FT_snapshotIn(oFTree, &oFSnapshot2) == SUCCESS);
+    assert(FT_rmDirIn(oFTree, "1root") == SUCCESS);
+    assert(FT_insertFileIn(oFTree, "1root/2other", NULL, 0) == SUCCESS);
+    FT_free(oFSnapshot);
+    assert((temp3 = FT_toStringIn(oFSnapshot2)) != NULL);
+    assert(!strcmp(temp2, temp3));
+    free(temp3);
+
+    /* a snapshot saved while the tree changes */
+    assert(FT_saveIn(oFSnapshot2, "ft_client.snap") == SUCCESS);
+    assert(FT_newFromFile("ft_client.snap", &oFTree2, &pvContents) ==
+           SUCCESS);
+    assert((temp3 = FT_toStringIn(oFTree2)) != NULL);
+    assert(!strcmp(temp2, temp3));
+    free(temp3);
+    FT_free(oFTree2);
+    free(pvContents);
+    assert(remove("ft_client.snap") == 0);
+    FT_free(oFSnapshot2);
+    assert((temp3 = FT_toStringIn(oFTree)) != NULL);
+    assert(!strcmp(temp3, "1root\n1root/2other\n"));
+    free(temp3);
+    free(temp2);
+    free(temp);
+    FT_free(oFTree);
+
+    /* a concurrent tree scanned through a snapshot while threads
+       insert into it */
+    assert((oFTree = FT_newConcurrent()) != NULL);
+    assert(FT_insertDirIn(oFTree, "1root/2base") == SUCCESS);
+    assert((temp = FT_toStringIn(oFTree)) != NULL);
+    assert(FT_snapshotIn(oFTree, &oFSnapshot) == SUCCESS);
+    sReader.oFSnapshot = oFSnapshot;
+    sReader.pcExpected = temp;
+    assert(pthread_create(&aoThreads[NUM_THREADS], NULL,
+                          snapshotReader, &sReader) == 0);
+    for(i = 0; i < NUM_THREADS; i++) {
+      asWorkers[i].oFTree = oFTree;
+      asWorkers[i].cDigit = (char) ('0' + i);
+      assert(pthread_create(&aoThreads[i], NULL, worker,
+                            &asWorkers[i]) == 0);
+    }
+    for(i = 0; i <= NUM_THREADS; i++)
+      assert(pthread_join(aoThreads[i], NULL) == 0);
+    FT_free(oFSnapshot);
+    assert(FT_containsFileIn(oFTree, "1root/2dir0/3fileaa"));
+    free(temp);
+    FT_free(oFTree);
+
+    /* the default File Tree */
+    assert(FT_snapshot(&oFSnapshot) == INITIALIZATION_ERROR);
+    assert(oFSnapshot == NULL);
+    assert(FT_init() == SUCCESS);
+    assert(FT_insertDir("1root/2a") == SUCCESS);
+    assert(FT_snapshot(&oFSnapshot) == SUCCESS);
+    assert(FT_rmDir("1root/2a") == SUCCESS);
+    assert(FT_containsDirIn(oFSnapshot, "1root/2a"));
+    FT_free(oFSnapshot);
+    assert(FT_destroy() == SUCCESS);
+  }
+
+  /* A tree loaded on demand from an image with FT_newLazy answers
+     and changes as the tree its image was written from does, however
+     small its budget, and keeps its changes through evictions */
+  {
+    FT_T oFTree, oFTree2, oFTree3, oFSnapshot;
+    struct FT_Op asOps[3];
+    char aacPaths[60][32];
+    char *temp2;
+    boolean bIsFile2;
+    size_t l2;
+    int i, j;
+
+    assert((oFTree = FT_new()) != NULL);
+    assert(FT_saveImageIn(oFTree, "ft_client.img") == SUCCESS);
+    assert(FT_newLazy("ft_client.img", 8, &oFTree2) == SUCCESS);
+    assert(FT_statIn(oFTree2, "1root", &bIsFile, &l) == NO_SUCH_PATH);
+    assert(FT_insertDirIn(oFTree2, "1root/2a") == SUCCESS);
+    assert((temp = FT_toStringIn(oFTree2)) != NULL);
+    assert(!strcmp(temp, "1root\n1root/2a\n"));
+    free(temp);
+    FT_free(oFTree2);
+
+    assert(FT_insertDirIn(oFTree, "1root/2empty") == SUCCESS);
+    for(i = 0; i < 60; i++) {
+      sprintf(aacPaths[i], "1root/2d%d/3e%d/4f%d", i % 4, i % 12, i);
+      assert(FT_insertFileIn(oFTree, aacPaths[i], aacPaths[i],
+                             strlen(aacPaths[i]) + 1) == SUCCESS);
+    }
+    assert(FT_saveImageIn(oFTree, "ft_client.img") == SUCCESS);
+    assert(FT_newLazy("ft_client.img", 8, &oFTree2) == SUCCESS);
+
+    /* every lookup loads what it needs and evicts what it does not,
+       in any order, repeatedly */
+    for(j = 0; j < 3; j++)
+      for(i = 0; i < 60; i++) {
+        assert(!strcmp(FT_getFileContentsIn(oFTree2,
+                                            aacPaths[(i * 7) % 60]),
+                       aacPaths[(i * 7) % 60]));
+        assert(FT_statIn(oFTree2, aacPaths[i], &bIsFile2, &l2) ==
+               SUCCESS);
+        assert(bIsFile2 && l2 == strlen(aacPaths[i]) + 1);
+        assert(FT_containsDirIn(oFTree2, "1root/2empty"));
+        assert(!FT_containsFileIn(oFTree2, "1root/2d1/3e1"));
+        assert(FT_statIn(oFTree2, "1root/2d1/3e1/4f99", &bIsFile2,
+                         &l2) == NO_SUCH_PATH);
+      }
+    assert(FT_statIn(oFTree2, "2root", &bIsFile2, &l2) ==
+           CONFLICTING_PATH);
+    assert((temp = FT_toStringIn(oFTree)) != NULL);
+    assert((temp2 = FT_toStringIn(oFTree2)) != NULL);
+    assert(!strcmp(temp, temp2));
+    free(temp);
+    free(temp2);
+
+    /* the same changes to both trees, then lookups that evict
+       everything unchanged */
+    for(i = 0; i < 2; i++) {
+      oFTree3 = i == 0 ? oFTree : oFTree2;
+      assert(FT_insertFileIn(oFTree3, "1root/2d2/3e6/4new", "new", 4)
+             == SUCCESS);
+      assert(FT_insertDirIn(oFTree3, "1root/2d5/3x") == SUCCESS);
+      assert(FT_insertDirIn(oFTree3, "1root/2d1/3e1/4f1") ==
+             ALREADY_IN_TREE);
+      assert(FT_rmFileIn(oFTree3, aacPaths[13]) == SUCCESS);
+      assert(FT_rmDirIn(oFTree3, "1root/2d3/3e11") == SUCCESS);
+      /* the lazy tree's old contents lie in its image */
+      assert(!strcmp(FT_replaceFileContentsIn(oFTree3, aacPaths[20],
+                                              "r", 2), aacPaths[20]));
+    }
+    for(j = 0; j < 2; j++)
+      for(i = 0; i < 60; i++)
+        assert(FT_containsFileIn(oFTree2, aacPaths[i]) ==
+               FT_containsFileIn(oFTree, aacPaths[i]));
+    assert(!strcmp(FT_getFileContentsIn(oFTree2, "1root/2d2/3e6/4new"),
+                   "new"));
+    assert(!strcmp(FT_getFileContentsIn(oFTree2, aacPaths[20]), "r"));
+    assert(FT_containsDirIn(oFTree2, "1root/2d5/3x"));
+    assert(!FT_containsDirIn(oFTree2, "1root/2d3/3e11"));
+    assert((temp = FT_toStringIn(oFTree)) != NULL);
+    assert((temp2 = FT_toStringParallel(oFTree2, 4)) != NULL);
+    assert(!strcmp(temp, temp2));
+    free(temp2);
+
+    asOps[0].eKind = FT_OP_GET_CONTENTS;
+    asOps[0].pcPath = aacPaths[5];
+    asOps[1].eKind = FT_OP_GET_CONTENTS;
+    asOps[1].pcPath = "1root/2d1";
+    asOps[2].eKind = FT_OP_STAT;
+    asOps[2].pcPath = aacPaths[13];
+    assert(FT_lookupMany(oFTree2, asOps, 3) == SUCCESS);
+    assert(asOps[0].iStatus == SUCCESS &&
+           !strcmp(asOps[0].pvResult, aacPaths[5]));
+    assert(asOps[1].iStatus == NOT_A_FILE);
+    assert(asOps[2].iStatus == NO_SUCH_PATH);
+
+    /* a snapshot loads stubs of its own, and nothing is evicted from
+       under it */
+    assert(FT_snapshotIn(oFTree2, &oFSnapshot) == SUCCESS);
+    assert(FT_rmDirIn(oFTree2, "1root/2d0") == SUCCESS);
+    for(i = 0; i < 60; i++)
+      assert(FT_containsFileIn(oFTree2, aacPaths[i]) == (i % 4 != 0 &&
+             FT_containsFileIn(oFTree, aacPaths[i])));
+    assert((temp2 = FT_toStringIn(oFSnapshot)) != NULL);
+    assert(!strcmp(temp, temp2));
+    free(temp2);
+    FT_free(oFSnapshot);
+    assert(FT_rmDirIn(oFTree, "1root/2d0") == SUCCESS);
+    free(temp);
+
+    /* saving loads everything first */
+    assert(FT_saveImageIn(oFTree2, "ft_client.img2") == SUCCESS);
+    FT_free(oFTree2);
+    assert(FT_newLazy("ft_client.img2", 0, &oFTree2) == SUCCESS);
+    assert((temp = FT_toStringIn(oFTree)) != NULL);
+    assert((temp2 = FT_toStringIn(oFTree2)) != NULL);
+    assert(!strcmp(temp, temp2));
+    free(temp);
+    free(temp2);
+    FT_free(oFTree2);
+    FT_free(oFTree);
+    assert(remove("ft_client.img2") == 0);
+
+    /* the default File Tree */
+    assert(FT_init() == SUCCESS);
+    assert(FT_loadLazy("ft_client.img", 4) == INITIALIZATION_ERROR);
+    assert(FT_destroy() == SUCCESS);
+    assert(FT_loadLazy("ft_client.img", 4) == SUCCESS);
+    assert(!strcmp(FT_getFileContents(aacPaths[7]), aacPaths[7]));
+    assert(FT_rmDir("1root/2d3") == SUCCESS);
+    assert(!FT_containsFile(aacPaths[7]));
+    assert(FT_containsFile(aacPaths[6]));
+    assert(FT_destroy() == SUCCESS);
+
+    assert(remove("ft_client.img") == 0);
+    assert(FT_newLazy("ft_client.img", 4, &oFTree2) == IO_ERROR);
+    assert(oFTree2 == NULL);
+  }
+
+  /* A tree in an arena with FT_newArena keeps its hierarchy in the
+     file, changing it in place, and opening the file again gives
+     back the same tree, contents and all */
+  {
+    FT_T oFTree, oFTree2, oFSnapshot;
+    FILE *psFile;
+    char acPath[32];
+    char acContents[8];
+    char *temp2;
+    void *pvOld;
+    size_t ulRoot, ulWord;
+    size_t aulNode[2];
+    int i;
+
+    (void) remove("ft_client.arena");
+    assert(FT_newArena("ft_client.arena", &oFTree2) == SUCCESS);
+    assert((temp = FT_toStringIn(oFTree2)) != NULL);
+    assert(!strcmp(temp, ""));
+    free(temp);
+    assert(FT_insertFileIn(oFTree2, "1root", NULL, 0) ==
+           CONFLICTING_PATH);
+
+    /* enough nodes that the file must grow several times */
+    assert((oFTree = FT_new()) != NULL);
+    for(i = 0; i < 2000; i++) {
+      sprintf(acPath, "1root/2d%d/3f%d", i % 37, i);
+      sprintf(acContents, "%d", i);
+      assert(FT_insertFileIn(oFTree, acPath, "x", 2) == SUCCESS);
+      assert(FT_insertFileIn(oFTree2, acPath, acContents,
+                             strlen(acContents) + 1) == SUCCESS);
+    }
+    /* the arena keeps copies of the contents */
+    strcpy(acContents, "changed");
+    assert(!strcmp(FT_getFileContentsIn(oFTree2, "1root/2d3/3f40"),
+                   "40"));
+    assert(FT_insertDirIn(oFTree2, "1root/2d3/3f40/4x") ==
+           NOT_A_DIRECTORY);
+    assert(FT_insertDirIn(oFTree2, "1root/2d3") == ALREADY_IN_TREE);
+    assert(FT_insertDirIn(oFTree2, "2root") == CONFLICTING_PATH);
+    assert(FT_insertDirIn(oFTree2, "1root//2x") == BAD_PATH);
+    assert(FT_rmFileIn(oFTree2, "1root/2d3") == NOT_A_FILE);
+    assert(FT_rmDirIn(oFTree2, "1root/2d3/3f40") == NOT_A_DIRECTORY);
+    assert(FT_statIn(oFTree2, "1root/2d3/3f40", &bIsFile, &l) ==
+           SUCCESS);
+    assert(bIsFile && l == 3);
+
+    for(i = 0; i < 2000; i += 3) {
+      sprintf(acPath, "1root/2d%d/3f%d", i % 37, i);
+      assert(FT_rmFileIn(oFTree, acPath) == SUCCESS);
+      assert(FT_rmFileIn(oFTree2, acPath) == SUCCESS);
+    }
+    assert(FT_rmDirIn(oFTree, "1root/2d5") == SUCCESS);
+    assert(FT_rmDirIn(oFTree2, "1root/2d5") == SUCCESS);
+    assert(FT_insertDirIn(oFTree, "1root/2d5/3new") == SUCCESS);
+    assert(FT_insertDirIn(oFTree2, "1root/2d5/3new") == SUCCESS);
+    pvOld = FT_replaceFileContentsIn(oFTree2, "1root/2d1/3f1", "r", 2);
+    assert(pvOld != NULL && !strcmp(pvOld, "1"));
+    assert(FT_replaceFileContentsIn(oFTree2, "1root/2d1", "r", 2) ==
+           NULL);
+
+    /* the arena is the saved tree */
+    assert(FT_saveIn(oFTree2, "ft_client.snap") == NOT_SUPPORTED);
+    assert(FT_saveImageIn(oFTree2, "ft_client.img") == NOT_SUPPORTED);
+    assert(FT_snapshotIn(oFTree2, &oFSnapshot) == NOT_SUPPORTED);
+    assert(oFSnapshot == NULL);
+    assert(FT_syncIn(oFTree2) == SUCCESS);
+    assert(FT_syncIn(oFTree) == SUCCESS);
+    FT_free(oFTree2);
+
+    assert(FT_newArena("ft_client.arena", &oFTree2) == SUCCESS);
+    assert((temp = FT_toStringIn(oFTree)) != NULL);
+    assert((temp2 = FT_toStringIn(oFTree2)) != NULL);
+    assert(!strcmp(temp, temp2));
+    free(temp);
+    free(temp2);
+    assert(!strcmp(FT_getFileContentsIn(oFTree2, "1root/2d1/3f1"), "r"));
+    assert(!strcmp(FT_getFileContentsIn(oFTree2, "1root/2d36/3f1997"),
+                   "1997"));
+    assert(FT_getFileContentsIn(oFTree2, "1root/2d3/3f3") == NULL);
+    FT_free(oFTree2);
+    FT_free(oFTree);
+
+    /* the default File Tree */
+    assert(FT_sync() == INITIALIZATION_ERROR);
+    assert(FT_loadArena("ft_client.arena") == SUCCESS);
+    assert(FT_loadArena("ft_client.arena") == INITIALIZATION_ERROR);
+    assert(FT_rmDir("1root/2d1") == SUCCESS);
+    assert(FT_sync() == SUCCESS);
+    assert(FT_destroy() == SUCCESS);
+    assert(FT_loadArena("ft_client.arena") == SUCCESS);
+    assert(!FT_containsDir("1root/2d1"));
+    assert(FT_containsDir("1root/2d2"));
+    assert(FT_destroy() == SUCCESS);
+
+    /* a root node whose name runs past its block, and then whose
+       children array is not a block */
+    assert((psFile = fopen("ft_client.arena", "r+b")) != NULL);
+    assert(fseek(psFile, 8 + 3 * (long) sizeof(size_t), SEEK_SET) == 0);
+    assert(fread(&ulRoot, sizeof(size_t), 1, psFile) == 1);
+    assert(fseek(psFile, (long) (ulRoot + 2 * sizeof(size_t)),
+                 SEEK_SET) == 0);
+    assert(fread(aulNode, sizeof(size_t), 2, psFile) == 2);
+    ulWord = (size_t) -1;
+    assert(fseek(psFile, (long) (ulRoot + 2 * sizeof(size_t)),
+                 SEEK_SET) == 0);
+    assert(fwrite(&ulWord, sizeof(size_t), 1, psFile) == 1);
+    assert(fflush(psFile) == 0);
+    assert(FT_newArena("ft_client.arena", &oFTree2) == CORRUPT_FILE);
+    ulWord = 1;
+    assert(fseek(psFile, (long) (ulRoot + 2 * sizeof(size_t)),
+                 SEEK_SET) == 0);
+    assert(fwrite(aulNode, sizeof(size_t), 1, psFile) == 1);
+    assert(fwrite(&ulWord, sizeof(size_t), 1, psFile) == 1);
+    assert(fflush(psFile) == 0);
+    assert(FT_newArena("ft_client.arena", &oFTree2) == CORRUPT_FILE);
+    assert(oFTree2 == NULL);
+    assert(fseek(psFile, (long) (ulRoot + 3 * sizeof(size_t)),
+                 SEEK_SET) == 0);
+    assert(fwrite(&aulNode[1], sizeof(size_t), 1, psFile) == 1);
+    assert(fclose(psFile) == 0);
+    assert(FT_newArena("ft_client.arena", &oFTree2) == SUCCESS);
+    assert(FT_containsDirIn(oFTree2, "1root/2d2"));
+    FT_free(oFTree2);
+
+    /* anything else is not an arena */
+    assert((oFTree = FT_new()) != NULL);
+    assert(FT_saveImageIn(oFTree, "ft_client.arena") == SUCCESS);
+    FT_free(oFTree);
+    assert(FT_newArena("ft_client.arena", &oFTree2) == CORRUPT_FILE);
+    assert(oFTree2 == NULL);
+    assert(remove("ft_client.arena") == 0);
+  }
+
+  /* A save started with FT_beginSaveIn writes the tree as it was when
+     the save began while the tree goes on changing, and replaces the
+     old file only once the new one is whole */
+  {
+    FT_T oFTree, oFTree2;
+    void *pvContents;
+    struct worker asWorkers[NUM_THREADS];
+    pthread_t aoThreads[NUM_THREADS];
+    char aacPaths[500][32];
+    char *temp2;
+    FILE *psFile;
+    int i;
+
+    assert((oFTree = FT_new()) != NULL);
+    assert(FT_saveIn(oFTree, "ft_client.snap") == SUCCESS);
+    for(i = 0; i < 500; i++) {
+      sprintf(aacPaths[i], "1root/2d%d/3f%d", i % 23, i);
+      assert(FT_insertFileIn(oFTree, aacPaths[i], aacPaths[i],
+                             strlen(aacPaths[i]) + 1) == SUCCESS);
+    }
+    assert((temp = FT_toStringIn(oFTree)) != NULL);
+    assert(FT_beginSaveIn(oFTree, "ft_client.snap") == SUCCESS);
+    assert(FT_rmDirIn(oFTree, "1root/2d4") == SUCCESS);
+    assert(FT_insertDirIn(oFTree, "1root/2d0/3new") == SUCCESS);
+    assert(FT_replaceFileContentsIn(oFTree, aacPaths[1], NULL, 0) ==
+           aacPaths[1]);
+    assert(FT_endSaveIn(oFTree) == SUCCESS);
+    assert(FT_endSaveIn(oFTree) == SUCCESS);
+    assert((psFile = fopen("ft_client.snap.tmp", "rb")) == NULL);
+    assert(FT_newFromFile("ft_client.snap", &oFTree2, &pvContents) ==
+           SUCCESS);
+    assert((temp2 = FT_toStringIn(oFTree2)) != NULL);
+    assert(!strcmp(temp, temp2));
+    assert(!strcmp(FT_getFileContentsIn(oFTree2, aacPaths[1]),
+                   aacPaths[1]));
+    free(temp2);
+    free(temp);
+    FT_free(oFTree2);
+    free(pvContents);
+
+    /* a second save waits for the first, and FT_free for the last */
+    assert(FT_beginSaveIn(oFTree, "ft_client.snap") == SUCCESS);
+    assert(FT_rmDirIn(oFTree, "1root/2d5") == SUCCESS);
+    assert((temp = FT_toStringIn(oFTree)) != NULL);
+    assert(FT_beginSaveIn(oFTree, "ft_client.snap") == SUCCESS);
+    FT_free(oFTree);
+    assert(FT_newFromFile("ft_client.snap", &oFTree2, &pvContents) ==
+           SUCCESS);
+    assert((temp2 = FT_toStringIn(oFTree2)) != NULL);
+    assert(!strcmp(temp, temp2));
+    free(temp2);
+    free(temp);
+    FT_free(oFTree2);
+    free(pvContents);
+
+    /* a failed save leaves the old file as it was */
+    assert((oFTree = FT_new()) != NULL);
+    assert(FT_beginSaveIn(oFTree, "ft_client.none/snap") == SUCCESS);
+    assert(FT_endSaveIn(oFTree) == IO_ERROR);
+    assert(FT_insertDirIn(oFTree, "1root") == SUCCESS);
+    FT_free(oFTree);
+
+    /* a concurrent tree saved while threads insert into it */
+    assert((oFTree = FT_newConcurrent()) != NULL);
+    assert(FT_insertDirIn(oFTree, "1root/2base") == SUCCESS);
+    assert((temp = FT_toStringIn(oFTree)) != NULL);
+    assert(FT_beginSaveIn(oFTree, "ft_client.snap") == SUCCESS);
+    for(i = 0; i < NUM_THREADS; i++) {
+      asWorkers[i].oFTree = oFTree;
+      asWorkers[i].cDigit = (char) ('0' + i);
+      assert(pthread_create(&aoThreads[i], NULL, worker,
+                            &asWorkers[i]) == 0);
+    }
+    assert(FT_endSaveIn(oFTree) == SUCCESS);
+    for(i = 0; i < NUM_THREADS; i++)
+      assert(pthread_join(aoThreads[i], NULL) == 0);
+    assert(FT_newFromFile("ft_client.snap", &oFTree2, &pvContents) ==
+           SUCCESS);
+    assert((temp2 = FT_toStringIn(oFTree2)) != NULL);
+    assert(!strcmp(temp, temp2));
+    free(temp2);
+    free(temp);
+    FT_free(oFTree2);
+    free(pvContents);
+    FT_free(oFTree);
+
+    /* the default File Tree */
+    assert(FT_beginSave("ft_client.snap") == INITIALIZATION_ERROR);
+    assert(FT_endSave() == INITIALIZATION_ERROR);
+    assert(FT_init() == SUCCESS);
+    assert(FT_insertDir("1root/2a") == SUCCESS);
+    assert(FT_beginSave("ft_client.snap") == SUCCESS);
+    assert(FT_insertDir("1root/2b") == SUCCESS);
+    assert(FT_endSave() == SUCCESS);
+    assert(FT_destroy() == SUCCESS);
+    assert(FT_load("ft_client.snap", &pvContents) == SUCCESS);
+    assert(FT_containsDir("1root/2a"));
+    assert(!FT_containsDir("1root/2b"));
+    assert(FT_destroy() == SUCCESS);
+    free(pvContents);
+    assert(remove("ft_client.snap") == 0);
+  }
+
+  /* A tree frozen with FT_freezeIn answers lookups as it did before,
+     whatever prefixes its names share, and is read-only */
+  {
+    FT_T oFTree, oFTree2, oFSnapshot;
+    struct FT_Op asOps[4];
+    char aacPaths[300][40];
+    char acPath[48];
+    char *temp2;
+    boolean bIsFile2;
+    size_t l2;
+    int i;
+
+    assert((oFTree = FT_new()) != NULL);
+    assert((oFTree2 = FT_new()) != NULL);
+    assert(FT_freezeIn(oFTree2) == SUCCESS);
+    assert((temp = FT_toStringIn(oFTree2)) != NULL);
+    assert(!strcmp(temp, ""));
+    free(temp);
+    assert(FT_statIn(oFTree2, "1root", &bIsFile, &l) == NO_SUCH_PATH);
+    FT_free(oFTree2);
+
+    /* siblings that share long prefixes, in blocks and across them */
+    assert((oFTree2 = FT_new()) != NULL);
+    for(i = 0; i < 300; i++) {
+      sprintf(aacPaths[i], "1root/2log-2026-%02d/3log-2026-10-%03d%s",
+              i % 3, i, i % 7 == 0 ? "" : ".txt");
+      assert(FT_insertFileIn(oFTree, aacPaths[i], aacPaths[i],
+                             strlen(aacPaths[i]) + 1) == SUCCESS);
+      assert(FT_insertFileIn(oFTree2, aacPaths[i], aacPaths[i],
+                             strlen(aacPaths[i]) + 1) == SUCCESS);
+    }
+    assert(FT_insertDirIn(oFTree, "1root/2log-2026-0") == SUCCESS);
+    assert(FT_insertDirIn(oFTree2, "1root/2log-2026-0") == SUCCESS);
+    assert((temp = FT_toStringIn(oFTree)) != NULL);
+    assert(FT_freezeIn(oFTree2) == SUCCESS);
+    assert((temp2 = FT_toStringIn(oFTree2)) != NULL);
+    assert(!strcmp(temp, temp2));
+    free(temp2);
+    free(temp);
+    for(i = 0; i < 300; i++) {
+      assert(FT_containsFileIn(oFTree2, aacPaths[i]));
+      assert(!FT_containsDirIn(oFTree2, aacPaths[i]));
+      assert(FT_getFileContentsIn(oFTree2, aacPaths[i]) ==
+             aacPaths[i]);
+      /* a prefix, an extension and a neighbour of each name */
+      strcpy(acPath, aacPaths[i]);
+      acPath[strlen(acPath) - 1] = '\0';
+      assert(FT_statIn(oFTree, acPath, &bIsFile, &l) ==
+             FT_statIn(oFTree2, acPath, &bIsFile2, &l2));
+      strcat(strcpy(acPath, aacPaths[i]), "0");
+      assert(!FT_containsFileIn(oFTree2, acPath));
+      strcat(strcpy(acPath, aacPaths[i]), "/4x");
+      assert(FT_statIn(oFTree2, acPath, &bIsFile2, &l2) ==
+             NO_SUCH_PATH);
+    }
+    assert(FT_statIn(oFTree2, "1root/2log-2026-01", &bIsFile2, &l2) ==
+           SUCCESS);
+    assert(!bIsFile2);
+    assert(FT_containsDirIn(oFTree2, "1root/2log-2026-0"));
+    assert(!FT_containsDirIn(oFTree2, "1root/2log-2026-"));
+    assert(!FT_containsDirIn(oFTree2, "1root/2log-2026-03"));
+    assert(FT_statIn(oFTree2, "1root", &bIsFile2, &l2) == SUCCESS);
+    assert(FT_statIn(oFTree2, "1roo", &bIsFile2, &l2) ==
+           CONFLICTING_PATH);
+    assert(FT_statIn(oFTree2, "1root/", &bIsFile2, &l2) == BAD_PATH);
+    asOps[0].eKind = FT_OP_GET_CONTENTS;
+    asOps[0].pcPath = aacPaths[5];
+    asOps[1].eKind = FT_OP_STAT;
+    asOps[1].pcPath = "1root/2log-2026-02";
+    asOps[2].eKind = FT_OP_GET_CONTENTS;
+    asOps[2].pcPath = "1root/2log-2026-02";
+    asOps[3].eKind = FT_OP_STAT;
+    asOps[3].pcPath = "1root/2none";
+    assert(FT_lookupMany(oFTree2, asOps, 4) == SUCCESS);
+    assert(asOps[0].iStatus == SUCCESS &&
+           asOps[0].pvResult == aacPaths[5]);
+    assert(asOps[1].iStatus == SUCCESS && !asOps[1].bIsFile);
+    assert(asOps[2].iStatus == NOT_A_FILE);
+    assert(asOps[3].iStatus == NO_SUCH_PATH);
+
+    /* a frozen tree changes no more */
+    assert(FT_insertDirIn(oFTree2, "1root/2new") == READ_ONLY_TREE);
+    assert(FT_insertFileIn(oFTree2, "1root/2new", NULL, 0) ==
+           READ_ONLY_TREE);
+    assert(FT_rmDirIn(oFTree2, "1root/2log-2026-00") == READ_ONLY_TREE);
+    assert(FT_rmFileIn(oFTree2, aacPaths[0]) == READ_ONLY_TREE);
+    assert(FT_replaceFileContentsIn(oFTree2, aacPaths[0], NULL, 0) ==
+           NULL);
+    assert(FT_saveIn(oFTree2, "ft_client.snap") == READ_ONLY_TREE);
+    assert(FT_saveImageIn(oFTree2, "ft_client.img") == READ_ONLY_TREE);
+    assert(FT_snapshotIn(oFTree2, &oFSnapshot) == READ_ONLY_TREE);
+    assert(FT_freezeIn(oFTree2) == READ_ONLY_TREE);
+    FT_free(oFTree2);
+
+    /* a concurrent tree, and a tree with a live snapshot */
+    assert((oFTree2 = FT_newConcurrent()) != NULL);
+    assert(FT_insertFileIn(oFTree2, aacPaths[0], NULL, 0) == SUCCESS);
+    assert(FT_freezeIn(oFTree2) == SUCCESS);
+    assert(FT_containsFileIn(oFTree2, aacPaths[0]));
+    assert(FT_insertDirIn(oFTree2, "1root/2new") == READ_ONLY_TREE);
+    FT_free(oFTree2);
+    assert(FT_snapshotIn(oFTree, &oFSnapshot) == SUCCESS);
+    assert(FT_freezeIn(oFSnapshot) == READ_ONLY_TREE);
+    assert(FT_freezeIn(oFTree) == SUCCESS);
+    assert(FT_containsFileIn(oFSnapshot, aacPaths[1]));
+    assert(FT_containsFileIn(oFTree, aacPaths[1]));
+    FT_free(oFSnapshot);
+    FT_free(oFTree);
+
+    /* a wide and deep hierarchy, whose shape spans many words */
+    assert((oFTree = FT_new()) != NULL);
+    assert((oFTree2 = FT_new()) != NULL);
+    for(i = 0; i < 2000; i++) {
+      sprintf(acPath, "1root/2d%d/3d%d/4d%d/5f%d", i % 37, i % 11,
+              i % 5, i);
+      if(i % 3 == 0)
+        acPath[strlen(acPath) - strlen(strrchr(acPath, '/'))] = '\0';
+      assert(FT_insertFileIn(oFTree, acPath, NULL, (size_t) i) ==
+             FT_insertFileIn(oFTree2, acPath, NULL, (size_t) i));
+    }
+    assert(FT_insertDirIn(oFTree, "1root/2d0/3e") == SUCCESS);
+    assert(FT_insertDirIn(oFTree2, "1root/2d0/3e") == SUCCESS);
+    assert(FT_freezeIn(oFTree2) == SUCCESS);
+    assert((temp = FT_toStringIn(oFTree)) != NULL);
+    assert((temp2 = FT_toStringIn(oFTree2)) != NULL);
+    assert(!strcmp(temp, temp2));
+    free(temp2);
+    free(temp);
+    for(i = 0; i < 2000; i++) {
+      sprintf(acPath, "1root/2d%d/3d%d/4d%d/5f%d", i % 37, i % 11,
+              i % 5, i);
+      if(FT_statIn(oFTree, acPath, &bIsFile, &l) == SUCCESS) {
+        assert(FT_statIn(oFTree2, acPath, &bIsFile2, &l2) == SUCCESS);
+        assert(bIsFile2 && l2 == l);
+      }
+      else
+        assert(!FT_containsFileIn(oFTree2, acPath));
+      *strrchr(acPath, '/') = '\0';
+      assert(FT_containsDirIn(oFTree, acPath) ==
+             FT_containsDirIn(oFTree2, acPath));
+      assert(FT_containsFileIn(oFTree, acPath) ==
+             FT_containsFileIn(oFTree2, acPath));
+    }
+    assert(FT_containsDirIn(oFTree2, "1root/2d0/3e"));
+    assert(FT_statIn(oFTree2, "1root/2d0/3e/4x", &bIsFile2, &l2) ==
+           NO_SUCH_PATH);
+    FT_free(oFTree2);
+    FT_free(oFTree);
+
+    /* the default File Tree */
+    assert(FT_freeze() == INITIALIZATION_ERROR);
+    assert(FT_init() == SUCCESS);
+    assert(FT_insertDir("1root/2a") == SUCCESS);
+    assert(FT_freeze() == SUCCESS);
+    assert(FT_containsDir("1root/2a"));
+    assert(FT_insertDir("1root/2b") == READ_ONLY_TREE);
+    assert(FT_destroy() == SUCCESS);
+    assert(FT_init() == SUCCESS);
+    assert(FT_insertDir("1root/2b") == SUCCESS);
+    assert(FT_destroy() == SUCCESS);
+  }
+
+  return 0;
+}
@@ -0,0 +1,895 @@
+/*--------------------------------------------------------------------*/
+/* ftfrozen.c                                                         */
+/* Author: Ishaan Javali & Jack Zhang                                 */
+/*--------------------------------------------------------------------*/
+
+#include <assert.h>
+#include <limits.h>
+#include <stdlib.h>
+#include <string.h>
+#include "path.h"
+#include "dynarray.h"
+#include "ftfrozen.h"
+
+/* The number of names in a block of front-coded names. */
+enum { FTFROZEN_BLOCK = 16 };
+
+/*
+  The number of bits in a word of a bit vector, and the number of
+  words that share an entry of its rank directory.
+*/
+enum { FTFROZEN_WORD_BITS = CHAR_BIT * sizeof(unsigned long),
+       FTFROZEN_RANK_WORDS = 8 };
+
+/* A bit vector that counts its 1 bits up to any position quickly. */
+struct FTFrozen_Bits {
+   /* the bits, least significant first in each word */
+   unsigned long *aulWords;
+   /* the number of 1 bits before each run of FTFROZEN_RANK_WORDS
+      words */
+   size_t *aulRanks;
+   /* the number of bits */
+   size_t ulLength;
+};
+
+/* A file's contents, as the node held them. */
+struct FTFrozen_Contents {
+   /* the contents, or NULL, and their length */
+   void *pvContents;
+   size_t ulLength;
+};
+
+/*
+  A frozen hierarchy is an ADT with 7 state variables. Its nodes are
+  numbered from 0 in breadth-first order, and no node is stored as
+  such: each is a position in the bit vectors, which hold the shape
+  of the hierarchy in about 4 bits per node.
+*/
+struct FTFrozen {
+   /* 1. the number of nodes */
+   size_t ulNumNodes;
+   /* 2. the shape of the hierarchy, in level-order unary degree
+      sequence: 1 then 0 for a virtual parent of the root, then for
+      each node in order, a 1 for each of its children and then a 0 */
+   struct FTFrozen_Bits sShape;
+   /* 3. a 1 for each node that is a file */
+   struct FTFrozen_Bits sFiles;
+   /* 4. a 1 for each node whose name starts a block */
+   struct FTFrozen_Bits sBlocks;
+   /* 5. the contents of each file, in the order of the nodes */
+   struct FTFrozen_Contents *psContents;
+   /* 6. the front-coded names: the root's, then, for each directory
+      in order, its files' and then its directories' */
+   unsigned char *pucNames;
+   /* 7. the offset in pucNames of the first name of each block */
+   size_t *aulRestarts;
+};
+
+/*
+  Sets *psBits to ulLength 0 bits, without a rank directory yet.
+  Returns TRUE, or FALSE if memory could not be allocated.
+*/
+static boolean FTFrozen_newBits(struct FTFrozen_Bits *psBits,
+                                size_t ulLength) {
+   assert(psBits != NULL);
+
+   psBits->ulLength = ulLength;
+   psBits->aulRanks = NULL;
+   psBits->aulWords = calloc(ulLength / FTFROZEN_WORD_BITS + 1,
+                             sizeof(unsigned long));
+   return (boolean) (psBits->aulWords != NULL);
+}
+
+/* Frees the bits and rank directory of *psBits. */
+static void FTFrozen_freeBits(struct FTFrozen_Bits *psBits) {
+   assert(psBits != NULL);
+
+   free(psBits->aulWords);
+   free(psBits->aulRanks);
+}
+
+/* Sets bit ulPosition of *psBits to 1. */
+static void FTFrozen_setBit(struct FTFrozen_Bits *psBits,
+                            size_t ulPosition) {
+   assert(psBits != NULL);
+   assert(ulPosition < psBits->ulLength);
+
+   psBits->aulWords[ulPosition / FTFROZEN_WORD_BITS] |=
+      1UL << (ulPosition % FTFROZEN_WORD_BITS);
+}
+
+/* Returns bit ulPosition of *psBits. */
+static boolean FTFrozen_getBit(const struct FTFrozen_Bits *psBits,
+                               size_t ulPosition) {
+   assert(psBits != NULL);
+   assert(ulPosition < psBits->ulLength);
+
+   return (boolean) ((psBits->aulWords[ulPosition / FTFROZEN_WORD_BITS]
+                      >> (ulPosition % FTFROZEN_WORD_BITS)) & 1);
+}
+
+/*
+  Builds the rank directory of *psBits, once its bits are set.
+  Returns TRUE, or FALSE if memory could not be allocated.
+*/
+static boolean FTFrozen_indexBits(struct FTFrozen_Bits *psBits) {
+   size_t ulNumWords;
+   size_t ulOnes = 0;
+   size_t i;
+
+   assert(psBits != NULL);
+
+   ulNumWords = psBits->ulLength / FTFROZEN_WORD_BITS + 1;
+   psBits->aulRanks = malloc((ulNumWords / FTFROZEN_RANK_WORDS + 1) *
+                             sizeof(size_t));
+   if(psBits->aulRanks == NULL)
+      return FALSE;
+   for(i = 0; i < ulNumWords; i++) {
+      if(i % FTFROZEN_RANK_WORDS == 0)
+         psBits->aulRanks[i / FTFROZEN_RANK_WORDS] = ulOnes;
+      ulOnes += (size_t) __builtin_popcountl(psBits->aulWords[i]);
+   }
+   return TRUE;
+}
+
+/*
+  Returns the number of 1 bits of *psBits before position ulPosition,
+  which may be its length: the entry of the rank directory, plus at
+  most FTFROZEN_RANK_WORDS words counted.
+*/
+static size_t FTFrozen_rank(const struct FTFrozen_Bits *psBits,
+                            size_t ulPosition) {
+   size_t ulWord;
+   size_t ulRank;
+   size_t i;
+
+   assert(psBits != NULL);
+   assert(ulPosition <= psBits->ulLength);
+
+   ulWord = ulPosition / FTFROZEN_WORD_BITS;
+   ulRank = psBits->aulRanks[ulWord / FTFROZEN_RANK_WORDS];
+   for(i = ulWord - ulWord % FTFROZEN_RANK_WORDS; i < ulWord; i++)
+      ulRank += (size_t) __builtin_popcountl(psBits->aulWords[i]);
+   if(ulPosition % FTFROZEN_WORD_BITS != 0)
+      ulRank += (size_t) __builtin_popcountl(psBits->aulWords[ulWord] &
+                   ((1UL << (ulPosition % FTFROZEN_WORD_BITS)) - 1));
+   return ulRank;
+}
+
+/*
+  Returns the position of the ulCount-th 0 bit of *psBits, counting
+  from 1, which must exist: binary searches the rank directory for
+  the run of words that holds it, then counts through the run.
+*/
+static size_t FTFrozen_select0(const struct FTFrozen_Bits *psBits,
+                               size_t ulCount) {
+   size_t ulLo = 0;
+   size_t ulHi;
+   size_t ulMid;
+   size_t ulWord;
+   size_t ulZeros;
+   unsigned long ulBits;
+
+   assert(psBits != NULL);
+   assert(ulCount > 0);
+
+   /* the last run with fewer than ulCount 0 bits before it */
+   ulHi = (psBits->ulLength / FTFROZEN_WORD_BITS + 1 +
+           FTFROZEN_RANK_WORDS - 1) / FTFROZEN_RANK_WORDS;
+   while(ulHi - ulLo > 1) {
+      ulMid = ulLo + (ulHi - ulLo) / 2;
+      if(ulMid * FTFROZEN_RANK_WORDS * FTFROZEN_WORD_BITS -
+         psBits->aulRanks[ulMid] < ulCount)
+         ulLo = ulMid;
+      else
+         ulHi = ulMid;
+   }
+
+   ulWord = ulLo * FTFROZEN_RANK_WORDS;
+   ulCount -= ulWord * FTFROZEN_WORD_BITS - psBits->aulRanks[ulLo];
+   for(;;) {
+      ulBits = ~psBits->aulWords[ulWord];
+      ulZeros = (size_t) __builtin_popcountl(ulBits);
+      if(ulZeros >= ulCount)
+         break;
+      ulCount -= ulZeros;
+      ulWord++;
+   }
+   /* clear the 0 bits before the one wanted */
+   while(--ulCount > 0)
+      ulBits &= ulBits - 1;
+   return ulWord * FTFROZEN_WORD_BITS + (size_t) __builtin_ctzl(ulBits);
+}
+
+/*
+  Sets *pulFirst to the number of the first child of node ulNode of
+  oFrozen, and *pulNumFiles and *pulNumDirs to its numbers of file and
+  directory children, which follow that child in that order. In the
+  shape, the node's 1 bits lie between the (ulNode + 1)-th 0 bit and
+  the next, and each child is numbered by the 1 bits before its own.
+*/
+static void FTFrozen_getChildren(FTFrozen_T oFrozen, size_t ulNode,
+                                 size_t *pulFirst,
+                                 size_t *pulNumFiles,
+                                 size_t *pulNumDirs) {
+   size_t ulStart;
+   size_t ulNumChildren;
+
+   assert(oFrozen != NULL);
+   assert(ulNode < oFrozen->ulNumNodes);
+   assert(pulFirst != NULL);
+   assert(pulNumFiles != NULL);
+   assert(pulNumDirs != NULL);
+
+   ulStart = FTFrozen_select0(&oFrozen->sShape, ulNode + 1);
+   ulNumChildren = FTFrozen_select0(&oFrozen->sShape, ulNode + 2) -
+                   ulStart - 1;
+   /* the 1 bits before ulStart + 1 are the nodes before the child */
+   *pulFirst = ulStart - ulNode;
+   *pulNumFiles = FTFrozen_rank(&oFrozen->sFiles,
+                                *pulFirst + ulNumChildren) -
+                  FTFrozen_rank(&oFrozen->sFiles, *pulFirst);
+   *pulNumDirs = ulNumChildren - *pulNumFiles;
+}
+
+/*
+  Stores ulValue at pucOut, seven bits to a byte, least significant
+  first, with the top bit of each byte but the last set, unless
+  pucOut is NULL. Returns the number of bytes it takes either way.
+*/
+static size_t FTFrozen_putNumber(unsigned char *pucOut,
+                                 size_t ulValue) {
+   size_t ulBytes = 0;
+
+   do {
+      if(pucOut != NULL)
+         pucOut[ulBytes] = (unsigned char)
+            ((ulValue & 0x7f) | (ulValue > 0x7f ? 0x80 : 0));
+      ulBytes++;
+      ulValue >>= 7;
+   } while(ulValue != 0);
+   return ulBytes;
+}
+
+/*
+  Returns the number that FTFrozen_putNumber stored at *ppucIn, and
+  advances *ppucIn past it.
+*/
+static size_t FTFrozen_getNumber(const unsigned char **ppucIn) {
+   size_t ulValue = 0;
+   unsigned int uShift = 0;
+   unsigned char ucByte;
+
+   assert(ppucIn != NULL);
+
+   do {
+      ucByte = *(*ppucIn)++;
+      ulValue |= (size_t) (ucByte & 0x7f) << uShift;
+      uShift += 7;
+   } while((ucByte & 0x80) != 0);
+   return ulValue;
+}
+
+/*
+  Decodes the name at *ppucName, which is name ulPosition of its
+  sorted run of sibling names, and advances *ppucName past it. Sets
+  *pulShared to the length of the prefix that it shares with the name
+  before it, or to 0 if it starts a block, and *pulSuffix to the
+  length of the rest of it, and returns the rest, which is not
+  terminated.
+*/
+static const unsigned char *FTFrozen_nextName(
+   const unsigned char **ppucName, size_t ulPosition,
+   size_t *pulShared, size_t *pulSuffix) {
+   const unsigned char *pucSuffix;
+
+   assert(ppucName != NULL);
+   assert(pulShared != NULL);
+   assert(pulSuffix != NULL);
+
+   *pulShared = 0;
+   if(ulPosition % FTFROZEN_BLOCK != 0)
+      *pulShared = FTFrozen_getNumber(ppucName);
+   *pulSuffix = FTFrozen_getNumber(ppucName);
+   pucSuffix = *ppucName;
+   *ppucName += *pulSuffix;
+   return pucSuffix;
+}
+
+/*
+  Searches the ulCount sorted names that start with block ulFirstBlock
+  of oFrozen for the ulLength-byte name pcName. Binary searches the
+  blocks' first names for the last that does not sort after pcName,
+  then scans that block. Along the scan, ulMatch is the length of the
+  prefix that the name last decoded, which sorts before pcName,
+  shares with pcName: a name that shares more with its predecessor
+  also sorts before pcName, one that shares less sorts after it, and
+  only one that shares exactly ulMatch needs its rest compared.
+  Returns TRUE and sets *pulResult to the name's position among the
+  ulCount if it is found, or returns FALSE otherwise.
+*/
+static boolean FTFrozen_search(FTFrozen_T oFrozen, size_t ulFirstBlock,
+                               size_t ulCount, const char *pcName,
+                               size_t ulLength, size_t *pulResult) {
+   const unsigned char *pucName;
+   const unsigned char *pucSuffix;
+   size_t ulLo = 0;
+   size_t ulHi = (ulCount + FTFROZEN_BLOCK - 1) / FTFROZEN_BLOCK;
+   size_t ulMid;
+   size_t ulShared;
+   size_t ulSuffix;
+   size_t ulMatch;
+   size_t ulEnd;
+   int iCompare;
+   size_t i;
+
+   assert(oFrozen != NULL);
+   assert(pcName != NULL);
+   assert(pulResult != NULL);
+
+   while(ulLo < ulHi) {
+      ulMid = ulLo + (ulHi - ulLo) / 2;
+      pucName = &oFrozen->pucNames[
+                   oFrozen->aulRestarts[ulFirstBlock + ulMid]];
+      ulSuffix = FTFrozen_getNumber(&pucName);
+      iCompare = memcmp(pcName, pucName,
+                        ulLength < ulSuffix ? ulLength : ulSuffix);
+      if(iCompare == 0 && ulLength != ulSuffix)
+         iCompare = ulLength < ulSuffix ? -1 : 1;
+      if(iCompare == 0) {
+         *pulResult = ulMid * FTFROZEN_BLOCK;
+         return TRUE;
+      }
+      if(iCompare < 0)
+         ulHi = ulMid;
+      else
+         ulLo = ulMid + 1;
+   }
+   if(ulLo == 0)
+      return FALSE;
+
+   ulMid = ulLo - 1;
+   pucName = &oFrozen->pucNames[oFrozen->aulRestarts[ulFirstBlock +
+                                                     ulMid]];
+   pucSuffix = FTFrozen_nextName(&pucName, 0, &ulShared, &ulSuffix);
+   for(ulMatch = 0; ulMatch < ulSuffix && ulMatch < ulLength &&
+       pucSuffix[ulMatch] == (unsigned char) pcName[ulMatch]; ulMatch++)
+      ;
+   ulEnd = ulCount - ulMid * FTFROZEN_BLOCK;
+   if(ulEnd > FTFROZEN_BLOCK)
+      ulEnd = FTFROZEN_BLOCK;
+   for(i = 1; i < ulEnd; i++) {
+      pucSuffix = FTFrozen_nextName(&pucName, i, &ulShared, &ulSuffix);
+      if(ulShared > ulMatch)
+         continue;
+      if(ulShared < ulMatch)
+         return FALSE;
+      for(ulShared = 0; ulShared < ulSuffix &&
+          ulMatch + ulShared < ulLength &&
+          pucSuffix[ulShared] == (unsigned char) pcName[ulMatch +
+                                                         ulShared];
+          ulShared++)
+         ;
+      if(ulShared == ulSuffix && ulMatch + ulShared == ulLength) {
+         *pulResult = ulMid * FTFROZEN_BLOCK + i;
+         return TRUE;
+      }
+      /* the name, unless it is a prefix of pcName, differs from
+         pcName at ulMatch + ulShared */
+      if(ulShared < ulSuffix &&
+         (ulMatch + ulShared == ulLength ||
+          pucSuffix[ulShared] > (unsigned char) pcName[ulMatch +
+                                                       ulShared]))
+         return FALSE;
+      ulMatch += ulShared;
+   }
+   return FALSE;
+}
+
+/*
+  Looks up pcPath in oFrozen, as FT_findNode does in a File Tree but
+  looking for a file and then a directory at the last component.
+  Returns SUCCESS and sets *pulResult to the node's index, or returns
+  BAD_PATH, NO_SUCH_PATH or CONFLICTING_PATH as FT_statIn does.
+*/
+static int FTFrozen_find(FTFrozen_T oFrozen, const char *pcPath,
+                         size_t *pulResult) {
+   const char *pcComponent = pcPath;
+   const char *pcEnd;
+   size_t ulLength;
+   size_t ulNode = 0;
+   size_t ulPosition;
+   size_t ulFirst;
+   size_t ulNumFiles;
+   size_t ulNumDirs;
+
+   assert(oFrozen != NULL);
+   assert(pcPath != NULL);
+   assert(pulResult != NULL);
+
+   /* the same well-formedness rules as Path_new */
+   if(*pcPath == '\0' || *pcPath == '/')
+      return BAD_PATH;
+   for(pcEnd = pcPath; *pcEnd != '\0'; pcEnd++)
+      if(*pcEnd == '/' && (pcEnd[1] == '/' || pcEnd[1] == '\0'))
+         return BAD_PATH;
+
+   if(oFrozen->ulNumNodes == 0)
+      return NO_SUCH_PATH;
+
+   /* the root's name is the only name in block 0 */
+   pcEnd = strchr(pcComponent, '/');
+   ulLength = pcEnd == NULL ? strlen(pcComponent) :
+                              (size_t) (pcEnd - pcComponent);
+   if(!FTFrozen_search(oFrozen, 0, 1, pcComponent, ulLength,
+                       &ulPosition))
+      return CONFLICTING_PATH;
+
+   while(pcEnd != NULL) {
+      pcComponent = pcEnd + 1;
+      pcEnd = strchr(pcComponent, '/');
+      ulLength = pcEnd == NULL ? strlen(pcComponent) :
+                                 (size_t) (pcEnd - pcComponent);
+      if(FTFrozen_getBit(&oFrozen->sFiles, ulNode))
+         return NO_SUCH_PATH;
+      FTFrozen_getChildren(oFrozen, ulNode, &ulFirst, &ulNumFiles,
+                           &ulNumDirs);
+      /* each run of sibling names starts a block */
+      if(pcEnd == NULL && ulNumFiles != 0 &&
+         FTFrozen_search(oFrozen,
+                         FTFrozen_rank(&oFrozen->sBlocks, ulFirst),
+                         ulNumFiles, pcComponent, ulLength,
+                         &ulPosition)) {
+         ulNode = ulFirst + ulPosition;
+         break;
+      }
+      if(ulNumDirs == 0 ||
+         !FTFrozen_search(oFrozen,
+                          FTFrozen_rank(&oFrozen->sBlocks,
+                                        ulFirst + ulNumFiles),
+                          ulNumDirs, pcComponent, ulLength,
+                          &ulPosition))
+         return NO_SUCH_PATH;
+      ulNode = ulFirst + ulNumFiles + ulPosition;
+   }
+
+   *pulResult = ulNode;
+   return SUCCESS;
+}
+
+/*
+  Returns the name of oNNode, the last component of its path, and
+  sets *pulLength to its length.
+*/
+static const char *FTFrozen_nodeName(Node_T oNNode,
+                                     size_t *pulLength) {
+   Path_T oPPath;
+   const char *pcName;
+
+   assert(oNNode != NULL);
+   assert(pulLength != NULL);
+
+   oPPath = Node_getPath(oNNode);
+   pcName = Path_getComponent(oPPath, Path_getDepth(oPPath) - 1);
+   *pulLength = strlen(pcName);
+   return pcName;
+}
+
+/*
+  Appends the nodes of the hierarchy rooted at oNRoot to oDNodes in
+  breadth-first order, each node's children in the order of
+  Node_getChild: files, then directories. Returns SUCCESS, or
+  MEMORY_ERROR if oDNodes could not grow.
+*/
+static int FTFrozen_gatherNodes(Node_T oNRoot, DynArray_T oDNodes) {
+   Node_T oNNode;
+   Node_T oNChild;
+   size_t ulNumFiles;
+   size_t ulNumChildren;
+   size_t ulNext;
+   size_t i;
+
+   assert(oNRoot != NULL);
+   assert(oDNodes != NULL);
+
+   if(!DynArray_add(oDNodes, oNRoot))
+      return MEMORY_ERROR;
+   for(ulNext = 0; ulNext < DynArray_getLength(oDNodes); ulNext++) {
+      oNNode = DynArray_get(oDNodes, ulNext);
+      if(Node_isFile(oNNode))
+         continue;
+      ulNumFiles = Node_getNumFileChildren(oNNode);
+      ulNumChildren = ulNumFiles + Node_getNumDirChildren(oNNode);
+      for(i = 0; i < ulNumChildren; i++) {
+         (void) Node_getChild(oNNode, i < ulNumFiles ? i :
+                              i - ulNumFiles, (boolean) (i < ulNumFiles),
+                              &oNChild);
+         if(!DynArray_add(oDNodes, oNChild))
+            return MEMORY_ERROR;
+      }
+   }
+   return SUCCESS;
+}
+
+/*
+  Front-codes the names of the ulCount nodes of oDNodes starting at
+  ulFirst, which are sorted, at offset ulOffset of pucOut, recording
+  the offset of each block's first name in aulRestarts from
+  aulRestarts[*pulBlock] on and advancing *pulBlock past them. If
+  pucOut is NULL, only measures them and advances *pulBlock. Returns
+  the offset just past them.
+*/
+static size_t FTFrozen_encodeNames(DynArray_T oDNodes, size_t ulFirst,
+                                   size_t ulCount,
+                                   unsigned char *pucOut,
+                                   size_t ulOffset,
+                                   size_t *aulRestarts,
+                                   size_t *pulBlock) {
+   const char *pcName;
+   const char *pcPrevious = NULL;
+   size_t ulLength;
+   size_t ulPreviousLength = 0;
+   size_t ulShared;
+   size_t i;
+
+   assert(oDNodes != NULL);
+   assert(pulBlock != NULL);
+
+   for(i = 0; i < ulCount; i++) {
+      pcName = FTFrozen_nodeName(DynArray_get(oDNodes, ulFirst + i),
+                                 &ulLength);
+      ulShared = 0;
+      if(i % FTFROZEN_BLOCK == 0) {
+         if(aulRestarts != NULL)
+            aulRestarts[*pulBlock] = ulOffset;
+         (*pulBlock)++;
+      }
+      else {
+         while(ulShared < ulLength && ulShared < ulPreviousLength &&
+               pcName[ulShared] == pcPrevious[ulShared])
+            ulShared++;
+         ulOffset += FTFrozen_putNumber(pucOut == NULL ? NULL :
+                                        &pucOut[ulOffset], ulShared);
+      }
+      ulOffset += FTFrozen_putNumber(pucOut == NULL ? NULL :
+                                     &pucOut[ulOffset],
+                                     ulLength - ulShared);
+      if(pucOut != NULL)
+         memcpy(&pucOut[ulOffset], pcName + ulShared,
+                ulLength - ulShared);
+      ulOffset += ulLength - ulShared;
+      pcPrevious = pcName;
+      ulPreviousLength = ulLength;
+   }
+   return ulOffset;
+}
+
+/*
+  Front-codes the names of the nodes in oDNodes, which are in
+  breadth-first order, into pucOut and records the blocks' first
+  names in aulRestarts, as FTFrozen_encodeNames does. Returns the
+  size of the names.
+*/
+static size_t FTFrozen_encode(DynArray_T oDNodes, unsigned char *pucOut,
+                              size_t *aulRestarts) {
+   Node_T oNNode;
+   size_t ulNumNodes;
+   size_t ulNumFiles;
+   size_t ulNextChild = 1;
+   size_t ulBlock = 0;
+   size_t ulOffset;
+   size_t i;
+
+   assert(oDNodes != NULL);
+
+   ulNumNodes = DynArray_getLength(oDNodes);
+   ulOffset = FTFrozen_encodeNames(oDNodes, 0, ulNumNodes == 0 ? 0 : 1,
+                                   pucOut, 0, aulRestarts, &ulBlock);
+   for(i = 0; i < ulNumNodes; i++) {
+      oNNode = DynArray_get(oDNodes, i);
+      if(Node_isFile(oNNode))
+         continue;
+      ulNumFiles = Node_getNumFileChildren(oNNode);
+      ulOffset = FTFrozen_encodeNames(oDNodes, ulNextChild, ulNumFiles,
+                                      pucOut, ulOffset, aulRestarts,
+                                      &ulBlock);
+      ulNextChild += ulNumFiles;
+      ulOffset = FTFrozen_encodeNames(oDNodes, ulNextChild,
+                                      Node_getNumDirChildren(oNNode),
+                                      pucOut, ulOffset, aulRestarts,
+                                      &ulBlock);
+      ulNextChild += Node_getNumDirChildren(oNNode);
+   }
+   return ulOffset;
+}
+
+/*
+  Sets the bits of oFrozen for the nodes in oDNodes, which are in
+  breadth-first order, and copies their contents into
+  oFrozen->psContents, then builds the bits' rank directories.
+  Returns SUCCESS, or MEMORY_ERROR.
+*/
+static int FTFrozen_describe(FTFrozen_T oFrozen, DynArray_T oDNodes) {
+   Node_T oNNode;
+   size_t ulNumChildren;
+   size_t ulNumFiles;
+   size_t ulNextChild = 1;
+   size_t ulNextFile = 0;
+   size_t ulBit = 2;
+   size_t i, j;
+
+   assert(oFrozen != NULL);
+   assert(oDNodes != NULL);
+
+   /* the virtual parent of the root */
+   FTFrozen_setBit(&oFrozen->sShape, 0);
+   if(oFrozen->ulNumNodes != 0)
+      FTFrozen_setBit(&oFrozen->sBlocks, 0);
+   for(i = 0; i < oFrozen->ulNumNodes; i++) {
+      oNNode = DynArray_get(oDNodes, i);
+      if(Node_isFile(oNNode)) {
+         FTFrozen_setBit(&oFrozen->sFiles, i);
+         oFrozen->psContents[ulNextFile].pvContents =
+            Node_getValue(oNNode);
+         oFrozen->psContents[ulNextFile].ulLength =
+            Node_getUlLength(oNNode);
+         ulNextFile++;
+      }
+      else {
+         ulNumFiles = Node_getNumFileChildren(oNNode);
+         ulNumChildren = ulNumFiles + Node_getNumDirChildren(oNNode);
+         for(j = 0; j < ulNumChildren; j++) {
+            FTFrozen_setBit(&oFrozen->sShape, ulBit++);
+            if((j < ulNumFiles ? j : j - ulNumFiles) %
+               FTFROZEN_BLOCK == 0)
+               FTFrozen_setBit(&oFrozen->sBlocks, ulNextChild + j);
+         }
+         ulNextChild += ulNumChildren;
+      }
+      /* the 0 bit that ends the node's children */
+      ulBit++;
+   }
+
+   if(!FTFrozen_indexBits(&oFrozen->sShape) ||
+      !FTFrozen_indexBits(&oFrozen->sFiles) ||
+      !FTFrozen_indexBits(&oFrozen->sBlocks))
+      return MEMORY_ERROR;
+   return SUCCESS;
+}
+
+int FTFrozen_new(Node_T oNRoot, FTFrozen_T *poFResult) {
+   FTFrozen_T oFrozen;
+   DynArray_T oDNodes;
+   size_t ulNumFiles = 0;
+   size_t ulNamesSize;
+   size_t ulNumBlocks;
+   int iStatus = SUCCESS;
+   size_t i;
+
+   assert(poFResult != NULL);
+
+   *poFResult = NULL;
+   oDNodes = DynArray_new(0);
+   if(oDNodes == NULL)
+      return MEMORY_ERROR;
+   if(oNRoot != NULL && FTFrozen_gatherNodes(oNRoot, oDNodes) !=
+      SUCCESS) {
+      DynArray_free(oDNodes);
+      return MEMORY_ERROR;
+   }
+
+   oFrozen = calloc(1, sizeof(struct FTFrozen));
+   if(oFrozen == NULL) {
+      DynArray_free(oDNodes);
+      return MEMORY_ERROR;
+   }
+   oFrozen->ulNumNodes = DynArray_getLength(oDNodes);
+   for(i = 0; i < oFrozen->ulNumNodes; i++)
+      if(Node_isFile(DynArray_get(oDNodes, i)))
+         ulNumFiles++;
+   /* the shape has a 1 bit for every node and a 0 bit for every node
+      and for the virtual parent */
+   if(!FTFrozen_newBits(&oFrozen->sShape,
+                        2 * oFrozen->ulNumNodes + 1) ||
+      !FTFrozen_newBits(&oFrozen->sFiles, oFrozen->ulNumNodes) ||
+      !FTFrozen_newBits(&oFrozen->sBlocks, oFrozen->ulNumNodes))
+      iStatus = MEMORY_ERROR;
+   if(iStatus == SUCCESS) {
+      oFrozen->psContents = malloc((ulNumFiles + 1) *
+                                   sizeof(struct FTFrozen_Contents));
+      if(oFrozen->psContents == NULL)
+         iStatus = MEMORY_ERROR;
+   }
+   if(iStatus == SUCCESS)
+      iStatus = FTFrozen_describe(oFrozen, oDNodes);
+
+   /* measure the names, then code them */
+   if(iStatus == SUCCESS) {
+      ulNamesSize = FTFrozen_encode(oDNodes, NULL, NULL);
+      ulNumBlocks = FTFrozen_rank(&oFrozen->sBlocks,
+                                  oFrozen->ulNumNodes);
+      oFrozen->pucNames = malloc(ulNamesSize + 1);
+      oFrozen->aulRestarts = malloc((ulNumBlocks + 1) *
+                                    sizeof(size_t));
+      if(oFrozen->pucNames == NULL || oFrozen->aulRestarts == NULL)
+         iStatus = MEMORY_ERROR;
+   }
+   if(iStatus == SUCCESS)
+      (void) FTFrozen_encode(oDNodes, oFrozen->pucNames,
+                             oFrozen->aulRestarts);
+   DynArray_free(oDNodes);
+
+   if(iStatus != SUCCESS) {
+      FTFrozen_free(oFrozen);
+      return iStatus;
+   }
+   *poFResult = oFrozen;
+   return SUCCESS;
+}
+
+void FTFrozen_free(FTFrozen_T oFrozen) {
+   if(oFrozen == NULL)
+      return;
+   FTFrozen_freeBits(&oFrozen->sShape);
+   FTFrozen_freeBits(&oFrozen->sFiles);
+   FTFrozen_freeBits(&oFrozen->sBlocks);
+   free(oFrozen->psContents);
+   free(oFrozen->pucNames);
+   free(oFrozen->aulRestarts);
+   free(oFrozen);
+}
+
+int FTFrozen_stat(FTFrozen_T oFrozen, const char *pcPath,
+                  boolean *pbIsFile, size_t *pulSize,
+                  void **ppvContents) {
+   const struct FTFrozen_Contents *psContents;
+   size_t ulNode;
+   int iStatus;
+
+   assert(oFrozen != NULL);
+   assert(pcPath != NULL);
+   assert(pbIsFile != NULL);
+   assert(pulSize != NULL);
+
+   iStatus = FTFrozen_find(oFrozen, pcPath, &ulNode);
+   if(iStatus != SUCCESS)
+      return iStatus;
+
+   *pbIsFile = FTFrozen_getBit(&oFrozen->sFiles, ulNode);
+   if(!*pbIsFile)
+      return SUCCESS;
+   psContents = &oFrozen->psContents[FTFrozen_rank(&oFrozen->sFiles,
+                                                   ulNode)];
+   *pulSize = psContents->ulLength;
+   if(ppvContents != NULL)
+      *ppvContents = psContents->pvContents;
+   return SUCCESS;
+}
+
+/*
+  Returns the total length of the lines that FTFrozen_toString writes
+  for the children of directory ulNode of oFrozen, and for their
+  subtrees, where the directory's own line is ulLength characters
+  long, not counting its newline. Decodes only the names' lengths.
+*/
+static size_t FTFrozen_measure(FTFrozen_T oFrozen, size_t ulNode,
+                               size_t ulLength) {
+   const unsigned char *pucName;
+   size_t ulFirst;
+   size_t ulNumFiles;
+   size_t ulNumDirs;
+   size_t ulShared;
+   size_t ulSuffix;
+   size_t ulChildLength;
+   size_t ulTotal = 0;
+   size_t i;
+
+   assert(oFrozen != NULL);
+
+   if(FTFrozen_getBit(&oFrozen->sFiles, ulNode))
+      return 0;
+   FTFrozen_getChildren(oFrozen, ulNode, &ulFirst, &ulNumFiles,
+                        &ulNumDirs);
+   if(ulNumFiles + ulNumDirs == 0)
+      return 0;
+   /* the directories' names follow the files' */
+   pucName = &oFrozen->pucNames[oFrozen->aulRestarts[
+                FTFrozen_rank(&oFrozen->sBlocks, ulFirst)]];
+   for(i = 0; i < ulNumFiles + ulNumDirs; i++) {
+      (void) FTFrozen_nextName(&pucName, i < ulNumFiles ? i :
+                               i - ulNumFiles, &ulShared, &ulSuffix);
+      ulChildLength = ulLength + 1 + ulShared + ulSuffix;
+      ulTotal += ulChildLength + 1;
+      if(i >= ulNumFiles)
+         ulTotal += FTFrozen_measure(oFrozen, ulFirst + i,
+                                     ulChildLength);
+   }
+   return ulTotal;
+}
+
+/*
+  Writes the lines of the children of directory ulNode of oFrozen,
+  and of their subtrees, at *ppcEnd, advancing *ppcEnd past them, as
+  FTFrozen_measure measures them. The directory's line begins at
+  pcLine and is ulLength characters long, not counting its newline.
+  Each name is rebuilt from the line of the sibling before it, which
+  the output already holds.
+*/
+static void FTFrozen_writeLines(FTFrozen_T oFrozen, size_t ulNode,
+                                const char *pcLine, size_t ulLength,
+                                char **ppcEnd) {
+   const unsigned char *pucName;
+   const unsigned char *pucSuffix;
+   const char *pcPrevious = NULL;
+   char *pcChildLine;
+   size_t ulFirst;
+   size_t ulNumFiles;
+   size_t ulNumDirs;
+   size_t ulShared;
+   size_t ulSuffix;
+   size_t i;
+
+   assert(oFrozen != NULL);
+   assert(pcLine != NULL);
+   assert(ppcEnd != NULL);
+
+   if(FTFrozen_getBit(&oFrozen->sFiles, ulNode))
+      return;
+   FTFrozen_getChildren(oFrozen, ulNode, &ulFirst, &ulNumFiles,
+                        &ulNumDirs);
+   if(ulNumFiles + ulNumDirs == 0)
+      return;
+   pucName = &oFrozen->pucNames[oFrozen->aulRestarts[
+                FTFrozen_rank(&oFrozen->sBlocks, ulFirst)]];
+   for(i = 0; i < ulNumFiles + ulNumDirs; i++) {
+      pucSuffix = FTFrozen_nextName(&pucName, i < ulNumFiles ? i :
+                                    i - ulNumFiles, &ulShared,
+                                    &ulSuffix);
+      pcChildLine = *ppcEnd;
+      memcpy(*ppcEnd, pcLine, ulLength);
+      *ppcEnd += ulLength;
+      *(*ppcEnd)++ = '/';
+      if(ulShared != 0)
+         memcpy(*ppcEnd, pcPrevious, ulShared);
+      pcPrevious = *ppcEnd;
+      *ppcEnd += ulShared;
+      memcpy(*ppcEnd, pucSuffix, ulSuffix);
+      *ppcEnd += ulSuffix;
+      *(*ppcEnd)++ = '\n';
+      if(i >= ulNumFiles)
+         FTFrozen_writeLines(oFrozen, ulFirst + i,
+                             pcChildLine,
+                             ulLength + 1 + ulShared + ulSuffix,
+                             ppcEnd);
+   }
+}
+
+char *FTFrozen_toString(FTFrozen_T oFrozen) {
+   const unsigned char *pucName;
+   const unsigned char *pucSuffix = NULL;
+   size_t ulShared;
+   size_t ulLength = 0;
+   size_t ulTotal = 1;
+   char *pcResult;
+   char *pcEnd;
+
+   assert(oFrozen != NULL);
+
+   if(oFrozen->ulNumNodes != 0) {
+      pucName = oFrozen->pucNames;
+      pucSuffix = FTFrozen_nextName(&pucName, 0, &ulShared, &ulLength);
+      ulTotal += ulLength + 1 + FTFrozen_measure(oFrozen, 0, ulLength);
+   }
+   pcResult = malloc(ulTotal);
+   if(pcResult == NULL)
+      return NULL;
+   pcEnd = pcResult;
+   if(oFrozen->ulNumNodes != 0) {
+      memcpy(pcEnd, pucSuffix, ulLength);
+      pcEnd += ulLength;
+      *pcEnd++ = '\n';
+      FTFrozen_writeLines(oFrozen, 0, pcResult, ulLength, &pcEnd);
+   }
+   *pcEnd = '\0';
+   return pcResult;
+}
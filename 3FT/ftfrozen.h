@@ -0,0 +1,71 @@
+/*--------------------------------------------------------------------*/
+/* ftfrozen.h                                                         */
+/* Author: Ishaan Javali & Jack Zhang                                 */
+/*--------------------------------------------------------------------*/
+
+#ifndef FTFROZEN_INCLUDED
+#define FTFROZEN_INCLUDED
+
+#include <stddef.h>
+#include "a4def.h"
+#include "nodeFT.h"
+
+/*
+  An FTFrozen_T is a frozen File Tree hierarchy: a compact, read-only
+  copy of a hierarchy of nodes, held in memory, for a tree that is
+  looked up much more than it is changed.
+
+  The nodes are numbered in breadth-first order, each node's children
+  consecutive, files then directories, each sorted by name, as in an
+  image (see ftimage.h), but no node is stored as a structure. The
+  shape of the hierarchy is a bit vector in level-order unary degree
+  sequence: each node in turn contributes a 1 bit for each of its
+  children and then a 0 bit, about 2 bits per node in all. With a
+  second bit vector marking which nodes are files, and a small
+  directory of counts that finds the number of 1 bits before any
+  position, or the position of the k-th 0 bit, in near constant time,
+  a node's children are found by counting bits rather than following
+  pointers, at about 4 bits of topology per node.
+
+  The names are front-coded: the sorted names of each directory's
+  files, and then of its directories, are cut into blocks of up to
+  16, and every name but the first of its block is stored as the
+  length of the prefix it shares with the name before it and the rest
+  of it. Sibling names that share long prefixes thus take little more
+  than their differing tails. The first name of each block is stored
+  whole, as a restart point, so a lookup binary searches a
+  directory's restart points and then decodes one block, comparing as
+  it goes rather than rebuilding names. The files' contents are not
+  copied: a table, indexed by the number of files before a file,
+  holds the contents that the nodes pointed to and their lengths.
+*/
+typedef struct FTFrozen *FTFrozen_T;
+
+/*
+  Freezes the hierarchy rooted at oNRoot, or an empty hierarchy if
+  oNRoot is NULL. Returns an int SUCCESS status and sets *poFResult to
+  be the new FTFrozen_T if successful. Otherwise, sets *poFResult to
+  NULL and returns MEMORY_ERROR. The nodes are left as they were.
+*/
+int FTFrozen_new(Node_T oNRoot, FTFrozen_T *poFResult);
+
+/* Frees oFrozen, but not the contents of its files. */
+void FTFrozen_free(FTFrozen_T oFrozen);
+
+/*
+  Looks up pcPath in oFrozen as FT_statIn does in a File Tree, with
+  the same statuses, and additionally sets *ppvContents, if
+  ppvContents is not NULL, to the contents of a file that is found.
+*/
+int FTFrozen_stat(FTFrozen_T oFrozen, const char *pcPath,
+                  boolean *pbIsFile, size_t *pulSize,
+                  void **ppvContents);
+
+/*
+  Returns the string representation of the hierarchy in oFrozen,
+  which is the string that FT_toString would return for it, or NULL
+  if there is an allocation error.
+*/
+char *FTFrozen_toString(FTFrozen_T oFrozen);
+
+#endif
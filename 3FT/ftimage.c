@@ -0,0 +1,729 @@
+/*--------------------------------------------------------------------*/
+/* ftimage.c                                                          */
+/* Author: Ishaan Javali & Jack Zhang                                 */
+/*--------------------------------------------------------------------*/
+
+/* for open, fstat, mmap and munmap, which C90 mode does not expose by
+   default */
+#define _POSIX_C_SOURCE 200112L
+
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include "path.h"
+#include "dynarray.h"
+#include "ftimage.h"
+
+/*
+  The layout of an image: every number is a word of FTIMAGE_WORD
+  bytes. The header is FTIMAGE_HEADER_WORDS words: the magic string
+  FTIMAGE_MAGIC, the number of nodes, the sizes of the name pool and
+  of the contents blob, and words reserved as 0. Each node's record is
+  FTIMAGE_RECORD_WORDS words, indexed by the RECORD_* enumerators.
+*/
+enum { FTIMAGE_WORD = 8, FTIMAGE_HEADER_WORDS = 8,
+       FTIMAGE_RECORD_WORDS = 8 };
+enum { RECORD_FLAGS, RECORD_NAME, RECORD_NAME_LENGTH, RECORD_CHILDREN,
+       RECORD_FILE_CHILDREN, RECORD_DIR_CHILDREN, RECORD_CONTENTS,
+       RECORD_CONTENTS_LENGTH };
+enum { FTIMAGE_FILE = 1, FTIMAGE_CONTENTS = 2 };
+static const char FTIMAGE_MAGIC[] = "FTIMAGE1";
+
+/*
+  A mapped image is an ADT with 8 state variables:
+*/
+struct FTImage {
+   /* 1. the start of the mapping */
+   const unsigned char *pucMap;
+   /* 2. the size of the mapping, which is the size of the file */
+   size_t ulMapSize;
+   /* 3. the number of node records */
+   size_t ulNumNodes;
+   /* 4. the first node record */
+   const unsigned char *pucRecords;
+   /* 5. the name pool */
+   const char *pcNames;
+   /* 6. the size of the name pool */
+   size_t ulNamesSize;
+   /* 7. the contents blob */
+   const unsigned char *pucContents;
+   /* 8. the size of the contents blob */
+   size_t ulContentsSize;
+};
+
+/*
+  Stores ulValue in the image word at pucWord.
+*/
+static void FTImage_putWord(unsigned char *pucWord, size_t ulValue) {
+   size_t i;
+
+   assert(pucWord != NULL);
+
+   for(i = 0; i < FTIMAGE_WORD; i++) {
+      pucWord[i] = (unsigned char) (ulValue & 0xff);
+      ulValue >>= 8;
+   }
+}
+
+/*
+  Returns the image word at pucWord, or sets *pbOverflow to TRUE if it
+  does not fit in a size_t.
+*/
+static size_t FTImage_getWord(const unsigned char *pucWord,
+                              boolean *pbOverflow) {
+   size_t ulValue = 0;
+   size_t i;
+
+   assert(pucWord != NULL);
+   assert(pbOverflow != NULL);
+
+   for(i = FTIMAGE_WORD; i > 0; i--) {
+      if(ulValue > ((size_t) -1 >> 8))
+         *pbOverflow = TRUE;
+      ulValue = (ulValue << 8) | pucWord[i - 1];
+   }
+   return ulValue;
+}
+
+/*
+  Returns field iField of node record ulIndex in oImage, or the
+  largest size_t if it does not fit in one, so that any bounds check
+  against the image fails.
+*/
+static size_t FTImage_field(FTImage_T oImage, size_t ulIndex,
+                            int iField) {
+   boolean bOverflow = FALSE;
+   size_t ulValue;
+
+   assert(oImage != NULL);
+   assert(ulIndex < oImage->ulNumNodes);
+
+   ulValue = FTImage_getWord(&oImage->pucRecords[
+                 (ulIndex * FTIMAGE_RECORD_WORDS + (size_t) iField) *
+                 FTIMAGE_WORD], &bOverflow);
+   if(bOverflow)
+      return (size_t) -1;
+   return ulValue;
+}
+
+/*
+  Returns the name of node ulIndex in oImage and sets *pulLength to
+  its length, or returns NULL if the record's name lies outside the
+  name pool.
+*/
+static const char *FTImage_getName(FTImage_T oImage, size_t ulIndex,
+                                   size_t *pulLength) {
+   size_t ulOffset;
+
+   assert(oImage != NULL);
+   assert(pulLength != NULL);
+
+   ulOffset = FTImage_field(oImage, ulIndex, RECORD_NAME);
+   *pulLength = FTImage_field(oImage, ulIndex, RECORD_NAME_LENGTH);
+   if(ulOffset > oImage->ulNamesSize ||
+      *pulLength > oImage->ulNamesSize - ulOffset)
+      return NULL;
+   return &oImage->pcNames[ulOffset];
+}
+
+/*
+  Sets *pulFirst and *pulNumFiles and *pulNumDirs to the index of node
+  ulIndex's first child in oImage and to its numbers of file and
+  directory children. Returns FALSE, with no children, if the record's
+  children lie outside the node table.
+*/
+static boolean FTImage_getChildren(FTImage_T oImage, size_t ulIndex,
+                                   size_t *pulFirst,
+                                   size_t *pulNumFiles,
+                                   size_t *pulNumDirs) {
+   assert(oImage != NULL);
+   assert(pulFirst != NULL);
+   assert(pulNumFiles != NULL);
+   assert(pulNumDirs != NULL);
+
+   *pulFirst = FTImage_field(oImage, ulIndex, RECORD_CHILDREN);
+   *pulNumFiles = FTImage_field(oImage, ulIndex, RECORD_FILE_CHILDREN);
+   *pulNumDirs = FTImage_field(oImage, ulIndex, RECORD_DIR_CHILDREN);
+   if(*pulFirst <= oImage->ulNumNodes &&
+      *pulNumFiles <= oImage->ulNumNodes - *pulFirst &&
+      *pulNumDirs <= oImage->ulNumNodes - *pulFirst - *pulNumFiles)
+      return TRUE;
+   *pulFirst = 0;
+   *pulNumFiles = 0;
+   *pulNumDirs = 0;
+   return FALSE;
+}
+
+/*
+  Compares the ulLength-byte name pcName with the name of node ulIndex
+  in oImage, as strcmp would compare them if each ended in '\0'; a
+  node whose name lies outside the name pool sorts after every name.
+*/
+static int FTImage_compareName(FTImage_T oImage, size_t ulIndex,
+                               const char *pcName, size_t ulLength) {
+   const char *pcNodeName;
+   size_t ulNodeLength;
+   int iCompare;
+
+   assert(oImage != NULL);
+   assert(pcName != NULL);
+
+   pcNodeName = FTImage_getName(oImage, ulIndex, &ulNodeLength);
+   if(pcNodeName == NULL)
+      return -1;
+   iCompare = memcmp(pcName, pcNodeName, ulLength < ulNodeLength ?
+                                         ulLength : ulNodeLength);
+   if(iCompare != 0)
+      return iCompare;
+   if(ulLength < ulNodeLength)
+      return -1;
+   return ulLength > ulNodeLength;
+}
+
+/*
+  Binary searches the ulCount consecutive nodes of oImage starting at
+  ulFirst, which are sorted by name, for the ulLength-byte name
+  pcName. Returns TRUE and sets *pulResult to the node's index if it
+  is found, or returns FALSE otherwise.
+*/
+static boolean FTImage_search(FTImage_T oImage, size_t ulFirst,
+                              size_t ulCount, const char *pcName,
+                              size_t ulLength, size_t *pulResult) {
+   size_t ulLo = ulFirst;
+   size_t ulHi = ulFirst + ulCount;
+   size_t ulMid;
+   int iCompare;
+
+   assert(oImage != NULL);
+   assert(pcName != NULL);
+   assert(pulResult != NULL);
+
+   while(ulLo < ulHi) {
+      ulMid = ulLo + (ulHi - ulLo) / 2;
+      iCompare = FTImage_compareName(oImage, ulMid, pcName, ulLength);
+      if(iCompare == 0) {
+         *pulResult = ulMid;
+         return TRUE;
+      }
+      if(iCompare < 0)
+         ulHi = ulMid;
+      else
+         ulLo = ulMid + 1;
+   }
+   return FALSE;
+}
+
+/*
+  Looks up pcPath in oImage, as FT_findNode does in a File Tree but
+  looking for a file and then a directory at the last component.
+  Returns SUCCESS and sets *pulResult to the node's index, or returns
+  BAD_PATH, NO_SUCH_PATH or CONFLICTING_PATH as FT_statIn does.
+*/
+static int FTImage_find(FTImage_T oImage, const char *pcPath,
+                        size_t *pulResult) {
+   const char *pcComponent = pcPath;
+   const char *pcEnd;
+   const char *pcName;
+   size_t ulNameLength;
+   size_t ulLength;
+   size_t ulNode = 0;
+   size_t ulFirst;
+   size_t ulNumFiles;
+   size_t ulNumDirs;
+
+   assert(oImage != NULL);
+   assert(pcPath != NULL);
+   assert(pulResult != NULL);
+
+   /* the same well-formedness rules as Path_new */
+   if(*pcPath == '\0' || *pcPath == '/')
+      return BAD_PATH;
+   for(pcEnd = pcPath; *pcEnd != '\0'; pcEnd++)
+      if(*pcEnd == '/' && (pcEnd[1] == '/' || pcEnd[1] == '\0'))
+         return BAD_PATH;
+
+   if(oImage->ulNumNodes == 0)
+      return NO_SUCH_PATH;
+
+   pcEnd = strchr(pcComponent, '/');
+   ulLength = pcEnd == NULL ? strlen(pcComponent) :
+                              (size_t) (pcEnd - pcComponent);
+   pcName = FTImage_getName(oImage, 0, &ulNameLength);
+   if(pcName == NULL || ulNameLength != ulLength ||
+      memcmp(pcName, pcComponent, ulLength) != 0)
+      return CONFLICTING_PATH;
+
+   while(pcEnd != NULL) {
+      pcComponent = pcEnd + 1;
+      pcEnd = strchr(pcComponent, '/');
+      ulLength = pcEnd == NULL ? strlen(pcComponent) :
+                                 (size_t) (pcEnd - pcComponent);
+      if(FTImage_field(oImage, ulNode, RECORD_FLAGS) & FTIMAGE_FILE)
+         return NO_SUCH_PATH;
+      (void) FTImage_getChildren(oImage, ulNode, &ulFirst, &ulNumFiles,
+                                 &ulNumDirs);
+      if(pcEnd == NULL && FTImage_search(oImage, ulFirst, ulNumFiles,
+                                         pcComponent, ulLength,
+                                         &ulNode))
+         break;
+      if(!FTImage_search(oImage, ulFirst + ulNumFiles, ulNumDirs,
+                         pcComponent, ulLength, &ulNode))
+         return NO_SUCH_PATH;
+   }
+
+   *pulResult = ulNode;
+   return SUCCESS;
+}
+
+/*
+  Writes the FTIMAGE_RECORD_WORDS words in aulWords to psFile.
+  Returns SUCCESS, or IO_ERROR if they could not be written.
+*/
+static int FTImage_writeWords(FILE *psFile, const size_t *aulWords) {
+   unsigned char aucWords[FTIMAGE_WORD * FTIMAGE_RECORD_WORDS];
+   size_t i;
+
+   assert(psFile != NULL);
+   assert(aulWords != NULL);
+
+   for(i = 0; i < FTIMAGE_RECORD_WORDS; i++)
+      FTImage_putWord(&aucWords[i * FTIMAGE_WORD], aulWords[i]);
+   if(fwrite(aucWords, FTIMAGE_WORD, FTIMAGE_RECORD_WORDS, psFile) !=
+      FTIMAGE_RECORD_WORDS)
+      return IO_ERROR;
+   return SUCCESS;
+}
+
+/*
+  Returns the name of oNNode, the last component of its path, and
+  sets *pulLength to its length.
+*/
+static const char *FTImage_nodeName(Node_T oNNode, size_t *pulLength) {
+   Path_T oPPath;
+   const char *pcName;
+
+   assert(oNNode != NULL);
+   assert(pulLength != NULL);
+
+   oPPath = Node_getPath(oNNode);
+   pcName = Path_getComponent(oPPath, Path_getDepth(oPPath) - 1);
+   *pulLength = strlen(pcName);
+   return pcName;
+}
+
+/*
+  Appends the nodes of the hierarchy rooted at oNRoot to oDNodes in
+  breadth-first order, each node's children in the order of
+  Node_getChild: files, then directories. Returns SUCCESS, or
+  MEMORY_ERROR if oDNodes could not grow.
+*/
+static int FTImage_gatherNodes(Node_T oNRoot, DynArray_T oDNodes) {
+   Node_T oNNode;
+   Node_T oNChild;
+   size_t ulNumFiles;
+   size_t ulNumChildren;
+   size_t ulNext;
+   size_t i;
+
+   assert(oNRoot != NULL);
+   assert(oDNodes != NULL);
+
+   if(!DynArray_add(oDNodes, oNRoot))
+      return MEMORY_ERROR;
+   for(ulNext = 0; ulNext < DynArray_getLength(oDNodes); ulNext++) {
+      oNNode = DynArray_get(oDNodes, ulNext);
+      if(Node_isFile(oNNode))
+         continue;
+      ulNumFiles = Node_getNumFileChildren(oNNode);
+      ulNumChildren = ulNumFiles + Node_getNumDirChildren(oNNode);
+      for(i = 0; i < ulNumChildren; i++) {
+         (void) Node_getChild(oNNode, i < ulNumFiles ? i :
+                              i - ulNumFiles, (boolean) (i < ulNumFiles),
+                              &oNChild);
+         if(!DynArray_add(oDNodes, oNChild))
+            return MEMORY_ERROR;
+      }
+   }
+   return SUCCESS;
+}
+
+/*
+  Writes the header, node table, name pool and contents blob of the
+  image of the ulNumNodes nodes in oDNodes, which are in breadth-first
+  order, to psFile. Returns SUCCESS or IO_ERROR.
+*/
+static int FTImage_writeNodes(FILE *psFile, DynArray_T oDNodes,
+                              size_t ulNumNodes) {
+   unsigned char aucHeader[FTIMAGE_WORD * FTIMAGE_HEADER_WORDS];
+   size_t aulWords[FTIMAGE_RECORD_WORDS];
+   Node_T oNNode;
+   const char *pcName;
+   size_t ulNamesSize = 0;
+   size_t ulContentsSize = 0;
+   size_t ulNextChild = 1;
+   size_t ulLength;
+   int iStatus = SUCCESS;
+   size_t i;
+
+   assert(psFile != NULL);
+   assert(oDNodes != NULL);
+
+   for(i = 0; i < ulNumNodes; i++) {
+      oNNode = DynArray_get(oDNodes, i);
+      (void) FTImage_nodeName(oNNode, &ulLength);
+      ulNamesSize += ulLength;
+      if(Node_isFile(oNNode) && Node_getValue(oNNode) != NULL)
+         ulContentsSize += Node_getUlLength(oNNode);
+   }
+
+   /* the header */
+   memset(aucHeader, 0, sizeof(aucHeader));
+   memcpy(aucHeader, FTIMAGE_MAGIC, FTIMAGE_WORD);
+   FTImage_putWord(&aucHeader[FTIMAGE_WORD], ulNumNodes);
+   FTImage_putWord(&aucHeader[2 * FTIMAGE_WORD], ulNamesSize);
+   FTImage_putWord(&aucHeader[3 * FTIMAGE_WORD], ulContentsSize);
+   if(fwrite(aucHeader, 1, sizeof(aucHeader), psFile) !=
+      sizeof(aucHeader))
+      return IO_ERROR;
+
+   /* the node table */
+   ulNamesSize = 0;
+   ulContentsSize = 0;
+   for(i = 0; i < ulNumNodes && iStatus == SUCCESS; i++) {
+      oNNode = DynArray_get(oDNodes, i);
+      memset(aulWords, 0, sizeof(aulWords));
+      (void) FTImage_nodeName(oNNode, &ulLength);
+      aulWords[RECORD_NAME] = ulNamesSize;
+      aulWords[RECORD_NAME_LENGTH] = ulLength;
+      ulNamesSize += ulLength;
+      if(Node_isFile(oNNode)) {
+         aulWords[RECORD_FLAGS] = FTIMAGE_FILE;
+         aulWords[RECORD_CONTENTS_LENGTH] = Node_getUlLength(oNNode);
+         if(Node_getValue(oNNode) != NULL) {
+            aulWords[RECORD_FLAGS] |= FTIMAGE_CONTENTS;
+            aulWords[RECORD_CONTENTS] = ulContentsSize;
+            ulContentsSize += Node_getUlLength(oNNode);
+         }
+      }
+      else {
+         aulWords[RECORD_CHILDREN] = ulNextChild;
+         aulWords[RECORD_FILE_CHILDREN] =
+            Node_getNumFileChildren(oNNode);
+         aulWords[RECORD_DIR_CHILDREN] = Node_getNumDirChildren(oNNode);
+         ulNextChild += aulWords[RECORD_FILE_CHILDREN] +
+                        aulWords[RECORD_DIR_CHILDREN];
+      }
+      iStatus = FTImage_writeWords(psFile, aulWords);
+   }
+
+   /* the name pool */
+   for(i = 0; i < ulNumNodes && iStatus == SUCCESS; i++) {
+      pcName = FTImage_nodeName(DynArray_get(oDNodes, i), &ulLength);
+      if(fwrite(pcName, 1, ulLength, psFile) != ulLength)
+         iStatus = IO_ERROR;
+   }
+
+   /* the contents blob */
+   for(i = 0; i < ulNumNodes && iStatus == SUCCESS; i++) {
+      oNNode = DynArray_get(oDNodes, i);
+      if(!Node_isFile(oNNode) || Node_getValue(oNNode) == NULL)
+         continue;
+      ulLength = Node_getUlLength(oNNode);
+      if(fwrite(Node_getValue(oNNode), 1, ulLength, psFile) != ulLength)
+         iStatus = IO_ERROR;
+   }
+   return iStatus;
+}
+
+int FTImage_write(Node_T oNRoot, const char *pcFilename) {
+   DynArray_T oDNodes;
+   FILE *psFile;
+   int iStatus = SUCCESS;
+
+   assert(pcFilename != NULL);
+
+   oDNodes = DynArray_new(0);
+   if(oDNodes == NULL)
+      return MEMORY_ERROR;
+   if(oNRoot != NULL)
+      iStatus = FTImage_gatherNodes(oNRoot, oDNodes);
+   if(iStatus != SUCCESS) {
+      DynArray_free(oDNodes);
+      return iStatus;
+   }
+
+   psFile = fopen(pcFilename, "wb");
+   if(psFile == NULL) {
+      DynArray_free(oDNodes);
+      return IO_ERROR;
+   }
+   iStatus = FTImage_writeNodes(psFile, oDNodes,
+                                DynArray_getLength(oDNodes));
+   if(fclose(psFile) != 0 && iStatus == SUCCESS)
+      iStatus = IO_ERROR;
+   DynArray_free(oDNodes);
+   return iStatus;
+}
+
+int FTImage_open(const char *pcFilename, FTImage_T *poIResult) {
+   FTImage_T oImage;
+   struct stat sStat;
+   void *pvMap;
+   const unsigned char *pucHeader;
+   boolean bOverflow = FALSE;
+   size_t ulTableSize;
+   int iFd;
+
+   assert(pcFilename != NULL);
+   assert(poIResult != NULL);
+
+   *poIResult = NULL;
+
+   iFd = open(pcFilename, O_RDONLY);
+   if(iFd < 0)
+      return IO_ERROR;
+   if(fstat(iFd, &sStat) != 0 || sStat.st_size < 0 ||
+      (unsigned long) sStat.st_size > (size_t) -1) {
+      (void) close(iFd);
+      return IO_ERROR;
+   }
+   if((size_t) sStat.st_size < FTIMAGE_WORD * FTIMAGE_HEADER_WORDS) {
+      (void) close(iFd);
+      return CORRUPT_FILE;
+   }
+   pvMap = mmap(NULL, (size_t) sStat.st_size, PROT_READ, MAP_SHARED,
+                iFd, 0);
+   /* the mapping holds its own reference to the file */
+   (void) close(iFd);
+   if(pvMap == MAP_FAILED)
+      return IO_ERROR;
+
+   oImage = malloc(sizeof(struct FTImage));
+   if(oImage == NULL) {
+      (void) munmap(pvMap, (size_t) sStat.st_size);
+      return MEMORY_ERROR;
+   }
+   oImage->pucMap = pvMap;
+   oImage->ulMapSize = (size_t) sStat.st_size;
+
+   pucHeader = oImage->pucMap;
+   oImage->ulNumNodes = FTImage_getWord(&pucHeader[FTIMAGE_WORD],
+                                        &bOverflow);
+   oImage->ulNamesSize = FTImage_getWord(&pucHeader[2 * FTIMAGE_WORD],
+                                         &bOverflow);
+   oImage->ulContentsSize =
+      FTImage_getWord(&pucHeader[3 * FTIMAGE_WORD], &bOverflow);
+   ulTableSize = FTIMAGE_WORD * FTIMAGE_RECORD_WORDS;
+   if(memcmp(pucHeader, FTIMAGE_MAGIC, FTIMAGE_WORD) != 0 || bOverflow ||
+      oImage->ulNumNodes > oImage->ulMapSize / ulTableSize) {
+      FTImage_close(oImage);
+      return CORRUPT_FILE;
+   }
+   ulTableSize *= oImage->ulNumNodes;
+   /* the header, table, pool and blob must fill the file exactly */
+   if(oImage->ulMapSize - FTIMAGE_WORD * FTIMAGE_HEADER_WORDS <
+         ulTableSize ||
+      oImage->ulMapSize - FTIMAGE_WORD * FTIMAGE_HEADER_WORDS -
+         ulTableSize < oImage->ulNamesSize ||
+      oImage->ulMapSize - FTIMAGE_WORD * FTIMAGE_HEADER_WORDS -
+         ulTableSize - oImage->ulNamesSize != oImage->ulContentsSize) {
+      FTImage_close(oImage);
+      return CORRUPT_FILE;
+   }
+
+   oImage->pucRecords = &pucHeader[FTIMAGE_WORD * FTIMAGE_HEADER_WORDS];
+   oImage->pcNames = (const char *) &oImage->pucRecords[ulTableSize];
+   oImage->pucContents = (const unsigned char *)
+                         &oImage->pcNames[oImage->ulNamesSize];
+   *poIResult = oImage;
+   return SUCCESS;
+}
+
+void FTImage_close(FTImage_T oImage) {
+   if(oImage == NULL)
+      return;
+   (void) munmap((void *) oImage->pucMap, oImage->ulMapSize);
+   free(oImage);
+}
+
+int FTImage_stat(FTImage_T oImage, const char *pcPath,
+                 boolean *pbIsFile, size_t *pulSize,
+                 void **ppvContents) {
+   size_t ulNode;
+   size_t ulOffset;
+   size_t ulLength;
+   size_t ulFlags;
+   int iStatus;
+
+   assert(oImage != NULL);
+   assert(pcPath != NULL);
+   assert(pbIsFile != NULL);
+   assert(pulSize != NULL);
+
+   iStatus = FTImage_find(oImage, pcPath, &ulNode);
+   if(iStatus != SUCCESS)
+      return iStatus;
+
+   ulFlags = FTImage_field(oImage, ulNode, RECORD_FLAGS);
+   *pbIsFile = (boolean) ((ulFlags & FTIMAGE_FILE) != 0);
+   if(!*pbIsFile)
+      return SUCCESS;
+
+   ulOffset = FTImage_field(oImage, ulNode, RECORD_CONTENTS);
+   ulLength = FTImage_field(oImage, ulNode, RECORD_CONTENTS_LENGTH);
+   *pulSize = ulLength;
+   if(ppvContents == NULL)
+      return SUCCESS;
+   *ppvContents = NULL;
+   if((ulFlags & FTIMAGE_CONTENTS) != 0 &&
+      ulOffset <= oImage->ulContentsSize &&
+      ulLength <= oImage->ulContentsSize - ulOffset)
+      *ppvContents = (void *) &oImage->pucContents[ulOffset];
+   return SUCCESS;
+}
+
+boolean FTImage_getEntry(FTImage_T oImage, size_t ulIndex,
+                         struct FTImage_Entry *psEntry) {
+   size_t ulFlags;
+   size_t ulOffset;
+
+   assert(oImage != NULL);
+   assert(psEntry != NULL);
+
+   if(ulIndex >= oImage->ulNumNodes)
+      return FALSE;
+   psEntry->pcName = FTImage_getName(oImage, ulIndex,
+                                     &psEntry->ulNameLength);
+   if(psEntry->pcName == NULL)
+      return FALSE;
+
+   ulFlags = FTImage_field(oImage, ulIndex, RECORD_FLAGS);
+   psEntry->bIsFile = (boolean) ((ulFlags & FTIMAGE_FILE) != 0);
+   psEntry->pvContents = NULL;
+   psEntry->ulLength = 0;
+   psEntry->ulFirstChild = 0;
+   psEntry->ulNumFiles = 0;
+   psEntry->ulNumDirs = 0;
+   if(psEntry->bIsFile) {
+      ulOffset = FTImage_field(oImage, ulIndex, RECORD_CONTENTS);
+      psEntry->ulLength = FTImage_field(oImage, ulIndex,
+                                        RECORD_CONTENTS_LENGTH);
+      if((ulFlags & FTIMAGE_CONTENTS) != 0 &&
+         ulOffset <= oImage->ulContentsSize &&
+         psEntry->ulLength <= oImage->ulContentsSize - ulOffset)
+         psEntry->pvContents =
+            (void *) &oImage->pucContents[ulOffset];
+   }
+   /* children always follow their parent, so a walk cannot loop */
+   else if(FTImage_getChildren(oImage, ulIndex, &psEntry->ulFirstChild,
+                               &psEntry->ulNumFiles,
+                               &psEntry->ulNumDirs) &&
+           psEntry->ulFirstChild <= ulIndex) {
+      psEntry->ulFirstChild = 0;
+      psEntry->ulNumFiles = 0;
+      psEntry->ulNumDirs = 0;
+   }
+   return TRUE;
+}
+
+/*
+  Returns the total length of the lines that FTImage_toString writes
+  for the subtree rooted at node ulIndex of oImage, whose parent's
+  path is ulParentLength characters long, or 0 for no parent.
+*/
+static size_t FTImage_measure(FTImage_T oImage, size_t ulIndex,
+                              size_t ulParentLength) {
+   size_t ulLength;
+   size_t ulFirst;
+   size_t ulNumFiles;
+   size_t ulNumDirs;
+   size_t ulTotal;
+   size_t i;
+
+   assert(oImage != NULL);
+
+   if(FTImage_getName(oImage, ulIndex, &ulLength) == NULL)
+      return 0;
+   if(ulParentLength != 0)
+      ulLength += ulParentLength + 1;
+   ulTotal = ulLength + 1;
+   if(FTImage_field(oImage, ulIndex, RECORD_FLAGS) & FTIMAGE_FILE)
+      return ulTotal;
+   (void) FTImage_getChildren(oImage, ulIndex, &ulFirst, &ulNumFiles,
+                              &ulNumDirs);
+   /* children always follow their parent, so a loop cannot recur */
+   if(ulFirst <= ulIndex)
+      return ulTotal;
+   for(i = 0; i < ulNumFiles + ulNumDirs; i++)
+      ulTotal += FTImage_measure(oImage, ulFirst + i, ulLength);
+   return ulTotal;
+}
+
+/*
+  Writes the lines of the subtree rooted at node ulIndex of oImage
+  at *ppcEnd, advancing *ppcEnd past them, as FTImage_measure
+  measures them. The parent's line begins at pcParent and is
+  ulParentLength characters long, not counting its newline.
+*/
+static void FTImage_writeLines(FTImage_T oImage, size_t ulIndex,
+                               const char *pcParent,
+                               size_t ulParentLength, char **ppcEnd) {
+   const char *pcName;
+   char *pcLine;
+   size_t ulLength;
+   size_t ulFirst;
+   size_t ulNumFiles;
+   size_t ulNumDirs;
+   size_t i;
+
+   assert(oImage != NULL);
+   assert(ppcEnd != NULL);
+
+   pcName = FTImage_getName(oImage, ulIndex, &ulLength);
+   if(pcName == NULL)
+      return;
+   pcLine = *ppcEnd;
+   if(ulParentLength != 0) {
+      memcpy(*ppcEnd, pcParent, ulParentLength);
+      *ppcEnd += ulParentLength;
+      *(*ppcEnd)++ = '/';
+   }
+   memcpy(*ppcEnd, pcName, ulLength);
+   *ppcEnd += ulLength;
+   *(*ppcEnd)++ = '\n';
+   ulLength = (size_t) (*ppcEnd - pcLine) - 1;
+
+   if(FTImage_field(oImage, ulIndex, RECORD_FLAGS) & FTIMAGE_FILE)
+      return;
+   (void) FTImage_getChildren(oImage, ulIndex, &ulFirst, &ulNumFiles,
+                              &ulNumDirs);
+   if(ulFirst <= ulIndex)
+      return;
+   for(i = 0; i < ulNumFiles + ulNumDirs; i++)
+      FTImage_writeLines(oImage, ulFirst + i, pcLine, ulLength, ppcEnd);
+}
+
+char *FTImage_toString(FTImage_T oImage) {
+   char *pcResult;
+   char *pcEnd;
+   size_t ulTotal = 1;
+
+   assert(oImage != NULL);
+
+   if(oImage->ulNumNodes != 0)
+      ulTotal += FTImage_measure(oImage, 0, 0);
+   pcResult = malloc(ulTotal);
+   if(pcResult == NULL)
+      return NULL;
+   pcEnd = pcResult;
+   if(oImage->ulNumNodes != 0)
+      FTImage_writeLines(oImage, 0, NULL, 0, &pcEnd);
+   *pcEnd = '\0';
+   return pcResult;
+}
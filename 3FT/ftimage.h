@@ -0,0 +1,101 @@
+/*--------------------------------------------------------------------*/
+/* ftimage.h                                                          */
+/* Author: Ishaan Javali & Jack Zhang                                 */
+/*--------------------------------------------------------------------*/
+
+#ifndef FTIMAGE_INCLUDED
+#define FTIMAGE_INCLUDED
+
+#include <stddef.h>
+#include "a4def.h"
+#include "nodeFT.h"
+
+/*
+  An FTImage_T is a read-only File Tree image: a file holding a whole
+  hierarchy in a pointer-free layout that is queried where it lies,
+  through a read-only shared memory mapping, rather than rebuilt into
+  nodes. Opening one takes constant time, pages are read in only as
+  lookups touch them, and every process that maps the same image
+  shares its pages in the page cache.
+
+  The image is a header, then a table of fixed-size node records in
+  breadth-first order, then a pool of the nodes' names and a blob of
+  the files' contents. Each record gives the offset and length of its
+  name and contents and the index of its first child; a node's
+  children are consecutive, files then directories, each sorted by
+  name, so a lookup binary searches one range of records per level.
+  Every number is a word of 8 bytes, least significant byte first.
+*/
+typedef struct FTImage *FTImage_T;
+
+/*
+  Writes an image of the hierarchy rooted at oNRoot, or of an empty
+  hierarchy if oNRoot is NULL, to the file pcFilename, replacing any
+  previous contents. Returns SUCCESS, or IO_ERROR if the file could
+  not be opened or written, or MEMORY_ERROR if memory could not be
+  allocated to complete request.
+*/
+int FTImage_write(Node_T oNRoot, const char *pcFilename);
+
+/*
+  Maps the image in the file pcFilename. Returns an int SUCCESS status
+  and sets *poIResult to be the new FTImage_T if successful.
+  Otherwise, sets *poIResult to NULL and returns status:
+  * IO_ERROR if the file could not be opened or mapped
+  * CORRUPT_FILE if the file's header does not describe an image of
+                 the file's size
+  * MEMORY_ERROR if memory could not be allocated to complete request
+  Only the header is checked here; a record found to point outside
+  the image during a lookup is treated as if it did not exist.
+*/
+int FTImage_open(const char *pcFilename, FTImage_T *poIResult);
+
+/* Unmaps and frees oImage. */
+void FTImage_close(FTImage_T oImage);
+
+/*
+  Looks up pcPath in oImage as FT_statIn does in a File Tree, with the
+  same statuses, and additionally sets *ppvContents, if ppvContents is
+  not NULL, to the contents of a file that is found. The contents lie
+  in the read-only mapping, so they must not be written to, and they
+  are valid until oImage is closed.
+*/
+int FTImage_stat(FTImage_T oImage, const char *pcPath,
+                 boolean *pbIsFile, size_t *pulSize,
+                 void **ppvContents);
+
+/* One node of an image, as FTImage_getEntry describes it. */
+struct FTImage_Entry {
+   /* the node's name, which is not terminated, and its length */
+   const char *pcName;
+   size_t ulNameLength;
+   /* TRUE if the node is a file, FALSE if it is a directory */
+   boolean bIsFile;
+   /* a file's contents, which lie in the read-only mapping, or NULL,
+      and their length */
+   void *pvContents;
+   size_t ulLength;
+   /* the index of a directory's first child, and its numbers of file
+      and directory children, whose records follow it in that order */
+   size_t ulFirstChild;
+   size_t ulNumFiles;
+   size_t ulNumDirs;
+};
+
+/*
+  Describes node ulIndex of oImage in *psEntry; the root is node 0.
+  Returns TRUE, or FALSE if oImage has no node ulIndex or the node's
+  name lies outside the image. A directory whose children lie outside
+  the image, or do not follow it, is described as having none.
+*/
+boolean FTImage_getEntry(FTImage_T oImage, size_t ulIndex,
+                         struct FTImage_Entry *psEntry);
+
+/*
+  Returns the string representation of the hierarchy in oImage, which
+  is the string that FT_toString would return for it, or NULL if there
+  is an allocation error.
+*/
+char *FTImage_toString(FTImage_T oImage);
+
+#endif
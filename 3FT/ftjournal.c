@@ -0,0 +1,1044 @@
+/*--------------------------------------------------------------------*/
+/* ftjournal.c                                                        */
+/* Author: Ishaan Javali & Jack Zhang                                 */
+/*--------------------------------------------------------------------*/
+
+/* for open, fsync, fdatasync and ftruncate, which C90 mode does not
+   expose by default */
+#define _POSIX_C_SOURCE 200112L
+
+#include <assert.h>
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <pthread.h>
+#include "dynarray.h"
+#include "ftjournal.h"
+
+/*
+  The layout of a journal: every number is a word of JOURNAL_WORD
+  bytes, least significant byte first. The header is the magic string
+  JOURNAL_MAGIC followed by the size and checksum of the snapshot the
+  journal applies to, both 0 for an empty tree. Each record is a
+  kind, ORed with JOURNAL_CONTENTS if its contents are not NULL, the
+  length of its path, counting a final '\0', the length of its
+  contents, and the checksum of those three words, the path and the
+  contents, which follow it. A file whose contents are NULL keeps its
+  length, but no contents follow its path.
+*/
+enum { JOURNAL_WORD = 8, JOURNAL_HEADER_WORDS = 3,
+       JOURNAL_RECORD_WORDS = 4 };
+enum { JOURNAL_INSERT_DIR = 1, JOURNAL_RM_DIR, JOURNAL_INSERT_FILE,
+       JOURNAL_RM_FILE, JOURNAL_REPLACE };
+enum { JOURNAL_KIND_MASK = 0xff, JOURNAL_CONTENTS = 0x100 };
+static const char JOURNAL_MAGIC[] = "FTJRNL01";
+
+/* The size of the blocks in which files are read to checksum them. */
+enum { JOURNAL_READ_SIZE = 65536 };
+
+/* The starting value and multiplier of the FNV-1a checksum, which
+   are 64-bit constants built up from 32-bit halves. */
+static const size_t JOURNAL_HASH_SEED =
+   ((size_t) 0xcbf29ce4UL << 16 << 16) ^ (size_t) 0x84222325UL;
+static const size_t JOURNAL_HASH_PRIME =
+   ((size_t) 1 << 20 << 20) + (size_t) 0x1b3;
+
+/*
+  A journal keeps appended records in one buffer while a group commit
+  writes another; a commit swaps the two.
+*/
+struct FTJournal {
+   /* the File Tree */
+   FT_T oFTree;
+   /* the snapshot and journal files, and the files that a checkpoint
+      writes before renaming them over those */
+   char *pcSnapshot;
+   char *pcJournal;
+   char *pcSnapshotTmp;
+   char *pcJournalTmp;
+   /* the open journal, positioned at its end */
+   int iFd;
+   /* the records appended but not yet being written, their length,
+      and the buffer's capacity */
+   unsigned char *pucPending;
+   size_t ulPending;
+   size_t ulPendingSize;
+   /* the buffer that the group commit under way writes from, and its
+      capacity */
+   unsigned char *pucWriting;
+   size_t ulWritingSize;
+   /* the number of records appended, and of those that are durable */
+   size_t ulAppended;
+   size_t ulDurable;
+   /* TRUE while a caller is writing and syncing a group */
+   boolean bFlushing;
+   /* SUCCESS, or IO_ERROR once the journal could not be written */
+   int iError;
+   /* the buffers that restored files' contents point into */
+   DynArray_T oDBuffers;
+   /* a lock guarding the fields above and the tree, and a condition
+      that callers wait on for their group's commit */
+   pthread_mutex_t oLock;
+   pthread_cond_t oDurableCond;
+};
+
+/*
+  Stores ulValue in the journal word at pucWord.
+*/
+static void FTJournal_putWord(unsigned char *pucWord, size_t ulValue) {
+   size_t i;
+
+   assert(pucWord != NULL);
+
+   for(i = 0; i < JOURNAL_WORD; i++) {
+      pucWord[i] = (unsigned char) (ulValue & 0xff);
+      ulValue >>= 8;
+   }
+}
+
+/*
+  Returns the journal word at pucWord, or sets *pbOverflow to TRUE if
+  it does not fit in a size_t.
+*/
+static size_t FTJournal_getWord(const unsigned char *pucWord,
+                                boolean *pbOverflow) {
+   size_t ulValue = 0;
+   size_t i;
+
+   assert(pucWord != NULL);
+   assert(pbOverflow != NULL);
+
+   for(i = JOURNAL_WORD; i > 0; i--) {
+      if(ulValue > ((size_t) -1 >> 8))
+         *pbOverflow = TRUE;
+      ulValue = (ulValue << 8) | pucWord[i - 1];
+   }
+   return ulValue;
+}
+
+/* Returns checksum ulHash extended over the ulLength bytes at
+   pucBytes. */
+static size_t FTJournal_hash(size_t ulHash,
+                             const unsigned char *pucBytes,
+                             size_t ulLength) {
+   size_t i;
+
+   assert(pucBytes != NULL || ulLength == 0);
+
+   for(i = 0; i < ulLength; i++)
+      ulHash = (ulHash ^ pucBytes[i]) * JOURNAL_HASH_PRIME;
+   return ulHash;
+}
+
+/*
+  Writes the ulLength bytes at pucBytes to iFd. Returns SUCCESS, or
+  IO_ERROR if they could not all be written.
+*/
+static int FTJournal_writeAll(int iFd, const unsigned char *pucBytes,
+                              size_t ulLength) {
+   ssize_t lWritten;
+
+   assert(pucBytes != NULL || ulLength == 0);
+
+   while(ulLength > 0) {
+      lWritten = write(iFd, pucBytes, ulLength);
+      if(lWritten < 0) {
+         if(errno == EINTR)
+            continue;
+         return IO_ERROR;
+      }
+      pucBytes += lWritten;
+      ulLength -= (size_t) lWritten;
+   }
+   return SUCCESS;
+}
+
+/*
+  Syncs the directory holding pcPath, so that a file created or
+  renamed in it is durable. Returns SUCCESS or IO_ERROR.
+*/
+static int FTJournal_syncDirectory(const char *pcPath) {
+   const char *pcSlash;
+   char *pcDirectory;
+   size_t ulLength;
+   int iFd;
+   int iStatus = SUCCESS;
+
+   assert(pcPath != NULL);
+
+   pcSlash = strrchr(pcPath, '/');
+   ulLength = pcSlash == NULL ? 1 :
+              pcSlash == pcPath ? 1 : (size_t) (pcSlash - pcPath);
+   pcDirectory = malloc(ulLength + 1);
+   if(pcDirectory == NULL)
+      return MEMORY_ERROR;
+   if(pcSlash == NULL)
+      strcpy(pcDirectory, ".");
+   else {
+      memcpy(pcDirectory, pcPath, ulLength);
+      pcDirectory[ulLength] = '\0';
+   }
+
+   iFd = open(pcDirectory, O_RDONLY);
+   free(pcDirectory);
+   if(iFd < 0)
+      return IO_ERROR;
+   if(fsync(iFd) != 0)
+      iStatus = IO_ERROR;
+   (void) close(iFd);
+   return iStatus;
+}
+
+/*
+  Sets *pulSize and *pulHash to the size and checksum of the file
+  pcFilename, first syncing it if bSync. Returns SUCCESS, or
+  NO_SUCH_PATH if the file does not exist, or IO_ERROR if it could
+  not be read or synced, or MEMORY_ERROR.
+*/
+static int FTJournal_identify(const char *pcFilename, boolean bSync,
+                              size_t *pulSize, size_t *pulHash) {
+   unsigned char *pucBlock;
+   ssize_t lRead;
+   int iFd;
+   int iStatus = SUCCESS;
+
+   assert(pcFilename != NULL);
+   assert(pulSize != NULL);
+   assert(pulHash != NULL);
+
+   iFd = open(pcFilename, O_RDONLY);
+   if(iFd < 0)
+      return errno == ENOENT ? NO_SUCH_PATH : IO_ERROR;
+   pucBlock = malloc(JOURNAL_READ_SIZE);
+   if(pucBlock == NULL) {
+      (void) close(iFd);
+      return MEMORY_ERROR;
+   }
+
+   *pulSize = 0;
+   *pulHash = JOURNAL_HASH_SEED;
+   for(;;) {
+      lRead = read(iFd, pucBlock, JOURNAL_READ_SIZE);
+      if(lRead < 0 && errno == EINTR)
+         continue;
+      if(lRead < 0)
+         iStatus = IO_ERROR;
+      if(lRead <= 0)
+         break;
+      *pulSize += (size_t) lRead;
+      *pulHash = FTJournal_hash(*pulHash, pucBlock, (size_t) lRead);
+   }
+   if(iStatus == SUCCESS && bSync && fsync(iFd) != 0)
+      iStatus = IO_ERROR;
+
+   free(pucBlock);
+   (void) close(iFd);
+   return iStatus;
+}
+
+/*
+  Makes oJournal's journal a new, empty one whose header names the
+  snapshot of size ulSize and checksum ulHash: writes and syncs it as
+  the temporary journal, then renames it over the journal and leaves
+  it open, in place of any journal that was open. The caller must
+  then sync the directory (see FTJournal_syncDirectory) for the
+  rename to be durable. Returns SUCCESS, or IO_ERROR, leaving the old
+  journal in place and open.
+*/
+static int FTJournal_startJournal(FTJournal_T oJournal, size_t ulSize,
+                                  size_t ulHash) {
+   unsigned char aucHeader[JOURNAL_WORD * JOURNAL_HEADER_WORDS];
+   int iFd;
+   int iStatus;
+
+   assert(oJournal != NULL);
+
+   memcpy(aucHeader, JOURNAL_MAGIC, JOURNAL_WORD);
+   FTJournal_putWord(&aucHeader[JOURNAL_WORD], ulSize);
+   FTJournal_putWord(&aucHeader[2 * JOURNAL_WORD], ulHash);
+
+   iFd = open(oJournal->pcJournalTmp, O_RDWR | O_CREAT | O_TRUNC, 0666);
+   if(iFd < 0)
+      return IO_ERROR;
+   iStatus = FTJournal_writeAll(iFd, aucHeader, sizeof(aucHeader));
+   if(iStatus == SUCCESS && fsync(iFd) != 0)
+      iStatus = IO_ERROR;
+   if(iStatus == SUCCESS &&
+      rename(oJournal->pcJournalTmp, oJournal->pcJournal) != 0)
+      iStatus = IO_ERROR;
+   if(iStatus != SUCCESS) {
+      (void) close(iFd);
+      (void) remove(oJournal->pcJournalTmp);
+      return iStatus;
+   }
+
+   if(oJournal->iFd >= 0)
+      (void) close(oJournal->iFd);
+   oJournal->iFd = iFd;
+   return SUCCESS;
+}
+
+/*
+  Makes room in oJournal's pending buffer for ulLength more bytes.
+  Returns SUCCESS, or MEMORY_ERROR if the buffer could not grow.
+*/
+static int FTJournal_reserve(FTJournal_T oJournal, size_t ulLength) {
+   unsigned char *pucGrown;
+   size_t ulSize;
+
+   assert(oJournal != NULL);
+
+   if(ulLength <= oJournal->ulPendingSize - oJournal->ulPending)
+      return SUCCESS;
+   ulSize = oJournal->ulPendingSize;
+   while(ulSize - oJournal->ulPending < ulLength) {
+      if(ulSize > (size_t) -1 / 2)
+         return MEMORY_ERROR;
+      ulSize *= 2;
+   }
+   pucGrown = realloc(oJournal->pucPending, ulSize);
+   if(pucGrown == NULL)
+      return MEMORY_ERROR;
+   oJournal->pucPending = pucGrown;
+   oJournal->ulPendingSize = ulSize;
+   return SUCCESS;
+}
+
+/* Returns the size of the record of a change to pcPath with contents
+   of ulLength bytes. */
+static size_t FTJournal_recordSize(const char *pcPath, size_t ulLength) {
+   assert(pcPath != NULL);
+
+   return JOURNAL_WORD * JOURNAL_RECORD_WORDS + strlen(pcPath) + 1 +
+          ulLength;
+}
+
+/*
+  Appends the record of a change of kind iKind to pcPath, with
+  contents pvContents of ulLength bytes, to oJournal's pending
+  buffer, which must have room for it (see FTJournal_reserve).
+*/
+static void FTJournal_append(FTJournal_T oJournal, int iKind,
+                             const char *pcPath, const void *pvContents,
+                             size_t ulLength) {
+   unsigned char *pucRecord;
+   size_t ulPathLength;
+   size_t ulBytes = 0;
+   size_t ulHash;
+
+   assert(oJournal != NULL);
+   assert(pcPath != NULL);
+
+   if(pvContents != NULL) {
+      iKind |= JOURNAL_CONTENTS;
+      ulBytes = ulLength;
+   }
+   ulPathLength = strlen(pcPath) + 1;
+   pucRecord = &oJournal->pucPending[oJournal->ulPending];
+   FTJournal_putWord(pucRecord, (size_t) iKind);
+   FTJournal_putWord(&pucRecord[JOURNAL_WORD], ulPathLength);
+   FTJournal_putWord(&pucRecord[2 * JOURNAL_WORD], ulLength);
+   memcpy(&pucRecord[JOURNAL_WORD * JOURNAL_RECORD_WORDS], pcPath,
+          ulPathLength);
+   if(ulBytes > 0)
+      memcpy(&pucRecord[JOURNAL_WORD * JOURNAL_RECORD_WORDS +
+                        ulPathLength], pvContents, ulBytes);
+
+   ulHash = FTJournal_hash(JOURNAL_HASH_SEED, pucRecord,
+                           3 * JOURNAL_WORD);
+   ulHash = FTJournal_hash(ulHash,
+                           &pucRecord[JOURNAL_WORD *
+                                      JOURNAL_RECORD_WORDS],
+                           ulPathLength + ulBytes);
+   FTJournal_putWord(&pucRecord[3 * JOURNAL_WORD], ulHash);
+
+   oJournal->ulPending += JOURNAL_WORD * JOURNAL_RECORD_WORDS +
+                          ulPathLength + ulBytes;
+   oJournal->ulAppended++;
+}
+
+/*
+  Returns once the first ulRecords records appended to oJournal are
+  durable, for a caller holding oJournal's lock. If no group commit
+  is under way, the caller commits every pending record itself,
+  releasing the lock while it writes and syncs them; otherwise, it
+  waits for the commit under way and then checks again, since its
+  records may have been appended after that group was taken. Returns
+  SUCCESS, or IO_ERROR if the journal could not be written.
+*/
+static int FTJournal_commit(FTJournal_T oJournal, size_t ulRecords) {
+   unsigned char *pucGroup;
+   size_t ulGroupSize;
+   size_t ulLength;
+   size_t ulTarget;
+   int iStatus;
+
+   assert(oJournal != NULL);
+
+   while(oJournal->ulDurable < ulRecords &&
+         oJournal->iError == SUCCESS) {
+      if(oJournal->bFlushing) {
+         (void) pthread_cond_wait(&oJournal->oDurableCond,
+                                  &oJournal->oLock);
+         continue;
+      }
+
+      /* take the pending records as this group */
+      pucGroup = oJournal->pucPending;
+      ulGroupSize = oJournal->ulPendingSize;
+      ulLength = oJournal->ulPending;
+      ulTarget = oJournal->ulAppended;
+      oJournal->pucPending = oJournal->pucWriting;
+      oJournal->ulPendingSize = oJournal->ulWritingSize;
+      oJournal->ulPending = 0;
+      oJournal->bFlushing = TRUE;
+      (void) pthread_mutex_unlock(&oJournal->oLock);
+
+      iStatus = FTJournal_writeAll(oJournal->iFd, pucGroup, ulLength);
+      if(iStatus == SUCCESS && fdatasync(oJournal->iFd) != 0)
+         iStatus = IO_ERROR;
+
+      (void) pthread_mutex_lock(&oJournal->oLock);
+      oJournal->pucWriting = pucGroup;
+      oJournal->ulWritingSize = ulGroupSize;
+      oJournal->bFlushing = FALSE;
+      if(iStatus == SUCCESS)
+         oJournal->ulDurable = ulTarget;
+      else
+         oJournal->iError = IO_ERROR;
+      (void) pthread_cond_broadcast(&oJournal->oDurableCond);
+   }
+   return oJournal->iError;
+}
+
+/*
+  Carries out the change of kind iKind to pcPath, with contents
+  pvContents of ulLength bytes, on oJournal's tree, holding its lock.
+  If the change succeeds, journals it and returns once it is durable.
+  Sets *ppvOldContents, for JOURNAL_REPLACE, as
+  FTJournal_replaceFileContents does. Returns the change's status, or
+  MEMORY_ERROR if there was no room to journal it, or IO_ERROR.
+*/
+static int FTJournal_change(FTJournal_T oJournal, int iKind,
+                            const char *pcPath, void *pvContents,
+                            size_t ulLength, void **ppvOldContents) {
+   boolean bIsFile;
+   size_t ulSize;
+   int iStatus;
+
+   assert(oJournal != NULL);
+   assert(pcPath != NULL);
+
+   (void) pthread_mutex_lock(&oJournal->oLock);
+   iStatus = oJournal->iError;
+   if(iStatus == SUCCESS)
+      iStatus = FTJournal_reserve(oJournal,
+                                  FTJournal_recordSize(pcPath,
+                                     pvContents == NULL ? 0 : ulLength));
+   if(iStatus != SUCCESS) {
+      (void) pthread_mutex_unlock(&oJournal->oLock);
+      return iStatus;
+   }
+
+   switch(iKind) {
+      case JOURNAL_INSERT_DIR:
+         iStatus = FT_insertDirIn(oJournal->oFTree, pcPath);
+         break;
+      case JOURNAL_RM_DIR:
+         iStatus = FT_rmDirIn(oJournal->oFTree, pcPath);
+         break;
+      case JOURNAL_INSERT_FILE:
+         iStatus = FT_insertFileIn(oJournal->oFTree, pcPath,
+                                   pvContents, ulLength);
+         break;
+      case JOURNAL_RM_FILE:
+         iStatus = FT_rmFileIn(oJournal->oFTree, pcPath);
+         break;
+      case JOURNAL_REPLACE:
+         iStatus = FT_statIn(oJournal->oFTree, pcPath, &bIsFile,
+                             &ulSize);
+         if(iStatus == SUCCESS && !bIsFile)
+            iStatus = NOT_A_FILE;
+         if(iStatus == SUCCESS)
+            *ppvOldContents =
+               FT_replaceFileContentsIn(oJournal->oFTree, pcPath,
+                                        pvContents, ulLength);
+         break;
+      default:
+         assert(FALSE);
+   }
+
+   if(iStatus == SUCCESS) {
+      FTJournal_append(oJournal, iKind, pcPath, pvContents, ulLength);
+      iStatus = FTJournal_commit(oJournal, oJournal->ulAppended);
+   }
+   (void) pthread_mutex_unlock(&oJournal->oLock);
+   return iStatus;
+}
+
+/*
+  Replays the journal of ulSize bytes at pucJournal, which starts
+  with its header, on oJournal's tree, and sets *pulValid to the
+  length of its header and the records that replayed, stopping at
+  the end or at the first record that is cut short or fails its
+  checksum. Returns SUCCESS, or CORRUPT_FILE if a record that passes
+  its checksum cannot be replayed, so the journal does not apply to
+  the tree.
+*/
+static int FTJournal_replay(FTJournal_T oJournal,
+                            unsigned char *pucJournal, size_t ulSize,
+                            size_t *pulValid) {
+   unsigned char *pucRecord;
+   const char *pcPath;
+   void *pvContents;
+   boolean bOverflow = FALSE;
+   boolean bIsFile;
+   size_t ulFileSize;
+   size_t ulRemaining;
+   size_t ulKind;
+   size_t ulPathLength;
+   size_t ulLength;
+   size_t ulBytes;
+   int iStatus;
+
+   assert(oJournal != NULL);
+   assert(pucJournal != NULL);
+   assert(pulValid != NULL);
+
+   *pulValid = JOURNAL_WORD * JOURNAL_HEADER_WORDS;
+   for(;;) {
+      pucRecord = &pucJournal[*pulValid];
+      ulRemaining = ulSize - *pulValid;
+      if(ulRemaining < JOURNAL_WORD * JOURNAL_RECORD_WORDS)
+         return SUCCESS;
+      ulRemaining -= JOURNAL_WORD * JOURNAL_RECORD_WORDS;
+      ulKind = FTJournal_getWord(pucRecord, &bOverflow);
+      ulPathLength = FTJournal_getWord(&pucRecord[JOURNAL_WORD],
+                                       &bOverflow);
+      ulLength = FTJournal_getWord(&pucRecord[2 * JOURNAL_WORD],
+                                   &bOverflow);
+      ulBytes = ulKind & JOURNAL_CONTENTS ? ulLength : 0;
+      if(bOverflow || ulPathLength == 0 || ulPathLength > ulRemaining ||
+         ulBytes > ulRemaining - ulPathLength)
+         return SUCCESS;
+      if(FTJournal_getWord(&pucRecord[3 * JOURNAL_WORD], &bOverflow) !=
+         FTJournal_hash(FTJournal_hash(JOURNAL_HASH_SEED, pucRecord,
+                                       3 * JOURNAL_WORD),
+                        &pucRecord[JOURNAL_WORD * JOURNAL_RECORD_WORDS],
+                        ulPathLength + ulBytes))
+         return SUCCESS;
+
+      pcPath = (const char *)
+               &pucRecord[JOURNAL_WORD * JOURNAL_RECORD_WORDS];
+      if(pcPath[ulPathLength - 1] != '\0')
+         return CORRUPT_FILE;
+      pvContents = NULL;
+      if(ulKind & JOURNAL_CONTENTS)
+         pvContents = &pucRecord[JOURNAL_WORD * JOURNAL_RECORD_WORDS +
+                                 ulPathLength];
+
+      switch(ulKind & JOURNAL_KIND_MASK) {
+         case JOURNAL_INSERT_DIR:
+            iStatus = FT_insertDirIn(oJournal->oFTree, pcPath);
+            break;
+         case JOURNAL_RM_DIR:
+            iStatus = FT_rmDirIn(oJournal->oFTree, pcPath);
+            break;
+         case JOURNAL_INSERT_FILE:
+            iStatus = FT_insertFileIn(oJournal->oFTree, pcPath,
+                                      pvContents, ulLength);
+            break;
+         case JOURNAL_RM_FILE:
+            iStatus = FT_rmFileIn(oJournal->oFTree, pcPath);
+            break;
+         case JOURNAL_REPLACE:
+            iStatus = FT_statIn(oJournal->oFTree, pcPath, &bIsFile,
+                                &ulFileSize);
+            if(iStatus == SUCCESS && !bIsFile)
+               iStatus = NOT_A_FILE;
+            if(iStatus == SUCCESS)
+               (void) FT_replaceFileContentsIn(oJournal->oFTree, pcPath,
+                                               pvContents, ulLength);
+            break;
+         default:
+            iStatus = CORRUPT_FILE;
+      }
+      if(iStatus != SUCCESS)
+         return CORRUPT_FILE;
+      *pulValid += JOURNAL_WORD * JOURNAL_RECORD_WORDS + ulPathLength +
+                   ulBytes;
+   }
+}
+
+/*
+  Reads the whole file pcFilename into a new array, setting *ppucFile
+  to it and *pulSize to its size. Returns SUCCESS, or NO_SUCH_PATH if
+  the file does not exist, or IO_ERROR or MEMORY_ERROR, leaving
+  nothing allocated.
+*/
+static int FTJournal_readFile(const char *pcFilename,
+                              unsigned char **ppucFile,
+                              size_t *pulSize) {
+   struct stat sStat;
+   ssize_t lRead;
+   size_t ulRead = 0;
+   int iFd;
+
+   assert(pcFilename != NULL);
+   assert(ppucFile != NULL);
+   assert(pulSize != NULL);
+
+   *ppucFile = NULL;
+   iFd = open(pcFilename, O_RDONLY);
+   if(iFd < 0)
+      return errno == ENOENT ? NO_SUCH_PATH : IO_ERROR;
+   if(fstat(iFd, &sStat) != 0 || sStat.st_size < 0 ||
+      (unsigned long) sStat.st_size >= (size_t) -1) {
+      (void) close(iFd);
+      return IO_ERROR;
+   }
+   *pulSize = (size_t) sStat.st_size;
+   /* one spare byte, so that an empty file still gets an array */
+   *ppucFile = malloc(*pulSize + 1);
+   if(*ppucFile == NULL) {
+      (void) close(iFd);
+      return MEMORY_ERROR;
+   }
+
+   while(ulRead < *pulSize) {
+      lRead = read(iFd, &(*ppucFile)[ulRead], *pulSize - ulRead);
+      if(lRead < 0 && errno == EINTR)
+         continue;
+      if(lRead <= 0)
+         break;
+      ulRead += (size_t) lRead;
+   }
+   (void) close(iFd);
+   if(ulRead != *pulSize) {
+      free(*ppucFile);
+      *ppucFile = NULL;
+      return IO_ERROR;
+   }
+   return SUCCESS;
+}
+
+/*
+  Sets oJournal's tree to the one in its snapshot file, keeping the
+  contents that FT_newFromFile restores. Returns SUCCESS, or any
+  status of FT_newFromFile.
+*/
+static int FTJournal_loadSnapshot(FTJournal_T oJournal) {
+   void *pvContents;
+   int iStatus;
+
+   assert(oJournal != NULL);
+   assert(oJournal->oFTree == NULL);
+
+   iStatus = FT_newFromFile(oJournal->pcSnapshot, &oJournal->oFTree,
+                            &pvContents);
+   if(iStatus != SUCCESS || pvContents == NULL)
+      return iStatus;
+   if(!DynArray_add(oJournal->oDBuffers, pvContents)) {
+      free(pvContents);
+      return MEMORY_ERROR;
+   }
+   return SUCCESS;
+}
+
+/*
+  Sets oJournal's tree to the snapshot of size ulSize and checksum
+  ulHash, or to an empty tree if both are 0. If the snapshot file is
+  not that snapshot, but the temporary snapshot that a checkpoint
+  writes is, then a crash cut the checkpoint short after it replaced
+  the journal, so the checkpoint is finished by renaming the
+  temporary snapshot over the snapshot. Returns SUCCESS, or
+  CORRUPT_FILE if neither file is the snapshot, or IO_ERROR or
+  MEMORY_ERROR.
+*/
+static int FTJournal_restoreBase(FTJournal_T oJournal, size_t ulSize,
+                                 size_t ulHash) {
+   size_t ulFoundSize;
+   size_t ulFoundHash;
+   int iStatus;
+
+   assert(oJournal != NULL);
+
+   if(ulSize == 0 && ulHash == 0) {
+      oJournal->oFTree = FT_new();
+      return oJournal->oFTree == NULL ? MEMORY_ERROR : SUCCESS;
+   }
+
+   iStatus = FTJournal_identify(oJournal->pcSnapshot, FALSE,
+                                &ulFoundSize, &ulFoundHash);
+   if(iStatus == SUCCESS && ulFoundSize == ulSize &&
+      ulFoundHash == ulHash)
+      return FTJournal_loadSnapshot(oJournal);
+   if(iStatus != SUCCESS && iStatus != NO_SUCH_PATH)
+      return iStatus;
+
+   iStatus = FTJournal_identify(oJournal->pcSnapshotTmp, FALSE,
+                                &ulFoundSize, &ulFoundHash);
+   if(iStatus == NO_SUCH_PATH ||
+      (iStatus == SUCCESS && (ulFoundSize != ulSize ||
+                              ulFoundHash != ulHash)))
+      return CORRUPT_FILE;
+   if(iStatus != SUCCESS)
+      return iStatus;
+   if(rename(oJournal->pcSnapshotTmp, oJournal->pcSnapshot) != 0)
+      return IO_ERROR;
+   iStatus = FTJournal_syncDirectory(oJournal->pcSnapshot);
+   if(iStatus != SUCCESS)
+      return iStatus;
+   return FTJournal_loadSnapshot(oJournal);
+}
+
+/*
+  Restores oJournal's tree from its snapshot and journal files and
+  opens the journal for appending, as FTJournal_open describes.
+  Returns SUCCESS or any status of FTJournal_open.
+*/
+static int FTJournal_restore(FTJournal_T oJournal) {
+   unsigned char *pucJournal;
+   boolean bOverflow = FALSE;
+   size_t ulSize;
+   size_t ulBaseSize;
+   size_t ulHash;
+   size_t ulValid;
+   int iStatus;
+
+   assert(oJournal != NULL);
+
+   iStatus = FTJournal_readFile(oJournal->pcJournal, &pucJournal,
+                                &ulSize);
+
+   /* with no journal, start one over the snapshot, if any */
+   if(iStatus == NO_SUCH_PATH) {
+      iStatus = FTJournal_identify(oJournal->pcSnapshot, FALSE, &ulSize,
+                                   &ulHash);
+      if(iStatus == NO_SUCH_PATH) {
+         ulSize = 0;
+         ulHash = 0;
+      }
+      else if(iStatus != SUCCESS)
+         return iStatus;
+      iStatus = FTJournal_restoreBase(oJournal, ulSize, ulHash);
+      if(iStatus == SUCCESS)
+         iStatus = FTJournal_startJournal(oJournal, ulSize, ulHash);
+      if(iStatus == SUCCESS)
+         iStatus = FTJournal_syncDirectory(oJournal->pcJournal);
+      return iStatus;
+   }
+   if(iStatus != SUCCESS)
+      return iStatus;
+   /* restored files' contents point into the journal */
+   if(!DynArray_add(oJournal->oDBuffers, pucJournal)) {
+      free(pucJournal);
+      return MEMORY_ERROR;
+   }
+
+   if(ulSize < JOURNAL_WORD * JOURNAL_HEADER_WORDS ||
+      memcmp(pucJournal, JOURNAL_MAGIC, JOURNAL_WORD) != 0)
+      return CORRUPT_FILE;
+   ulBaseSize = FTJournal_getWord(&pucJournal[JOURNAL_WORD],
+                                  &bOverflow);
+   ulHash = FTJournal_getWord(&pucJournal[2 * JOURNAL_WORD],
+                              &bOverflow);
+   if(bOverflow)
+      return CORRUPT_FILE;
+   iStatus = FTJournal_restoreBase(oJournal, ulBaseSize, ulHash);
+   if(iStatus != SUCCESS)
+      return iStatus;
+   iStatus = FTJournal_replay(oJournal, pucJournal, ulSize, &ulValid);
+   if(iStatus != SUCCESS)
+      return iStatus;
+
+   /* cut off a record that a crash left incomplete, so that new
+      records follow the last whole one */
+   oJournal->iFd = open(oJournal->pcJournal, O_RDWR);
+   if(oJournal->iFd < 0)
+      return IO_ERROR;
+   if(ulValid < ulSize &&
+      (ftruncate(oJournal->iFd, (off_t) ulValid) != 0 ||
+       fsync(oJournal->iFd) != 0))
+      return IO_ERROR;
+   if(lseek(oJournal->iFd, (off_t) ulValid, SEEK_SET) < 0)
+      return IO_ERROR;
+   return SUCCESS;
+}
+
+/*
+  Returns a new string holding pcName followed by pcSuffix, or NULL
+  if insufficient memory is available.
+*/
+static char *FTJournal_name(const char *pcName, const char *pcSuffix) {
+   char *pcResult;
+
+   assert(pcName != NULL);
+   assert(pcSuffix != NULL);
+
+   pcResult = malloc(strlen(pcName) + strlen(pcSuffix) + 1);
+   if(pcResult == NULL)
+      return NULL;
+   strcpy(pcResult, pcName);
+   strcat(pcResult, pcSuffix);
+   return pcResult;
+}
+
+/* Frees the buffer pvBuffer; a DynArray_map callback. */
+static void FTJournal_freeBuffer(void *pvBuffer, void *pvExtra) {
+   (void) pvExtra;
+
+   free(pvBuffer);
+}
+
+/*
+  Frees oJournal and everything it holds: its tree, its open journal
+  and whatever parts of it were allocated; a partly opened journal
+  may have any field NULL.
+*/
+static void FTJournal_destroy(FTJournal_T oJournal) {
+   assert(oJournal != NULL);
+
+   if(oJournal->iFd >= 0)
+      (void) close(oJournal->iFd);
+   FT_free(oJournal->oFTree);
+   if(oJournal->oDBuffers != NULL) {
+      DynArray_map(oJournal->oDBuffers, FTJournal_freeBuffer, NULL);
+      DynArray_free(oJournal->oDBuffers);
+   }
+   free(oJournal->pucPending);
+   free(oJournal->pucWriting);
+   free(oJournal->pcSnapshot);
+   free(oJournal->pcJournal);
+   free(oJournal->pcSnapshotTmp);
+   free(oJournal->pcJournalTmp);
+   (void) pthread_cond_destroy(&oJournal->oDurableCond);
+   (void) pthread_mutex_destroy(&oJournal->oLock);
+   free(oJournal);
+}
+
+int FTJournal_open(const char *pcSnapshot, const char *pcJournal,
+                   FTJournal_T *poJResult) {
+   FTJournal_T oJournal;
+   int iStatus;
+
+   assert(pcSnapshot != NULL);
+   assert(pcJournal != NULL);
+   assert(poJResult != NULL);
+
+   *poJResult = NULL;
+   oJournal = malloc(sizeof(struct FTJournal));
+   if(oJournal == NULL)
+      return MEMORY_ERROR;
+   if(pthread_mutex_init(&oJournal->oLock, NULL) != 0) {
+      free(oJournal);
+      return MEMORY_ERROR;
+   }
+   if(pthread_cond_init(&oJournal->oDurableCond, NULL) != 0) {
+      (void) pthread_mutex_destroy(&oJournal->oLock);
+      free(oJournal);
+      return MEMORY_ERROR;
+   }
+   oJournal->oFTree = NULL;
+   oJournal->iFd = -1;
+   oJournal->ulPending = 0;
+   oJournal->ulPendingSize = JOURNAL_READ_SIZE;
+   oJournal->ulWritingSize = JOURNAL_READ_SIZE;
+   oJournal->ulAppended = 0;
+   oJournal->ulDurable = 0;
+   oJournal->bFlushing = FALSE;
+   oJournal->iError = SUCCESS;
+   oJournal->oDBuffers = DynArray_new(0);
+   oJournal->pucPending = malloc(oJournal->ulPendingSize);
+   oJournal->pucWriting = malloc(oJournal->ulWritingSize);
+   oJournal->pcSnapshot = FTJournal_name(pcSnapshot, "");
+   oJournal->pcJournal = FTJournal_name(pcJournal, "");
+   oJournal->pcSnapshotTmp = FTJournal_name(pcSnapshot, ".tmp");
+   oJournal->pcJournalTmp = FTJournal_name(pcJournal, ".tmp");
+   if(oJournal->oDBuffers == NULL || oJournal->pucPending == NULL ||
+      oJournal->pucWriting == NULL || oJournal->pcSnapshot == NULL ||
+      oJournal->pcJournal == NULL || oJournal->pcSnapshotTmp == NULL ||
+      oJournal->pcJournalTmp == NULL) {
+      FTJournal_destroy(oJournal);
+      return MEMORY_ERROR;
+   }
+
+   iStatus = FTJournal_restore(oJournal);
+   if(iStatus != SUCCESS) {
+      FTJournal_destroy(oJournal);
+      return iStatus;
+   }
+   *poJResult = oJournal;
+   return SUCCESS;
+}
+
+void FTJournal_close(FTJournal_T oJournal) {
+   if(oJournal == NULL)
+      return;
+   FTJournal_destroy(oJournal);
+}
+
+FT_T FTJournal_getTree(FTJournal_T oJournal) {
+   assert(oJournal != NULL);
+
+   return oJournal->oFTree;
+}
+
+int FTJournal_insertDir(FTJournal_T oJournal, const char *pcPath) {
+   assert(oJournal != NULL);
+   assert(pcPath != NULL);
+
+   return FTJournal_change(oJournal, JOURNAL_INSERT_DIR, pcPath, NULL, 0,
+                           NULL);
+}
+
+int FTJournal_rmDir(FTJournal_T oJournal, const char *pcPath) {
+   assert(oJournal != NULL);
+   assert(pcPath != NULL);
+
+   return FTJournal_change(oJournal, JOURNAL_RM_DIR, pcPath, NULL, 0,
+                           NULL);
+}
+
+int FTJournal_insertFile(FTJournal_T oJournal, const char *pcPath,
+                         void *pvContents, size_t ulLength) {
+   assert(oJournal != NULL);
+   assert(pcPath != NULL);
+
+   return FTJournal_change(oJournal, JOURNAL_INSERT_FILE, pcPath,
+                           pvContents, ulLength, NULL);
+}
+
+int FTJournal_rmFile(FTJournal_T oJournal, const char *pcPath) {
+   assert(oJournal != NULL);
+   assert(pcPath != NULL);
+
+   return FTJournal_change(oJournal, JOURNAL_RM_FILE, pcPath, NULL, 0,
+                           NULL);
+}
+
+int FTJournal_replaceFileContents(FTJournal_T oJournal,
+                                  const char *pcPath,
+                                  void *pvNewContents,
+                                  size_t ulNewLength,
+                                  void **ppvOldContents) {
+   assert(oJournal != NULL);
+   assert(pcPath != NULL);
+   assert(ppvOldContents != NULL);
+
+   *ppvOldContents = NULL;
+   return FTJournal_change(oJournal, JOURNAL_REPLACE, pcPath,
+                           pvNewContents, ulNewLength, ppvOldContents);
+}
+
+/* Returns the journal record kind of eKind, or 0 if it is a lookup,
+   which is not journaled. */
+static int FTJournal_kind(enum FT_OpKind eKind) {
+   switch(eKind) {
+      case FT_OP_INSERT_DIR:
+         return JOURNAL_INSERT_DIR;
+      case FT_OP_INSERT_FILE:
+         return JOURNAL_INSERT_FILE;
+      case FT_OP_RM_DIR:
+         return JOURNAL_RM_DIR;
+      case FT_OP_RM_FILE:
+         return JOURNAL_RM_FILE;
+      default:
+         return 0;
+   }
+}
+
+int FTJournal_applyBatch(FTJournal_T oJournal, struct FT_Op *psOps,
+                         size_t ulNumOps) {
+   size_t ulSize = 0;
+   size_t ulRecordSize;
+   int iStatus;
+   size_t i;
+
+   assert(oJournal != NULL);
+   assert(psOps != NULL || ulNumOps == 0);
+
+   for(i = 0; i < ulNumOps; i++) {
+      if(FTJournal_kind(psOps[i].eKind) == 0)
+         continue;
+      ulRecordSize = FTJournal_recordSize(psOps[i].pcPath,
+         psOps[i].eKind == FT_OP_INSERT_FILE &&
+         psOps[i].pvContents != NULL ? psOps[i].ulLength : 0);
+      if(ulSize > (size_t) -1 - ulRecordSize)
+         return MEMORY_ERROR;
+      ulSize += ulRecordSize;
+   }
+
+   (void) pthread_mutex_lock(&oJournal->oLock);
+   iStatus = oJournal->iError;
+   if(iStatus == SUCCESS)
+      iStatus = FTJournal_reserve(oJournal, ulSize);
+   if(iStatus != SUCCESS) {
+      (void) pthread_mutex_unlock(&oJournal->oLock);
+      return iStatus;
+   }
+
+   FT_applyBatch(oJournal->oFTree, psOps, ulNumOps);
+   for(i = 0; i < ulNumOps; i++)
+      if(FTJournal_kind(psOps[i].eKind) != 0 &&
+         psOps[i].iStatus == SUCCESS)
+         FTJournal_append(oJournal, FTJournal_kind(psOps[i].eKind),
+                          psOps[i].pcPath,
+                          psOps[i].eKind == FT_OP_INSERT_FILE ?
+                          psOps[i].pvContents : NULL,
+                          psOps[i].eKind == FT_OP_INSERT_FILE ?
+                          psOps[i].ulLength : 0);
+   iStatus = FTJournal_commit(oJournal, oJournal->ulAppended);
+   (void) pthread_mutex_unlock(&oJournal->oLock);
+   return iStatus;
+}
+
+int FTJournal_checkpoint(FTJournal_T oJournal) {
+   size_t ulSize;
+   size_t ulHash;
+   int iStatus;
+
+   assert(oJournal != NULL);
+
+   (void) pthread_mutex_lock(&oJournal->oLock);
+   while(oJournal->bFlushing)
+      (void) pthread_cond_wait(&oJournal->oDurableCond,
+                               &oJournal->oLock);
+
+   iStatus = oJournal->iError;
+   if(iStatus == SUCCESS)
+      iStatus = FT_saveIn(oJournal->oFTree, oJournal->pcSnapshotTmp);
+   if(iStatus == SUCCESS)
+      iStatus = FTJournal_identify(oJournal->pcSnapshotTmp, TRUE,
+                                   &ulSize, &ulHash);
+   if(iStatus == SUCCESS)
+      iStatus = FTJournal_startJournal(oJournal, ulSize, ulHash);
+   if(iStatus != SUCCESS) {
+      (void) pthread_mutex_unlock(&oJournal->oLock);
+      return iStatus;
+   }
+
+   /* the new snapshot holds every change made so far, including
+      those still waiting for a group commit, which thus need not
+      reach the new journal */
+   oJournal->ulPending = 0;
+   iStatus = FTJournal_syncDirectory(oJournal->pcJournal);
+   if(iStatus == SUCCESS)
+      oJournal->ulDurable = oJournal->ulAppended;
+   else
+      oJournal->iError = IO_ERROR;
+   (void) pthread_cond_broadcast(&oJournal->oDurableCond);
+
+   if(iStatus == SUCCESS &&
+      rename(oJournal->pcSnapshotTmp, oJournal->pcSnapshot) != 0)
+      iStatus = IO_ERROR;
+   if(iStatus == SUCCESS)
+      iStatus = FTJournal_syncDirectory(oJournal->pcSnapshot);
+   (void) pthread_mutex_unlock(&oJournal->oLock);
+   return iStatus;
+}
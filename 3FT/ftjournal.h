@@ -0,0 +1,119 @@
+/*--------------------------------------------------------------------*/
+/* ftjournal.h                                                        */
+/* Author: Ishaan Javali & Jack Zhang                                 */
+/*--------------------------------------------------------------------*/
+
+#ifndef FTJOURNAL_INCLUDED
+#define FTJOURNAL_INCLUDED
+
+#include <stddef.h>
+#include "a4def.h"
+#include "ft.h"
+
+/*
+  An FTJournal_T makes the changes to a File Tree durable without
+  writing a snapshot after each one. The tree lives in memory and is
+  restored at startup from a snapshot file (see FT_save) plus a
+  journal file: every change that succeeds is appended to the journal
+  as a record holding the operation, its path and its contents, and
+  the call that made it returns only once the record is on stable
+  storage. Reopening the journal loads the snapshot and replays the
+  records on top of it.
+
+  Durability costs one fsync, so the journal commits in groups: while
+  one caller writes and syncs the records appended so far, others
+  append theirs behind it, and the next sync covers all of them.
+  Threads making changes at once thus share syncs, and
+  FTJournal_applyBatch logs a whole batch of changes with a single
+  sync. Each record carries a checksum, so replay stops cleanly at a
+  record cut short by a crash and discards it; such a record's call
+  had not returned.
+
+  FTJournal_checkpoint writes a new snapshot and empties the journal.
+  The journal's header names the snapshot it applies to by the
+  snapshot's size and checksum, and the new journal replaces the old
+  one before the new snapshot replaces the old, so a crash at any
+  point during a checkpoint leaves a snapshot and journal that agree.
+
+  The FTJournal_* functions other than FTJournal_close may be called
+  from any number of threads at once. Changes are applied to the tree
+  one at a time, in the order they are journaled.
+*/
+typedef struct FTJournal *FTJournal_T;
+
+/*
+  Restores the File Tree in the snapshot file pcSnapshot and the
+  journal file pcJournal, creating an empty journal, and starting
+  from an empty tree, if pcJournal does not exist. Discards any
+  record at the end of the journal that a crash cut short. Returns an
+  int SUCCESS status and sets *poJResult to be the new FTJournal_T if
+  successful. Otherwise, sets *poJResult to NULL and returns status:
+  * IO_ERROR if a file could not be opened, read, written or synced
+  * CORRUPT_FILE if the snapshot is not the one the journal applies
+                 to, or either file is not well-formed
+  * MEMORY_ERROR if memory could not be allocated to complete request
+*/
+int FTJournal_open(const char *pcSnapshot, const char *pcJournal,
+                   FTJournal_T *poJResult);
+
+/*
+  Closes oJournal, freeing it and its File Tree. Every change it
+  returned from is already durable.
+*/
+void FTJournal_close(FTJournal_T oJournal);
+
+/*
+  Returns oJournal's File Tree, for lookups. Changes made to it other
+  than through oJournal are not journaled. The tree was not made by
+  FT_newConcurrent, so lookups in it must not overlap changes made
+  through oJournal. The contents of files restored from the snapshot
+  or the journal belong to oJournal and are freed by FTJournal_close;
+  those of other files belong to the client, as usual.
+*/
+FT_T FTJournal_getTree(FTJournal_T oJournal);
+
+/*
+  Each of the following makes its change, as FT_xIn does, and, if it
+  succeeded, returns once the change is durable. If the journal could
+  not be written or synced, returns IO_ERROR: the change may then
+  remain in memory without being durable, and every later change
+  through oJournal fails with IO_ERROR without being made.
+*/
+int FTJournal_insertDir(FTJournal_T oJournal, const char *pcPath);
+int FTJournal_rmDir(FTJournal_T oJournal, const char *pcPath);
+int FTJournal_insertFile(FTJournal_T oJournal, const char *pcPath,
+                         void *pvContents, size_t ulLength);
+int FTJournal_rmFile(FTJournal_T oJournal, const char *pcPath);
+
+/*
+  Replaces the contents of file pcPath, as FT_replaceFileContentsIn
+  does, and sets *ppvOldContents to its old contents. Returns SUCCESS
+  once the change is durable, or the status that FT_statIn returns
+  for pcPath, or NOT_A_FILE if pcPath is a directory, leaving
+  *ppvOldContents NULL, or IO_ERROR as the functions above do.
+*/
+int FTJournal_replaceFileContents(FTJournal_T oJournal,
+                                  const char *pcPath,
+                                  void *pvNewContents,
+                                  size_t ulNewLength,
+                                  void **ppvOldContents);
+
+/*
+  Carries out the ulNumOps operations in psOps, as FT_applyBatch
+  does, and returns SUCCESS once all their changes that succeeded are
+  durable, which takes a single sync; or returns IO_ERROR as the
+  functions above do.
+*/
+int FTJournal_applyBatch(FTJournal_T oJournal, struct FT_Op *psOps,
+                         size_t ulNumOps);
+
+/*
+  Writes a snapshot of oJournal's File Tree to its snapshot file and
+  empties its journal, holding off changes meanwhile. Returns
+  SUCCESS, or IO_ERROR if a file could not be written or synced, in
+  which case the old snapshot and journal still restore the tree, or
+  MEMORY_ERROR if memory could not be allocated to complete request.
+*/
+int FTJournal_checkpoint(FTJournal_T oJournal);
+
+#endif
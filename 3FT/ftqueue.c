@@ -0,0 +1,355 @@
+/*--------------------------------------------------------------------*/
+/* ftqueue.c                                                          */
+/* Author: Ishaan Javali & Jack Zhang                                 */
+/*--------------------------------------------------------------------*/
+
+#include <assert.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include "ftqueue.h"
+
+/* The most operations the worker takes out of the ring at once. */
+enum { MAX_BATCH = 64 };
+
+/* A submitted operation, and what to do once it has completed. */
+struct entry {
+   struct FT_Op *psOp;
+   void (*pfDone)(struct FT_Op *psOp, void *pvExtra);
+   void *pvExtra;
+};
+
+/*
+  An operation counts against the capacity from when it is submitted
+  until its callback has run or, if it has none, until it is reaped,
+  so neither ring can overflow.
+*/
+struct FTQueue {
+   /* the File Tree that the operations apply to */
+   FT_T oFTree;
+   /* the capacity of both rings */
+   size_t ulCapacity;
+   /* the ring of submitted operations, the index of the oldest, and
+      how many there are */
+   struct entry *psSubmitted;
+   size_t ulSubmittedHead;
+   size_t ulSubmitted;
+   /* the ring of completed operations without callbacks, the index
+      of the oldest, and how many there are */
+   struct FT_Op **ppsCompleted;
+   size_t ulCompletedHead;
+   size_t ulCompleted;
+   /* the operations that count against the capacity */
+   size_t ulInFlight;
+   /* the operations without callbacks that are not yet reaped */
+   size_t ulAwaiting;
+   /* the operations the worker has taken out but not completed */
+   size_t ulRunning;
+   /* 1 once FTQueue_free has asked the worker to stop */
+   int iShutdown;
+   /* a lock guarding the fields above, a condition the worker waits
+      on for operations, and one that clients wait on for progress */
+   pthread_mutex_t oLock;
+   pthread_cond_t oSubmittedCond;
+   pthread_cond_t oProgressCond;
+   /* the worker thread */
+   pthread_t oWorker;
+};
+
+/* Returns TRUE if eKind changes the tree and FALSE if it only reads
+   it. */
+static boolean FTQueue_isChange(enum FT_OpKind eKind) {
+   return (boolean) (eKind != FT_OP_STAT &&
+                     eKind != FT_OP_GET_CONTENTS);
+}
+
+/*
+  Returns TRUE if operations on absolute paths pcPath1 and pcPath2
+  may affect each other: if one path is the other or one of its
+  ancestors, or if they have different roots, in which case one of
+  them might create or remove the root that decides whether the other
+  conflicts. Returns FALSE for paths that part ways below a common
+  directory.
+*/
+static boolean FTQueue_related(const char *pcPath1,
+                               const char *pcPath2) {
+   boolean bBelowRoot = FALSE;
+
+   assert(pcPath1 != NULL);
+   assert(pcPath2 != NULL);
+
+   while(*pcPath1 != '\0' && *pcPath1 == *pcPath2) {
+      if(*pcPath1 == '/')
+         bBelowRoot = TRUE;
+      pcPath1++;
+      pcPath2++;
+   }
+   if(*pcPath1 == '\0' && (*pcPath2 == '\0' || *pcPath2 == '/'))
+      return TRUE;
+   if(*pcPath2 == '\0' && *pcPath1 == '/')
+      return TRUE;
+   return (boolean) !bBelowRoot;
+}
+
+/* Returns TRUE if swapping psEntry1's and psEntry2's operations could
+   change their results. */
+static boolean FTQueue_conflict(const struct entry *psEntry1,
+                                const struct entry *psEntry2) {
+   assert(psEntry1 != NULL);
+   assert(psEntry2 != NULL);
+
+   if(!FTQueue_isChange(psEntry1->psOp->eKind) &&
+      !FTQueue_isChange(psEntry2->psOp->eKind))
+      return FALSE;
+   return FTQueue_related(psEntry1->psOp->pcPath,
+                          psEntry2->psOp->pcPath);
+}
+
+/* Compares the paths of the operations of entries pvEntry1 and
+   pvEntry2 with strcmp; a qsort comparison function. */
+static int FTQueue_compare(const void *pvEntry1, const void *pvEntry2) {
+   const struct entry *psEntry1 = pvEntry1;
+   const struct entry *psEntry2 = pvEntry2;
+
+   return strcmp(psEntry1->psOp->pcPath, psEntry2->psOp->pcPath);
+}
+
+/*
+  Reorders the ulLength entries of psBatch so that operations with a
+  common path prefix are adjacent, without changing their results.
+  The batch is cut into runs of operations of which no two conflict,
+  and each run is sorted by path; runs keep their order.
+*/
+static void FTQueue_group(struct entry *psBatch, size_t ulLength) {
+   size_t ulStart = 0;
+   size_t ulEnd;
+   size_t i;
+   boolean bConflict;
+
+   assert(psBatch != NULL);
+
+   while(ulStart < ulLength) {
+      bConflict = FALSE;
+      for(ulEnd = ulStart + 1; ulEnd < ulLength; ulEnd++) {
+         for(i = ulStart; i < ulEnd && !bConflict; i++)
+            bConflict = FTQueue_conflict(&psBatch[i], &psBatch[ulEnd]);
+         if(bConflict)
+            break;
+      }
+      qsort(&psBatch[ulStart], ulEnd - ulStart, sizeof(struct entry),
+            FTQueue_compare);
+      ulStart = ulEnd;
+   }
+}
+
+/*
+  Carries out the ulLength operations of psBatch on oQueue's tree with
+  one call of FT_applyBatch, then completes them.
+*/
+static void FTQueue_process(FTQueue_T oQueue, struct entry *psBatch,
+                            size_t ulLength) {
+   struct FT_Op asOps[MAX_BATCH];
+   size_t i;
+
+   assert(oQueue != NULL);
+   assert(psBatch != NULL);
+   assert(ulLength <= MAX_BATCH);
+
+   FTQueue_group(psBatch, ulLength);
+   for(i = 0; i < ulLength; i++)
+      asOps[i] = *psBatch[i].psOp;
+   FT_applyBatch(oQueue->oFTree, asOps, ulLength);
+   for(i = 0; i < ulLength; i++) {
+      *psBatch[i].psOp = asOps[i];
+      if(psBatch[i].pfDone != NULL)
+         (*psBatch[i].pfDone)(psBatch[i].psOp, psBatch[i].pvExtra);
+   }
+
+   (void) pthread_mutex_lock(&oQueue->oLock);
+   for(i = 0; i < ulLength; i++) {
+      if(psBatch[i].pfDone != NULL)
+         oQueue->ulInFlight--;
+      else {
+         oQueue->ppsCompleted[(oQueue->ulCompletedHead +
+                               oQueue->ulCompleted) %
+                              oQueue->ulCapacity] = psBatch[i].psOp;
+         oQueue->ulCompleted++;
+      }
+   }
+   oQueue->ulRunning = 0;
+   (void) pthread_cond_broadcast(&oQueue->oProgressCond);
+   (void) pthread_mutex_unlock(&oQueue->oLock);
+}
+
+/*
+  The body of the worker thread of pvQueue: takes batches of
+  submitted operations out of the ring and processes them until the
+  queue is freed and the ring is empty.
+*/
+static void *FTQueue_work(void *pvQueue) {
+   FTQueue_T oQueue = pvQueue;
+   struct entry asBatch[MAX_BATCH];
+   size_t ulLength;
+   size_t i;
+
+   assert(oQueue != NULL);
+
+   for(;;) {
+      (void) pthread_mutex_lock(&oQueue->oLock);
+      while(oQueue->ulSubmitted == 0 && !oQueue->iShutdown)
+         (void) pthread_cond_wait(&oQueue->oSubmittedCond,
+                                  &oQueue->oLock);
+      if(oQueue->ulSubmitted == 0) {
+         (void) pthread_mutex_unlock(&oQueue->oLock);
+         return NULL;
+      }
+      ulLength = oQueue->ulSubmitted < MAX_BATCH ? oQueue->ulSubmitted
+                                                 : MAX_BATCH;
+      for(i = 0; i < ulLength; i++) {
+         asBatch[i] = oQueue->psSubmitted[oQueue->ulSubmittedHead];
+         oQueue->ulSubmittedHead = (oQueue->ulSubmittedHead + 1) %
+                                   oQueue->ulCapacity;
+      }
+      oQueue->ulSubmitted -= ulLength;
+      oQueue->ulRunning = ulLength;
+      (void) pthread_mutex_unlock(&oQueue->oLock);
+
+      FTQueue_process(oQueue, asBatch, ulLength);
+   }
+}
+
+/* Frees oQueue and its rings, whichever of them exist. */
+static void FTQueue_freeRings(FTQueue_T oQueue) {
+   assert(oQueue != NULL);
+
+   free(oQueue->psSubmitted);
+   free(oQueue->ppsCompleted);
+   free(oQueue);
+}
+
+FTQueue_T FTQueue_new(FT_T oFTree, size_t ulCapacity) {
+   FTQueue_T oQueue;
+
+   assert(oFTree != NULL);
+
+   if(ulCapacity == 0)
+      return NULL;
+
+   oQueue = malloc(sizeof(struct FTQueue));
+   if(oQueue == NULL)
+      return NULL;
+   oQueue->oFTree = oFTree;
+   oQueue->ulCapacity = ulCapacity;
+   oQueue->ulSubmittedHead = 0;
+   oQueue->ulSubmitted = 0;
+   oQueue->ulCompletedHead = 0;
+   oQueue->ulCompleted = 0;
+   oQueue->ulInFlight = 0;
+   oQueue->ulAwaiting = 0;
+   oQueue->ulRunning = 0;
+   oQueue->iShutdown = 0;
+
+   oQueue->psSubmitted = malloc(ulCapacity * sizeof(struct entry));
+   oQueue->ppsCompleted = malloc(ulCapacity * sizeof(struct FT_Op *));
+   if(oQueue->psSubmitted == NULL || oQueue->ppsCompleted == NULL ||
+      pthread_mutex_init(&oQueue->oLock, NULL) != 0) {
+      FTQueue_freeRings(oQueue);
+      return NULL;
+   }
+   if(pthread_cond_init(&oQueue->oSubmittedCond, NULL) != 0) {
+      (void) pthread_mutex_destroy(&oQueue->oLock);
+      FTQueue_freeRings(oQueue);
+      return NULL;
+   }
+   if(pthread_cond_init(&oQueue->oProgressCond, NULL) != 0) {
+      (void) pthread_cond_destroy(&oQueue->oSubmittedCond);
+      (void) pthread_mutex_destroy(&oQueue->oLock);
+      FTQueue_freeRings(oQueue);
+      return NULL;
+   }
+   if(pthread_create(&oQueue->oWorker, NULL, FTQueue_work, oQueue)
+      != 0) {
+      (void) pthread_cond_destroy(&oQueue->oProgressCond);
+      (void) pthread_cond_destroy(&oQueue->oSubmittedCond);
+      (void) pthread_mutex_destroy(&oQueue->oLock);
+      FTQueue_freeRings(oQueue);
+      return NULL;
+   }
+   return oQueue;
+}
+
+void FTQueue_free(FTQueue_T oQueue) {
+   if(oQueue == NULL)
+      return;
+
+   (void) pthread_mutex_lock(&oQueue->oLock);
+   oQueue->iShutdown = 1;
+   (void) pthread_cond_signal(&oQueue->oSubmittedCond);
+   (void) pthread_mutex_unlock(&oQueue->oLock);
+   (void) pthread_join(oQueue->oWorker, NULL);
+
+   (void) pthread_cond_destroy(&oQueue->oProgressCond);
+   (void) pthread_cond_destroy(&oQueue->oSubmittedCond);
+   (void) pthread_mutex_destroy(&oQueue->oLock);
+   FTQueue_freeRings(oQueue);
+}
+
+void FTQueue_submit(FTQueue_T oQueue, struct FT_Op *psOp,
+                    void (*pfDone)(struct FT_Op *psOp, void *pvExtra),
+                    void *pvExtra) {
+   struct entry *psEntry;
+
+   assert(oQueue != NULL);
+   assert(psOp != NULL);
+   assert(psOp->pcPath != NULL);
+
+   (void) pthread_mutex_lock(&oQueue->oLock);
+   while(oQueue->ulInFlight == oQueue->ulCapacity)
+      (void) pthread_cond_wait(&oQueue->oProgressCond, &oQueue->oLock);
+   psEntry = &oQueue->psSubmitted[(oQueue->ulSubmittedHead +
+                                   oQueue->ulSubmitted) %
+                                  oQueue->ulCapacity];
+   psEntry->psOp = psOp;
+   psEntry->pfDone = pfDone;
+   psEntry->pvExtra = pvExtra;
+   oQueue->ulSubmitted++;
+   oQueue->ulInFlight++;
+   if(pfDone == NULL)
+      oQueue->ulAwaiting++;
+   (void) pthread_cond_signal(&oQueue->oSubmittedCond);
+   (void) pthread_mutex_unlock(&oQueue->oLock);
+}
+
+struct FT_Op *FTQueue_reap(FTQueue_T oQueue, boolean bWait) {
+   struct FT_Op *psOp;
+
+   assert(oQueue != NULL);
+
+   (void) pthread_mutex_lock(&oQueue->oLock);
+   while(oQueue->ulCompleted == 0) {
+      if(!bWait || oQueue->ulAwaiting == 0) {
+         (void) pthread_mutex_unlock(&oQueue->oLock);
+         return NULL;
+      }
+      (void) pthread_cond_wait(&oQueue->oProgressCond, &oQueue->oLock);
+   }
+   psOp = oQueue->ppsCompleted[oQueue->ulCompletedHead];
+   oQueue->ulCompletedHead = (oQueue->ulCompletedHead + 1) %
+                             oQueue->ulCapacity;
+   oQueue->ulCompleted--;
+   oQueue->ulAwaiting--;
+   oQueue->ulInFlight--;
+   /* a submitter may be waiting for room */
+   (void) pthread_cond_broadcast(&oQueue->oProgressCond);
+   (void) pthread_mutex_unlock(&oQueue->oLock);
+   return psOp;
+}
+
+void FTQueue_flush(FTQueue_T oQueue) {
+   assert(oQueue != NULL);
+
+   (void) pthread_mutex_lock(&oQueue->oLock);
+   while(oQueue->ulSubmitted > 0 || oQueue->ulRunning > 0)
+      (void) pthread_cond_wait(&oQueue->oProgressCond, &oQueue->oLock);
+   (void) pthread_mutex_unlock(&oQueue->oLock);
+}
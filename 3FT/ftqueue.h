@@ -0,0 +1,77 @@
+/*--------------------------------------------------------------------*/
+/* ftqueue.h                                                          */
+/* Author: Ishaan Javali & Jack Zhang                                 */
+/*--------------------------------------------------------------------*/
+
+#ifndef FTQUEUE_INCLUDED
+#define FTQUEUE_INCLUDED
+
+#include <stddef.h>
+#include "a4def.h"
+#include "ft.h"
+
+/*
+  An FTQueue_T carries out operations on a File Tree asynchronously.
+  Clients submit operations, described by struct FT_Op (see ft.h),
+  into a ring of bounded capacity, and a dedicated worker thread
+  takes them out in batches and applies each batch with one call of
+  FT_applyBatch, so that fixed per-call costs such as taking the
+  tree's lock are paid once per batch. Within a batch, the worker
+  reorders operations so that those with a common path prefix are
+  carried out one after another, but never reorders two operations
+  whose result could depend on their order: that is, a change and
+  another operation on the same path, on one of its ancestors or
+  descendants, or under a different root. Each completed operation
+  is either passed to the callback given when it was submitted, on
+  the worker thread, or, if it had none, put in a completion queue
+  from which clients take it with FTQueue_reap.
+
+  The struct FT_Op of an operation and the path it names belong to
+  the client, which must not change or free them until the operation
+  has completed. Unless the File Tree was returned by
+  FT_newConcurrent, no other thread may use it while the queue
+  exists. The FTQueue_* functions may be called from any number of
+  client threads at once, but not from inside a callback.
+*/
+typedef struct FTQueue *FTQueue_T;
+
+/*
+  Returns a new FTQueue_T that carries out operations on oFTree,
+  with at most ulCapacity operations submitted but not yet completed
+  and reaped at any time, or NULL if ulCapacity is 0, insufficient
+  memory is available, or the worker thread could not be started.
+*/
+FTQueue_T FTQueue_new(FT_T oFTree, size_t ulCapacity);
+
+/*
+  Waits for every operation submitted to oQueue to complete, then
+  stops its worker and frees oQueue. Completed operations that were
+  not reaped are simply forgotten.
+*/
+void FTQueue_free(FTQueue_T oQueue);
+
+/*
+  Submits the operation psOp to oQueue, first waiting while the queue
+  is at capacity. Once psOp has completed, (*pfDone)(psOp, pvExtra)
+  is called on the worker thread if pfDone is not NULL; otherwise,
+  psOp is put in the completion queue.
+*/
+void FTQueue_submit(FTQueue_T oQueue, struct FT_Op *psOp,
+                    void (*pfDone)(struct FT_Op *psOp, void *pvExtra),
+                    void *pvExtra);
+
+/*
+  Removes and returns the oldest operation in oQueue's completion
+  queue. If the completion queue is empty, waits for an operation to
+  complete if bWait is TRUE and an operation without a callback is
+  still outstanding, and returns NULL otherwise.
+*/
+struct FT_Op *FTQueue_reap(FTQueue_T oQueue, boolean bWait);
+
+/*
+  Waits until every operation submitted to oQueue so far has
+  completed.
+*/
+void FTQueue_flush(FTQueue_T oQueue);
+
+#endif
@@ -0,0 +1,681 @@
+/*--------------------------------------------------------------------*/
+/* ftshard.c                                                          */
+/* Author: Ishaan Javali & Jack Zhang                                 */
+/*--------------------------------------------------------------------*/
+
+/* for pthread_rwlock_t, which C90 mode does not declare otherwise */
+#define _POSIX_C_SOURCE 200112L
+
+#include <assert.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include "ftshard.h"
+#include "strsort.h"
+
+/* One shard: an independent File Tree and the lock that guards it. */
+struct shard {
+   FT_T oFTree;
+   pthread_rwlock_t oLock;
+};
+
+/*
+  Every shard holds the same directories and files above the sharding
+  depth, and every directory or file at or below it is in exactly the
+  shard that its first ulDepth components hash to. Whoever changes the
+  shared part holds every shard's lock, taken in index order.
+*/
+struct FTShard {
+   /* the number of shards and the sharding depth */
+   size_t ulShards;
+   size_t ulDepth;
+   /* the shards */
+   struct shard *psShards;
+};
+
+/*
+  Where a path belongs, as found by FTShard_locate: in shard ulShard,
+  or in every shard if ulShard is the number of shards.
+*/
+struct location {
+   size_t ulShard;
+   /* the length of the path's first ulDepth - 1 components, which
+      name the directory that must exist in ulShard before a path
+      below it is inserted there */
+   size_t ulParent;
+};
+
+/*
+  Where FTShard_toString is in the string of one shard. The string is
+  taken one block at a time: a line above the sharding depth, or a
+  line at the sharding depth together with the lines of its subtree,
+  which no other shard has.
+*/
+struct cursor {
+   /* the shard's File Tree and its string representation */
+   FT_T oFTree;
+   char *pcString;
+   /* the first line of the current block, with its newline replaced
+      by '\0', or NULL once the string is used up */
+   char *pcHead;
+   /* the end of the current block */
+   char *pcBlockEnd;
+   /* whether the first line of the block names a file */
+   boolean bIsFile;
+};
+
+/*
+  Sets *psLocation to where pcPath belongs in oShards. Returns SUCCESS,
+  or BAD_PATH if pcPath is not a well-formatted path.
+*/
+static int FTShard_locate(FTShard_T oShards, const char *pcPath,
+                          struct location *psLocation) {
+   /* 32-bit FNV-1a */
+   unsigned long ulHash = 2166136261UL;
+   size_t ulComponents = 1;
+   size_t i;
+
+   assert(oShards != NULL);
+   assert(pcPath != NULL);
+   assert(psLocation != NULL);
+
+   psLocation->ulParent = 0;
+   for(i = 0; pcPath[i] != '\0'; i++) {
+      if(pcPath[i] == '/') {
+         if(i == 0 || pcPath[i - 1] == '/' || pcPath[i + 1] == '\0')
+            return BAD_PATH;
+         if(ulComponents == oShards->ulDepth)
+            break;
+         ulComponents++;
+         if(ulComponents == oShards->ulDepth)
+            psLocation->ulParent = i;
+      }
+      ulHash = ((ulHash ^ (unsigned char) pcPath[i]) * 16777619UL) &
+               0xffffffffUL;
+   }
+   if(i == 0)
+      return BAD_PATH;
+
+   /* validate the rest of the path, which does not affect the hash */
+   for(; pcPath[i] != '\0'; i++)
+      if(pcPath[i] == '/' &&
+         (pcPath[i - 1] == '/' || pcPath[i + 1] == '\0'))
+         return BAD_PATH;
+
+   if(ulComponents < oShards->ulDepth)
+      psLocation->ulShard = oShards->ulShards;
+   else
+      psLocation->ulShard = (size_t) (ulHash % oShards->ulShards);
+   return SUCCESS;
+}
+
+/* Takes the lock of every shard of oShards, exclusive if bWrite is
+   TRUE and shared otherwise. */
+static void FTShard_lockAll(FTShard_T oShards, boolean bWrite) {
+   size_t i;
+
+   assert(oShards != NULL);
+
+   for(i = 0; i < oShards->ulShards; i++) {
+      if(bWrite)
+         (void) pthread_rwlock_wrlock(&oShards->psShards[i].oLock);
+      else
+         (void) pthread_rwlock_rdlock(&oShards->psShards[i].oLock);
+   }
+}
+
+/* Releases the locks that FTShard_lockAll took. */
+static void FTShard_unlockAll(FTShard_T oShards) {
+   size_t i;
+
+   assert(oShards != NULL);
+
+   for(i = oShards->ulShards; i > 0; i--)
+      (void) pthread_rwlock_unlock(&oShards->psShards[i - 1].oLock);
+}
+
+/*
+  Removes the directory or file that pcPath names (a file if bIsFile
+  is TRUE) from the first ulCount shards of oShards. Returns the status
+  of the removal from shard 0, as every shard holds the same
+  directories and files above the sharding depth.
+*/
+static int FTShard_removeEverywhere(FTShard_T oShards,
+                                    const char *pcPath,
+                                    boolean bIsFile, size_t ulCount) {
+   int iStatus = SUCCESS;
+   int iShardStatus;
+   size_t i;
+
+   assert(oShards != NULL);
+   assert(pcPath != NULL);
+
+   for(i = 0; i < ulCount; i++) {
+      if(bIsFile)
+         iShardStatus = FT_rmFileIn(oShards->psShards[i].oFTree, pcPath);
+      else
+         iShardStatus = FT_rmDirIn(oShards->psShards[i].oFTree, pcPath);
+      if(i == 0)
+         iStatus = iShardStatus;
+   }
+   return iStatus;
+}
+
+/*
+  Inserts the directory or file whose path is the first ulLength
+  characters of pcPath into every shard of oShards, as FT_insertDirIn
+  or, if bIsFile is TRUE, FT_insertFileIn does. The caller must hold
+  every shard's lock exclusively. On SUCCESS, sets *pulNew to the
+  length of the shortest prefix of the path that did not exist before,
+  which is what FTShard_removeEverywhere must remove to undo the
+  insertion. On failure, leaves every shard unchanged.
+*/
+static int FTShard_insertEverywhere(FTShard_T oShards,
+                                    const char *pcPath, size_t ulLength,
+                                    boolean bIsFile, void *pvContents,
+                                    size_t ulContentsLength,
+                                    size_t *pulNew) {
+   FT_T oFTree;
+   char *pcCopy;
+   char cSaved;
+   size_t ulNew;
+   int iStatus = SUCCESS;
+   size_t i;
+
+   assert(oShards != NULL);
+   assert(pcPath != NULL);
+   assert(pulNew != NULL);
+
+   pcCopy = malloc(ulLength + 1);
+   if(pcCopy == NULL)
+      return MEMORY_ERROR;
+   memcpy(pcCopy, pcPath, ulLength);
+   pcCopy[ulLength] = '\0';
+
+   /* find the first of the path's prefixes that shard 0, and so every
+      shard, lacks */
+   oFTree = oShards->psShards[0].oFTree;
+   for(ulNew = 0; ulNew < ulLength; ulNew++) {
+      if(pcCopy[ulNew] != '/')
+         continue;
+      pcCopy[ulNew] = '\0';
+      if(!FT_containsDirIn(oFTree, pcCopy)) {
+         pcCopy[ulNew] = '/';
+         break;
+      }
+      pcCopy[ulNew] = '/';
+   }
+
+   for(i = 0; i < oShards->ulShards && iStatus == SUCCESS; i++) {
+      oFTree = oShards->psShards[i].oFTree;
+      if(bIsFile)
+         iStatus = FT_insertFileIn(oFTree, pcCopy, pvContents,
+                                   ulContentsLength);
+      else
+         iStatus = FT_insertDirIn(oFTree, pcCopy);
+   }
+
+   /* only running out of memory can fail in a shard after the first,
+      so undo the shards that succeeded */
+   if(iStatus != SUCCESS && i > 1) {
+      cSaved = pcCopy[ulNew];
+      pcCopy[ulNew] = '\0';
+      (void) FTShard_removeEverywhere(oShards, pcCopy,
+                                      (boolean) (bIsFile &&
+                                                 ulNew == ulLength),
+                                      i - 1);
+      pcCopy[ulNew] = cSaved;
+   }
+
+   free(pcCopy);
+   *pulNew = ulNew;
+   return iStatus;
+}
+
+/*
+  Inserts a directory or, if bIsFile is TRUE, a file with contents
+  pvContents of ulLength bytes, at pcPath in oShards.
+*/
+static int FTShard_insert(FTShard_T oShards, const char *pcPath,
+                          boolean bIsFile, void *pvContents,
+                          size_t ulLength) {
+   struct location sLocation;
+   struct shard *psShard;
+   char *pcParent;
+   boolean bHasParent;
+   size_t ulNew = 0;
+   int iParentStatus;
+   int iStatus;
+
+   assert(oShards != NULL);
+   assert(pcPath != NULL);
+
+   iStatus = FTShard_locate(oShards, pcPath, &sLocation);
+   if(iStatus != SUCCESS)
+      return iStatus;
+
+   if(sLocation.ulShard == oShards->ulShards) {
+      FTShard_lockAll(oShards, TRUE);
+      iStatus = FTShard_insertEverywhere(oShards, pcPath, strlen(pcPath),
+                                         bIsFile, pvContents, ulLength,
+                                         &ulNew);
+      FTShard_unlockAll(oShards);
+      return iStatus;
+   }
+
+   pcParent = malloc(sLocation.ulParent + 1);
+   if(pcParent == NULL)
+      return MEMORY_ERROR;
+   memcpy(pcParent, pcPath, sLocation.ulParent);
+   pcParent[sLocation.ulParent] = '\0';
+
+   /* the common case: the parent already exists, so the insertion
+      only touches this shard */
+   psShard = &oShards->psShards[sLocation.ulShard];
+   (void) pthread_rwlock_wrlock(&psShard->oLock);
+   bHasParent = FT_containsDirIn(psShard->oFTree, pcParent);
+   if(bHasParent) {
+      if(bIsFile)
+         iStatus = FT_insertFileIn(psShard->oFTree, pcPath, pvContents,
+                                   ulLength);
+      else
+         iStatus = FT_insertDirIn(psShard->oFTree, pcPath);
+   }
+   (void) pthread_rwlock_unlock(&psShard->oLock);
+   if(bHasParent) {
+      free(pcParent);
+      return iStatus;
+   }
+
+   /* otherwise, the parent goes into every shard first; another
+      thread may have inserted it meanwhile, or a file may stand in
+      its place, which the insertion below reports */
+   FTShard_lockAll(oShards, TRUE);
+   iParentStatus = FTShard_insertEverywhere(oShards, pcParent,
+                                            sLocation.ulParent, FALSE,
+                                            NULL, 0, &ulNew);
+   if(iParentStatus != SUCCESS && iParentStatus != ALREADY_IN_TREE) {
+      FTShard_unlockAll(oShards);
+      free(pcParent);
+      return iParentStatus;
+   }
+   if(bIsFile)
+      iStatus = FT_insertFileIn(psShard->oFTree, pcPath, pvContents,
+                                ulLength);
+   else
+      iStatus = FT_insertDirIn(psShard->oFTree, pcPath);
+   if(iStatus != SUCCESS && iParentStatus == SUCCESS) {
+      pcParent[ulNew] = '\0';
+      (void) FTShard_removeEverywhere(oShards, pcParent, FALSE,
+                                      oShards->ulShards);
+   }
+   FTShard_unlockAll(oShards);
+   free(pcParent);
+   return iStatus;
+}
+
+/*
+  Removes the directory or, if bIsFile is TRUE, the file at pcPath
+  from oShards.
+*/
+static int FTShard_remove(FTShard_T oShards, const char *pcPath,
+                          boolean bIsFile) {
+   struct location sLocation;
+   struct shard *psShard;
+   int iStatus;
+
+   assert(oShards != NULL);
+   assert(pcPath != NULL);
+
+   iStatus = FTShard_locate(oShards, pcPath, &sLocation);
+   if(iStatus != SUCCESS)
+      return iStatus;
+
+   if(sLocation.ulShard == oShards->ulShards) {
+      FTShard_lockAll(oShards, TRUE);
+      iStatus = FTShard_removeEverywhere(oShards, pcPath, bIsFile,
+                                         oShards->ulShards);
+      FTShard_unlockAll(oShards);
+      return iStatus;
+   }
+
+   psShard = &oShards->psShards[sLocation.ulShard];
+   (void) pthread_rwlock_wrlock(&psShard->oLock);
+   if(bIsFile)
+      iStatus = FT_rmFileIn(psShard->oFTree, pcPath);
+   else
+      iStatus = FT_rmDirIn(psShard->oFTree, pcPath);
+   (void) pthread_rwlock_unlock(&psShard->oLock);
+   return iStatus;
+}
+
+/*
+  Returns the shard of oShards in which pcPath can be looked up, with
+  its lock taken shared, or NULL if pcPath is not a well-formatted
+  path. Paths above the sharding depth are looked up in shard 0.
+*/
+static struct shard *FTShard_beginLookup(FTShard_T oShards,
+                                         const char *pcPath) {
+   struct location sLocation;
+   struct shard *psShard;
+
+   assert(oShards != NULL);
+   assert(pcPath != NULL);
+
+   if(FTShard_locate(oShards, pcPath, &sLocation) != SUCCESS)
+      return NULL;
+   if(sLocation.ulShard == oShards->ulShards)
+      sLocation.ulShard = 0;
+   psShard = &oShards->psShards[sLocation.ulShard];
+   (void) pthread_rwlock_rdlock(&psShard->oLock);
+   return psShard;
+}
+
+/*--------------------------------------------------------------------*/
+
+FTShard_T FTShard_new(size_t ulShards, size_t ulDepth) {
+   FTShard_T oShards;
+   size_t i;
+
+   if(ulShards == 0 || ulDepth < 2)
+      return NULL;
+
+   oShards = malloc(sizeof(struct FTShard));
+   if(oShards == NULL)
+      return NULL;
+   oShards->psShards = calloc(ulShards, sizeof(struct shard));
+   if(oShards->psShards == NULL) {
+      free(oShards);
+      return NULL;
+   }
+   oShards->ulShards = ulShards;
+   oShards->ulDepth = ulDepth;
+
+   for(i = 0; i < ulShards; i++) {
+      oShards->psShards[i].oFTree = FT_new();
+      if(oShards->psShards[i].oFTree == NULL)
+         break;
+      if(pthread_rwlock_init(&oShards->psShards[i].oLock, NULL) != 0) {
+         FT_free(oShards->psShards[i].oFTree);
+         break;
+      }
+   }
+   if(i < ulShards) {
+      oShards->ulShards = i;
+      FTShard_free(oShards);
+      return NULL;
+   }
+   return oShards;
+}
+
+void FTShard_free(FTShard_T oShards) {
+   size_t i;
+
+   assert(oShards != NULL);
+
+   for(i = 0; i < oShards->ulShards; i++) {
+      FT_free(oShards->psShards[i].oFTree);
+      (void) pthread_rwlock_destroy(&oShards->psShards[i].oLock);
+   }
+   free(oShards->psShards);
+   free(oShards);
+}
+
+size_t FTShard_getShards(FTShard_T oShards) {
+   assert(oShards != NULL);
+
+   return oShards->ulShards;
+}
+
+int FTShard_insertDir(FTShard_T oShards, const char *pcPath) {
+   return FTShard_insert(oShards, pcPath, FALSE, NULL, 0);
+}
+
+boolean FTShard_containsDir(FTShard_T oShards, const char *pcPath) {
+   struct shard *psShard;
+   boolean bResult;
+
+   psShard = FTShard_beginLookup(oShards, pcPath);
+   if(psShard == NULL)
+      return FALSE;
+   bResult = FT_containsDirIn(psShard->oFTree, pcPath);
+   (void) pthread_rwlock_unlock(&psShard->oLock);
+   return bResult;
+}
+
+int FTShard_rmDir(FTShard_T oShards, const char *pcPath) {
+   return FTShard_remove(oShards, pcPath, FALSE);
+}
+
+int FTShard_insertFile(FTShard_T oShards, const char *pcPath,
+                       void *pvContents, size_t ulLength) {
+   return FTShard_insert(oShards, pcPath, TRUE, pvContents, ulLength);
+}
+
+boolean FTShard_containsFile(FTShard_T oShards, const char *pcPath) {
+   struct shard *psShard;
+   boolean bResult;
+
+   psShard = FTShard_beginLookup(oShards, pcPath);
+   if(psShard == NULL)
+      return FALSE;
+   bResult = FT_containsFileIn(psShard->oFTree, pcPath);
+   (void) pthread_rwlock_unlock(&psShard->oLock);
+   return bResult;
+}
+
+int FTShard_rmFile(FTShard_T oShards, const char *pcPath) {
+   return FTShard_remove(oShards, pcPath, TRUE);
+}
+
+void *FTShard_getFileContents(FTShard_T oShards, const char *pcPath) {
+   struct shard *psShard;
+   void *pvResult;
+
+   psShard = FTShard_beginLookup(oShards, pcPath);
+   if(psShard == NULL)
+      return NULL;
+   pvResult = FT_getFileContentsIn(psShard->oFTree, pcPath);
+   (void) pthread_rwlock_unlock(&psShard->oLock);
+   return pvResult;
+}
+
+void *FTShard_replaceFileContents(FTShard_T oShards,
+                                  const char *pcPath,
+                                  void *pvNewContents,
+                                  size_t ulNewLength) {
+   struct location sLocation;
+   struct shard *psShard;
+   void *pvResult = NULL;
+   void *pvShardResult;
+   size_t i;
+
+   assert(oShards != NULL);
+   assert(pcPath != NULL);
+
+   if(FTShard_locate(oShards, pcPath, &sLocation) != SUCCESS)
+      return NULL;
+
+   if(sLocation.ulShard == oShards->ulShards) {
+      FTShard_lockAll(oShards, TRUE);
+      for(i = 0; i < oShards->ulShards; i++) {
+         pvShardResult = FT_replaceFileContentsIn(
+            oShards->psShards[i].oFTree, pcPath, pvNewContents,
+            ulNewLength);
+         if(i == 0)
+            pvResult = pvShardResult;
+      }
+      FTShard_unlockAll(oShards);
+      return pvResult;
+   }
+
+   psShard = &oShards->psShards[sLocation.ulShard];
+   (void) pthread_rwlock_wrlock(&psShard->oLock);
+   pvResult = FT_replaceFileContentsIn(psShard->oFTree, pcPath,
+                                       pvNewContents, ulNewLength);
+   (void) pthread_rwlock_unlock(&psShard->oLock);
+   return pvResult;
+}
+
+int FTShard_stat(FTShard_T oShards, const char *pcPath,
+                 boolean *pbIsFile, size_t *pulSize) {
+   struct shard *psShard;
+   int iStatus;
+
+   psShard = FTShard_beginLookup(oShards, pcPath);
+   if(psShard == NULL)
+      return BAD_PATH;
+   iStatus = FT_statIn(psShard->oFTree, pcPath, pbIsFile, pulSize);
+   (void) pthread_rwlock_unlock(&psShard->oLock);
+   return iStatus;
+}
+
+/*--------------------------------------------------------------------*/
+
+/*
+  Returns TRUE if the line that starts at pcLine, which ends at a
+  newline or '\0', has more than ulDepth components.
+*/
+static boolean FTShard_isBelow(const char *pcLine, size_t ulDepth) {
+   size_t ulComponents = 1;
+
+   assert(pcLine != NULL);
+
+   for(; *pcLine != '\n' && *pcLine != '\0'; pcLine++)
+      if(*pcLine == '/' && ++ulComponents > ulDepth)
+         return TRUE;
+   return FALSE;
+}
+
+/*
+  Moves psCursor to the block that starts at pcNext in its string.
+  Returns SUCCESS, or MEMORY_ERROR if the type of the block's first
+  line could not be looked up.
+*/
+static int FTShard_advance(struct cursor *psCursor, char *pcNext,
+                           size_t ulDepth) {
+   char *pcLineEnd;
+   size_t ulSize;
+
+   assert(psCursor != NULL);
+   assert(pcNext != NULL);
+
+   if(*pcNext == '\0') {
+      psCursor->pcHead = NULL;
+      return SUCCESS;
+   }
+
+   pcLineEnd = strchr(pcNext, '\n');
+   assert(pcLineEnd != NULL);
+   *pcLineEnd = '\0';
+   psCursor->pcHead = pcNext;
+   psCursor->pcBlockEnd = pcLineEnd + 1;
+
+   /* the subtree of a line at the sharding depth comes with it */
+   if(FTShard_isBelow(pcNext, ulDepth - 1))
+      while(*psCursor->pcBlockEnd != '\0' &&
+            FTShard_isBelow(psCursor->pcBlockEnd, ulDepth))
+         psCursor->pcBlockEnd = strchr(psCursor->pcBlockEnd, '\n') + 1;
+
+   /* a line with lines below it is a directory; otherwise ask */
+   if(psCursor->pcBlockEnd != pcLineEnd + 1) {
+      psCursor->bIsFile = FALSE;
+      return SUCCESS;
+   }
+   return FT_statIn(psCursor->oFTree, pcNext, &psCursor->bIsFile,
+                    &ulSize) == MEMORY_ERROR ? MEMORY_ERROR : SUCCESS;
+}
+
+/*
+  Merges the strings of the ulShards shards that the cursors in
+  psCursors are at the start of into pcResult, which must have room
+  for all of them. Returns SUCCESS or MEMORY_ERROR.
+*/
+static int FTShard_merge(struct cursor *psCursors, size_t ulShards,
+                         size_t ulDepth, char *pcResult) {
+   struct cursor *psMin;
+   const char *pcRest;
+   size_t ulLength;
+   size_t i;
+
+   assert(psCursors != NULL);
+   assert(pcResult != NULL);
+
+   for(i = 0; i < ulShards; i++)
+      if(FTShard_advance(&psCursors[i], psCursors[i].pcString,
+                         ulDepth) != SUCCESS)
+         return MEMORY_ERROR;
+
+   for(;;) {
+      psMin = NULL;
+      for(i = 0; i < ulShards; i++)
+         if(psCursors[i].pcHead != NULL &&
+            (psMin == NULL ||
+             StrSort_comparePaths(psCursors[i].pcHead,
+                                  psCursors[i].bIsFile, psMin->pcHead,
+                                  psMin->bIsFile) < 0))
+            psMin = &psCursors[i];
+      if(psMin == NULL)
+         break;
+
+      /* a line above the sharding depth is in every shard, but goes
+         into the result once */
+      for(i = 0; i < ulShards; i++)
+         if(&psCursors[i] != psMin && psCursors[i].pcHead != NULL &&
+            strcmp(psCursors[i].pcHead, psMin->pcHead) == 0 &&
+            FTShard_advance(&psCursors[i], psCursors[i].pcBlockEnd,
+                            ulDepth) != SUCCESS)
+            return MEMORY_ERROR;
+
+      /* the first line lost its newline to FTShard_advance */
+      ulLength = strlen(psMin->pcHead);
+      memcpy(pcResult, psMin->pcHead, ulLength);
+      pcResult[ulLength] = '\n';
+      pcRest = psMin->pcHead + ulLength + 1;
+      pcResult += ulLength + 1;
+      ulLength = (size_t) (psMin->pcBlockEnd - pcRest);
+      memcpy(pcResult, pcRest, ulLength);
+      pcResult += ulLength;
+      if(FTShard_advance(psMin, psMin->pcBlockEnd, ulDepth) != SUCCESS)
+         return MEMORY_ERROR;
+   }
+   *pcResult = '\0';
+   return SUCCESS;
+}
+
+char *FTShard_toString(FTShard_T oShards) {
+   struct cursor *psCursors;
+   char *pcResult = NULL;
+   size_t ulTotal = 1;
+   size_t i;
+
+   assert(oShards != NULL);
+
+   psCursors = calloc(oShards->ulShards, sizeof(struct cursor));
+   if(psCursors == NULL)
+      return NULL;
+
+   FTShard_lockAll(oShards, FALSE);
+   for(i = 0; i < oShards->ulShards; i++) {
+      psCursors[i].oFTree = oShards->psShards[i].oFTree;
+      psCursors[i].pcString = FT_toStringIn(psCursors[i].oFTree);
+      if(psCursors[i].pcString == NULL)
+         break;
+      ulTotal += strlen(psCursors[i].pcString);
+   }
+   if(i == oShards->ulShards) {
+      pcResult = malloc(ulTotal);
+      if(pcResult != NULL &&
+         FTShard_merge(psCursors, oShards->ulShards, oShards->ulDepth,
+                       pcResult) != SUCCESS) {
+         free(pcResult);
+         pcResult = NULL;
+      }
+   }
+   FTShard_unlockAll(oShards);
+
+   for(i = 0; i < oShards->ulShards; i++)
+      free(psCursors[i].pcString);
+   free(psCursors);
+   return pcResult;
+}
@@ -0,0 +1,95 @@
+/*--------------------------------------------------------------------*/
+/* ftshard.h                                                          */
+/* Author: Ishaan Javali & Jack Zhang                                 */
+/*--------------------------------------------------------------------*/
+
+#ifndef FTSHARD_INCLUDED
+#define FTSHARD_INCLUDED
+
+#include <stddef.h>
+#include "a4def.h"
+#include "ft.h"
+
+/*
+  An FTShard_T is a File Tree whose namespace is split among a fixed
+  number of shards. Each shard is an independent FT_T with a lock of
+  its own. A path with at least as many components as the sharding
+  depth belongs to the shard chosen by a hash of its first
+  sharding-depth components, so a whole subtree rooted at that depth
+  lives in one shard. Threads working in different subtrees then
+  contend for different locks. Each shard holds a copy of the
+  directories and files above the sharding depth. A change to one of
+  them takes every shard's lock, and so does inserting a path whose
+  ancestors at the depth just above the sharding depth do not yet
+  exist. Other operations take the lock of a single shard, shared for
+  lookups and exclusive for changes.
+
+  Each FTShard_x function behaves as FT_xIn does on a single File
+  Tree holding the same directories and files, and, except for
+  FTShard_free, may be called from any number of threads at once.
+*/
+typedef struct FTShard *FTShard_T;
+
+/*
+  Returns a new, empty FTShard_T with ulShards shards and a sharding
+  depth of ulDepth components, or NULL if ulShards is 0, ulDepth is
+  less than 2, insufficient memory is available or a lock could not be
+  created. (With a depth of 1, every path would hash by the root
+  alone, so the shards could not tell that their roots conflict.)
+*/
+FTShard_T FTShard_new(size_t ulShards, size_t ulDepth);
+
+/* Destroys and frees all memory allocated for oShards. */
+void FTShard_free(FTShard_T oShards);
+
+/* Returns the number of shards of oShards. */
+size_t FTShard_getShards(FTShard_T oShards);
+
+/* Inserts a new directory, as FT_insertDirIn does. */
+int FTShard_insertDir(FTShard_T oShards, const char *pcPath);
+
+/* Returns whether oShards contains directory pcPath, as
+   FT_containsDirIn does. */
+boolean FTShard_containsDir(FTShard_T oShards, const char *pcPath);
+
+/* Removes a directory and its subtree, as FT_rmDirIn does. */
+int FTShard_rmDir(FTShard_T oShards, const char *pcPath);
+
+/* Inserts a new file, as FT_insertFileIn does. */
+int FTShard_insertFile(FTShard_T oShards, const char *pcPath,
+                       void *pvContents, size_t ulLength);
+
+/* Returns whether oShards contains file pcPath, as
+   FT_containsFileIn does. */
+boolean FTShard_containsFile(FTShard_T oShards, const char *pcPath);
+
+/* Removes a file, as FT_rmFileIn does. */
+int FTShard_rmFile(FTShard_T oShards, const char *pcPath);
+
+/* Returns the contents of file pcPath, as FT_getFileContentsIn
+   does. */
+void *FTShard_getFileContents(FTShard_T oShards, const char *pcPath);
+
+/* Replaces the contents of file pcPath, as FT_replaceFileContentsIn
+   does. */
+void *FTShard_replaceFileContents(FTShard_T oShards,
+                                  const char *pcPath,
+                                  void *pvNewContents,
+                                  size_t ulNewLength);
+
+/* Reports the type and size of pcPath, as FT_statIn does. */
+int FTShard_stat(FTShard_T oShards, const char *pcPath,
+                 boolean *pbIsFile, size_t *pulSize);
+
+/*
+  Returns the string representation of oShards, which is exactly the
+  string that FT_toStringIn returns for a single File Tree holding the
+  same directories and files, or NULL if there is an allocation error.
+  Holds every shard's lock, shared, while it works, so the result is a
+  consistent picture of the whole tree. Each shard's string is built
+  separately and the strings are merged in canonical order. Allocates
+  memory for the returned string, which is then owned by client!
+*/
+char *FTShard_toString(FTShard_T oShards);
+
+#endif
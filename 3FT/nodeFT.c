@@ -9,6 +9,8 @@
 #include <stdio.h>
 #include "path.h"
 #include "dynarray.h"
+#include "epoch.h"
+#include "threadpool.h"
 #include "nodeFT.h"
 
 
@@ -16,6 +18,9 @@
 struct node {
    /* the object corresponding to the node's absolute path */
    Path_T oPPath;
+   /* the string form of oPPath, kept here so that a search comparing
+      against it reaches it one pointer sooner */
+   const char *pcPath;
    /* this node's parent */
    Node_T oNParent;
    /* the object containing links to this node's children that are files */
@@ -28,30 +33,115 @@ struct node {
    boolean* isFile; 
    /* size of file contents in bytes*/
    size_t ulLength;
+   /* TRUE if the node belongs to a tree that is read without locks */
+   boolean bShared;
+   /* a counter that is odd while a writer holds the node's lock and
+      grows whenever a locked writer changes its children */
+   unsigned long ulVersion;
+   /* how the node has changed since its File Tree's last checkpoint,
+      as NODE_NEW, NODE_CHANGED and NODE_DIRTY bits */
+   unsigned int uiMarks;
+   /* the generation of its File Tree in which the node was made (see
+      Node_getGeneration) */
+   unsigned long ulGeneration;
+   /* one more than the index of the image record that the node's
+      subtree matches, or 0 (see Node_getRecord) */
+   size_t ulRecord;
+   /* TRUE if the node's children are still only in its image */
+   boolean bStub;
+   /* the stamp of the last traversal through the node */
+   unsigned long ulStamp;
 };
 
 
 /*
-  Links new child oNChild into oNParent's children array at index
-  ulIndex. Returns SUCCESS if the new child was added successfully,
-  or  MEMORY_ERROR if allocation fails adding oNChild to the array.
+  Returns in *poDCopy a copy of the children array oDChildren with
+  oNChild inserted at index ulIndex if oNChild is not NULL, or with
+  the element at index ulIndex removed otherwise. Returns SUCCESS, or
+  MEMORY_ERROR if allocation fails.
 */
-static int Node_addChild(Node_T oNParent, Node_T oNChild,
-                         boolean isFile, size_t ulIndex) {
+static int Node_copyChildren(DynArray_T oDChildren, Node_T oNChild,
+                             size_t ulIndex, DynArray_T *poDCopy) {
+   size_t ulLength;
+   size_t i, j;
+
+   assert(oDChildren != NULL);
+   assert(poDCopy != NULL);
+
+   ulLength = DynArray_getLength(oDChildren);
+   assert(ulIndex <= ulLength);
+   assert(oNChild != NULL || ulIndex < ulLength);
+
+   *poDCopy = DynArray_new(oNChild != NULL ? ulLength + 1
+                                           : ulLength - 1);
+   if(*poDCopy == NULL)
+      return MEMORY_ERROR;
+
+   j = 0;
+   for(i = 0; i <= ulLength; i++) {
+      if(i == ulIndex && oNChild != NULL)
+         (void) DynArray_set(*poDCopy, j++, oNChild);
+      if(i < ulLength && !(i == ulIndex && oNChild == NULL))
+         (void) DynArray_set(*poDCopy, j++, DynArray_get(oDChildren, i));
+   }
+   return SUCCESS;
+}
+
+/* Frees the children array pvDChildren; a callback for Epoch_retire. */
+static void Node_freeChildren(void *pvDChildren) {
+   DynArray_free(pvDChildren);
+}
+
+/*
+  Inserts oNChild at index ulIndex of oNParent's file children if
+  isFile and its directory children otherwise, or, if oNChild is NULL,
+  removes the child at index ulIndex instead. If oNParent is shared,
+  the change is made on a copy of the array, which then replaces the
+  original in one atomic store, so that readers without locks see
+  either the old children or the new ones; the original array is
+  retired. Returns SUCCESS, or MEMORY_ERROR if allocation fails.
+*/
+static int Node_updateChildren(Node_T oNParent, Node_T oNChild,
+                               boolean isFile, size_t ulIndex) {
+   DynArray_T *poDChildren;
+   DynArray_T oDCopy;
+   DynArray_T oDOld;
+   int iStatus;
+
    assert(oNParent != NULL);
-   assert(oNChild != NULL);
-   if(isFile){
-      if(DynArray_addAt(oNParent->fDChildren, ulIndex, oNChild))
+
+   poDChildren = isFile ? &oNParent->fDChildren : &oNParent->dDChildren;
+
+   if(!oNParent->bShared) {
+      if(oNChild == NULL) {
+         (void) DynArray_removeAt(*poDChildren, ulIndex);
          return SUCCESS;
-      else
-         return MEMORY_ERROR;
-   }else{
-      if(DynArray_addAt(oNParent->dDChildren, ulIndex, oNChild))
+      }
+      if(DynArray_addAt(*poDChildren, ulIndex, oNChild))
          return SUCCESS;
-      else
-         return MEMORY_ERROR;
+      return MEMORY_ERROR;
    }
-   
+
+   iStatus = Node_copyChildren(*poDChildren, oNChild, ulIndex, &oDCopy);
+   if(iStatus != SUCCESS)
+      return iStatus;
+   oDOld = __atomic_exchange_n(poDChildren, oDCopy, __ATOMIC_RELEASE);
+   Epoch_retire(oDOld, Node_freeChildren);
+   return SUCCESS;
+}
+
+/*
+  Loads oNParent's file children array if isFile, or its directory
+  children array otherwise. The array is never modified once a
+  shared node has published it, so the caller may search it without
+  a lock for as long as it stays in its read-side critical section.
+*/
+static DynArray_T Node_loadChildren(Node_T oNParent, boolean isFile) {
+   assert(oNParent != NULL);
+
+   if(isFile)
+      return __atomic_load_n(&oNParent->fDChildren, __ATOMIC_ACQUIRE);
+   return __atomic_load_n(&oNParent->dDChildren, __ATOMIC_ACQUIRE);
 }
 
 /*
@@ -65,10 +155,40 @@ static int Node_compareString(const Node_T oNFirst,
    assert(oNFirst != NULL);
    assert(pcSecond != NULL);
 
-   return Path_compareString(oNFirst->oPPath, pcSecond);
+   return strcmp(oNFirst->pcPath, pcSecond);
 }
 
-int Node_new(Path_T oPPath, Node_T oNParent, Node_T *poNResult, boolean isFile, void* value, size_t contentLength) {
+/* The stages of a struct Node_Search. */
+enum { SEARCH_START, SEARCH_PICK, SEARCH_LOAD, SEARCH_NAME,
+       SEARCH_COMPARE };
+
+/*
+  Compares oNFirst's path with the first ulLength characters of
+  pcSecond, as Node_compareString compares it with a whole string.
+*/
+static int Node_comparePrefix(const Node_T oNFirst, const char *pcSecond,
+                              size_t ulLength) {
+   int iResult;
+
+   assert(oNFirst != NULL);
+   assert(pcSecond != NULL);
+
+   iResult = strncmp(oNFirst->pcPath, pcSecond, ulLength);
+   if(iResult != 0)
+      return iResult;
+   return oNFirst->pcPath[ulLength] != '\0';
+}
+
+/*
+  Creates a new node with path oPPath and parent oNParent, as
+  Node_new does. If bAppend is TRUE, the new node is added after all
+  of oNParent's existing children of its type rather than at its
+  sorted position, which requires that oPPath sort after all of their
+  paths; see Node_append.
+*/
+static int Node_create(Path_T oPPath, Node_T oNParent,
+                       Node_T *poNResult, boolean isFile, void* value,
+                       size_t contentLength, boolean bAppend) {
    struct node *psNew;
    Path_T oPParentPath = NULL;
    Path_T oPNewPath = NULL;
@@ -95,6 +215,7 @@ int Node_new(Path_T oPPath, Node_T oNParent, Node_T *poNResult, boolean isFile,
       return iStatus;
    }
    psNew->oPPath = oPNewPath;
+   psNew->pcPath = Path_getPathname(oPNewPath);
 
    /* validate and set the new node's parent */
    if(oNParent != NULL) {
@@ -120,8 +241,23 @@ int Node_new(Path_T oPPath, Node_T oNParent, Node_T *poNResult, boolean isFile,
          return NO_SUCH_PATH;
       }
 
+      if(bAppend) {
+         /* new child must sort after every sibling of its type,
+            which also rules out an existing child with this path */
+         DynArray_T oDSiblings =
+            isFile ? oNParent->fDChildren : oNParent->dDChildren;
+         ulIndex = DynArray_getLength(oDSiblings);
+         if(ulIndex > 0 &&
+            Node_compareString(DynArray_get(oDSiblings, ulIndex - 1),
+                               Path_getPathname(oPPath)) >= 0) {
+            Path_free(psNew->oPPath);
+            free(psNew);
+            *poNResult = NULL;
+            return ALREADY_IN_TREE;
+         }
+      }
       /* parent must not already have child with this path */
-      if(Node_hasChild(oNParent, oPPath, isFile, &ulIndex)) {
+      else if(Node_hasChild(oNParent, oPPath, isFile, &ulIndex)) {
          Path_free(psNew->oPPath);
          free(psNew);
          *poNResult = NULL;
@@ -139,6 +275,16 @@ int Node_new(Path_T oPPath, Node_T oNParent, Node_T *poNResult, boolean isFile,
       }
    }
    psNew->oNParent = oNParent;
+   psNew->bShared = (oNParent != NULL) ? oNParent->bShared : FALSE;
+   /* a child of a locked node is born locked, so that no other writer
+      can add to it before its creator is done */
+   psNew->ulVersion = (oNParent != NULL) ?
+      (Node_getVersion(oNParent) & 1) : 0;
+   psNew->uiMarks = 0;
+   psNew->ulGeneration = 0;
+   psNew->ulRecord = 0;
+   psNew->bStub = FALSE;
+   psNew->ulStamp = 0;
 
 
    /* initialize the new node */
@@ -159,23 +305,18 @@ int Node_new(Path_T oPPath, Node_T oNParent, Node_T *poNResult, boolean isFile,
       return MEMORY_ERROR;
    }
 
-   /* Link into parent's children list */
-   if(oNParent != NULL) {
-      iStatus = Node_addChild(oNParent, psNew, isFile, ulIndex);
-      if(iStatus != SUCCESS) {
-         Path_free(psNew->oPPath);
-         DynArray_free(psNew->fDChildren);
-         DynArray_free(psNew->dDChildren);
-         free(psNew);
-         *poNResult = NULL;
-         return iStatus;
-      }
-   }
-    
     /* If node is a file, set value equal to parameter value, 
     and set file content length equal to the parameter contentLength,
     otherwise set value equal to NULL and ulLength to 0.*/
     psNew->isFile = malloc(sizeof(boolean));
+    if(psNew->isFile == NULL) {
+       DynArray_free(psNew->fDChildren);
+       DynArray_free(psNew->dDChildren);
+       Path_free(psNew->oPPath);
+       free(psNew);
+       *poNResult = NULL;
+       return MEMORY_ERROR;
+    }
     *(psNew->isFile) = isFile;
     if(isFile)
     {
@@ -187,20 +328,37 @@ int Node_new(Path_T oPPath, Node_T oNParent, Node_T *poNResult, boolean isFile,
         psNew->ulLength = 0;
         psNew->value = NULL;
     }
-   *poNResult = psNew;
 
+   /* Link into parent's children list */
+   if(oNParent != NULL) {
+      iStatus = Node_updateChildren(oNParent, psNew, isFile, ulIndex);
+      if(iStatus != SUCCESS) {
+         Path_free(psNew->oPPath);
+         DynArray_free(psNew->fDChildren);
+         DynArray_free(psNew->dDChildren);
+         free(psNew->isFile);
+         free(psNew);
+         *poNResult = NULL;
+         return iStatus;
+      }
+   }
 
+   *poNResult = psNew;
+   return SUCCESS;
+}
 
-   if(oNParent != NULL){
-      for(ulIndex = 0; ulIndex < DynArray_getLength(oNParent->fDChildren); ulIndex++){
-         Node_T temp;
-         Node_getChild(oNParent, ulIndex, TRUE, &temp);
-        
-      } 
+int Node_new(Path_T oPPath, Node_T oNParent, Node_T *poNResult,
+             boolean isFile, void *value, size_t contentLength) {
+   return Node_create(oPPath, oNParent, poNResult, isFile, value,
+                      contentLength, FALSE);
+}
 
-   }
-     
-   return SUCCESS;
+int Node_append(Path_T oPPath, Node_T oNParent, Node_T *poNResult,
+                boolean isFile, void *value, size_t contentLength) {
+   assert(oNParent != NULL);
+
+   return Node_create(oPPath, oNParent, poNResult, isFile, value,
+                      contentLength, TRUE);
 }
 
 boolean Node_isFile(Node_T oNNode){
@@ -209,60 +367,90 @@ boolean Node_isFile(Node_T oNNode){
 }
 size_t Node_getUlLength(Node_T oNNode){
    assert(oNNode != NULL);
-   return oNNode->ulLength;
+   return __atomic_load_n(&oNNode->ulLength, __ATOMIC_RELAXED);
 }
 void Node_setUlLength(Node_T oNNode, size_t ulLength){
    assert(oNNode != NULL);
-   oNNode->ulLength = ulLength;
+   __atomic_store_n(&oNNode->ulLength, ulLength, __ATOMIC_RELAXED);
 }
 void* Node_getValue(Node_T oNNode){
    assert(oNNode != NULL);
-   return oNNode->value;
+   return __atomic_load_n(&oNNode->value, __ATOMIC_ACQUIRE);
 }
 void Node_setValue(Node_T oNNode, void* value){
    assert(oNNode != NULL);
-   oNNode->value = value;
+   __atomic_store_n(&oNNode->value, value, __ATOMIC_RELEASE);
 }
 
+unsigned long Node_getVersion(Node_T oNNode) {
+   assert(oNNode != NULL);
 
-size_t Node_free(Node_T oNNode) {
-   size_t ulIndex;
-   size_t ulCount = 0;
+   return __atomic_load_n(&oNNode->ulVersion, __ATOMIC_ACQUIRE);
+}
 
+boolean Node_tryLock(Node_T oNNode, unsigned long ulVersion) {
    assert(oNNode != NULL);
-   /* remove this file from parent's list */
-   if(*(oNNode->isFile)){
-      if(oNNode->oNParent != NULL) {
-         if(DynArray_bsearch(
-               oNNode->oNParent->fDChildren,
-               oNNode, &ulIndex,
-               (int (*)(const void *, const void *)) Node_compare)
-         ){
-            (void) DynArray_removeAt(oNNode->oNParent->fDChildren,
-                                 ulIndex);
-         }
-      }
-   }else{
-      /* remove this directory from parent's list */
-      if(oNNode->oNParent != NULL) {
-         if(DynArray_bsearch(
-               oNNode->oNParent->dDChildren,
-               oNNode, &ulIndex,
-               (int (*)(const void *, const void *)) Node_compare)
-         )
-            (void) DynArray_removeAt(oNNode->oNParent->dDChildren,
-                                 ulIndex);
-      }
-      /* recursively remove directory children */
-      while(DynArray_getLength(oNNode->fDChildren) != 0) {
-         ulCount += Node_free(DynArray_removeAt(oNNode->fDChildren, 0));
-      }
-      /* recursively remove directory children */
-      while(DynArray_getLength(oNNode->dDChildren) != 0) {
-         ulCount += Node_free(DynArray_removeAt(oNNode->dDChildren, 0));
-      }
-   }
-   
+
+   if(ulVersion & 1)
+      return FALSE;
+   return (boolean) __atomic_compare_exchange_n(&oNNode->ulVersion,
+                                                &ulVersion,
+                                                ulVersion + 1, 0,
+                                                __ATOMIC_ACQUIRE,
+                                                __ATOMIC_RELAXED);
+}
+
+void Node_unlock(Node_T oNNode) {
+   unsigned long ulVersion;
+
+   assert(oNNode != NULL);
+
+   ulVersion = __atomic_load_n(&oNNode->ulVersion, __ATOMIC_RELAXED);
+   assert(ulVersion & 1);
+   __atomic_store_n(&oNNode->ulVersion, ulVersion + 1, __ATOMIC_RELEASE);
+}
+
+void Node_mark(Node_T oNNode, unsigned int uiMarks) {
+   Node_T oNCurr;
+
+   assert(oNNode != NULL);
+
+   (void) __atomic_fetch_or(&oNNode->uiMarks, uiMarks,
+                            __ATOMIC_RELAXED);
+   /* an ancestor that is already dirty has dirty ancestors too */
+   for(oNCurr = oNNode->oNParent; oNCurr != NULL;
+       oNCurr = oNCurr->oNParent)
+      if(__atomic_fetch_or(&oNCurr->uiMarks, NODE_DIRTY,
+                           __ATOMIC_RELAXED) & NODE_DIRTY)
+         break;
+}
+
+unsigned int Node_getMarks(Node_T oNNode) {
+   assert(oNNode != NULL);
+
+   return __atomic_load_n(&oNNode->uiMarks, __ATOMIC_RELAXED);
+}
+
+void Node_clearMarks(Node_T oNNode) {
+   assert(oNNode != NULL);
+
+   __atomic_store_n(&oNNode->uiMarks, 0, __ATOMIC_RELAXED);
+}
+
+void Node_setShared(Node_T oNRoot) {
+   assert(oNRoot != NULL);
+   assert(oNRoot->oNParent == NULL);
+   assert(DynArray_getLength(oNRoot->fDChildren) == 0);
+   assert(DynArray_getLength(oNRoot->dDChildren) == 0);
+
+   oNRoot->bShared = TRUE;
+}
+
+
+/* Frees oNNode itself, whose children have already been freed. */
+static void Node_release(Node_T oNNode) {
+   assert(oNNode != NULL);
+
    DynArray_free(oNNode->fDChildren);
    DynArray_free(oNNode->dDChildren);
 
@@ -272,10 +460,366 @@ size_t Node_free(Node_T oNNode) {
    /* finally, free the struct node */
    free(oNNode->isFile);
    free(oNNode);
+}
+
+/*
+  Frees the subtree rooted at oNNode without unlinking oNNode from
+  its parent, which may already have been freed. Returns the number
+  of nodes freed.
+*/
+static size_t Node_destroy(Node_T oNNode) {
+   size_t ulCount = 0;
+   size_t i;
+
+   assert(oNNode != NULL);
+
+   for(i = 0; i < DynArray_getLength(oNNode->fDChildren); i++)
+      ulCount += Node_destroy(DynArray_get(oNNode->fDChildren, i));
+   for(i = 0; i < DynArray_getLength(oNNode->dDChildren); i++)
+      ulCount += Node_destroy(DynArray_get(oNNode->dDChildren, i));
+
+   Node_release(oNNode);
    ulCount++;
    return ulCount;
 }
 
+/* Frees the subtree rooted at pvNode; a callback for Epoch_retire. */
+static void Node_reclaim(void *pvNode) {
+   (void) Node_destroy(pvNode);
+}
+
+/* One directory subtree that Node_destroyParallel frees as a task. */
+struct destroyJob {
+   /* the root of the subtree, and the pool that frees it */
+   Node_T oNNode;
+   ThreadPool_T oPool;
+   /* the task freeing the subtree, or NULL if it has already run */
+   ThreadPool_Task_T oTask;
+   /* the number of nodes freed */
+   size_t ulCount;
+};
+
+static size_t Node_destroyParallel(Node_T oNNode, ThreadPool_T oPool);
+
+/* Frees the subtree of the destroyJob pvJob; a ThreadPool task. */
+static void Node_destroyTask(void *pvJob) {
+   struct destroyJob *psJob = pvJob;
+
+   assert(psJob != NULL);
+
+   psJob->ulCount = Node_destroyParallel(psJob->oNNode, psJob->oPool);
+}
+
+/*
+  Node_destroy, except that the subtrees of oNNode's directory
+  children that have directories of their own are freed as tasks of
+  oPool, recursively, so that the threads of oPool free disjoint
+  parts of a large subtree at once. Returns once the whole subtree
+  has been freed, with the number of nodes freed.
+*/
+static size_t Node_destroyParallel(Node_T oNNode, ThreadPool_T oPool) {
+   struct destroyJob *psJobs;
+   Node_T oNChild;
+   size_t ulDirs;
+   size_t ulCount = 1;
+   size_t i;
+
+   assert(oNNode != NULL);
+   assert(oPool != NULL);
+
+   ulDirs = DynArray_getLength(oNNode->dDChildren);
+   if(ulDirs == 0)
+      return Node_destroy(oNNode);
+   psJobs = malloc(ulDirs * sizeof(struct destroyJob));
+   if(psJobs == NULL)
+      return Node_destroy(oNNode);
+
+   for(i = 0; i < ulDirs; i++) {
+      oNChild = DynArray_get(oNNode->dDChildren, i);
+      psJobs[i].oNNode = oNChild;
+      psJobs[i].oPool = oPool;
+      psJobs[i].oTask = NULL;
+      /* a directory of files alone is too little work for a task */
+      if(DynArray_getLength(oNChild->dDChildren) == 0)
+         psJobs[i].ulCount = Node_destroy(oNChild);
+      else
+         psJobs[i].oTask = ThreadPool_spawn(oPool, Node_destroyTask,
+                                            &psJobs[i]);
+   }
+   for(i = 0; i < DynArray_getLength(oNNode->fDChildren); i++)
+      ulCount += Node_destroy(DynArray_get(oNNode->fDChildren, i));
+   for(i = 0; i < ulDirs; i++) {
+      ThreadPool_join(oPool, psJobs[i].oTask);
+      ulCount += psJobs[i].ulCount;
+   }
+
+   free(psJobs);
+   Node_release(oNNode);
+   return ulCount;
+}
+
+size_t Node_countSubtree(Node_T oNNode) {
+   size_t ulCount = 1;
+   size_t i;
+
+   assert(oNNode != NULL);
+
+   for(i = 0; i < DynArray_getLength(oNNode->fDChildren); i++)
+      ulCount += Node_countSubtree(DynArray_get(oNNode->fDChildren, i));
+   for(i = 0; i < DynArray_getLength(oNNode->dDChildren); i++)
+      ulCount += Node_countSubtree(DynArray_get(oNNode->dDChildren, i));
+   return ulCount;
+}
+
+boolean Node_detach(Node_T oNNode) {
+   size_t ulIndex;
+   boolean bIsFile;
+
+   assert(oNNode != NULL);
+
+   /* remove this node from parent's list */
+   bIsFile = *(oNNode->isFile);
+   if(oNNode->oNParent != NULL &&
+      DynArray_bsearch(bIsFile ? oNNode->oNParent->fDChildren
+                               : oNNode->oNParent->dDChildren,
+                       oNNode, &ulIndex,
+                       (int (*)(const void *, const void *)) Node_compare)) {
+      /* only a shared parent can fail, by not getting a new array */
+      if(Node_updateChildren(oNNode->oNParent, NULL, bIsFile, ulIndex)
+         != SUCCESS)
+         return FALSE;
+   }
+   return TRUE;
+}
+
+size_t Node_freeDetached(Node_T oNNode, ThreadPool_T oPool) {
+   assert(oNNode != NULL);
+
+   if(oPool == NULL)
+      return Node_destroy(oNNode);
+   return Node_destroyParallel(oNNode, oPool);
+}
+
+size_t Node_free(Node_T oNNode) {
+   size_t ulCount;
+
+   assert(oNNode != NULL);
+
+   if(!Node_detach(oNNode))
+      return 0;
+
+   if(!oNNode->bShared)
+      return Node_destroy(oNNode);
+
+   /* readers may still be inside the subtree, so free it only once
+      they have all left */
+   ulCount = Node_countSubtree(oNNode);
+   Epoch_retire(oNNode, Node_reclaim);
+   return ulCount;
+}
+
+/* Frees the node pvNode alone; a callback for Epoch_retire. */
+static void Node_releaseRetired(void *pvNode) {
+   Node_release(pvNode);
+}
+
+unsigned long Node_getGeneration(Node_T oNNode) {
+   assert(oNNode != NULL);
+
+   return oNNode->ulGeneration;
+}
+
+void Node_setGeneration(Node_T oNNode, unsigned long ulGeneration) {
+   assert(oNNode != NULL);
+
+   oNNode->ulGeneration = ulGeneration;
+}
+
+int Node_copy(Node_T oNNode, Node_T oNParent, unsigned long ulGeneration,
+              Node_T *poNResult) {
+   struct node *psCopy;
+   Path_T oPCopyPath = NULL;
+   size_t i;
+   int iStatus;
+
+   assert(oNNode != NULL);
+   assert(poNResult != NULL);
+
+   *poNResult = NULL;
+   psCopy = malloc(sizeof(struct node));
+   if(psCopy == NULL)
+      return MEMORY_ERROR;
+   iStatus = Path_dup(oNNode->oPPath, &oPCopyPath);
+   if(iStatus != SUCCESS) {
+      free(psCopy);
+      return iStatus;
+   }
+   psCopy->isFile = malloc(sizeof(boolean));
+   psCopy->fDChildren =
+      DynArray_new(DynArray_getLength(oNNode->fDChildren));
+   psCopy->dDChildren =
+      DynArray_new(DynArray_getLength(oNNode->dDChildren));
+   if(psCopy->isFile == NULL || psCopy->fDChildren == NULL ||
+      psCopy->dDChildren == NULL) {
+      if(psCopy->fDChildren != NULL)
+         DynArray_free(psCopy->fDChildren);
+      if(psCopy->dDChildren != NULL)
+         DynArray_free(psCopy->dDChildren);
+      free(psCopy->isFile);
+      Path_free(oPCopyPath);
+      free(psCopy);
+      return MEMORY_ERROR;
+   }
+
+   psCopy->oPPath = oPCopyPath;
+   psCopy->pcPath = Path_getPathname(oPCopyPath);
+   psCopy->oNParent = oNParent;
+   *(psCopy->isFile) = *(oNNode->isFile);
+   psCopy->value = oNNode->value;
+   psCopy->ulLength = oNNode->ulLength;
+   psCopy->bShared = oNNode->bShared;
+   psCopy->ulVersion = 0;
+   psCopy->uiMarks = Node_getMarks(oNNode);
+   psCopy->ulGeneration = ulGeneration;
+   psCopy->ulRecord = oNNode->ulRecord;
+   psCopy->bStub = oNNode->bStub;
+   psCopy->ulStamp = oNNode->ulStamp;
+   for(i = 0; i < DynArray_getLength(oNNode->fDChildren); i++)
+      (void) DynArray_set(psCopy->fDChildren, i,
+                          DynArray_get(oNNode->fDChildren, i));
+   for(i = 0; i < DynArray_getLength(oNNode->dDChildren); i++)
+      (void) DynArray_set(psCopy->dDChildren, i,
+                          DynArray_get(oNNode->dDChildren, i));
+
+   *poNResult = psCopy;
+   return SUCCESS;
+}
+
+void Node_adoptChildren(Node_T oNNode) {
+   size_t i;
+
+   assert(oNNode != NULL);
+
+   /* only the newest version of a tree looks upwards (see
+      nodeFT.h), so children shared with older versions may point at
+      the newest parent */
+   for(i = 0; i < DynArray_getLength(oNNode->fDChildren); i++)
+      ((Node_T) DynArray_get(oNNode->fDChildren, i))->oNParent = oNNode;
+   for(i = 0; i < DynArray_getLength(oNNode->dDChildren); i++)
+      ((Node_T) DynArray_get(oNNode->dDChildren, i))->oNParent = oNNode;
+}
+
+int Node_replaceChild(Node_T oNParent, Node_T oNOld, Node_T oNNew) {
+   DynArray_T *poDChildren;
+   DynArray_T oDCopy;
+   DynArray_T oDOld;
+   size_t ulIndex;
+   size_t i;
+
+   assert(oNParent != NULL);
+   assert(oNOld != NULL);
+   assert(oNNew != NULL);
+   assert(*(oNOld->isFile) == *(oNNew->isFile));
+
+   poDChildren = *(oNOld->isFile) ? &oNParent->fDChildren
+                                  : &oNParent->dDChildren;
+   if(!DynArray_bsearch(*poDChildren, oNOld, &ulIndex,
+                        (int (*)(const void *, const void *)) Node_compare))
+      return NO_SUCH_PATH;
+
+   if(!oNParent->bShared) {
+      (void) DynArray_set(*poDChildren, ulIndex, oNNew);
+      return SUCCESS;
+   }
+
+   /* as in Node_updateChildren, readers see the old array or the new */
+   oDCopy = DynArray_new(DynArray_getLength(*poDChildren));
+   if(oDCopy == NULL)
+      return MEMORY_ERROR;
+   for(i = 0; i < DynArray_getLength(*poDChildren); i++)
+      (void) DynArray_set(oDCopy, i, i == ulIndex ? oNNew :
+                          DynArray_get(*poDChildren, i));
+   oDOld = __atomic_exchange_n(poDChildren, oDCopy, __ATOMIC_RELEASE);
+   Epoch_retire(oDOld, Node_freeChildren);
+   return SUCCESS;
+}
+
+void Node_freeRetired(Node_T oNNode, boolean bSubtree) {
+   assert(oNNode != NULL);
+
+   if(!oNNode->bShared) {
+      if(bSubtree)
+         (void) Node_destroy(oNNode);
+      else
+         Node_release(oNNode);
+   }
+   else
+      Epoch_retire(oNNode, bSubtree ? Node_reclaim : Node_releaseRetired);
+}
+
+size_t Node_getRecord(Node_T oNNode) {
+   assert(oNNode != NULL);
+
+   return oNNode->ulRecord;
+}
+
+void Node_setRecord(Node_T oNNode, size_t ulRecord) {
+   assert(oNNode != NULL);
+
+   oNNode->ulRecord = ulRecord;
+}
+
+void Node_clearRecord(Node_T oNNode) {
+   Node_T oNCurr;
+
+   assert(oNNode != NULL);
+
+   /* an ancestor that has no record has none above it either */
+   for(oNCurr = oNNode; oNCurr != NULL && oNCurr->ulRecord != 0;
+       oNCurr = oNCurr->oNParent)
+      oNCurr->ulRecord = 0;
+}
+
+boolean Node_isStub(Node_T oNNode) {
+   assert(oNNode != NULL);
+
+   return oNNode->bStub;
+}
+
+void Node_setStub(Node_T oNNode, boolean bStub) {
+   assert(oNNode != NULL);
+
+   oNNode->bStub = bStub;
+}
+
+unsigned long Node_getStamp(Node_T oNNode) {
+   assert(oNNode != NULL);
+
+   return oNNode->ulStamp;
+}
+
+void Node_setStamp(Node_T oNNode, unsigned long ulStamp) {
+   assert(oNNode != NULL);
+
+   oNNode->ulStamp = ulStamp;
+}
+
+size_t Node_evict(Node_T oNNode) {
+   size_t ulCount = 0;
+
+   assert(oNNode != NULL);
+   assert(!oNNode->bShared);
+
+   while(DynArray_getLength(oNNode->fDChildren) > 0)
+      ulCount += Node_destroy(DynArray_removeAt(oNNode->fDChildren,
+                     DynArray_getLength(oNNode->fDChildren) - 1));
+   while(DynArray_getLength(oNNode->dDChildren) > 0)
+      ulCount += Node_destroy(DynArray_removeAt(oNNode->dDChildren,
+                     DynArray_getLength(oNNode->dDChildren) - 1));
+   oNNode->bStub = TRUE;
+   return ulCount;
+}
+
 Path_T Node_getPath(Node_T oNNode) {
    assert(oNNode != NULL);
 
@@ -289,14 +833,102 @@ boolean Node_hasChild(Node_T oNParent, Path_T oPPath, boolean isFile,
    assert(pulChildID != NULL);
 
    /* *pulChildID is the index into oNParent->oDChildren */
-   if(isFile){
-      return DynArray_bsearch(oNParent->fDChildren,
+   return DynArray_bsearch(Node_loadChildren(oNParent, isFile),
                (char*) Path_getPathname(oPPath), pulChildID,
                (int (*)(const void*,const void*)) Node_compareString);
+}
+
+boolean Node_findChild(Node_T oNParent, Path_T oPPath, boolean isFile,
+                       Node_T *poNResult) {
+   DynArray_T oDChildren;
+   size_t ulChildID;
+
+   assert(oNParent != NULL);
+   assert(oPPath != NULL);
+   assert(poNResult != NULL);
+
+   oDChildren = Node_loadChildren(oNParent, isFile);
+   if(!DynArray_bsearch(oDChildren, (char*) Path_getPathname(oPPath),
+               &ulChildID,
+               (int (*)(const void*,const void*)) Node_compareString)) {
+      *poNResult = NULL;
+      return FALSE;
    }
-   return DynArray_bsearch(oNParent->dDChildren,
-               (char*) Path_getPathname(oPPath), pulChildID,
-               (int (*)(const void*,const void*)) Node_compareString);
+   *poNResult = DynArray_get(oDChildren, ulChildID);
+   return TRUE;
+}
+
+void Node_prefetch(Node_T oNNode) {
+   assert(oNNode != NULL);
+
+   __builtin_prefetch(oNNode, 0, 3);
+}
+
+void Node_searchBegin(struct Node_Search *psSearch, Node_T oNParent,
+                      boolean isFile, const char *pcPath,
+                      size_t ulLength) {
+   assert(psSearch != NULL);
+   assert(oNParent != NULL);
+   assert(pcPath != NULL);
+
+   psSearch->oDChildren = Node_loadChildren(oNParent, isFile);
+   psSearch->pcPath = pcPath;
+   psSearch->ulLength = ulLength;
+   psSearch->oNProbe = NULL;
+   psSearch->iStage = SEARCH_START;
+   __builtin_prefetch(psSearch->oDChildren, 0, 3);
+}
+
+boolean Node_searchStep(struct Node_Search *psSearch,
+                        Node_T *poNResult) {
+   int iCompare;
+
+   assert(psSearch != NULL);
+   assert(poNResult != NULL);
+
+   /* each stage but the last starts a load for the next one */
+   switch(psSearch->iStage) {
+      case SEARCH_START:
+         psSearch->ulLo = 0;
+         psSearch->ulHi = DynArray_getLength(psSearch->oDChildren);
+         break;
+      case SEARCH_LOAD:
+         psSearch->oNProbe = DynArray_get(psSearch->oDChildren,
+                                          psSearch->ulMid);
+         __builtin_prefetch(psSearch->oNProbe, 0, 3);
+         psSearch->iStage = SEARCH_NAME;
+         return FALSE;
+      case SEARCH_NAME:
+         __builtin_prefetch(psSearch->oNProbe->pcPath, 0, 3);
+         psSearch->iStage = SEARCH_COMPARE;
+         return FALSE;
+      case SEARCH_COMPARE:
+         iCompare = Node_comparePrefix(psSearch->oNProbe,
+                                       psSearch->pcPath,
+                                       psSearch->ulLength);
+         if(iCompare == 0) {
+            *poNResult = psSearch->oNProbe;
+            return TRUE;
+         }
+         if(iCompare < 0)
+            psSearch->ulLo = psSearch->ulMid + 1;
+         else
+            psSearch->ulHi = psSearch->ulMid;
+         break;
+      default:
+         assert(psSearch->iStage == SEARCH_PICK);
+   }
+
+   /* SEARCH_PICK: probe the middle of what is left */
+   if(psSearch->ulLo >= psSearch->ulHi) {
+      *poNResult = NULL;
+      return TRUE;
+   }
+   psSearch->ulMid = psSearch->ulLo +
+                     (psSearch->ulHi - psSearch->ulLo) / 2;
+   DynArray_prefetchElement(psSearch->oDChildren, psSearch->ulMid);
+   psSearch->iStage = SEARCH_LOAD;
+   return FALSE;
 }
 
 void Node_setFile(Node_T oNNode, boolean value);
@@ -304,41 +936,29 @@ void Node_setFile(Node_T oNNode, boolean value);
 size_t Node_getNumFileChildren(Node_T oNParent) {
    assert(oNParent != NULL);
 
-   return DynArray_getLength(oNParent->fDChildren);
+   return DynArray_getLength(Node_loadChildren(oNParent, TRUE));
 }
 size_t Node_getNumDirChildren(Node_T oNParent) {
    assert(oNParent != NULL);
 
-   return DynArray_getLength(oNParent->dDChildren);
+   return DynArray_getLength(Node_loadChildren(oNParent, FALSE));
 }
 
 int Node_getChild(Node_T oNParent, size_t ulChildID, boolean isFile,
                    Node_T *poNResult) {
+   DynArray_T oDChildren;
 
    assert(oNParent != NULL);
    assert(poNResult != NULL);
-   if(isFile){
-      /* ulChildID is the index into oNParent->oDChildren */
-      if(ulChildID >= Node_getNumFileChildren(oNParent)) {
-         *poNResult = NULL;
-         return NO_SUCH_PATH;
-      }
-      else {
-         *poNResult = DynArray_get(oNParent->fDChildren, ulChildID);
-         return SUCCESS;
-      }
-   }else{
-      /* ulChildID is the index into oNParent->oDChildren */
-      if(ulChildID >= Node_getNumDirChildren(oNParent)) {
-         *poNResult = NULL;
-         return NO_SUCH_PATH;
-      }
-      else {
-         *poNResult = DynArray_get(oNParent->dDChildren, ulChildID);
-         return SUCCESS;
-      }
+
+   /* ulChildID is the index into oNParent's children of type isFile */
+   oDChildren = Node_loadChildren(oNParent, isFile);
+   if(ulChildID >= DynArray_getLength(oDChildren)) {
+      *poNResult = NULL;
+      return NO_SUCH_PATH;
    }
-   return NO_SUCH_PATH;
+   *poNResult = DynArray_get(oDChildren, ulChildID);
+   return SUCCESS;
 }
 
 Node_T Node_getParent(Node_T oNNode) {
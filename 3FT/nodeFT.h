@@ -9,6 +9,8 @@
 #include <stddef.h>
 #include "a4def.h"
 #include "path.h"
+#include "dynarray.h"
+#include "threadpool.h"
 
 
 /* A Node_T is a node in a Directory Tree */
@@ -31,13 +33,178 @@ typedef struct node *Node_T;
 */
 int Node_new(Path_T oPPath, Node_T oNParent, Node_T *poNResult, boolean isFile, void* value, size_t ulLength);
 
+/*
+  Creates a new node exactly as Node_new does, except that the new
+  node is added after all of oNParent's existing children of the same
+  type (file or directory) instead of at its sorted position. This
+  takes O(1) time rather than a binary search and a shift, but
+  requires that oPPath sort after the paths of all those children.
+  oNParent must not be NULL. Returns SUCCESS or any status that
+  Node_new returns, except that ALREADY_IN_TREE is returned if
+  oPPath does not sort after every existing child of its type.
+*/
+int Node_append(Path_T oPPath, Node_T oNParent, Node_T *poNResult,
+                boolean isFile, void *value, size_t ulLength);
+
 /*
   Destroys and frees all memory allocated for the subtree rooted at
   oNNode, i.e., deletes this node and all its descendents. Returns the
-  number of nodes deleted.
+  number of nodes deleted. If oNNode is shared (see Node_setShared),
+  it is unlinked from its parent at once, but the subtree is only
+  freed once no reader can still be inside it; if memory for the
+  parent's new children array could not be allocated, the tree is
+  left unchanged and 0 is returned.
 */
 size_t Node_free(Node_T oNNode);
 
+/*
+  Unlinks oNNode from its parent, if it has one, without freeing
+  anything, and returns TRUE; the subtree rooted at oNNode is then
+  reachable only through oNNode. The time taken does not depend on
+  the size of the subtree. If oNNode is shared and memory for the
+  parent's new children array could not be allocated, leaves the
+  tree unchanged and returns FALSE.
+*/
+boolean Node_detach(Node_T oNNode);
+
+/*
+  Frees the subtree rooted at oNNode, which must have been unlinked
+  with Node_detach (or be a root) and which no reader may still be
+  inside. Returns the number of nodes freed. If oPool is not NULL,
+  large directory subtrees are freed as tasks of oPool, in parallel,
+  and the function returns once all of them have been freed.
+*/
+size_t Node_freeDetached(Node_T oNNode, ThreadPool_T oPool);
+
+/*
+  Marks oNRoot, which must be a root without children, as the root of
+  a tree that threads read without locks, inside Epoch_enter and
+  Epoch_exit, while a single writer at a time changes it. The nodes
+  later created below oNRoot are marked too. A change to the children
+  of a marked node is made on a copy of the children array, which is
+  published with one atomic store; the replaced array, and any
+  subtree that Node_free removes, is freed with Epoch_retire.
+*/
+void Node_setShared(Node_T oNRoot);
+
+/*
+  The marks with which a File Tree records how its nodes have changed
+  since its last checkpoint: NODE_NEW for a node created since then,
+  NODE_CHANGED for a file whose contents were replaced, and
+  NODE_DIRTY for a node with a marked node somewhere below it.
+*/
+enum { NODE_NEW = 1, NODE_CHANGED = 2, NODE_DIRTY = 4 };
+
+/*
+  Adds uiMarks to oNNode's marks, and NODE_DIRTY to those of each of
+  its ancestors, so that every marked node can be found by descending
+  from the root through dirty nodes only. Threads may mark nodes of a
+  shared tree at once.
+*/
+void Node_mark(Node_T oNNode, unsigned int uiMarks);
+
+/* Returns oNNode's marks. */
+unsigned int Node_getMarks(Node_T oNNode);
+
+/* Clears oNNode's marks, but not those of its descendants. */
+void Node_clearMarks(Node_T oNNode);
+
+/*
+  Returns the generation of oNNode, which a File Tree that keeps
+  snapshots sets when it makes the node: a node older than the tree's
+  current generation may be seen by a snapshot, so it must not change
+  and is copied instead (see Node_copy). A new node's generation is 0.
+*/
+unsigned long Node_getGeneration(Node_T oNNode);
+
+/* Sets the generation of oNNode to ulGeneration. */
+void Node_setGeneration(Node_T oNNode, unsigned long ulGeneration);
+
+/*
+  Returns an int SUCCESS status and sets *poNResult to a new node of
+  generation ulGeneration with oNNode's path, type, contents, marks,
+  record, stamp and children, whose parent is oNParent. oNNode is
+  unchanged, and its children still name it as their parent; the
+  caller puts the copy in its place (see Node_replaceChild) and then
+  hands it the children with Node_adoptChildren. Otherwise, sets
+  *poNResult to NULL and returns MEMORY_ERROR.
+*/
+int Node_copy(Node_T oNNode, Node_T oNParent, unsigned long ulGeneration,
+              Node_T *poNResult);
+
+/*
+  Makes oNNode the parent of each of its children, which may be
+  shared with the node that oNNode is a copy of. A child shared with
+  older versions of a tree then names only the newest version's node
+  as its parent, so only the newest version may look upwards, with
+  Node_getParent, Node_mark or Node_clearRecord: a snapshot must
+  reach its nodes only by descending from its own root.
+*/
+void Node_adoptChildren(Node_T oNNode);
+
+/*
+  Replaces oNParent's child oNOld with oNNew, which has the same path
+  and type. A shared parent's children array is replaced in one
+  atomic store, as when a child is inserted. Returns SUCCESS, or
+  NO_SUCH_PATH if oNOld is not a child of oNParent, or MEMORY_ERROR
+  if a shared parent's new children array could not be allocated.
+*/
+int Node_replaceChild(Node_T oNParent, Node_T oNOld, Node_T oNNew);
+
+/*
+  Frees oNNode, which is no longer reachable from its File Tree:
+  together with its subtree if bSubtree, or else alone, as a node that
+  a copy has replaced and whose children live on. A shared node is
+  freed through Epoch_retire.
+*/
+void Node_freeRetired(Node_T oNNode, boolean bSubtree);
+
+/* Returns the number of nodes in the subtree rooted at oNNode. */
+size_t Node_countSubtree(Node_T oNNode);
+
+/*
+  Returns the record of oNNode, which a File Tree that loads its
+  directories on demand from an image (see ftimage.h) sets when it
+  loads the node: one more than the index of the image's node whose
+  subtree oNNode's subtree still matches, or 0 if oNNode did not come
+  from an image or its subtree has changed since. A new node's record
+  is 0.
+*/
+size_t Node_getRecord(Node_T oNNode);
+
+/* Sets the record of oNNode to ulRecord. */
+void Node_setRecord(Node_T oNNode, size_t ulRecord);
+
+/*
+  Sets the records of oNNode and of each of its ancestors to 0, as
+  their subtrees no longer match the image they were loaded from.
+*/
+void Node_clearRecord(Node_T oNNode);
+
+/*
+  Returns TRUE if oNNode is a stub: a directory whose children have
+  not yet been loaded from its image record. A new node is not a stub.
+*/
+boolean Node_isStub(Node_T oNNode);
+
+/* Sets whether oNNode is a stub. */
+void Node_setStub(Node_T oNNode, boolean bStub);
+
+/*
+  Returns the stamp of oNNode, with which a File Tree tells nodes it
+  used recently from cold ones. A new node's stamp is 0.
+*/
+unsigned long Node_getStamp(Node_T oNNode);
+
+/* Sets the stamp of oNNode to ulStamp. */
+void Node_setStamp(Node_T oNNode, unsigned long ulStamp);
+
+/*
+  Frees the subtrees of oNNode's children, which must not be shared,
+  and makes oNNode a stub again. Returns the number of nodes freed.
+*/
+size_t Node_evict(Node_T oNNode);
+
 /* Returns the path object representing oNNode's absolute path. */
 Path_T Node_getPath(Node_T oNNode);
 
@@ -53,6 +220,84 @@ Path_T Node_getPath(Node_T oNNode);
 boolean Node_hasChild(Node_T oNParent, Path_T oPPath, boolean isFile,
                          size_t *pulChildID);
 
+/*
+  Returns oNNode's version, a counter that is odd while a writer holds
+  oNNode's lock and that changes whenever a writer holding the lock
+  changes oNNode's children. A writer that reads the version before
+  searching oNNode's children can later lock oNNode with Node_tryLock
+  only if those children have not changed in the meantime. A node
+  created below a locked node starts out locked as well, by the
+  writer that holds its parent's lock.
+*/
+unsigned long Node_getVersion(Node_T oNNode);
+
+/*
+  Locks oNNode and returns TRUE if its version is still ulVersion,
+  which must be even. Returns FALSE if ulVersion is odd, or if oNNode
+  has been locked or changed since ulVersion was read.
+*/
+boolean Node_tryLock(Node_T oNNode, unsigned long ulVersion);
+
+/* Unlocks oNNode, which the caller must have locked. */
+void Node_unlock(Node_T oNNode);
+
+/*
+  Returns TRUE and sets *poNResult to oNParent's child with path oPPath
+  if there is one, or returns FALSE and sets *poNResult to NULL
+  otherwise. isFile is used as in Node_hasChild. Unlike calling
+  Node_hasChild and then Node_getChild, this searches a single version
+  of the children array, so readers of a shared tree (see
+  Node_setShared) can use it while the array is being replaced.
+*/
+boolean Node_findChild(Node_T oNParent, Path_T oPPath, boolean isFile,
+                       Node_T *poNResult);
+
+/*
+  Starts loading oNNode into the cache without waiting for it, so that
+  a caller that has other work to do can come back to oNNode once it
+  has arrived.
+*/
+void Node_prefetch(Node_T oNNode);
+
+/*
+  A search of a node's children for the child with a given path that
+  advances in small steps (see Node_searchStep). Its fields are
+  private to the node module.
+*/
+struct Node_Search {
+   DynArray_T oDChildren;
+   const char *pcPath;
+   size_t ulLength;
+   size_t ulLo;
+   size_t ulMid;
+   size_t ulHi;
+   Node_T oNProbe;
+   int iStage;
+};
+
+/*
+  Starts psSearch, a search of oNParent's file children if isFile and
+  its directory children otherwise for the child whose path is the
+  first ulLength characters of pcPath, which need not be terminated
+  there. oNParent should already be in the cache (see Node_prefetch).
+  Like Node_findChild, the search sees a single version of the
+  children array, and it allocates nothing.
+*/
+void Node_searchBegin(struct Node_Search *psSearch, Node_T oNParent,
+                      boolean isFile, const char *pcPath,
+                      size_t ulLength);
+
+/*
+  Advances psSearch by one step, which does little more than start
+  loading what the next step reads, so that a caller can advance
+  several searches in turn while their loads are in flight. Returns
+  FALSE if the search needs more steps. Otherwise returns TRUE and
+  sets *poNResult to the child sought, or to NULL if there is none.
+  pcPath must not change until the search is done.
+*/
+boolean Node_searchStep(struct Node_Search *psSearch,
+                        Node_T *poNResult);
+
 /*
   Returns TRUE if oNNode is a file, FALSE if it is a directory
 */
@@ -103,6 +348,8 @@ int Node_getChild(Node_T oNParent, size_t ulChildID, boolean isFile,
 /*
   Returns a the parent node of oNNode.
   Returns NULL if oNNode is the root and thus has no parent.
+  For a node shared with older versions of a tree, this is the parent
+  in the newest version (see Node_adoptChildren).
 */
 Node_T Node_getParent(Node_T oNNode);
 
@@ -0,0 +1 @@
+../0shared/strsort.c
\ No newline at end of file
@@ -0,0 +1 @@
+../0shared/strsort.h
\ No newline at end of file
@@ -0,0 +1 @@
+../0shared/threadpool.c
\ No newline at end of file
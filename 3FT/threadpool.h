@@ -0,0 +1 @@
+../0shared/threadpool.h
\ No newline at end of file